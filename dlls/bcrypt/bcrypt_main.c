@@ -49,6 +49,10 @@ WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 static void *libgnutls_handle;
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f
+MAKE_FUNCPTR(gnutls_cipher_decrypt2);
+MAKE_FUNCPTR(gnutls_cipher_deinit);
+MAKE_FUNCPTR(gnutls_cipher_encrypt2);
+MAKE_FUNCPTR(gnutls_cipher_init);
 MAKE_FUNCPTR(gnutls_global_deinit);
 MAKE_FUNCPTR(gnutls_global_init);
 MAKE_FUNCPTR(gnutls_global_set_log_function);
@@ -62,6 +66,27 @@ MAKE_FUNCPTR(gnutls_hmac_init);
 MAKE_FUNCPTR(gnutls_perror);
 #undef MAKE_FUNCPTR
 
+/* Not present in gnutls version < 3.0. */
+static void (*pgnutls_cipher_set_iv)(gnutls_cipher_hd_t handle, void *iv, size_t iv_size);
+static int (*pgnutls_cipher_add_auth)(gnutls_cipher_hd_t handle, const void *data, size_t data_size);
+static int (*pgnutls_cipher_tag)(gnutls_cipher_hd_t handle, void *tag, size_t tag_size);
+
+#if GNUTLS_VERSION_MAJOR < 3
+#define GNUTLS_CIPHER_AES_192_CBC 92
+#define GNUTLS_CIPHER_AES_128_GCM 93
+#define GNUTLS_CIPHER_AES_256_GCM 94
+#endif
+
+static int compat_gnutls_cipher_add_auth( gnutls_cipher_hd_t handle, const void *data, size_t data_size )
+{
+    return GNUTLS_E_UNKNOWN_CIPHER_TYPE;
+}
+
+static int compat_gnutls_cipher_tag( gnutls_cipher_hd_t handle, void *tag, size_t tag_size )
+{
+    return GNUTLS_E_UNKNOWN_CIPHER_TYPE;
+}
+
 static void gnutls_log( int level, const char *msg )
 {
     TRACE( "<%d> %s", level, msg );
@@ -84,6 +109,10 @@ static BOOL gnutls_initialize(void)
         goto fail; \
     }
 
+    LOAD_FUNCPTR(gnutls_cipher_decrypt2)
+    LOAD_FUNCPTR(gnutls_cipher_deinit)
+    LOAD_FUNCPTR(gnutls_cipher_encrypt2)
+    LOAD_FUNCPTR(gnutls_cipher_init)
     LOAD_FUNCPTR(gnutls_global_deinit)
     LOAD_FUNCPTR(gnutls_global_init)
     LOAD_FUNCPTR(gnutls_global_set_log_function)
@@ -97,6 +126,19 @@ static BOOL gnutls_initialize(void)
     LOAD_FUNCPTR(gnutls_perror)
 #undef LOAD_FUNCPTR
 
+    if (!(pgnutls_cipher_set_iv = wine_dlsym( libgnutls_handle, "gnutls_cipher_set_iv", NULL, 0 )))
+        WARN( "gnutls_cipher_set_iv not found\n" );
+    if (!(pgnutls_cipher_add_auth = wine_dlsym( libgnutls_handle, "gnutls_cipher_add_auth", NULL, 0 )))
+    {
+        WARN( "gnutls_cipher_add_auth not found\n" );
+        pgnutls_cipher_add_auth = compat_gnutls_cipher_add_auth;
+    }
+    if (!(pgnutls_cipher_tag = wine_dlsym( libgnutls_handle, "gnutls_cipher_tag", NULL, 0 )))
+    {
+        WARN( "gnutls_cipher_tag not found\n" );
+        pgnutls_cipher_tag = compat_gnutls_cipher_tag;
+    }
+
     if ((ret = pgnutls_global_init()) != GNUTLS_E_SUCCESS)
     {
         pgnutls_perror( ret );
@@ -138,6 +180,7 @@ NTSTATUS WINAPI BCryptEnumAlgorithms(ULONG dwAlgOperations, ULONG *pAlgCount,
 
 #define MAGIC_ALG  (('A' << 24) | ('L' << 16) | ('G' << 8) | '0')
 #define MAGIC_HASH (('H' << 24) | ('A' << 16) | ('S' << 8) | 'H')
+#define MAGIC_KEY  (('K' << 24) | ('E' << 16) | ('Y' << 8) | '0')
 struct object
 {
     ULONG magic;
@@ -145,6 +188,7 @@ struct object
 
 enum alg_id
 {
+    ALG_ID_AES,
     ALG_ID_MD5,
     ALG_ID_RNG,
     ALG_ID_SHA1,
@@ -157,6 +201,7 @@ static const struct {
     ULONG hash_length;
     const WCHAR *alg_name;
 } alg_props[] = {
+    /* ALG_ID_AES    */ {  0, BCRYPT_AES_ALGORITHM },
     /* ALG_ID_MD5    */ { 16, BCRYPT_MD5_ALGORITHM },
     /* ALG_ID_RNG    */ {  0, BCRYPT_RNG_ALGORITHM },
     /* ALG_ID_SHA1   */ { 20, BCRYPT_SHA1_ALGORITHM },
@@ -165,10 +210,25 @@ static const struct {
     /* ALG_ID_SHA512 */ { 64, BCRYPT_SHA512_ALGORITHM }
 };
 
+enum mode_id
+{
+    MODE_ID_CBC,
+    MODE_ID_ECB,
+    MODE_ID_GCM
+};
+
+static const WCHAR *mode_names[] =
+{
+    /* MODE_ID_CBC */ BCRYPT_CHAIN_MODE_CBC,
+    /* MODE_ID_ECB */ BCRYPT_CHAIN_MODE_ECB,
+    /* MODE_ID_GCM */ BCRYPT_CHAIN_MODE_GCM
+};
+
 struct algorithm
 {
     struct object hdr;
     enum alg_id   id;
+    enum mode_id  mode;
     BOOL hmac;
 };
 
@@ -229,7 +289,8 @@ NTSTATUS WINAPI BCryptOpenAlgorithmProvider( BCRYPT_ALG_HANDLE *handle, LPCWSTR
         return STATUS_NOT_IMPLEMENTED;
     }
 
-    if (!strcmpW( id, BCRYPT_SHA1_ALGORITHM )) alg_id = ALG_ID_SHA1;
+    if (!strcmpW( id, BCRYPT_AES_ALGORITHM )) alg_id = ALG_ID_AES;
+    else if (!strcmpW( id, BCRYPT_SHA1_ALGORITHM )) alg_id = ALG_ID_SHA1;
     else if (!strcmpW( id, BCRYPT_MD5_ALGORITHM )) alg_id = ALG_ID_MD5;
     else if (!strcmpW( id, BCRYPT_RNG_ALGORITHM )) alg_id = ALG_ID_RNG;
     else if (!strcmpW( id, BCRYPT_SHA256_ALGORITHM )) alg_id = ALG_ID_SHA256;
@@ -249,6 +310,7 @@ NTSTATUS WINAPI BCryptOpenAlgorithmProvider( BCRYPT_ALG_HANDLE *handle, LPCWSTR
     if (!(alg = HeapAlloc( GetProcessHeap(), 0, sizeof(*alg) ))) return STATUS_NO_MEMORY;
     alg->hdr.magic = MAGIC_ALG;
     alg->id        = alg_id;
+    alg->mode      = MODE_ID_CBC;
     alg->hmac      = flags & BCRYPT_ALG_HANDLE_HMAC_FLAG;
 
     *handle = alg;
@@ -586,6 +648,200 @@ static NTSTATUS hmac_finish( struct hash *hash, UCHAR *output, ULONG size )
 }
 #endif
 
+#if defined(HAVE_GNUTLS_HASH) && !defined(HAVE_COMMONCRYPTO_COMMONDIGEST_H)
+struct key
+{
+    struct object             hdr;
+    enum alg_id               alg_id;
+    enum mode_id              mode;
+    ULONG                     block_size;
+    gnutls_cipher_hd_t        handle;
+    gnutls_cipher_algorithm_t cipher;
+    UCHAR                    *secret;
+    ULONG                     secret_len;
+};
+
+static NTSTATUS key_init( struct key *key, const UCHAR *secret, ULONG secret_len )
+{
+    if (!libgnutls_handle) return STATUS_INTERNAL_ERROR;
+
+    if (!(key->secret = HeapAlloc( GetProcessHeap(), 0, secret_len ))) return STATUS_NO_MEMORY;
+    memcpy( key->secret, secret, secret_len );
+    key->secret_len = secret_len;
+    key->handle     = NULL;
+    return STATUS_SUCCESS;
+}
+
+static gnutls_cipher_algorithm_t get_gnutls_cipher( const struct key *key )
+{
+    switch (key->mode)
+    {
+    case MODE_ID_CBC:
+    case MODE_ID_ECB: /* ECB runs through CBC, see process_blocks() */
+        if (key->secret_len == 16) return GNUTLS_CIPHER_AES_128_CBC;
+        if (key->secret_len == 24) return GNUTLS_CIPHER_AES_192_CBC;
+        return GNUTLS_CIPHER_AES_256_CBC;
+
+    case MODE_ID_GCM:
+        if (key->secret_len == 16) return GNUTLS_CIPHER_AES_128_GCM;
+        if (key->secret_len == 32) return GNUTLS_CIPHER_AES_256_GCM;
+        break;
+    }
+    FIXME( "unsupported mode %u with key length %u\n", key->mode, key->secret_len );
+    return GNUTLS_CIPHER_UNKNOWN;
+}
+
+static NTSTATUS key_set_params( struct key *key, UCHAR *iv, ULONG iv_len )
+{
+    static const UCHAR zero_iv[16];
+    gnutls_cipher_algorithm_t cipher;
+    gnutls_datum_t secret, vector;
+    int ret;
+
+    if (!iv)
+    {
+        iv = (UCHAR *)zero_iv;
+        iv_len = (key->mode == MODE_ID_GCM) ? 12 : sizeof(zero_iv);
+    }
+
+    if ((cipher = get_gnutls_cipher( key )) == GNUTLS_CIPHER_UNKNOWN) return STATUS_NOT_SUPPORTED;
+
+    /* keep the expanded key schedule around, only restart the chaining state */
+    if (key->handle && key->cipher == cipher && pgnutls_cipher_set_iv)
+    {
+        pgnutls_cipher_set_iv( key->handle, iv, iv_len );
+        return STATUS_SUCCESS;
+    }
+
+    if (key->handle) pgnutls_cipher_deinit( key->handle );
+    key->handle = NULL;
+
+    secret.data = key->secret;
+    secret.size = key->secret_len;
+    vector.data = iv;
+    vector.size = iv_len;
+    if ((ret = pgnutls_cipher_init( &key->handle, cipher, &secret, &vector )))
+    {
+        pgnutls_perror( ret );
+        key->handle = NULL;
+        return STATUS_INTERNAL_ERROR;
+    }
+    key->cipher = cipher;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS key_add_auth( struct key *key, UCHAR *data, ULONG size )
+{
+    int ret;
+
+    if ((ret = pgnutls_cipher_add_auth( key->handle, data, size )))
+    {
+        pgnutls_perror( ret );
+        return STATUS_INTERNAL_ERROR;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS key_encrypt( struct key *key, const UCHAR *input, ULONG input_len, UCHAR *output,
+                             ULONG output_len )
+{
+    int ret;
+
+    if ((ret = pgnutls_cipher_encrypt2( key->handle, input, input_len, output, output_len )))
+    {
+        pgnutls_perror( ret );
+        return STATUS_INTERNAL_ERROR;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS key_decrypt( struct key *key, const UCHAR *input, ULONG input_len, UCHAR *output,
+                             ULONG output_len  )
+{
+    int ret;
+
+    if ((ret = pgnutls_cipher_decrypt2( key->handle, input, input_len, output, output_len )))
+    {
+        pgnutls_perror( ret );
+        return STATUS_INTERNAL_ERROR;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS key_get_tag( struct key *key, UCHAR *tag, ULONG len )
+{
+    int ret;
+
+    if ((ret = pgnutls_cipher_tag( key->handle, tag, len )))
+    {
+        pgnutls_perror( ret );
+        return STATUS_INTERNAL_ERROR;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS key_destroy( struct key *key )
+{
+    if (key->handle) pgnutls_cipher_deinit( key->handle );
+    HeapFree( GetProcessHeap(), 0, key->secret );
+    HeapFree( GetProcessHeap(), 0, key );
+    return STATUS_SUCCESS;
+}
+#else
+struct key
+{
+    struct object hdr;
+    enum alg_id   alg_id;
+    enum mode_id  mode;
+    ULONG         block_size;
+};
+
+static NTSTATUS key_init( struct key *key, const UCHAR *secret, ULONG secret_len )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS key_set_params( struct key *key, UCHAR *iv, ULONG iv_len )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS key_add_auth( struct key *key, UCHAR *data, ULONG size )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS key_encrypt( struct key *key, const UCHAR *input, ULONG input_len, UCHAR *output,
+                             ULONG output_len )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS key_decrypt( struct key *key, const UCHAR *input, ULONG input_len, UCHAR *output,
+                             ULONG output_len )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS key_get_tag( struct key *key, UCHAR *tag, ULONG len )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS key_destroy( struct key *key )
+{
+    ERR( "support for keys not available at build time\n" );
+    return STATUS_NOT_IMPLEMENTED;
+}
+#endif
+
+#define OBJECT_LENGTH_AES       654
 #define OBJECT_LENGTH_MD5       274
 #define OBJECT_LENGTH_SHA1      278
 #define OBJECT_LENGTH_SHA256    286
@@ -617,17 +873,73 @@ static NTSTATUS generic_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *
     return STATUS_NOT_IMPLEMENTED;
 }
 
-static NTSTATUS get_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *buf, ULONG size, ULONG *ret_size )
+static NTSTATUS get_aes_property( enum mode_id mode, const WCHAR *prop, UCHAR *buf, ULONG size, ULONG *ret_size )
+{
+    if (!strcmpW( prop, BCRYPT_BLOCK_LENGTH ))
+    {
+        *ret_size = sizeof(ULONG);
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (buf) *(ULONG *)buf = 16;
+        return STATUS_SUCCESS;
+    }
+    if (!strcmpW( prop, BCRYPT_CHAINING_MODE ))
+    {
+        *ret_size = 64;
+        if (size < *ret_size) return STATUS_BUFFER_TOO_SMALL;
+        if (buf) memcpy( buf, mode_names[mode], (strlenW( mode_names[mode] ) + 1) * sizeof(WCHAR) );
+        return STATUS_SUCCESS;
+    }
+    if (!strcmpW( prop, BCRYPT_KEY_LENGTHS ))
+    {
+        BCRYPT_KEY_LENGTHS_STRUCT *lengths = (BCRYPT_KEY_LENGTHS_STRUCT *)buf;
+        *ret_size = sizeof(*lengths);
+        if (size < *ret_size) return STATUS_BUFFER_TOO_SMALL;
+        if (lengths)
+        {
+            lengths->dwMinLength = 128;
+            lengths->dwMaxLength = 256;
+            lengths->dwIncrement = 64;
+        }
+        return STATUS_SUCCESS;
+    }
+    if (!strcmpW( prop, BCRYPT_AUTH_TAG_LENGTH ))
+    {
+        BCRYPT_AUTH_TAG_LENGTHS_STRUCT *tag_lengths = (BCRYPT_AUTH_TAG_LENGTHS_STRUCT *)buf;
+        if (mode != MODE_ID_GCM) return STATUS_NOT_SUPPORTED;
+        *ret_size = sizeof(*tag_lengths);
+        if (size < *ret_size) return STATUS_BUFFER_TOO_SMALL;
+        if (tag_lengths)
+        {
+            tag_lengths->dwMinLength = 12;
+            tag_lengths->dwMaxLength = 16;
+            tag_lengths->dwIncrement = 1;
+        }
+        return STATUS_SUCCESS;
+    }
+
+    FIXME( "unsupported aes algorithm property %s\n", debugstr_w(prop) );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS get_alg_property( const struct algorithm *alg, const WCHAR *prop, UCHAR *buf, ULONG size, ULONG *ret_size )
 {
     NTSTATUS status;
     ULONG value;
 
-    status = generic_alg_property( id, prop, buf, size, ret_size );
+    status = generic_alg_property( alg->id, prop, buf, size, ret_size );
     if (status != STATUS_NOT_IMPLEMENTED)
         return status;
 
-    switch (id)
+    switch (alg->id)
     {
+    case ALG_ID_AES:
+        if (!strcmpW( prop, BCRYPT_OBJECT_LENGTH ))
+        {
+            value = OBJECT_LENGTH_AES;
+            break;
+        }
+        return get_aes_property( alg->mode, prop, buf, size, ret_size );
+
     case ALG_ID_MD5:
         if (!strcmpW( prop, BCRYPT_OBJECT_LENGTH ))
         {
@@ -679,7 +991,7 @@ static NTSTATUS get_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *buf,
         return STATUS_NOT_IMPLEMENTED;
 
     default:
-        FIXME( "unsupported algorithm %u\n", id );
+        FIXME( "unsupported algorithm %u\n", alg->id );
         return STATUS_NOT_IMPLEMENTED;
     }
 
@@ -718,13 +1030,70 @@ NTSTATUS WINAPI BCryptGetProperty( BCRYPT_HANDLE handle, LPCWSTR prop, UCHAR *bu
     case MAGIC_ALG:
     {
         const struct algorithm *alg = (const struct algorithm *)object;
-        return get_alg_property( alg->id, prop, buffer, count, res );
+        return get_alg_property( alg, prop, buffer, count, res );
     }
     case MAGIC_HASH:
     {
         const struct hash *hash = (const struct hash *)object;
         return get_hash_property( hash->alg_id, prop, buffer, count, res );
     }
+    case MAGIC_KEY:
+    {
+        const struct key *key = (const struct key *)object;
+        return get_aes_property( key->mode, prop, buffer, count, res );
+    }
+    default:
+        WARN( "unknown magic %08x\n", object->magic );
+        return STATUS_INVALID_HANDLE;
+    }
+}
+
+static NTSTATUS set_aes_property( enum mode_id *mode, const WCHAR *prop, UCHAR *value, ULONG size )
+{
+    if (!strcmpW( prop, BCRYPT_CHAINING_MODE ))
+    {
+        if (!value) return STATUS_INVALID_PARAMETER;
+        if (!strcmpW( (const WCHAR *)value, BCRYPT_CHAIN_MODE_CBC )) *mode = MODE_ID_CBC;
+        else if (!strcmpW( (const WCHAR *)value, BCRYPT_CHAIN_MODE_ECB )) *mode = MODE_ID_ECB;
+        else if (!strcmpW( (const WCHAR *)value, BCRYPT_CHAIN_MODE_GCM )) *mode = MODE_ID_GCM;
+        else
+        {
+            FIXME( "unsupported mode %s\n", debugstr_w((const WCHAR *)value) );
+            return STATUS_NOT_IMPLEMENTED;
+        }
+        return STATUS_SUCCESS;
+    }
+
+    FIXME( "unsupported aes property %s\n", debugstr_w(prop) );
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+NTSTATUS WINAPI BCryptSetProperty( BCRYPT_HANDLE handle, LPCWSTR prop, UCHAR *value, ULONG size, ULONG flags )
+{
+    struct object *object = handle;
+
+    TRACE( "%p, %s, %p, %u, %08x\n", handle, debugstr_w(prop), value, size, flags );
+
+    if (!object) return STATUS_INVALID_HANDLE;
+    if (!prop) return STATUS_INVALID_PARAMETER;
+
+    switch (object->magic)
+    {
+    case MAGIC_ALG:
+    {
+        struct algorithm *alg = (struct algorithm *)object;
+        if (alg->id != ALG_ID_AES)
+        {
+            FIXME( "unsupported algorithm %u\n", alg->id );
+            return STATUS_NOT_IMPLEMENTED;
+        }
+        return set_aes_property( &alg->mode, prop, value, size );
+    }
+    case MAGIC_KEY:
+    {
+        struct key *key = (struct key *)object;
+        return set_aes_property( &key->mode, prop, value, size );
+    }
     default:
         WARN( "unknown magic %08x\n", object->magic );
         return STATUS_INVALID_HANDLE;
@@ -854,6 +1223,261 @@ NTSTATUS WINAPI BCryptHash( BCRYPT_ALG_HANDLE algorithm, UCHAR *secret, ULONG se
     return BCryptDestroyHash( handle );
 }
 
+NTSTATUS WINAPI BCryptGenerateSymmetricKey( BCRYPT_ALG_HANDLE algorithm, BCRYPT_KEY_HANDLE *handle,
+                                            UCHAR *object, ULONG object_len, UCHAR *secret, ULONG secret_len,
+                                            ULONG flags )
+{
+    struct algorithm *alg = algorithm;
+    struct key *key;
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %p, %u, %p, %u, %08x\n", algorithm, handle, object, object_len, secret, secret_len, flags );
+
+    if (!alg || alg->hdr.magic != MAGIC_ALG) return STATUS_INVALID_HANDLE;
+    if (!handle || !secret) return STATUS_INVALID_PARAMETER;
+    if (alg->id != ALG_ID_AES)
+    {
+        FIXME( "algorithm %u not supported\n", alg->id );
+        return STATUS_NOT_SUPPORTED;
+    }
+    if (secret_len != 16 && secret_len != 24 && secret_len != 32) return STATUS_INVALID_PARAMETER;
+    if (object) FIXME( "ignoring object buffer\n" );
+
+    if (!(key = HeapAlloc( GetProcessHeap(), 0, sizeof(*key) ))) return STATUS_NO_MEMORY;
+    key->hdr.magic  = MAGIC_KEY;
+    key->alg_id     = alg->id;
+    key->mode       = alg->mode;
+    key->block_size = 16;
+
+    if ((status = key_init( key, secret, secret_len )))
+    {
+        HeapFree( GetProcessHeap(), 0, key );
+        return status;
+    }
+
+    *handle = key;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS WINAPI BCryptDestroyKey( BCRYPT_KEY_HANDLE handle )
+{
+    struct key *key = handle;
+
+    TRACE( "%p\n", handle );
+
+    if (!key || key->hdr.magic != MAGIC_KEY) return STATUS_INVALID_HANDLE;
+    return key_destroy( key );
+}
+
+/* ECB is run through CBC starting from a zero IV, with the chaining undone
+ * on each block; other modes process the whole buffer at once */
+static NTSTATUS process_blocks( struct key *key, const UCHAR *input, UCHAR *output, ULONG len, BOOL encrypt )
+{
+    UCHAR block[16], *copy = NULL;
+    NTSTATUS status;
+    ULONG i, j;
+
+    if (key->mode != MODE_ID_ECB)
+    {
+        if (!len) return STATUS_SUCCESS;
+        if (encrypt) return key_encrypt( key, input, len, output, len );
+        return key_decrypt( key, input, len, output, len );
+    }
+
+    if (!len) return STATUS_SUCCESS;
+    if ((status = key_set_params( key, NULL, 0 ))) return status;
+
+    if (!encrypt)
+    {
+        /* the ciphertext is still needed after decrypting in place */
+        if (input == output)
+        {
+            if (!(copy = HeapAlloc( GetProcessHeap(), 0, len ))) return STATUS_NO_MEMORY;
+            memcpy( copy, input, len );
+            input = copy;
+        }
+        if (!(status = key_decrypt( key, input, len, output, len )))
+            for (i = key->block_size; i < len; i++) output[i] ^= input[i - key->block_size];
+        HeapFree( GetProcessHeap(), 0, copy );
+        return status;
+    }
+
+    /* encryption depends on the previous output block, so it has to go block by block */
+    for (i = 0; i < len; i += key->block_size)
+    {
+        memcpy( block, input + i, key->block_size );
+        if (i) for (j = 0; j < key->block_size; j++) block[j] ^= output[i - key->block_size + j];
+        if ((status = key_encrypt( key, block, key->block_size, output + i, key->block_size ))) return status;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS check_auth_info( const struct key *key, const BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO *auth_info,
+                                 ULONG flags )
+{
+    if (!auth_info || !auth_info->pbNonce || !auth_info->pbTag) return STATUS_INVALID_PARAMETER;
+    if (auth_info->cbNonce != 12) return STATUS_NOT_SUPPORTED;
+    if (auth_info->cbTag < 12 || auth_info->cbTag > 16) return STATUS_INVALID_PARAMETER;
+    if (flags & BCRYPT_BLOCK_PADDING) return STATUS_INVALID_PARAMETER;
+    if (auth_info->dwFlags & BCRYPT_AUTH_MODE_CHAIN_CALLS_FLAG)
+    {
+        FIXME( "call chaining not supported\n" );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS encrypt_gcm( struct key *key, UCHAR *input, ULONG input_len,
+                             BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO *auth_info, UCHAR *output, ULONG output_len,
+                             ULONG *ret_len, ULONG flags )
+{
+    NTSTATUS status;
+
+    if ((status = check_auth_info( key, auth_info, flags ))) return status;
+
+    *ret_len = input_len;
+    if (!output) return STATUS_SUCCESS;
+    if (output_len < *ret_len) return STATUS_BUFFER_TOO_SMALL;
+
+    if ((status = key_set_params( key, auth_info->pbNonce, auth_info->cbNonce ))) return status;
+    if (auth_info->pbAuthData && (status = key_add_auth( key, auth_info->pbAuthData, auth_info->cbAuthData )))
+        return status;
+    if ((status = process_blocks( key, input, output, input_len, TRUE ))) return status;
+    return key_get_tag( key, auth_info->pbTag, auth_info->cbTag );
+}
+
+static NTSTATUS decrypt_gcm( struct key *key, UCHAR *input, ULONG input_len,
+                             BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO *auth_info, UCHAR *output, ULONG output_len,
+                             ULONG *ret_len, ULONG flags )
+{
+    UCHAR tag[16];
+    NTSTATUS status;
+
+    if ((status = check_auth_info( key, auth_info, flags ))) return status;
+
+    *ret_len = input_len;
+    if (!output) return STATUS_SUCCESS;
+    if (output_len < *ret_len) return STATUS_BUFFER_TOO_SMALL;
+
+    if ((status = key_set_params( key, auth_info->pbNonce, auth_info->cbNonce ))) return status;
+    if (auth_info->pbAuthData && (status = key_add_auth( key, auth_info->pbAuthData, auth_info->cbAuthData )))
+        return status;
+    if ((status = process_blocks( key, input, output, input_len, FALSE ))) return status;
+    if ((status = key_get_tag( key, tag, auth_info->cbTag ))) return status;
+    if (memcmp( tag, auth_info->pbTag, auth_info->cbTag )) return STATUS_AUTH_TAG_MISMATCH;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS WINAPI BCryptEncrypt( BCRYPT_KEY_HANDLE handle, UCHAR *input, ULONG input_len, void *padding, UCHAR *iv,
+                               ULONG iv_len, UCHAR *output, ULONG output_len, ULONG *ret_len, ULONG flags )
+{
+    struct key *key = handle;
+    ULONG full_len, pad;
+    UCHAR block[16];
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %u, %p, %p, %u, %p, %u, %p, %08x\n", handle, input, input_len, padding, iv, iv_len, output,
+           output_len, ret_len, flags );
+
+    if (!key || key->hdr.magic != MAGIC_KEY) return STATUS_INVALID_HANDLE;
+    if (!ret_len) return STATUS_INVALID_PARAMETER;
+    if (flags & ~BCRYPT_BLOCK_PADDING)
+    {
+        FIXME( "flags %08x not implemented\n", flags );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (key->mode == MODE_ID_GCM)
+        return encrypt_gcm( key, input, input_len, padding, output, output_len, ret_len, flags );
+
+    full_len = input_len & ~(key->block_size - 1);
+    if (flags & BCRYPT_BLOCK_PADDING) *ret_len = full_len + key->block_size;
+    else
+    {
+        *ret_len = input_len;
+        if (full_len != input_len) return STATUS_INVALID_BUFFER_SIZE;
+    }
+    if (!output) return STATUS_SUCCESS;
+    if (output_len < *ret_len) return STATUS_BUFFER_TOO_SMALL;
+    if (key->mode != MODE_ID_CBC) iv = NULL;
+    else if (iv && iv_len != key->block_size) return STATUS_INVALID_PARAMETER;
+
+    if ((status = key_set_params( key, iv, iv_len ))) return status;
+    if ((status = process_blocks( key, input, output, full_len, TRUE ))) return status;
+
+    if (flags & BCRYPT_BLOCK_PADDING)
+    {
+        pad = key->block_size - (input_len - full_len);
+        memcpy( block, input + full_len, input_len - full_len );
+        memset( block + input_len - full_len, pad, pad );
+        if ((status = process_blocks( key, block, output + full_len, key->block_size, TRUE ))) return status;
+    }
+
+    /* the last cipher block is the IV for a subsequent call */
+    if (iv && *ret_len) memcpy( iv, output + *ret_len - key->block_size, key->block_size );
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS WINAPI BCryptDecrypt( BCRYPT_KEY_HANDLE handle, UCHAR *input, ULONG input_len, void *padding, UCHAR *iv,
+                               ULONG iv_len, UCHAR *output, ULONG output_len, ULONG *ret_len, ULONG flags )
+{
+    struct key *key = handle;
+    UCHAR block[16], next_iv[16];
+    ULONG full_len, pad, i;
+    NTSTATUS status;
+
+    TRACE( "%p, %p, %u, %p, %p, %u, %p, %u, %p, %08x\n", handle, input, input_len, padding, iv, iv_len, output,
+           output_len, ret_len, flags );
+
+    if (!key || key->hdr.magic != MAGIC_KEY) return STATUS_INVALID_HANDLE;
+    if (!ret_len) return STATUS_INVALID_PARAMETER;
+    if (flags & ~BCRYPT_BLOCK_PADDING)
+    {
+        FIXME( "flags %08x not implemented\n", flags );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (key->mode == MODE_ID_GCM)
+        return decrypt_gcm( key, input, input_len, padding, output, output_len, ret_len, flags );
+
+    *ret_len = input_len;
+    if (input_len & (key->block_size - 1)) return STATUS_INVALID_BUFFER_SIZE;
+    if (!output) return STATUS_SUCCESS;
+
+    full_len = input_len;
+    if (flags & BCRYPT_BLOCK_PADDING)
+    {
+        if (!input_len) return STATUS_INVALID_BUFFER_SIZE;
+        if (output_len + key->block_size < input_len) return STATUS_BUFFER_TOO_SMALL;
+        full_len -= key->block_size;
+    }
+    else if (output_len < input_len) return STATUS_BUFFER_TOO_SMALL;
+    if (key->mode != MODE_ID_CBC) iv = NULL;
+    else if (iv && iv_len != key->block_size) return STATUS_INVALID_PARAMETER;
+
+    /* save the last cipher block first, decrypting in place overwrites it */
+    if (iv && input_len) memcpy( next_iv, input + input_len - key->block_size, key->block_size );
+
+    if ((status = key_set_params( key, iv, iv_len ))) return status;
+    if ((status = process_blocks( key, input, output, full_len, FALSE ))) return status;
+
+    if (flags & BCRYPT_BLOCK_PADDING)
+    {
+        if ((status = process_blocks( key, input + full_len, block, key->block_size, FALSE ))) return status;
+        pad = block[key->block_size - 1];
+        if (!pad || pad > key->block_size) return STATUS_UNSUCCESSFUL;
+        for (i = key->block_size - pad; i < key->block_size; i++)
+            if (block[i] != pad) return STATUS_UNSUCCESSFUL;
+
+        *ret_len = input_len - pad;
+        if (output_len < *ret_len) return STATUS_BUFFER_TOO_SMALL;
+        memcpy( output + full_len, block, key->block_size - pad );
+    }
+
+    if (iv && input_len) memcpy( iv, next_iv, key->block_size );
+    return STATUS_SUCCESS;
+}
+
 BOOL WINAPI DllMain( HINSTANCE hinst, DWORD reason, LPVOID reserved )
 {
     switch (reason)
@@ -780,7 +780,7 @@ static void test_aes(void)
     ULONG size, len;
     UCHAR mode[64];
     NTSTATUS ret;
-todo_wine {
+
     alg = NULL;
     ret = pBCryptOpenAlgorithmProvider(&alg, BCRYPT_AES_ALGORITHM, MS_PRIMITIVE_PROVIDER, 0);
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
@@ -814,7 +814,6 @@ todo_wine {
     ret = pBCryptCloseAlgorithmProvider(alg, 0);
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
 }
-}
 
 static void test_BCryptGenerateSymmetricKey(void)
 {
@@ -833,11 +832,6 @@ static void test_BCryptGenerateSymmetricKey(void)
     NTSTATUS ret;
 
     ret = pBCryptOpenAlgorithmProvider(&aes, BCRYPT_AES_ALGORITHM, NULL, 0);
-    if (ret != STATUS_SUCCESS) /* remove whole IF when Wine is fixed */
-    {
-        todo_wine ok(0, "AES provider not available\n");
-        return;
-    }
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
 
     len = size = 0xdeadbeef;
@@ -852,7 +846,7 @@ static void test_BCryptGenerateSymmetricKey(void)
 
     ret = pBCryptSetProperty(aes, BCRYPT_CHAINING_MODE, (UCHAR *)BCRYPT_CHAIN_MODE_CBC,
                             sizeof(BCRYPT_CHAIN_MODE_CBC), 0);
-    todo_wine ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
 
     size = 0xdeadbeef;
     ret = pBCryptEncrypt(key, NULL, 0, NULL, NULL, 0, NULL, 0, &size, 0);
@@ -915,18 +909,22 @@ static void test_BCryptEncrypt(void)
     static UCHAR expected2[] =
         {0xc6,0xa1,0x3b,0x37,0x87,0x8f,0x5b,0x82,0x6f,0x4f,0x81,0x62,0xa1,0xc8,0xd8,0x79,
          0x28,0x73,0x3d,0xef,0x84,0x8f,0xb0,0xa6,0x5d,0x1a,0x51,0xb7,0xec,0x8f,0xea,0xe9};
+    static UCHAR data_ecb[] =
+        {0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff};
+    static UCHAR expected_ecb[] =
+        {0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a};
+    static UCHAR expected_gcm[] =
+        {0x03,0x88,0xda,0xce,0x60,0xb6,0xa3,0x92,0xf3,0x28,0xc2,0xb9,0x71,0xb2,0xfe,0x78};
+    static UCHAR expected_tag[] =
+        {0xab,0x6e,0x47,0xd4,0x2c,0xec,0x13,0xbd,0xf5,0x3a,0x67,0xb2,0x12,0x57,0xbd,0xdf};
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO auth_info;
     BCRYPT_ALG_HANDLE aes;
     BCRYPT_KEY_HANDLE key;
-    UCHAR *buf, ciphertext[32], ivbuf[16];
+    UCHAR *buf, ciphertext[32], ivbuf[16], zeroes[16], tag[16];
     ULONG size, len, i;
     NTSTATUS ret;
 
     ret = pBCryptOpenAlgorithmProvider(&aes, BCRYPT_AES_ALGORITHM, NULL, 0);
-    if (ret != STATUS_SUCCESS) /* remove whole IF when Wine is fixed */
-    {
-        todo_wine ok(0, "AES provider not available\n");
-        return;
-    }
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
 
     len = 0xdeadbeef;
@@ -987,6 +985,56 @@ static void test_BCryptEncrypt(void)
     ok(ret == STATUS_BUFFER_TOO_SMALL, "got %08x\n", ret);
     ok(size == 32, "got %u\n", size);
 
+    /* ECB mode, the IV is ignored */
+    ret = pBCryptSetProperty(key, BCRYPT_CHAINING_MODE, (UCHAR *)BCRYPT_CHAIN_MODE_ECB,
+                            sizeof(BCRYPT_CHAIN_MODE_ECB), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    size = 0;
+    memcpy(ciphertext, data_ecb, sizeof(data_ecb));
+    memcpy(ciphertext + 16, data_ecb, sizeof(data_ecb));
+    ret = pBCryptEncrypt(key, ciphertext, 32, NULL, NULL, 0, ciphertext, 32, &size, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ok(size == 32, "got %u\n", size);
+    ok(!memcmp(ciphertext, expected_ecb, sizeof(expected_ecb)), "wrong data\n");
+    ok(!memcmp(ciphertext + 16, expected_ecb, sizeof(expected_ecb)), "wrong data\n");
+
+    ret = pBCryptDestroyKey(key);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    /* GCM mode */
+    ret = pBCryptSetProperty(aes, BCRYPT_CHAINING_MODE, (UCHAR *)BCRYPT_CHAIN_MODE_GCM,
+                            sizeof(BCRYPT_CHAIN_MODE_GCM), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    memset(zeroes, 0, sizeof(zeroes));
+    ret = pBCryptGenerateSymmetricKey(aes, &key, buf, len, zeroes, sizeof(zeroes), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    BCRYPT_INIT_AUTH_MODE_INFO(auth_info);
+    auth_info.pbNonce = zeroes;
+    auth_info.cbNonce = 12;
+    auth_info.pbTag = tag;
+    auth_info.cbTag = sizeof(tag);
+
+    size = 0;
+    ret = pBCryptEncrypt(key, zeroes, 16, &auth_info, NULL, 0, NULL, 0, &size, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ok(size == 16, "got %u\n", size);
+
+    size = 0;
+    memset(ciphertext, 0xff, sizeof(ciphertext));
+    memset(tag, 0xff, sizeof(tag));
+    ret = pBCryptEncrypt(key, zeroes, 16, &auth_info, NULL, 0, ciphertext, 16, &size, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ok(size == 16, "got %u\n", size);
+    ok(!memcmp(ciphertext, expected_gcm, sizeof(expected_gcm)), "wrong data\n");
+    ok(!memcmp(tag, expected_tag, sizeof(expected_tag)), "wrong tag\n");
+
+    /* block padding is not allowed */
+    ret = pBCryptEncrypt(key, zeroes, 16, &auth_info, NULL, 0, ciphertext, 32, &size, BCRYPT_BLOCK_PADDING);
+    ok(ret == STATUS_INVALID_PARAMETER, "got %08x\n", ret);
+
     ret = pBCryptDestroyKey(key);
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
     HeapFree(GetProcessHeap(), 0, buf);
@@ -1006,18 +1054,20 @@ static void test_BCryptDecrypt(void)
     static UCHAR ciphertext[32] =
         {0xc6,0xa1,0x3b,0x37,0x87,0x8f,0x5b,0x82,0x6f,0x4f,0x81,0x62,0xa1,0xc8,0xd8,0x79,
          0x28,0x73,0x3d,0xef,0x84,0x8f,0xb0,0xa6,0x5d,0x1a,0x51,0xb7,0xec,0x8f,0xea,0xe9};
+    static UCHAR expected2[] =
+        {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,0x10};
+    static UCHAR ciphertext_gcm[] =
+        {0x03,0x88,0xda,0xce,0x60,0xb6,0xa3,0x92,0xf3,0x28,0xc2,0xb9,0x71,0xb2,0xfe,0x78};
+    static UCHAR tag_gcm[] =
+        {0xab,0x6e,0x47,0xd4,0x2c,0xec,0x13,0xbd,0xf5,0x3a,0x67,0xb2,0x12,0x57,0xbd,0xdf};
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO auth_info;
     BCRYPT_ALG_HANDLE aes;
     BCRYPT_KEY_HANDLE key;
-    UCHAR *buf, plaintext[32], ivbuf[16];
+    UCHAR *buf, plaintext[32], ivbuf[16], zeroes[16], tag[16];
     ULONG size, len;
     NTSTATUS ret;
 
     ret = pBCryptOpenAlgorithmProvider(&aes, BCRYPT_AES_ALGORITHM, NULL, 0);
-    if (ret != STATUS_SUCCESS) /* remove whole IF when Wine is fixed */
-    {
-        todo_wine ok(0, "AES provider not available\n");
-        return;
-    }
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
 
     len = 0xdeadbeef;
@@ -1065,6 +1115,45 @@ static void test_BCryptDecrypt(void)
     ok(ret == STATUS_INVALID_BUFFER_SIZE, "got %08x\n", ret);
     ok(size == 17 || broken(size == 0 /* Win < 7 */), "got %u\n", size);
 
+    /* input size is a multiple of block size, block padding set */
+    size = 0;
+    memcpy(ivbuf, iv, sizeof(iv));
+    memset(plaintext, 0, sizeof(plaintext));
+    ret = pBCryptDecrypt(key, ciphertext, 32, NULL, ivbuf, 16, plaintext, 32, &size, BCRYPT_BLOCK_PADDING);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ok(size == 17, "got %u\n", size);
+    ok(!memcmp(plaintext, expected2, sizeof(expected2)), "wrong data\n");
+
+    ret = pBCryptDestroyKey(key);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    /* GCM mode */
+    ret = pBCryptSetProperty(aes, BCRYPT_CHAINING_MODE, (UCHAR *)BCRYPT_CHAIN_MODE_GCM,
+                            sizeof(BCRYPT_CHAIN_MODE_GCM), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    memset(zeroes, 0, sizeof(zeroes));
+    ret = pBCryptGenerateSymmetricKey(aes, &key, buf, len, zeroes, sizeof(zeroes), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    memcpy(tag, tag_gcm, sizeof(tag_gcm));
+    BCRYPT_INIT_AUTH_MODE_INFO(auth_info);
+    auth_info.pbNonce = zeroes;
+    auth_info.cbNonce = 12;
+    auth_info.pbTag = tag;
+    auth_info.cbTag = sizeof(tag);
+
+    size = 0;
+    memset(plaintext, 0xff, sizeof(plaintext));
+    ret = pBCryptDecrypt(key, ciphertext_gcm, 16, &auth_info, NULL, 0, plaintext, 16, &size, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ok(size == 16, "got %u\n", size);
+    ok(!memcmp(plaintext, zeroes, sizeof(zeroes)), "wrong data\n");
+
+    tag[0] ^= 1;
+    ret = pBCryptDecrypt(key, ciphertext_gcm, 16, &auth_info, NULL, 0, plaintext, 16, &size, 0);
+    ok(ret == STATUS_AUTH_TAG_MISMATCH, "got %08x\n", ret);
+
     ret = pBCryptDestroyKey(key);
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
     HeapFree(GetProcessHeap(), 0, buf);
@@ -20,6 +20,10 @@
 #define COBJMACROS
 #include "config.h"
 #include "wine/port.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
 #include "wine/debug.h"
 #include "wine/unicode.h"
 
@@ -27,9 +31,14 @@
 #include "wine/wpp.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3dcompiler);
+WINE_DECLARE_DEBUG_CHANNEL(shader_cache);
 
 #define D3DXERR_INVALIDDATA                      0x88760b59
 
+#ifndef D3D_COMPILER_VERSION
+#define D3D_COMPILER_VERSION 43
+#endif
+
 #define BUFFER_INITIAL_CAPACITY 256
 
 struct mem_file_desc
@@ -388,6 +397,331 @@ cleanup:
     return hr;
 }
 
+/* On-disk cache of compilation results. The key is made of the compiler
+ * version, the target, entry point and flags, followed by the preprocessed
+ * source, which already has the defines applied and the includes expanded.
+ * The whole key is stored in the cache file and compared on lookup, so a
+ * hash collision only results in a cache miss. All the functions below are
+ * called with wpp_mutex held. */
+#define SHADER_CACHE_MAGIC 0x48534344 /* "DCSH" */
+#define SHADER_CACHE_DEFAULT_SIZE 64 /* MiB */
+
+struct shader_cache_header
+{
+    DWORD magic;
+    DWORD key_size;
+    DWORD code_size;
+    DWORD messages_size;
+};
+
+struct shader_cache_file
+{
+    FILETIME time;
+    ULONGLONG size;
+    char name[MAX_PATH];
+};
+
+static struct
+{
+    BOOL initialized;
+    BOOL enabled;
+    char path[MAX_PATH];
+    ULONGLONG max_size;
+    ULONGLONG size;
+    unsigned int hits;
+    unsigned int misses;
+} shader_cache;
+
+static int shader_cache_file_compare(const void *a, const void *b)
+{
+    const struct shader_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+/* Removes the least recently used entries until the cache is comfortably
+ * below its size limit, and updates the cached size estimate. */
+static void shader_cache_trim(void)
+{
+    struct shader_cache_file *files = NULL, *new_files;
+    unsigned int count = 0, capacity = 0, i;
+    char path[MAX_PATH + 16];
+    WIN32_FIND_DATAA data;
+    ULONGLONG total = 0;
+    HANDLE find;
+
+    sprintf(path, "%s\\*.bin", shader_cache.path);
+    if ((find = FindFirstFileA(path, &data)) == INVALID_HANDLE_VALUE)
+    {
+        shader_cache.size = 0;
+        return;
+    }
+
+    do
+    {
+        if (count == capacity)
+        {
+            capacity = max(capacity * 2, 64);
+            if (!files)
+                new_files = HeapAlloc(GetProcessHeap(), 0, capacity * sizeof(*files));
+            else
+                new_files = HeapReAlloc(GetProcessHeap(), 0, files, capacity * sizeof(*files));
+            if (!new_files)
+            {
+                ERR("Failed to allocate memory.\n");
+                break;
+            }
+            files = new_files;
+        }
+        files[count].time = data.ftLastWriteTime;
+        files[count].size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        strcpy(files[count].name, data.cFileName);
+        total += files[count++].size;
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+
+    if (total > shader_cache.max_size)
+    {
+        qsort(files, count, sizeof(*files), shader_cache_file_compare);
+        for (i = 0; i < count && total > shader_cache.max_size / 4 * 3; ++i)
+        {
+            sprintf(path, "%s\\%s", shader_cache.path, files[i].name);
+            if (DeleteFileA(path))
+                total -= files[i].size;
+        }
+        TRACE_(shader_cache)("Removed %u entries, cache size is now %s bytes.\n",
+                i, wine_dbgstr_longlong(total));
+    }
+
+    HeapFree(GetProcessHeap(), 0, files);
+    shader_cache.size = total;
+}
+
+static void shader_cache_init(void)
+{
+    DWORD type, size, value;
+    HKEY hkey;
+
+    shader_cache.initialized = TRUE;
+    shader_cache.max_size = (ULONGLONG)SHADER_CACHE_DEFAULT_SIZE << 20;
+
+    /* @@ Wine registry key: HKCU\Software\Wine\D3DCompiler */
+    if (!RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\D3DCompiler", &hkey))
+    {
+        size = sizeof(value);
+        if (!RegQueryValueExA(hkey, "ShaderCacheSize", NULL, &type, (BYTE *)&value, &size)
+                && type == REG_DWORD)
+            shader_cache.max_size = (ULONGLONG)value << 20;
+        size = sizeof(shader_cache.path) - 1;
+        if (RegQueryValueExA(hkey, "ShaderCacheDir", NULL, &type, (BYTE *)shader_cache.path, &size)
+                || type != REG_SZ)
+            shader_cache.path[0] = 0;
+        RegCloseKey(hkey);
+    }
+
+    if (!shader_cache.max_size)
+    {
+        TRACE_(shader_cache)("Shader cache disabled.\n");
+        return;
+    }
+
+    if (!shader_cache.path[0])
+    {
+        static const char dir_name[] = "d3dcompiler_cache";
+
+        size = GetTempPathA(sizeof(shader_cache.path), shader_cache.path);
+        if (!size || size + sizeof(dir_name) > sizeof(shader_cache.path))
+        {
+            WARN("Failed to get the temporary path.\n");
+            return;
+        }
+        strcat(shader_cache.path, dir_name);
+    }
+    if (strlen(shader_cache.path) > MAX_PATH - 32)
+    {
+        WARN("Shader cache path %s is too long.\n", debugstr_a(shader_cache.path));
+        return;
+    }
+    if (!CreateDirectoryA(shader_cache.path, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        WARN("Failed to create shader cache directory %s, error %u.\n",
+                debugstr_a(shader_cache.path), GetLastError());
+        return;
+    }
+
+    shader_cache.enabled = TRUE;
+    shader_cache_trim();
+    TRACE_(shader_cache)("Using shader cache %s, size %s, limit %s bytes.\n",
+            debugstr_a(shader_cache.path), wine_dbgstr_longlong(shader_cache.size),
+            wine_dbgstr_longlong(shader_cache.max_size));
+}
+
+static char *shader_cache_create_key(const char *target, const char *entrypoint,
+        UINT sflags, UINT eflags, const char *source, SIZE_T source_size, DWORD *key_size)
+{
+    char *key;
+    int len;
+
+    if (!shader_cache.initialized)
+        shader_cache_init();
+    if (!shader_cache.enabled)
+        return NULL;
+
+    len = snprintf(NULL, 0, "wine %s d3dcompiler %u\n%s\n%s\n%#x %#x\n", PACKAGE_VERSION,
+            D3D_COMPILER_VERSION, target, entrypoint, sflags, eflags);
+    if (!(key = HeapAlloc(GetProcessHeap(), 0, len + 1 + source_size)))
+        return NULL;
+    sprintf(key, "wine %s d3dcompiler %u\n%s\n%s\n%#x %#x\n", PACKAGE_VERSION,
+            D3D_COMPILER_VERSION, target, entrypoint, sflags, eflags);
+    memcpy(key + len, source, source_size);
+    *key_size = len + source_size;
+
+    return key;
+}
+
+static void shader_cache_get_filename(char *filename, const char *key, DWORD key_size)
+{
+    ULONGLONG hash = 0xcbf29ce484222325ull;
+    DWORD i;
+
+    /* 64-bit FNV-1a. */
+    for (i = 0; i < key_size; ++i)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    sprintf(filename, "%s\\%08x%08x.bin", shader_cache.path, (DWORD)(hash >> 32), (DWORD)hash);
+}
+
+static BOOL shader_cache_read_blob(HANDLE file, DWORD size, ID3DBlob **blob)
+{
+    DWORD read;
+
+    *blob = NULL;
+    if (!size)
+        return TRUE;
+    if (FAILED(D3DCreateBlob(size, blob)))
+        return FALSE;
+    if (!ReadFile(file, ID3D10Blob_GetBufferPointer(*blob), size, &read, NULL) || read != size)
+    {
+        ID3D10Blob_Release(*blob);
+        *blob = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL shader_cache_lookup(const char *key, DWORD key_size, ID3DBlob **code, ID3DBlob **messages)
+{
+    char filename[MAX_PATH + 32];
+    struct shader_cache_header header;
+    char *stored_key = NULL;
+    BOOL ret = FALSE;
+    FILETIME now;
+    HANDLE file;
+    DWORD read;
+
+    shader_cache_get_filename(filename, key, key_size);
+    file = CreateFileA(filename, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        if (ReadFile(file, &header, sizeof(header), &read, NULL) && read == sizeof(header)
+                && header.magic == SHADER_CACHE_MAGIC && header.key_size == key_size && header.code_size
+                && (stored_key = HeapAlloc(GetProcessHeap(), 0, key_size))
+                && ReadFile(file, stored_key, key_size, &read, NULL) && read == key_size
+                && !memcmp(stored_key, key, key_size))
+        {
+            if (shader_cache_read_blob(file, header.code_size, code))
+            {
+                if (shader_cache_read_blob(file, header.messages_size, messages))
+                    ret = TRUE;
+                else
+                    ID3D10Blob_Release(*code);
+            }
+        }
+        if (ret)
+        {
+            /* The last write time is used for LRU eviction. */
+            GetSystemTimeAsFileTime(&now);
+            SetFileTime(file, NULL, NULL, &now);
+        }
+        HeapFree(GetProcessHeap(), 0, stored_key);
+        CloseHandle(file);
+    }
+
+    if (ret)
+        ++shader_cache.hits;
+    else
+        ++shader_cache.misses;
+    TRACE_(shader_cache)("Cache %s for %s, %u hits, %u misses.\n", ret ? "hit" : "miss",
+            debugstr_a(filename), shader_cache.hits, shader_cache.misses);
+
+    return ret;
+}
+
+static void shader_cache_store(const char *key, DWORD key_size, ID3DBlob *code, ID3DBlob *messages)
+{
+    char filename[MAX_PATH + 32], tmp_filename[MAX_PATH + 32];
+    struct shader_cache_header header;
+    DWORD written;
+    BOOL ret;
+    HANDLE file;
+
+    header.magic = SHADER_CACHE_MAGIC;
+    header.key_size = key_size;
+    header.code_size = ID3D10Blob_GetBufferSize(code);
+    header.messages_size = messages ? ID3D10Blob_GetBufferSize(messages) : 0;
+
+    /* Write to a temporary file first, so that concurrent readers never see
+     * partial entries. */
+    shader_cache_get_filename(filename, key, key_size);
+    if (snprintf(tmp_filename, sizeof(tmp_filename), "%s.%x.tmp", filename,
+            GetCurrentProcessId()) >= sizeof(tmp_filename))
+    {
+        WARN("Cache entry name %s is too long.\n", debugstr_a(filename));
+        return;
+    }
+    file = CreateFileA(tmp_filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_filename), GetLastError());
+        return;
+    }
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL)
+            && WriteFile(file, key, key_size, &written, NULL)
+            && WriteFile(file, ID3D10Blob_GetBufferPointer(code), header.code_size, &written, NULL)
+            && (!messages || WriteFile(file, ID3D10Blob_GetBufferPointer(messages),
+            header.messages_size, &written, NULL));
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_filename, filename, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write cache entry %s, error %u.\n", debugstr_a(filename), GetLastError());
+        DeleteFileA(tmp_filename);
+        return;
+    }
+
+    shader_cache.size += sizeof(header) + key_size + header.code_size + header.messages_size;
+    if (shader_cache.size > shader_cache.max_size)
+        shader_cache_trim();
+}
+
+static void shader_cache_return_blobs(ID3DBlob *code, ID3DBlob *messages,
+        ID3DBlob **shader, ID3DBlob **error_messages)
+{
+    if (shader)
+        *shader = code;
+    else if (code)
+        ID3D10Blob_Release(code);
+
+    if (error_messages)
+        *error_messages = messages;
+    else if (messages)
+        ID3D10Blob_Release(messages);
+}
+
 static HRESULT assemble_shader(const char *preproc_shader,
         ID3DBlob **shader_blob, ID3DBlob **error_messages)
 {
@@ -469,6 +803,9 @@ HRESULT WINAPI D3DAssemble(const void *data, SIZE_T datasize, const char *filena
         const D3D_SHADER_MACRO *defines, ID3DInclude *include, UINT flags,
         ID3DBlob **shader, ID3DBlob **error_messages)
 {
+    ID3DBlob *code = NULL, *messages = NULL;
+    DWORD key_size;
+    char *key;
     HRESULT hr;
 
     TRACE("data %p, datasize %lu, filename %s, defines %p, include %p, sflags %#x, "
@@ -485,7 +822,17 @@ HRESULT WINAPI D3DAssemble(const void *data, SIZE_T datasize, const char *filena
 
     hr = preprocess_shader(data, datasize, filename, defines, include, error_messages);
     if (SUCCEEDED(hr))
-        hr = assemble_shader(wpp_output, shader, error_messages);
+    {
+        key = shader_cache_create_key("asm", "", flags, 0, wpp_output, wpp_output_size, &key_size);
+        if (!key || !shader_cache_lookup(key, key_size, &code, &messages))
+        {
+            hr = assemble_shader(wpp_output, &code, &messages);
+            if (SUCCEEDED(hr) && key)
+                shader_cache_store(key, key_size, code, messages);
+        }
+        HeapFree(GetProcessHeap(), 0, key);
+        shader_cache_return_blobs(code, messages, shader, error_messages);
+    }
 
     HeapFree(GetProcessHeap(), 0, wpp_output);
     LeaveCriticalSection(&wpp_mutex);
@@ -698,6 +1045,9 @@ HRESULT WINAPI D3DCompile2(const void *data, SIZE_T data_size, const char *filen
         const void *secondary_data, SIZE_T secondary_data_size, ID3DBlob **shader,
         ID3DBlob **error_messages)
 {
+    ID3DBlob *code = NULL, *messages = NULL;
+    DWORD key_size;
+    char *key;
     HRESULT hr;
 
     TRACE("data %p, data_size %lu, filename %s, defines %p, include %p, entrypoint %s, "
@@ -717,7 +1067,18 @@ HRESULT WINAPI D3DCompile2(const void *data, SIZE_T data_size, const char *filen
 
     hr = preprocess_shader(data, data_size, filename, defines, include, error_messages);
     if (SUCCEEDED(hr))
-        hr = compile_shader(wpp_output, target, entrypoint, shader, error_messages);
+    {
+        key = shader_cache_create_key(target, entrypoint, sflags, eflags,
+                wpp_output, wpp_output_size, &key_size);
+        if (!key || !shader_cache_lookup(key, key_size, &code, &messages))
+        {
+            hr = compile_shader(wpp_output, target, entrypoint, &code, &messages);
+            if (SUCCEEDED(hr) && key)
+                shader_cache_store(key, key_size, code, messages);
+        }
+        HeapFree(GetProcessHeap(), 0, key);
+        shader_cache_return_blobs(code, messages, shader, error_messages);
+    }
 
     HeapFree(GetProcessHeap(), 0, wpp_output);
     LeaveCriticalSection(&wpp_mutex);
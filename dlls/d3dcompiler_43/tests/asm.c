@@ -19,6 +19,7 @@
 #define CONST_VTABLE
 #include "wine/test.h"
 
+#include <stdio.h>
 #include <d3d9types.h>
 #include <d3dcommon.h>
 #include <d3dcompiler.h>
@@ -1532,8 +1533,17 @@ static void assembleshader_test(void) {
             NULL, NULL
         }
     };
+    static const D3D_SHADER_MACRO defines2[] =
+    {
+        {
+            "DEF2", "r1"
+        },
+        {
+            NULL, NULL
+        }
+    };
     HRESULT hr;
-    ID3DBlob *shader, *messages;
+    ID3DBlob *shader, *shader2, *messages;
     struct D3DIncludeImpl include;
 
     /* defines test */
@@ -1568,6 +1578,27 @@ static void assembleshader_test(void) {
         ID3D10Blob_Release(messages);
     }
 
+    /* Repeated assembly returns the same bytecode, and depends on the defines */
+    hr = D3DAssemble(test1, strlen(test1), NULL, defines, NULL, D3DCOMPILE_SKIP_VALIDATION, &shader, NULL);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    hr = D3DAssemble(test1, strlen(test1), NULL, defines, NULL, D3DCOMPILE_SKIP_VALIDATION, &shader2, NULL);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    ok(ID3D10Blob_GetBufferSize(shader) == ID3D10Blob_GetBufferSize(shader2),
+            "Got unexpected size %lu, expected %lu.\n",
+            ID3D10Blob_GetBufferSize(shader2), ID3D10Blob_GetBufferSize(shader));
+    ok(!memcmp(ID3D10Blob_GetBufferPointer(shader), ID3D10Blob_GetBufferPointer(shader2),
+            ID3D10Blob_GetBufferSize(shader)), "Got unexpected bytecode.\n");
+    ID3D10Blob_Release(shader2);
+    hr = D3DAssemble(test1, strlen(test1), NULL, defines2, NULL, D3DCOMPILE_SKIP_VALIDATION, &shader2, NULL);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    ok(ID3D10Blob_GetBufferSize(shader) == ID3D10Blob_GetBufferSize(shader2),
+            "Got unexpected size %lu, expected %lu.\n",
+            ID3D10Blob_GetBufferSize(shader2), ID3D10Blob_GetBufferSize(shader));
+    ok(memcmp(ID3D10Blob_GetBufferPointer(shader), ID3D10Blob_GetBufferPointer(shader2),
+            ID3D10Blob_GetBufferSize(shader)), "Got unexpected bytecode.\n");
+    ID3D10Blob_Release(shader2);
+    ID3D10Blob_Release(shader);
+
     /* D3DInclude test */
     shader = NULL;
     messages = NULL;
@@ -1718,8 +1749,75 @@ static void d3dpreprocess_test(void)
     if (shader) ID3D10Blob_Release(shader);
 }
 
+static char shader_cache_dir[MAX_PATH];
+static char old_shader_cache_dir[MAX_PATH];
+static DWORD old_shader_cache_dir_size;
+
+/* Keep Wine's shader cache out of the user's temporary directory. The
+ * setting is read when the first shader is compiled. */
+static void set_shader_cache_dir(void)
+{
+    DWORD len, type;
+    HKEY key;
+
+    len = GetTempPathA(sizeof(shader_cache_dir), shader_cache_dir);
+    if (!len || len + 32 > sizeof(shader_cache_dir))
+    {
+        shader_cache_dir[0] = 0;
+        return;
+    }
+    sprintf(shader_cache_dir + len, "d3dcompiler_test_%x", GetCurrentProcessId());
+    CreateDirectoryA(shader_cache_dir, NULL);
+
+    if (RegCreateKeyA(HKEY_CURRENT_USER, "Software\\Wine\\D3DCompiler", &key))
+        return;
+    old_shader_cache_dir_size = sizeof(old_shader_cache_dir);
+    if (RegQueryValueExA(key, "ShaderCacheDir", NULL, &type, (BYTE *)old_shader_cache_dir,
+            &old_shader_cache_dir_size) || type != REG_SZ)
+        old_shader_cache_dir_size = 0;
+    RegSetValueExA(key, "ShaderCacheDir", 0, REG_SZ, (BYTE *)shader_cache_dir, strlen(shader_cache_dir) + 1);
+    RegCloseKey(key);
+}
+
+static void remove_shader_cache_dir(void)
+{
+    char path[MAX_PATH + 16];
+    WIN32_FIND_DATAA data;
+    HANDLE find;
+    HKEY key;
+
+    if (!shader_cache_dir[0])
+        return;
+
+    if (!RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\D3DCompiler", &key))
+    {
+        if (old_shader_cache_dir_size)
+            RegSetValueExA(key, "ShaderCacheDir", 0, REG_SZ, (BYTE *)old_shader_cache_dir,
+                    old_shader_cache_dir_size);
+        else
+            RegDeleteValueA(key, "ShaderCacheDir");
+        RegCloseKey(key);
+    }
+
+    sprintf(path, "%s\\*", shader_cache_dir);
+    if ((find = FindFirstFileA(path, &data)) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                continue;
+            sprintf(path, "%s\\%s", shader_cache_dir, data.cFileName);
+            DeleteFileA(path);
+        } while (FindNextFileA(find, &data));
+        FindClose(find);
+    }
+    RemoveDirectoryA(shader_cache_dir);
+}
+
 START_TEST(asm)
 {
+    set_shader_cache_dir();
+
     preproc_test();
     ps_1_1_test();
     vs_1_1_test();
@@ -1737,4 +1835,6 @@ START_TEST(asm)
     assembleshader_test();
 
     d3dpreprocess_test();
+
+    remove_shader_cache_dir();
 }
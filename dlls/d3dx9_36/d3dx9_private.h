@@ -147,6 +147,8 @@ struct d3dx_const_tab
     unsigned int const_set_size;
     struct d3dx_const_param_eval_output *const_set;
     const enum pres_reg_tables *regset2table;
+    /* Version of the inputs at the last evaluation, 0 if never evaluated. */
+    ULONG64 update_version;
 };
 
 struct d3dx_regstore
@@ -174,6 +176,8 @@ struct d3dx_param_eval
 
     struct d3dx_preshader pres;
     struct d3dx_const_tab shader_inputs;
+
+    ULONG64 *version_counter;
 };
 
 struct d3dx_parameter
@@ -199,10 +203,20 @@ struct d3dx_parameter
 
     struct d3dx_parameter *referenced_param;
     struct d3dx_param_eval *param_eval;
+
+    struct d3dx_parameter *top_level_param;
+    ULONG64 update_version;
 };
 
 struct d3dx9_base_effect;
 
+static inline ULONG64 next_update_version(ULONG64 *version_counter)
+{
+    return ++*version_counter;
+}
+
+ULONG64 *get_version_counter_ptr(struct d3dx9_base_effect *base) DECLSPEC_HIDDEN;
+
 struct d3dx_parameter *get_parameter_by_name(struct d3dx9_base_effect *base,
         struct d3dx_parameter *parameter, const char *name) DECLSPEC_HIDDEN;
 
@@ -156,6 +156,8 @@ struct d3dx9_base_effect
     struct d3dx_object *objects;
 
     struct param_table param_table;
+
+    ULONG64 version_counter;
 };
 
 struct ID3DXEffectImpl
@@ -483,6 +485,22 @@ static struct d3dx_parameter *get_valid_parameter(struct d3dx9_base_effect *base
     return get_parameter_by_name(base, NULL, parameter);
 }
 
+static struct d3dx_parameter *get_valid_parameter_for_write(struct d3dx9_base_effect *base,
+        D3DXHANDLE parameter)
+{
+    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+
+    /* Preshaders depending on the parameter are reevaluated on next use. */
+    if (param)
+        param->top_level_param->update_version = next_update_version(&base->version_counter);
+    return param;
+}
+
+ULONG64 *get_version_counter_ptr(struct d3dx9_base_effect *base)
+{
+    return &base->version_counter;
+}
+
 static void free_state(struct d3dx_state *state)
 {
     free_parameter(&state->parameter, FALSE, FALSE);
@@ -1319,7 +1337,7 @@ static D3DXHANDLE d3dx9_base_effect_get_annotation_by_name(struct d3dx9_base_eff
 static HRESULT d3dx9_base_effect_set_value(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const void *data, UINT bytes)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (!param)
     {
@@ -1445,7 +1463,7 @@ static HRESULT d3dx9_base_effect_get_value(struct d3dx9_base_effect *base,
 
 static HRESULT d3dx9_base_effect_set_bool(struct d3dx9_base_effect *base, D3DXHANDLE parameter, BOOL b)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count && param->rows == 1 && param->columns == 1)
     {
@@ -1477,7 +1495,7 @@ static HRESULT d3dx9_base_effect_get_bool(struct d3dx9_base_effect *base, D3DXHA
 static HRESULT d3dx9_base_effect_set_bool_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const BOOL *b, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param)
     {
@@ -1538,7 +1556,7 @@ static HRESULT d3dx9_base_effect_get_bool_array(struct d3dx9_base_effect *base,
 
 static HRESULT d3dx9_base_effect_set_int(struct d3dx9_base_effect *base, D3DXHANDLE parameter, INT n)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count)
     {
@@ -1614,7 +1632,7 @@ static HRESULT d3dx9_base_effect_get_int(struct d3dx9_base_effect *base, D3DXHAN
 static HRESULT d3dx9_base_effect_set_int_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const INT *n, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param)
     {
@@ -1674,7 +1692,7 @@ static HRESULT d3dx9_base_effect_get_int_array(struct d3dx9_base_effect *base,
 
 static HRESULT d3dx9_base_effect_set_float(struct d3dx9_base_effect *base, D3DXHANDLE parameter, float f)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count && param->rows == 1 && param->columns == 1)
     {
@@ -1706,7 +1724,7 @@ static HRESULT d3dx9_base_effect_get_float(struct d3dx9_base_effect *base, D3DXH
 static HRESULT d3dx9_base_effect_set_float_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const float *f, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param)
     {
@@ -1767,7 +1785,7 @@ static HRESULT d3dx9_base_effect_get_float_array(struct d3dx9_base_effect *base,
 static HRESULT d3dx9_base_effect_set_vector(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXVECTOR4 *vector)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count)
     {
@@ -1859,7 +1877,7 @@ static HRESULT d3dx9_base_effect_get_vector(struct d3dx9_base_effect *base,
 static HRESULT d3dx9_base_effect_set_vector_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXVECTOR4 *vector, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && param->element_count && param->element_count >= count)
     {
@@ -1946,7 +1964,7 @@ static HRESULT d3dx9_base_effect_get_vector_array(struct d3dx9_base_effect *base
 static HRESULT d3dx9_base_effect_set_matrix(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXMATRIX *matrix)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count)
     {
@@ -2010,7 +2028,7 @@ static HRESULT d3dx9_base_effect_get_matrix(struct d3dx9_base_effect *base,
 static HRESULT d3dx9_base_effect_set_matrix_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXMATRIX *matrix, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && param->element_count >= count)
     {
@@ -2086,7 +2104,7 @@ static HRESULT d3dx9_base_effect_get_matrix_array(struct d3dx9_base_effect *base
 static HRESULT d3dx9_base_effect_set_matrix_pointer_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXMATRIX **matrix, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && count <= param->element_count)
     {
@@ -2158,7 +2176,7 @@ static HRESULT d3dx9_base_effect_get_matrix_pointer_array(struct d3dx9_base_effe
 static HRESULT d3dx9_base_effect_set_matrix_transpose(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXMATRIX *matrix)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count)
     {
@@ -2225,7 +2243,7 @@ static HRESULT d3dx9_base_effect_get_matrix_transpose(struct d3dx9_base_effect *
 static HRESULT d3dx9_base_effect_set_matrix_transpose_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXMATRIX *matrix, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && param->element_count >= count)
     {
@@ -2301,7 +2319,7 @@ static HRESULT d3dx9_base_effect_get_matrix_transpose_array(struct d3dx9_base_ef
 static HRESULT d3dx9_base_effect_set_matrix_transpose_pointer_array(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, const D3DXMATRIX **matrix, UINT count)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && count <= param->element_count)
     {
@@ -2398,7 +2416,7 @@ static HRESULT d3dx9_base_effect_get_string(struct d3dx9_base_effect *base,
 static HRESULT d3dx9_base_effect_set_texture(struct d3dx9_base_effect *base,
         D3DXHANDLE parameter, struct IDirect3DBaseTexture9 *texture)
 {
-    struct d3dx_parameter *param = get_valid_parameter(base, parameter);
+    struct d3dx_parameter *param = get_valid_parameter_for_write(base, parameter);
 
     if (param && !param->element_count &&
             (param->type == D3DXPT_TEXTURE || param->type == D3DXPT_TEXTURE1D
@@ -5003,6 +5021,16 @@ static void sync_param_handles(struct d3dx9_base_effect *base)
         table->table[i]->handle = (D3DXHANDLE)&table->table[i];
 }
 
+static void set_top_level_param(struct d3dx_parameter *param, struct d3dx_parameter *top_level_param)
+{
+    unsigned int i, count;
+
+    param->top_level_param = top_level_param;
+    count = param->element_count ? param->element_count : param->member_count;
+    for (i = 0; i < count; ++i)
+        set_top_level_param(&param->members[i], top_level_param);
+}
+
 static HRESULT d3dx9_parse_effect_typedef(struct d3dx9_base_effect *base, struct d3dx_parameter *param,
 	const char *data, const char **ptr, struct d3dx_parameter *parent, UINT flags)
 {
@@ -5216,6 +5244,7 @@ static HRESULT d3dx9_parse_effect_annotation(struct d3dx9_base_effect *base, str
         WARN("Failed to parse type definition\n");
         return hr;
     }
+    set_top_level_param(anno, anno);
 
     read_dword(ptr, &offset);
     TRACE("Value offset: %#x\n", offset);
@@ -5253,6 +5282,7 @@ static HRESULT d3dx9_parse_state(struct d3dx9_base_effect *base, struct d3dx_sta
         WARN("Failed to parse type definition\n");
         goto err_out;
     }
+    set_top_level_param(&state->parameter, &state->parameter);
 
     read_dword(ptr, &offset);
     TRACE("Value offset: %#x\n", offset);
@@ -5299,6 +5329,7 @@ static HRESULT d3dx9_parse_effect_parameter(struct d3dx9_base_effect *base, stru
         WARN("Failed to parse type definition\n");
         return hr;
     }
+    set_top_level_param(param, param);
 
     hr = d3dx9_parse_init_value(base, param, data, data + offset, objects);
     if (hr != D3D_OK)
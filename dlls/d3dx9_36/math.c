@@ -27,6 +27,10 @@
 
 #include "d3dx9_private.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(d3dx);
 
 struct ID3DXMatrixStackImpl
@@ -41,6 +45,50 @@ struct ID3DXMatrixStackImpl
 
 static const unsigned int INITIAL_STACK_SIZE = 32;
 
+#ifdef __SSE__
+/* The SSE helpers compute a vector-matrix product one matrix row at a time,
+ * accumulating the products in the same order as the scalar code does per
+ * component. The results are thus identical to the scalar implementation. */
+static inline void sse_load_matrix(__m128 *rows, const D3DXMATRIX *m)
+{
+    rows[0] = _mm_loadu_ps(m->u.m[0]);
+    rows[1] = _mm_loadu_ps(m->u.m[1]);
+    rows[2] = _mm_loadu_ps(m->u.m[2]);
+    rows[3] = _mm_loadu_ps(m->u.m[3]);
+}
+
+static inline __m128 sse_transform_xy(const __m128 *rows, float x, float y)
+{
+    return _mm_add_ps(_mm_mul_ps(rows[0], _mm_set1_ps(x)), _mm_mul_ps(rows[1], _mm_set1_ps(y)));
+}
+
+static inline __m128 sse_transform_xyz(const __m128 *rows, float x, float y, float z)
+{
+    return _mm_add_ps(sse_transform_xy(rows, x, y), _mm_mul_ps(rows[2], _mm_set1_ps(z)));
+}
+
+static inline __m128 sse_transform_xyzw(const __m128 *rows, float x, float y, float z, float w)
+{
+    return _mm_add_ps(sse_transform_xyz(rows, x, y, z), _mm_mul_ps(rows[3], _mm_set1_ps(w)));
+}
+
+static inline __m128 sse_project(__m128 v)
+{
+    return _mm_div_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+static inline void sse_store_xy(float *out, __m128 v)
+{
+    _mm_storel_pi((__m64 *)out, v);
+}
+
+static inline void sse_store_xyz(float *out, __m128 v)
+{
+    _mm_storel_pi((__m64 *)out, v);
+    _mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+}
+#endif
+
 /*_________________D3DXColor____________________*/
 
 D3DXCOLOR* WINAPI D3DXColorAdjustContrast(D3DXCOLOR *pout, const D3DXCOLOR *pc, FLOAT s)
@@ -392,6 +440,18 @@ D3DXMATRIX * WINAPI D3DXMatrixLookAtRH(D3DXMATRIX *out, const D3DXVECTOR3 *eye,
 
 D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, const D3DXMATRIX *pm2)
 {
+#ifdef __SSE__
+    __m128 rows[4], out[4];
+    int i;
+
+    TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
+
+    sse_load_matrix(rows, pm2);
+    for (i = 0; i < 4; ++i)
+        out[i] = sse_transform_xyzw(rows, pm1->u.m[i][0], pm1->u.m[i][1], pm1->u.m[i][2], pm1->u.m[i][3]);
+    for (i = 0; i < 4; ++i)
+        _mm_storeu_ps(pout->u.m[i], out[i]);
+#else
     D3DXMATRIX out;
     int i,j;
 
@@ -406,11 +466,25 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiply(D3DXMATRIX *pout, const D3DXMATRIX *pm1, c
     }
 
     *pout = out;
+#endif
     return pout;
 }
 
 D3DXMATRIX* WINAPI D3DXMatrixMultiplyTranspose(D3DXMATRIX *pout, const D3DXMATRIX *pm1, const D3DXMATRIX *pm2)
 {
+#ifdef __SSE__
+    __m128 rows[4], out[4];
+    int i;
+
+    TRACE("pout %p, pm1 %p, pm2 %p\n", pout, pm1, pm2);
+
+    sse_load_matrix(rows, pm2);
+    for (i = 0; i < 4; ++i)
+        out[i] = sse_transform_xyzw(rows, pm1->u.m[i][0], pm1->u.m[i][1], pm1->u.m[i][2], pm1->u.m[i][3]);
+    _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+    for (i = 0; i < 4; ++i)
+        _mm_storeu_ps(pout->u.m[i], out[i]);
+#else
     D3DXMATRIX temp;
     int i, j;
 
@@ -421,6 +495,7 @@ D3DXMATRIX* WINAPI D3DXMatrixMultiplyTranspose(D3DXMATRIX *pout, const D3DXMATRI
             temp.u.m[j][i] = pm1->u.m[i][0] * pm2->u.m[0][j] + pm1->u.m[i][1] * pm2->u.m[1][j] + pm1->u.m[i][2] * pm2->u.m[2][j] + pm1->u.m[i][3] * pm2->u.m[3][j];
 
     *pout = temp;
+#endif
     return pout;
 }
 
@@ -1324,16 +1399,29 @@ D3DXPLANE* WINAPI D3DXPlaneTransform(D3DXPLANE *pout, const D3DXPLANE *pplane, c
 
 D3DXPLANE* WINAPI D3DXPlaneTransformArray(D3DXPLANE* out, UINT outstride, const D3DXPLANE* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXPLANE *v = (const D3DXPLANE *)((const char *)in + instride * i);
+
+        _mm_storeu_ps((float *)((char *)out + outstride * i), sse_transform_xyzw(rows, v->a, v->b, v->c, v->d));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXPlaneTransform(
             (D3DXPLANE*)((char*)out + outstride * i),
             (const D3DXPLANE*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -1727,16 +1815,29 @@ D3DXVECTOR4* WINAPI D3DXVec2Transform(D3DXVECTOR4 *pout, const D3DXVECTOR2 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec2TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR2* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 *v = (const D3DXVECTOR2 *)((const char *)in + instride * i);
+
+        _mm_storeu_ps((float *)((char *)out + outstride * i), _mm_add_ps(sse_transform_xy(rows, v->x, v->y), rows[3]));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec2Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
             (const D3DXVECTOR2*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -1758,16 +1859,30 @@ D3DXVECTOR2* WINAPI D3DXVec2TransformCoord(D3DXVECTOR2 *pout, const D3DXVECTOR2
 
 D3DXVECTOR2* WINAPI D3DXVec2TransformCoordArray(D3DXVECTOR2* out, UINT outstride, const D3DXVECTOR2* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 *v = (const D3DXVECTOR2 *)((const char *)in + instride * i);
+
+        sse_store_xy((float *)((char *)out + outstride * i),
+                sse_project(_mm_add_ps(sse_transform_xy(rows, v->x, v->y), rows[3])));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec2TransformCoord(
             (D3DXVECTOR2*)((char*)out + outstride * i),
             (const D3DXVECTOR2*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -1784,16 +1899,29 @@ D3DXVECTOR2* WINAPI D3DXVec2TransformNormal(D3DXVECTOR2 *pout, const D3DXVECTOR2
 
 D3DXVECTOR2* WINAPI D3DXVec2TransformNormalArray(D3DXVECTOR2* out, UINT outstride, const D3DXVECTOR2 *in, UINT instride, const D3DXMATRIX *matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR2 *v = (const D3DXVECTOR2 *)((const char *)in + instride * i);
+
+        sse_store_xy((float *)((char *)out + outstride * i), sse_transform_xy(rows, v->x, v->y));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec2TransformNormal(
             (D3DXVECTOR2*)((char*)out + outstride * i),
             (const D3DXVECTOR2*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -1913,16 +2041,29 @@ D3DXVECTOR4* WINAPI D3DXVec3Transform(D3DXVECTOR4 *pout, const D3DXVECTOR3 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec3TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 *v = (const D3DXVECTOR3 *)((const char *)in + instride * i);
+
+        _mm_storeu_ps((float *)((char *)out + outstride * i), _mm_add_ps(sse_transform_xyz(rows, v->x, v->y, v->z), rows[3]));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec3Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
             (const D3DXVECTOR3*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -1946,16 +2087,30 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformCoord(D3DXVECTOR3 *pout, const D3DXVECTOR3
 
 D3DXVECTOR3* WINAPI D3DXVec3TransformCoordArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 *v = (const D3DXVECTOR3 *)((const char *)in + instride * i);
+
+        sse_store_xyz((float *)((char *)out + outstride * i),
+                sse_project(_mm_add_ps(sse_transform_xyz(rows, v->x, v->y, v->z), rows[3])));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec3TransformCoord(
             (D3DXVECTOR3*)((char*)out + outstride * i),
             (const D3DXVECTOR3*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -1974,16 +2129,29 @@ D3DXVECTOR3* WINAPI D3DXVec3TransformNormal(D3DXVECTOR3 *pout, const D3DXVECTOR3
 
 D3DXVECTOR3* WINAPI D3DXVec3TransformNormalArray(D3DXVECTOR3* out, UINT outstride, const D3DXVECTOR3* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR3 *v = (const D3DXVECTOR3 *)((const char *)in + instride * i);
+
+        sse_store_xyz((float *)((char *)out + outstride * i), sse_transform_xyz(rows, v->x, v->y, v->z));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec3TransformNormal(
             (D3DXVECTOR3*)((char*)out + outstride * i),
             (const D3DXVECTOR3*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -2114,16 +2282,29 @@ D3DXVECTOR4* WINAPI D3DXVec4Transform(D3DXVECTOR4 *pout, const D3DXVECTOR4 *pv,
 
 D3DXVECTOR4* WINAPI D3DXVec4TransformArray(D3DXVECTOR4* out, UINT outstride, const D3DXVECTOR4* in, UINT instride, const D3DXMATRIX* matrix, UINT elements)
 {
+#ifdef __SSE__
+    __m128 rows[4];
+#endif
     UINT i;
 
     TRACE("out %p, outstride %u, in %p, instride %u, matrix %p, elements %u\n", out, outstride, in, instride, matrix, elements);
 
+#ifdef __SSE__
+    sse_load_matrix(rows, matrix);
+    for (i = 0; i < elements; ++i)
+    {
+        const D3DXVECTOR4 *v = (const D3DXVECTOR4 *)((const char *)in + instride * i);
+
+        _mm_storeu_ps((float *)((char *)out + outstride * i), sse_transform_xyzw(rows, v->x, v->y, v->z, v->w));
+    }
+#else
     for (i = 0; i < elements; ++i) {
         D3DXVec4Transform(
             (D3DXVECTOR4*)((char*)out + outstride * i),
             (const D3DXVECTOR4*)((const char*)in + instride * i),
             matrix);
     }
+#endif
     return out;
 }
 
@@ -317,18 +317,6 @@ static void regstore_set_double(struct d3dx_regstore *rs, unsigned int table, un
             1u << (reg_idx % PRES_BITMASK_BLOCK_SIZE);
 }
 
-static void regstore_reset_table(struct d3dx_regstore *rs, unsigned int table)
-{
-    unsigned int size;
-
-    size = rs->table_sizes[table] * table_info[table].reg_component_count * table_info[table].component_size;
-
-    memset(rs->tables[table], 0, size);
-    memset(rs->table_value_set[table], 0,
-            sizeof(*rs->table_value_set[table]) *
-            ((rs->table_sizes[table] + PRES_BITMASK_BLOCK_SIZE - 1) / PRES_BITMASK_BLOCK_SIZE));
-}
-
 static void dump_bytecode(void *data, unsigned int size)
 {
     unsigned int *bytecode = (unsigned int *)data;
@@ -738,6 +726,7 @@ void d3dx_create_param_eval(struct d3dx9_base_effect *base_effect, void *byte_co
         goto err_out;
 
     peval->param_type = type;
+    peval->version_counter = get_version_counter_ptr(base_effect);
     switch (type)
     {
         case D3DXPT_VERTEXSHADER:
@@ -1148,6 +1137,42 @@ static HRESULT execute_preshader(struct d3dx_preshader *pres)
     return D3D_OK;
 }
 
+static BOOL is_const_tab_input_dirty(const struct d3dx_const_tab *const_tab)
+{
+    unsigned int i;
+
+    if (!const_tab->update_version)
+        return TRUE;
+
+    for (i = 0; i < const_tab->const_set_count; ++i)
+    {
+        if (const_tab->const_set[i].param->top_level_param->update_version > const_tab->update_version)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* The preshader output registers are kept between evaluations, so the
+ * preshader only needs to run again when one of its inputs has changed. */
+static HRESULT update_preshader(struct d3dx_param_eval *peval)
+{
+    struct d3dx_preshader *pres = &peval->pres;
+    HRESULT hr;
+
+    if (!is_const_tab_input_dirty(&pres->inputs))
+    {
+        TRACE("Preshader inputs unchanged, skipping evaluation.\n");
+        return D3D_OK;
+    }
+
+    set_constants(&pres->regs, &pres->inputs);
+    if (FAILED(hr = execute_preshader(pres)))
+        return hr;
+
+    pres->inputs.update_version = next_update_version(peval->version_counter);
+    return D3D_OK;
+}
+
 HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx_parameter *param, void *param_value)
 {
     HRESULT hr;
@@ -1157,9 +1182,7 @@ HRESULT d3dx_evaluate_parameter(struct d3dx_param_eval *peval, const struct d3dx
 
     TRACE("peval %p, param %p, param_value %p.\n", peval, param, param_value);
 
-    set_constants(&peval->pres.regs, &peval->pres.inputs);
-
-    if (FAILED(hr = execute_preshader(&peval->pres)))
+    if (FAILED(hr = update_preshader(peval)))
         return hr;
 
     elements_table = table_info[PRES_REGTAB_OCONST].reg_component_count
@@ -1242,7 +1265,6 @@ static HRESULT set_shader_constants_device(struct IDirect3DDevice9 *device, stru
         }
         start += count;
     }
-    regstore_reset_table(rs, table);
     return result;
 }
 
@@ -1257,8 +1279,7 @@ HRESULT d3dx_param_eval_set_shader_constants(struct IDirect3DDevice9 *device, st
 
     TRACE("device %p, peval %p, param_type %u.\n", device, peval, peval->param_type);
 
-    set_constants(rs, &pres->inputs);
-    if (FAILED(hr = execute_preshader(pres)))
+    if (FAILED(hr = update_preshader(peval)))
         return hr;
 
     set_constants(rs, &peval->shader_inputs);
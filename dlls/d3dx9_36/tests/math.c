@@ -2366,6 +2366,153 @@ static void test_D3DXVec_Array(void)
     compare_planes(exp_plane, out_plane);
 }
 
+static BOOL compare_floats_exact(const float *exp, const float *got, unsigned int count)
+{
+    return !memcmp(exp, got, count * sizeof(*exp));
+}
+
+static BOOL compare_floats_loose(const float *exp, const float *got, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (exp[i] == got[i] || (exp[i] != exp[i] && got[i] != got[i]))
+            continue;
+        if (!(relative_error(exp[i], got[i]) < admitted_error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+#define check_consistency(exp, got, count, name, m, v) \
+    ok(compare_floats_exact(exp, got, count) || broken(compare_floats_loose(exp, got, count)), \
+            "%s: matrix %u, element %u: expected (%.8e, %.8e), got (%.8e, %.8e)\n", \
+            name, m, v, (exp)[0], (exp)[1], (got)[0], (got)[1])
+
+/* The array transforms and matrix products may be vectorized, check that they
+ * round exactly like the single element functions. */
+static void test_D3DX_array_consistency(void)
+{
+    static const float matrices[][16] =
+    {
+        /* identity */
+        {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f},
+        /* zero */
+        {0.0f},
+        {1.1f, -2.7f, 3.3e-5f, 0.25f, -0.3f, 7.9f, 1.0e7f, -0.125f,
+         4.4f, 0.1f, -6.6f, 0.5f, 12.0f, -13.5f, 0.7f, 2.0f},
+        /* denormals and negative zeroes */
+        {1.0e-39f, -0.0f, 2.0e-40f, 1.0f, -0.0f, -3.0e-39f, 1.0f, -0.0f,
+         5.0e-41f, 1.0f, -0.0f, 1.0e-45f, 1.0f, -1.0e-39f, 0.0f, 1.0f},
+        /* large values cancelling out */
+        {1.0e30f, -1.0e30f, 1.0f, 3.0f, -1.0e30f, 1.0e30f, 1.0e-30f, 3.0f,
+         1.0f, 1.0f, -1.0e30f, 1.0e30f, 1.0e-7f, 1.0e7f, 1.0e30f, 1.0f},
+    };
+    static const D3DXVECTOR4 vectors[] =
+    {
+        {0.0f, 0.0f, 0.0f, 1.0f},
+        {1.0f, 2.0f, 3.0f, 4.0f},
+        {-0.0f, -0.0f, -0.0f, -0.0f},
+        {1.0e-40f, -2.0e-39f, 3.0e-45f, 1.0f},
+        {0.1f, -1.0e-7f, 1.0e7f, 0.3f},
+        {1.0e20f, -1.0e20f, 1.0e-20f, -1.0f},
+        {3.14159265f, 2.71828183f, -1.41421356f, 0.5f},
+    };
+    D3DXVECTOR4 out4[sizeof(vectors) / sizeof(*vectors)], exp4;
+    D3DXVECTOR3 out3[sizeof(vectors) / sizeof(*vectors)], exp3;
+    D3DXVECTOR2 out2[sizeof(vectors) / sizeof(*vectors)], exp2;
+    D3DXPLANE out_plane[sizeof(vectors) / sizeof(*vectors)], exp_plane;
+    const unsigned int vector_count = sizeof(vectors) / sizeof(*vectors);
+    const unsigned int matrix_count = sizeof(matrices) / sizeof(*matrices);
+    D3DXMATRIX mat, mat2, prod, prod_transpose, exp_mat;
+    unsigned int i, j, k;
+
+    for (i = 0; i < matrix_count; ++i)
+    {
+        memcpy(&mat, matrices[i], sizeof(mat));
+
+        D3DXVec4TransformArray(out4, sizeof(*out4), vectors, sizeof(*vectors), &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec4Transform(&exp4, &vectors[j], &mat);
+            check_consistency(&exp4.x, &out4[j].x, 4, "D3DXVec4TransformArray", i, j);
+        }
+
+        D3DXPlaneTransformArray(out_plane, sizeof(*out_plane), (const D3DXPLANE *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXPlaneTransform(&exp_plane, (const D3DXPLANE *)&vectors[j], &mat);
+            check_consistency(&exp_plane.a, &out_plane[j].a, 4, "D3DXPlaneTransformArray", i, j);
+        }
+
+        D3DXVec3TransformArray(out4, sizeof(*out4), (const D3DXVECTOR3 *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec3Transform(&exp4, (const D3DXVECTOR3 *)&vectors[j], &mat);
+            check_consistency(&exp4.x, &out4[j].x, 4, "D3DXVec3TransformArray", i, j);
+        }
+
+        D3DXVec3TransformCoordArray(out3, sizeof(*out3), (const D3DXVECTOR3 *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec3TransformCoord(&exp3, (const D3DXVECTOR3 *)&vectors[j], &mat);
+            check_consistency(&exp3.x, &out3[j].x, 3, "D3DXVec3TransformCoordArray", i, j);
+        }
+
+        D3DXVec3TransformNormalArray(out3, sizeof(*out3), (const D3DXVECTOR3 *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec3TransformNormal(&exp3, (const D3DXVECTOR3 *)&vectors[j], &mat);
+            check_consistency(&exp3.x, &out3[j].x, 3, "D3DXVec3TransformNormalArray", i, j);
+        }
+
+        D3DXVec2TransformArray(out4, sizeof(*out4), (const D3DXVECTOR2 *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec2Transform(&exp4, (const D3DXVECTOR2 *)&vectors[j], &mat);
+            check_consistency(&exp4.x, &out4[j].x, 4, "D3DXVec2TransformArray", i, j);
+        }
+
+        D3DXVec2TransformCoordArray(out2, sizeof(*out2), (const D3DXVECTOR2 *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec2TransformCoord(&exp2, (const D3DXVECTOR2 *)&vectors[j], &mat);
+            check_consistency(&exp2.x, &out2[j].x, 2, "D3DXVec2TransformCoordArray", i, j);
+        }
+
+        D3DXVec2TransformNormalArray(out2, sizeof(*out2), (const D3DXVECTOR2 *)vectors, sizeof(*vectors),
+                &mat, vector_count);
+        for (j = 0; j < vector_count; ++j)
+        {
+            D3DXVec2TransformNormal(&exp2, (const D3DXVECTOR2 *)&vectors[j], &mat);
+            check_consistency(&exp2.x, &out2[j].x, 2, "D3DXVec2TransformNormalArray", i, j);
+        }
+
+        /* each row of a product is the matching row of the first matrix
+         * transformed by the second one */
+        for (j = 0; j < matrix_count; ++j)
+        {
+            memcpy(&mat2, matrices[j], sizeof(mat2));
+            D3DXMatrixMultiply(&prod, &mat2, &mat);
+            D3DXMatrixMultiplyTranspose(&prod_transpose, &mat2, &mat);
+            for (k = 0; k < 4; ++k)
+                D3DXVec4Transform((D3DXVECTOR4 *)U(exp_mat).m[k], (const D3DXVECTOR4 *)U(mat2).m[k], &mat);
+            check_consistency(&U(exp_mat).m[0][0], &U(prod).m[0][0], 16, "D3DXMatrixMultiply", i, j);
+
+            D3DXMatrixTranspose(&exp_mat, &exp_mat);
+            check_consistency(&U(exp_mat).m[0][0], &U(prod_transpose).m[0][0], 16,
+                    "D3DXMatrixMultiplyTranspose", i, j);
+        }
+    }
+}
+
 static void test_D3DXFloat_Array(void)
 {
     static const float z = 0.0f;
@@ -3435,6 +3582,7 @@ START_TEST(math)
     test_Matrix_Decompose();
     test_Matrix_Transformation2D();
     test_D3DXVec_Array();
+    test_D3DX_array_consistency();
     test_D3DXFloat_Array();
     test_D3DXSHAdd();
     test_D3DXSHDot();
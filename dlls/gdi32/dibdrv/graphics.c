@@ -26,6 +26,7 @@
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
+WINE_DECLARE_DEBUG_CHANNEL(glyphcache);
 
 struct cached_glyph
 {
@@ -47,6 +48,8 @@ struct cached_font
 {
     struct list           entry;
     LONG                  ref;
+    LONG                  last_used;    /* font_cache_clock value of the last lookup */
+    LONG                  glyph_size;   /* memory used by the cached glyphs */
     DWORD                 hash;
     LOGFONTW              lf;
     XFORM                 xform;
@@ -54,16 +57,35 @@ struct cached_font
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
-static struct list font_cache = LIST_INIT( font_cache );
+/* The font cache is split in shards by font hash, each with its own lock.
+ * Lookups only take the lock shared, the glyphs of a font are added and read
+ * without locking. Unused fonts are evicted least recently used first, when a
+ * shard holds too many of them or when the glyphs use too much memory. */
+#define FONT_CACHE_SHARDS     16
+#define FONT_CACHE_MAX_UNUSED 5                  /* per shard */
+#define FONT_CACHE_MAX_SIZE   (4 * 1024 * 1024)  /* total glyph memory */
 
-static CRITICAL_SECTION font_cache_cs;
-static CRITICAL_SECTION_DEBUG critsect_debug =
+struct font_cache_shard
 {
-    0, 0, &font_cache_cs,
-    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
-      0, 0, { (DWORD_PTR)(__FILE__ ": font_cache_cs") }
+    SRWLOCK     lock;
+    struct list fonts;
 };
-static CRITICAL_SECTION font_cache_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+#define FONT_CACHE_SHARD(i) { SRWLOCK_INIT, LIST_INIT( font_cache[i].fonts ) }
+
+static struct font_cache_shard font_cache[FONT_CACHE_SHARDS] =
+{
+    FONT_CACHE_SHARD(0),  FONT_CACHE_SHARD(1),  FONT_CACHE_SHARD(2),  FONT_CACHE_SHARD(3),
+    FONT_CACHE_SHARD(4),  FONT_CACHE_SHARD(5),  FONT_CACHE_SHARD(6),  FONT_CACHE_SHARD(7),
+    FONT_CACHE_SHARD(8),  FONT_CACHE_SHARD(9),  FONT_CACHE_SHARD(10), FONT_CACHE_SHARD(11),
+    FONT_CACHE_SHARD(12), FONT_CACHE_SHARD(13), FONT_CACHE_SHARD(14), FONT_CACHE_SHARD(15)
+};
+
+static LONG font_cache_clock;
+static LONG font_cache_size;
+
+/* statistics, only collected when the glyphcache channel is enabled */
+static LONG glyph_cache_hits, glyph_cache_misses, glyph_cache_evictions;
 
 
 static BOOL brush_rect( dibdrv_physdev *pdev, dib_brush *brush, const RECT *rect, HRGN clip )
@@ -552,10 +574,85 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_font( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+    InterlockedExchangeAdd( &font_cache_size, -font->glyph_size );
+    if (TRACE_ON(glyphcache)) InterlockedIncrement( &glyph_cache_evictions );
+    HeapFree( GetProcessHeap(), 0, font );
+}
+
+/* find the least recently used font that is not selected anywhere; shard lock must be held */
+static struct cached_font *find_unused_font( struct font_cache_shard *shard, UINT *count )
+{
+    struct cached_font *ptr, *ret = NULL;
+
+    *count = 0;
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
+    {
+        if (ptr->ref) continue;
+        (*count)++;
+        if (!ret || ptr->last_used - ret->last_used < 0) ret = ptr;
+    }
+    return ret;
+}
+
+/* evict unused fonts across all shards until the glyph memory is below the limit */
+static void trim_font_cache(void)
+{
+    struct cached_font *font;
+    UINT i, count, shard;
+    LONG oldest_used;
+    BOOL found;
+
+    while (font_cache_size > FONT_CACHE_MAX_SIZE)
+    {
+        /* only remember the candidate's shard and clock value, the font itself
+         * can go away as soon as its shard lock is released */
+        found = FALSE;
+        oldest_used = 0;
+        shard = 0;
+        for (i = 0; i < FONT_CACHE_SHARDS; i++)
+        {
+            AcquireSRWLockShared( &font_cache[i].lock );
+            font = find_unused_font( &font_cache[i], &count );
+            if (font && (!found || font->last_used - oldest_used < 0))
+            {
+                found = TRUE;
+                oldest_used = font->last_used;
+                shard = i;
+            }
+            ReleaseSRWLockShared( &font_cache[i].lock );
+        }
+        if (!found) break;
+
+        /* the font may have been used or evicted in the meantime, check again;
+         * clock values are never reused so a new font can't match */
+        AcquireSRWLockExclusive( &font_cache[shard].lock );
+        font = find_unused_font( &font_cache[shard], &count );
+        if (font && font->last_used == oldest_used) list_remove( &font->entry );
+        else font = NULL;
+        ReleaseSRWLockExclusive( &font_cache[shard].lock );
+        if (font) free_cached_font( font );
+    }
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr, *new_font, *unused = NULL;
+    struct font_cache_shard *shard;
+    UINT count;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -569,66 +666,73 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     font.lf.lfWidth = abs( font.lf.lfWidth );
     font.aa_flags = aa_flags;
     font.hash = font_cache_hash( &font );
+    shard = &font_cache[font.hash % FONT_CACHE_SHARDS];
 
-    EnterCriticalSection( &font_cache_cs );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    AcquireSRWLockShared( &shard->lock );
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
     {
         if (!font_cache_cmp( &font, ptr ))
         {
             InterlockedIncrement( &ptr->ref );
-            list_remove( &ptr->entry );
+            ptr->last_used = InterlockedIncrement( &font_cache_clock );
+            ReleaseSRWLockShared( &shard->lock );
             goto done;
         }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
     }
+    ReleaseSRWLockShared( &shard->lock );
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    if (!(new_font = HeapAlloc( GetProcessHeap(), 0, sizeof(*new_font) ))) return NULL;
+    *new_font = font;
+    new_font->ref = 1;
+    new_font->last_used = InterlockedIncrement( &font_cache_clock );
+    new_font->glyph_size = 0;
+    memset( new_font->glyphs, 0, sizeof(new_font->glyphs) );
+
+    AcquireSRWLockExclusive( &shard->lock );
+    /* another thread may have added it in the meantime */
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
     {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
+        if (!font_cache_cmp( &font, ptr ))
         {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
+            InterlockedIncrement( &ptr->ref );
+            ptr->last_used = new_font->last_used;
+            ReleaseSRWLockExclusive( &shard->lock );
+            HeapFree( GetProcessHeap(), 0, new_font );
+            goto done;
         }
-        list_remove( &ptr->entry );
-    }
-    else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
-    {
-        LeaveCriticalSection( &font_cache_cs );
-        return NULL;
     }
+    ptr = new_font;
+    list_add_head( &shard->fonts, &ptr->entry );
+
+    /* keep a few of the most recently used fonts around */
+    if ((unused = find_unused_font( shard, &count )) && count > FONT_CACHE_MAX_UNUSED)
+        list_remove( &unused->entry );
+    else
+        unused = NULL;
+    ReleaseSRWLockExclusive( &shard->lock );
+
+    if (unused) free_cached_font( unused );
+    trim_font_cache();
 
-    *ptr = font;
-    ptr->ref = 1;
-    memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
-    list_add_head( &font_cache, &ptr->entry );
-    LeaveCriticalSection( &font_cache_cs );
     TRACE( "%d %s -> %p\n", ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
     return ptr;
 }
 
 void release_cached_font( struct cached_font *font )
 {
-    if (font) InterlockedDecrement( &font->ref );
+    if (font && !InterlockedDecrement( &font->ref ) && font_cache_size > FONT_CACHE_MAX_SIZE)
+        trim_font_cache();
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, DWORD size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
     UINT page = index / GLYPH_CACHE_PAGE_SIZE;
     UINT entry = index % GLYPH_CACHE_PAGE_SIZE;
+    LONG added = 0;
 
     if (!font->glyphs[type][page])
     {
@@ -642,10 +746,22 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         }
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             HeapFree( GetProcessHeap(), 0, ptr );
+        else
+            added += GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr);
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        ret = glyph;
+        added += size;
+    }
     else HeapFree( GetProcessHeap(), 0, glyph );
+
+    if (added)
+    {
+        InterlockedExchangeAdd( &font->glyph_size, added );
+        InterlockedExchangeAdd( &font_cache_size, added );
+    }
     return ret;
 }
 
@@ -803,7 +919,26 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
+}
+
+static void count_glyph_lookup( BOOL hit )
+{
+    LONG hits, misses;
+
+    if (hit)
+    {
+        hits = InterlockedIncrement( &glyph_cache_hits );
+        misses = glyph_cache_misses;
+    }
+    else
+    {
+        misses = InterlockedIncrement( &glyph_cache_misses );
+        hits = glyph_cache_hits;
+    }
+    if ((hits + misses) % 0x1000) return;
+    TRACE_(glyphcache)( "%d hits, %d misses, %d fonts evicted, %d bytes of glyphs\n",
+                        hits, misses, glyph_cache_evictions, font_cache_size );
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
@@ -829,8 +964,12 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
 
     for (i = 0; i < count; i++)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        if (!(glyph = get_cached_glyph( font, str[i], flags )))
+        {
+            if (TRACE_ON(glyphcache)) count_glyph_lookup( FALSE );
+            if (!(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        }
+        else if (TRACE_ON(glyphcache)) count_glyph_lookup( TRUE );
 
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
@@ -173,6 +173,7 @@ static FT_Error (*pFT_Library_SetLcdFilter)(FT_Library, FT_LcdFilter);
 
 #ifdef SONAME_LIBFONTCONFIG
 #include <fontconfig/fontconfig.h>
+MAKE_FUNCPTR(FcConfigGetFontDirs);
 MAKE_FUNCPTR(FcConfigSubstitute);
 MAKE_FUNCPTR(FcFontList);
 MAKE_FUNCPTR(FcFontSetDestroy);
@@ -185,6 +186,8 @@ MAKE_FUNCPTR(FcPatternDestroy);
 MAKE_FUNCPTR(FcPatternGetBool);
 MAKE_FUNCPTR(FcPatternGetInteger);
 MAKE_FUNCPTR(FcPatternGetString);
+MAKE_FUNCPTR(FcStrListDone);
+MAKE_FUNCPTR(FcStrListNext);
 #endif
 
 #undef MAKE_FUNCPTR
@@ -292,6 +295,8 @@ typedef struct tagFace {
 
 typedef struct tagFamily {
     struct list entry;
+    struct list name_entry;     /* entry in the family name hash table */
+    struct list english_entry;  /* entry in the english name hash table */
     unsigned int refcount;
     WCHAR *FamilyName;
     WCHAR *EnglishName;
@@ -595,6 +600,77 @@ struct font_mapping
 
 static struct list mappings_list = LIST_INIT( mappings_list );
 
+#define FAMILY_HASH_SIZE 509
+
+static struct list family_name_hash[FAMILY_HASH_SIZE];
+static struct list family_english_hash[FAMILY_HASH_SIZE];
+
+/* Binary font index, a snapshot of the font list built by init_font_list() that
+ * is mapped by the following processes instead of scanning the fonts again.
+ * It is kept in the prefix and rebuilt when a font directory or the font
+ * registry keys change. */
+#define FONT_INDEX_MAGIC   0x58444946  /* "FIDX" */
+#define FONT_INDEX_VERSION 1
+
+struct font_index_header
+{
+    DWORD     magic;
+    DWORD     version;
+    DWORD     size;           /* size of the whole index */
+    DWORD     key;            /* hash of the settings the index was built with */
+    FILETIME  fonts_key_time; /* last write time of the Fonts registry key */
+    DWORD     dir_count;      /* number of struct font_index_dir following the header */
+    DWORD     family_count;   /* number of families following the dirs */
+};
+
+struct font_index_dir
+{
+    ULONGLONG mtime;
+    DWORD     name;           /* offset of the unix name, strings are stored as WCHARs */
+    DWORD     pad;
+};
+
+/* each family is followed by its faces */
+struct font_index_family
+{
+    DWORD     name;
+    DWORD     english_name;   /* 0 if none */
+    DWORD     face_count;
+};
+
+struct font_index_face
+{
+    ULONGLONG     dev;
+    ULONGLONG     ino;
+    DWORD         style_name;
+    DWORD         full_name;  /* 0 if none */
+    DWORD         file;
+    DWORD         flags;
+    LONG          face_index;
+    LONG          font_version;
+    DWORD         ntm_flags;
+    DWORD         scalable;
+    FONTSIGNATURE fs;
+    SHORT         height;
+    SHORT         width;
+    LONG          size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+    SHORT         internal_leading;
+    SHORT         pad;
+};
+
+struct font_index
+{
+    BYTE  *data;
+    DWORD  pos;               /* end of the fixed size records */
+    DWORD  str_pos;           /* end of the strings */
+};
+
+static BOOL font_index_building;
+static char **font_index_dirs;
+static unsigned int font_index_dirs_count, font_index_dirs_size;
+
 static UINT default_aa_flags;
 static HKEY hkey_font_cache;
 static BOOL antialias_fakes = TRUE;
@@ -1048,11 +1124,39 @@ static Face *find_face_from_filename(const WCHAR *file_name, const WCHAR *face_n
     return NULL;
 }
 
+static inline unsigned int hash_family_name(const WCHAR *name)
+{
+    unsigned int hash = 0;
+
+    while (*name) hash = hash * 31 + tolowerW(*name++);
+    return hash % FAMILY_HASH_SIZE;
+}
+
+static void init_family_hash(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < FAMILY_HASH_SIZE; i++)
+    {
+        list_init(&family_name_hash[i]);
+        list_init(&family_english_hash[i]);
+    }
+}
+
+static void add_family_to_hash(Family *family)
+{
+    list_add_tail(&family_name_hash[hash_family_name(family->FamilyName)], &family->name_entry);
+    if (family->EnglishName)
+        list_add_tail(&family_english_hash[hash_family_name(family->EnglishName)], &family->english_entry);
+    else
+        list_init(&family->english_entry);
+}
+
 static Family *find_family_from_name(const WCHAR *name)
 {
     Family *family;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    LIST_FOR_EACH_ENTRY(family, &family_name_hash[hash_family_name(name)], Family, name_entry)
     {
         if(!strcmpiW(family->FamilyName, name))
             return family;
@@ -1065,11 +1169,12 @@ static Family *find_family_from_any_name(const WCHAR *name)
 {
     Family *family;
 
-    LIST_FOR_EACH_ENTRY(family, &font_list, Family, entry)
+    if ((family = find_family_from_name(name)))
+        return family;
+
+    LIST_FOR_EACH_ENTRY(family, &family_english_hash[hash_family_name(name)], Family, english_entry)
     {
-        if(!strcmpiW(family->FamilyName, name))
-            return family;
-        if(family->EnglishName && !strcmpiW(family->EnglishName, name))
+        if(!strcmpiW(family->EnglishName, name))
             return family;
     }
 
@@ -1483,6 +1588,8 @@ static void release_family( Family *family )
     if (--family->refcount) return;
     assert( list_empty( &family->faces ));
     list_remove( &family->entry );
+    list_remove( &family->name_entry );
+    list_remove( &family->english_entry );
     HeapFree( GetProcessHeap(), 0, family->FamilyName );
     HeapFree( GetProcessHeap(), 0, family->EnglishName );
     HeapFree( GetProcessHeap(), 0, family );
@@ -1588,6 +1695,7 @@ static Family *create_family( WCHAR *name, WCHAR *english_name )
     list_init( &family->faces );
     family->replacement = &family->faces;
     list_add_tail( &font_list, &family->entry );
+    add_family_to_hash( family );
 
     return family;
 }
@@ -1735,6 +1843,35 @@ static void reorder_vertical_fonts(void)
     list_move_tail( &font_list, &vertical_families );
 }
 
+/* drop the fonts that were removed from the session with RemoveFontResource */
+static void remove_session_removed_fonts(HKEY hkey_font_cache)
+{
+    Family *family, *family_next;
+    Face *face, *face_next;
+    DWORD size, type, index = 0;
+    WCHAR buffer[4096];
+
+    size = sizeof(buffer) / sizeof(WCHAR);
+    while (!RegEnumValueW(hkey_font_cache, index++, buffer, &size, NULL, &type, NULL, NULL))
+    {
+        size = sizeof(buffer) / sizeof(WCHAR);
+        if (type != REG_DWORD) continue;
+        LIST_FOR_EACH_ENTRY_SAFE( family, family_next, &font_list, Family, entry )
+        {
+            family->refcount++;
+            LIST_FOR_EACH_ENTRY_SAFE( face, face_next, &family->faces, Face, entry )
+            {
+                if (!face->file || strcmpiW( face->file, buffer )) continue;
+                TRACE( "removing %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName) );
+                /* it is already recorded as removed */
+                face->flags &= ~ADDFONT_ADD_TO_CACHE;
+                release_face( face );
+            }
+            release_family( family );
+        }
+    }
+}
+
 static void load_font_list_from_cache(HKEY hkey_font_cache)
 {
     DWORD size, family_index = 0;
@@ -1786,7 +1923,7 @@ static void load_font_list_from_cache(HKEY hkey_font_cache)
         size = sizeof(buffer);
     }
 
-    reorder_vertical_fonts();
+    if (family_index > 1) reorder_vertical_fonts();
 }
 
 static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
@@ -1809,11 +1946,30 @@ static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
     return ret;
 }
 
+static void add_font_index_dir( const char *dir );
+
 static void add_face_to_cache(Face *face)
 {
     HKEY hkey_family, hkey_face;
     WCHAR *face_key_name;
 
+    /* fonts found while building the font list are stored in the font index */
+    if (font_index_building)
+    {
+        char *dir = strWtoA( CP_UNIXCP, face->file ), *p;
+
+        if (dir && (p = strrchr( dir, '/' )))
+        {
+            *p = 0;
+            add_font_index_dir( dir );
+        }
+        HeapFree( GetProcessHeap(), 0, dir );
+        return;
+    }
+
+    /* the font may have been removed from the session earlier */
+    RegDeleteValueW( hkey_font_cache, face->file );
+
     RegCreateKeyExW(hkey_font_cache, face->family->FamilyName, 0,
                     NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &hkey_family, NULL);
     if(face->family->EnglishName)
@@ -1863,7 +2019,12 @@ static void remove_face_from_cache( Face *face )
 {
     HKEY hkey_family;
 
-    RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
+    /* faces from the font index are not in the registry, record the file as
+     * removed so that the other processes of the session skip it too */
+    reg_save_dword( hkey_font_cache, face->file, 1 );
+
+    if (RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family ))
+        return;
 
     if (face->scalable)
     {
@@ -1880,6 +2041,454 @@ static void remove_face_from_cache( Face *face )
     RegCloseKey(hkey_family);
 }
 
+static ULONGLONG get_dir_mtime( const char *dir )
+{
+    struct stat st;
+
+    if (stat( dir, &st ) == -1) return 0;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return (ULONGLONG)st.st_mtime * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    return st.st_mtime;
+#endif
+}
+
+/* remember a directory the font list depends on, with its current mtime */
+static void add_font_index_dir( const char *dir )
+{
+    unsigned int i;
+    char *name;
+
+    for (i = 0; i < font_index_dirs_count; i++)
+        if (!strcmp( font_index_dirs[i] + sizeof(ULONGLONG), dir )) return;
+
+    if (font_index_dirs_count == font_index_dirs_size)
+    {
+        unsigned int new_size = max( 16, font_index_dirs_size * 2 );
+        char **new_dirs;
+
+        if (font_index_dirs)
+            new_dirs = HeapReAlloc( GetProcessHeap(), 0, font_index_dirs, new_size * sizeof(*new_dirs) );
+        else
+            new_dirs = HeapAlloc( GetProcessHeap(), 0, new_size * sizeof(*new_dirs) );
+        if (!new_dirs) return;
+        font_index_dirs = new_dirs;
+        font_index_dirs_size = new_size;
+    }
+
+    /* the mtime is stored in front of the name */
+    if (!(name = HeapAlloc( GetProcessHeap(), 0, sizeof(ULONGLONG) + strlen(dir) + 1 ))) return;
+    *(ULONGLONG *)name = get_dir_mtime( dir );
+    strcpy( name + sizeof(ULONGLONG), dir );
+    font_index_dirs[font_index_dirs_count++] = name;
+}
+
+static void free_font_index_dirs(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < font_index_dirs_count; i++) HeapFree( GetProcessHeap(), 0, font_index_dirs[i] );
+    HeapFree( GetProcessHeap(), 0, font_index_dirs );
+    font_index_dirs = NULL;
+    font_index_dirs_count = font_index_dirs_size = 0;
+}
+
+static char *get_font_index_path( const char *suffix )
+{
+    static const char nameA[] = "/fontindex";
+    const char *dir = wine_get_config_dir();
+    char *path;
+
+    if ((path = HeapAlloc( GetProcessHeap(), 0, strlen(dir) + sizeof(nameA) + strlen(suffix) )))
+    {
+        strcpy( path, dir );
+        strcat( path, nameA );
+        strcat( path, suffix );
+    }
+    return path;
+}
+
+static DWORD hash_font_index_data( DWORD hash, const void *data, DWORD size )
+{
+    const BYTE *ptr = data;
+
+    while (size--) hash = (hash ^ *ptr++) * 16777619;
+    return hash;
+}
+
+#ifdef SONAME_LIBFONTCONFIG
+static DWORD hash_fontconfig_dirs( DWORD hash );
+#endif
+
+/* hash the settings that change the result of init_font_list() */
+static DWORD get_font_index_key(void)
+{
+    static const WCHAR pathW[] = {'P','a','t','h',0};
+    DWORD values[6], hash = 2166136261u, size;
+    WCHAR *path;
+    HKEY hkey;
+
+    values[0] = FONT_INDEX_VERSION;
+    values[1] = GetSystemDefaultLCID();
+    values[2] = GetACP();
+    values[3] = default_aa_flags;
+    values[4] = FT_SimpleVersion;
+    values[5] = is_win9x();
+    hash = hash_font_index_data( hash, values, sizeof(values) );
+
+    if (!RegOpenKeyExW( HKEY_CURRENT_USER, wine_fonts_key, 0, KEY_READ, &hkey ))
+    {
+        if (!RegQueryValueExW( hkey, pathW, NULL, NULL, NULL, &size ) &&
+            (path = HeapAlloc( GetProcessHeap(), 0, size )))
+        {
+            if (!RegQueryValueExW( hkey, pathW, NULL, NULL, (BYTE *)path, &size ))
+                hash = hash_font_index_data( hash, path, size );
+            HeapFree( GetProcessHeap(), 0, path );
+        }
+        RegCloseKey( hkey );
+    }
+#ifdef SONAME_LIBFONTCONFIG
+    hash = hash_fontconfig_dirs( hash );
+#endif
+    return hash;
+}
+
+static void get_fonts_key_time( FILETIME *time )
+{
+    HKEY hkey;
+
+    memset( time, 0, sizeof(*time) );
+    if (!RegOpenKeyW( HKEY_LOCAL_MACHINE, is_win9x() ? win9x_font_reg_key : winnt_font_reg_key, &hkey ))
+    {
+        RegQueryInfoKeyW( hkey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, time );
+        RegCloseKey( hkey );
+    }
+}
+
+/* the index is built twice, first without data to compute the sizes */
+static void add_font_index_data( struct font_index *index, const void *data, DWORD size )
+{
+    if (index->data) memcpy( index->data + index->pos, data, size );
+    index->pos += size;
+}
+
+static DWORD add_font_index_string( struct font_index *index, const WCHAR *str )
+{
+    DWORD ret = index->str_pos, len;
+
+    if (!str) return 0;
+    len = (strlenW( str ) + 1) * sizeof(WCHAR);
+    if (index->data) memcpy( index->data + ret, str, len );
+    index->str_pos += len;
+    return ret;
+}
+
+static inline BOOL is_indexed_face( const Face *face )
+{
+    return face->file && (face->flags & ADDFONT_ADD_TO_CACHE);
+}
+
+static void fill_font_index( struct font_index *index )
+{
+    struct font_index_header header;
+    struct font_index_dir dir;
+    struct font_index_family family_rec;
+    struct font_index_face face_rec;
+    const Family *family;
+    const Face *face;
+    WCHAR *name;
+    unsigned int i;
+
+    memset( &header, 0, sizeof(header) );
+    header.magic = FONT_INDEX_MAGIC;
+    header.version = FONT_INDEX_VERSION;
+    header.key = get_font_index_key();
+    header.dir_count = font_index_dirs_count;
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!is_indexed_face( face )) continue;
+            header.family_count++;
+            break;
+        }
+    }
+    add_font_index_data( index, &header, sizeof(header) );
+
+    for (i = 0; i < font_index_dirs_count; i++)
+    {
+        dir.mtime = *(ULONGLONG *)font_index_dirs[i];
+        name = towstr( CP_UNIXCP, font_index_dirs[i] + sizeof(ULONGLONG) );
+        dir.name = add_font_index_string( index, name );
+        dir.pad = 0;
+        HeapFree( GetProcessHeap(), 0, name );
+        add_font_index_data( index, &dir, sizeof(dir) );
+    }
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+    {
+        family_rec.face_count = 0;
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+            if (is_indexed_face( face )) family_rec.face_count++;
+        if (!family_rec.face_count) continue;
+
+        family_rec.name = add_font_index_string( index, family->FamilyName );
+        family_rec.english_name = add_font_index_string( index, family->EnglishName );
+        add_font_index_data( index, &family_rec, sizeof(family_rec) );
+
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+        {
+            if (!is_indexed_face( face )) continue;
+            memset( &face_rec, 0, sizeof(face_rec) );
+            face_rec.dev = face->dev;
+            face_rec.ino = face->ino;
+            face_rec.style_name = add_font_index_string( index, face->StyleName );
+            face_rec.full_name = add_font_index_string( index, face->FullName );
+            face_rec.file = add_font_index_string( index, face->file );
+            face_rec.flags = face->flags;
+            face_rec.face_index = face->face_index;
+            face_rec.font_version = face->font_version;
+            face_rec.ntm_flags = face->ntmFlags;
+            face_rec.scalable = face->scalable;
+            face_rec.fs = face->fs;
+            face_rec.height = face->size.height;
+            face_rec.width = face->size.width;
+            face_rec.size = face->size.size;
+            face_rec.x_ppem = face->size.x_ppem;
+            face_rec.y_ppem = face->size.y_ppem;
+            face_rec.internal_leading = face->size.internal_leading;
+            add_font_index_data( index, &face_rec, sizeof(face_rec) );
+        }
+    }
+}
+
+/* serialize the fonts found by init_font_list() */
+static void create_font_index( struct font_index *index )
+{
+    DWORD strings_pos;
+
+    index->data = NULL;
+    index->pos = index->str_pos = 0;
+    fill_font_index( index );
+
+    strings_pos = index->pos;
+    /* the index ends with an empty string, so every string is terminated */
+    if ((index->data = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                  index->pos + index->str_pos + sizeof(WCHAR) )))
+    {
+        index->pos = 0;
+        index->str_pos = strings_pos;
+        fill_font_index( index );
+        index->pos = index->str_pos + sizeof(WCHAR);
+        ((struct font_index_header *)index->data)->size = index->pos;
+    }
+    free_font_index_dirs();
+}
+
+static void save_font_index( struct font_index *index )
+{
+    char *path, *tmp_path = NULL;
+    BOOL ret = FALSE;
+    int fd;
+
+    if (!index->data) return;
+
+    /* the Fonts key is updated by update_reg_entries(), get the time afterwards */
+    get_fonts_key_time( &((struct font_index_header *)index->data)->fonts_key_time );
+
+    if ((path = get_font_index_path( "" )) && (tmp_path = get_font_index_path( ".tmp" )) &&
+        (fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+    {
+        ret = write( fd, index->data, index->pos ) == index->pos;
+        if (close( fd )) ret = FALSE;
+        if (ret) ret = !rename( tmp_path, path );
+        if (!ret) unlink( tmp_path );
+    }
+    if (ret) TRACE( "saved font index %s, %u bytes\n", debugstr_a(path), index->pos );
+    else WARN( "failed to save font index %s\n", debugstr_a(path) );
+
+    HeapFree( GetProcessHeap(), 0, tmp_path );
+    HeapFree( GetProcessHeap(), 0, path );
+    HeapFree( GetProcessHeap(), 0, index->data );
+    index->data = NULL;
+}
+
+static inline const WCHAR *get_font_index_string( const BYTE *data, DWORD offset )
+{
+    return offset ? (const WCHAR *)(data + offset) : NULL;
+}
+
+static BOOL check_font_index_string( const struct font_index_header *header, DWORD offset, BOOL optional )
+{
+    if (!offset) return optional;
+    return offset >= sizeof(*header) && offset < header->size && !(offset % sizeof(WCHAR));
+}
+
+/* check that the index is intact and up to date */
+static BOOL check_font_index( const BYTE *data, DWORD size )
+{
+    const struct font_index_header *header = (const struct font_index_header *)data;
+    const struct font_index_dir *dir;
+    const struct font_index_family *family;
+    const struct font_index_face *face;
+    const BYTE *end = data + size, *ptr;
+    FILETIME time;
+    DWORD i, j;
+    char *name;
+
+    if (size < sizeof(*header) + sizeof(WCHAR) || header->magic != FONT_INDEX_MAGIC ||
+        header->version != FONT_INDEX_VERSION || header->size != size ||
+        *(const WCHAR *)(end - sizeof(WCHAR)))
+        return FALSE;
+
+    if (header->key != get_font_index_key())
+    {
+        TRACE( "font settings changed\n" );
+        return FALSE;
+    }
+    get_fonts_key_time( &time );
+    if (CompareFileTime( &time, &header->fonts_key_time ))
+    {
+        TRACE( "font registry key changed\n" );
+        return FALSE;
+    }
+
+    ptr = (const BYTE *)(header + 1);
+    for (i = 0; i < header->dir_count; i++)
+    {
+        dir = (const struct font_index_dir *)ptr;
+        if ((ptr += sizeof(*dir)) > end || !check_font_index_string( header, dir->name, FALSE ))
+            return FALSE;
+        if (!(name = strWtoA( CP_UNIXCP, get_font_index_string( data, dir->name ))))
+            return FALSE;
+        if (get_dir_mtime( name ) != dir->mtime)
+        {
+            TRACE( "%s changed\n", debugstr_a(name) );
+            HeapFree( GetProcessHeap(), 0, name );
+            return FALSE;
+        }
+        HeapFree( GetProcessHeap(), 0, name );
+    }
+
+    for (i = 0; i < header->family_count; i++)
+    {
+        family = (const struct font_index_family *)ptr;
+        if ((ptr += sizeof(*family)) > end ||
+            !check_font_index_string( header, family->name, FALSE ) ||
+            !check_font_index_string( header, family->english_name, TRUE ))
+            return FALSE;
+        for (j = 0; j < family->face_count; j++)
+        {
+            face = (const struct font_index_face *)ptr;
+            if ((ptr += sizeof(*face)) > end ||
+                !check_font_index_string( header, face->style_name, FALSE ) ||
+                !check_font_index_string( header, face->full_name, TRUE ) ||
+                !check_font_index_string( header, face->file, FALSE ))
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static BOOL load_font_list_from_index(void)
+{
+    const struct font_index_header *header;
+    const struct font_index_family *family_rec;
+    const struct font_index_face *face_rec;
+    const BYTE *data, *ptr;
+    struct stat st;
+    char *path;
+    DWORD i, j;
+    BOOL ret;
+    int fd;
+
+    if (!(path = get_font_index_path( "" ))) return FALSE;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return FALSE;
+
+    if (fstat( fd, &st ) == -1 || !st.st_size ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return FALSE;
+    }
+    close( fd );
+
+    if (!(ret = check_font_index( data, st.st_size )))
+    {
+        TRACE( "rebuilding the font index\n" );
+        goto done;
+    }
+
+    header = (const struct font_index_header *)data;
+    ptr = (const BYTE *)(header + 1) + header->dir_count * sizeof(struct font_index_dir);
+    for (i = 0; i < header->family_count; i++)
+    {
+        Family *family;
+        WCHAR *family_name, *english_family = NULL;
+
+        family_rec = (const struct font_index_family *)ptr;
+        ptr += sizeof(*family_rec);
+
+        family_name = strdupW( get_font_index_string( data, family_rec->name ));
+        if (family_rec->english_name)
+            english_family = strdupW( get_font_index_string( data, family_rec->english_name ));
+        family = create_family( family_name, english_family );
+
+        if (english_family)
+        {
+            FontSubst *subst = HeapAlloc( GetProcessHeap(), 0, sizeof(*subst) );
+            subst->from.name = strdupW( english_family );
+            subst->from.charset = -1;
+            subst->to.name = strdupW( family_name );
+            subst->to.charset = -1;
+            add_font_subst( &font_subst_list, subst, 0 );
+        }
+
+        for (j = 0; j < family_rec->face_count; j++)
+        {
+            Face *face = HeapAlloc( GetProcessHeap(), 0, sizeof(*face) );
+
+            face_rec = (const struct font_index_face *)ptr;
+            ptr += sizeof(*face_rec);
+
+            face->refcount = 1;
+            face->StyleName = strdupW( get_font_index_string( data, face_rec->style_name ));
+            face->FullName = face_rec->full_name ? strdupW( get_font_index_string( data, face_rec->full_name )) : NULL;
+            face->file = strdupW( get_font_index_string( data, face_rec->file ));
+            face->dev = face_rec->dev;
+            face->ino = face_rec->ino;
+            face->font_data_ptr = NULL;
+            face->font_data_size = 0;
+            face->face_index = face_rec->face_index;
+            face->fs = face_rec->fs;
+            face->ntmFlags = face_rec->ntm_flags;
+            face->font_version = face_rec->font_version;
+            face->scalable = face_rec->scalable;
+            face->size.height = face_rec->height;
+            face->size.width = face_rec->width;
+            face->size.size = face_rec->size;
+            face->size.x_ppem = face_rec->x_ppem;
+            face->size.y_ppem = face_rec->y_ppem;
+            face->size.internal_leading = face_rec->internal_leading;
+            face->flags = face_rec->flags;
+            face->family = NULL;
+            face->cached_enum_data = NULL;
+
+            if (insert_face_in_family_list( face, family ))
+                TRACE( "Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName) );
+            release_face( face );
+        }
+        release_family( family );
+    }
+    TRACE( "loaded %u families from the font index\n", header->family_count );
+
+done:
+    munmap( (void *)data, st.st_size );
+    return ret;
+}
+
 static WCHAR *prepend_at(WCHAR *family)
 {
     WCHAR *str;
@@ -2356,6 +2965,7 @@ static BOOL map_font_family(const WCHAR *orig, const WCHAR *repl)
             list_init(&new_family->faces);
             new_family->replacement = &family->faces;
             list_add_tail(&font_list, &new_family->entry);
+            add_family_to_hash(new_family);
             return TRUE;
         }
     }
@@ -2725,6 +3335,8 @@ static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
 
     TRACE("Loading fonts from %s\n", debugstr_a(dirname));
 
+    if (font_index_building) add_font_index_dir(dirname);
+
     dir = opendir(dirname);
     if(!dir) {
         WARN("Can't open directory %s\n", debugstr_a(dirname));
@@ -2796,6 +3408,7 @@ static void init_fontconfig(void)
     }
 
 #define LOAD_FUNCPTR(f) if((p##f = wine_dlsym(fc_handle, #f, NULL, 0)) == NULL){WARN("Can't find symbol %s\n", #f); return;}
+    LOAD_FUNCPTR(FcConfigGetFontDirs);
     LOAD_FUNCPTR(FcConfigSubstitute);
     LOAD_FUNCPTR(FcFontList);
     LOAD_FUNCPTR(FcFontSetDestroy);
@@ -2808,6 +3421,8 @@ static void init_fontconfig(void)
     LOAD_FUNCPTR(FcPatternGetBool);
     LOAD_FUNCPTR(FcPatternGetInteger);
     LOAD_FUNCPTR(FcPatternGetString);
+    LOAD_FUNCPTR(FcStrListDone);
+    LOAD_FUNCPTR(FcStrListNext);
 #undef LOAD_FUNCPTR
 
     if (pFcInit())
@@ -2874,6 +3489,24 @@ static void load_fontconfig_fonts(void)
     pFcPatternDestroy(pat);
 }
 
+/* fontconfig font directories and their subdirectories, with their mtimes */
+static DWORD hash_fontconfig_dirs( DWORD hash )
+{
+    FcStrList *dirs;
+    FcChar8 *dir;
+    ULONGLONG mtime;
+
+    if (!fontconfig_enabled || !(dirs = pFcConfigGetFontDirs( NULL ))) return hash;
+    while ((dir = pFcStrListNext( dirs )))
+    {
+        mtime = get_dir_mtime( (const char *)dir );
+        hash = hash_font_index_data( hash, dir, strlen( (const char *)dir ));
+        hash = hash_font_index_data( hash, &mtime, sizeof(mtime) );
+    }
+    pFcStrListDone( dirs );
+    return hash;
+}
+
 #elif defined(HAVE_CARBON_CARBON_H)
 
 static void load_mac_font_callback(const void *value, void *context)
@@ -4355,6 +4988,8 @@ BOOL WineEngInit(void)
     HKEY hkey;
     DWORD disposition;
     HANDLE font_mutex;
+    struct font_index index;
+    BOOL from_index;
 
     /* update locale dependent font info in registry */
     update_font_info();
@@ -4391,10 +5026,23 @@ BOOL WineEngInit(void)
 
     create_font_cache_key(&hkey_font_cache, &disposition);
 
-    if(disposition == REG_CREATED_NEW_KEY)
+    init_family_hash();
+    /* the first process of a session always rescans the fonts */
+    if (disposition == REG_CREATED_NEW_KEY || !(from_index = load_font_list_from_index()))
+    {
+        from_index = FALSE;
+        font_index_building = TRUE;
         init_font_list();
-    else
+        font_index_building = FALSE;
+        create_font_index(&index);
+    }
+
+    /* fonts added to or removed from the session by other processes */
+    if(disposition != REG_CREATED_NEW_KEY)
+    {
+        remove_session_removed_fonts(hkey_font_cache);
         load_font_list_from_cache(hkey_font_cache);
+    }
 
     reorder_font_list();
 
@@ -4403,8 +5051,11 @@ BOOL WineEngInit(void)
     DumpSubstList();
     LoadReplaceList();
 
-    if(disposition == REG_CREATED_NEW_KEY)
+    if (!from_index)
+    {
         update_reg_entries();
+        save_font_index(&index);
+    }
 
     init_system_links();
     
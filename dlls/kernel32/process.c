@@ -3983,9 +3983,20 @@ BOOL WINAPI GetNumaHighestNodeNumber(PULONG highestnode)
  */
 BOOL WINAPI GetNumaNodeProcessorMask(UCHAR node, PULONGLONG mask)
 {
-    FIXME("(%c %p): stub\n", node, mask);
-    SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
-    return FALSE;
+    SYSTEM_INFO si;
+
+    TRACE("(%u %p)\n", node, mask);
+
+    /* GetNumaHighestNodeNumber reports a single node holding all processors */
+    if (node)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    GetSystemInfo(&si);
+    *mask = si.dwActiveProcessorMask;
+    return TRUE;
 }
 
 /**********************************************************************
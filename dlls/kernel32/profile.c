@@ -61,20 +61,37 @@ typedef struct tagPROFILESECTION
 } PROFILESECTION;
 
 
+/* Hash index entry for a section (key is NULL) or for a key of a section */
+typedef struct
+{
+    UINT             hash;
+    PROFILESECTION  *section;
+    PROFILEKEY      *key;
+} PROFILEINDEX;
+
 typedef struct
 {
     BOOL             changed;
     PROFILESECTION  *section;
     WCHAR           *filename;
+    UINT             filename_hash;
     FILETIME LastWriteTime;
+    DWORD            FileSize;
+    ULONGLONG        ContentHash;
+    BOOL             flushed;     /* the file was last written by PROFILE_FlushFile */
     ENCODING encoding;
+    PROFILEINDEX    *index;       /* open addressing hash table, built on demand */
+    UINT             index_size;  /* power of two */
+    UINT             index_count;
 } PROFILE;
 
 
-#define N_CACHED_PROFILES 10
+#define N_CACHED_PROFILES 32
+#define MAX_CACHED_PROFILES 256
 
 /* Cached profile files */
-static PROFILE *MRUProfile[N_CACHED_PROFILES]={NULL};
+static PROFILE *MRUProfile[MAX_CACHED_PROFILES]={NULL};
+static UINT cached_profiles;
 
 #define CurProfile (MRUProfile[0])
 
@@ -126,34 +143,52 @@ static inline void PROFILE_ByteSwapShortBuffer(WCHAR * buffer, int len)
         shortbuffer[i] = RtlUshortByteSwap(shortbuffer[i]);
 }
 
-/* writes any necessary encoding marker to the file */
-static inline void PROFILE_WriteMarker(HANDLE hFile, ENCODING encoding)
+/* FNV-1a hash of the file contents, to recognize files we wrote */
+#define PROFILE_HASH_INIT 0xcbf29ce484222325ull
+
+static ULONGLONG PROFILE_HashData( ULONGLONG hash, const void *data, DWORD size )
+{
+    const BYTE *ptr = data;
+
+    while (size--) hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+/* writes data to the file and adds what was written to the hash */
+static void PROFILE_WriteData( HANDLE hFile, const void *data, DWORD size, ULONGLONG *hash )
 {
     DWORD dwBytesWritten;
+
+    if (!WriteFile(hFile, data, size, &dwBytesWritten, NULL)) dwBytesWritten = 0;
+    *hash = PROFILE_HashData(*hash, data, dwBytesWritten);
+}
+
+/* writes any necessary encoding marker to the file */
+static inline void PROFILE_WriteMarker(HANDLE hFile, ENCODING encoding, ULONGLONG *hash)
+{
     WCHAR bom;
     switch (encoding)
     {
     case ENCODING_ANSI:
         break;
     case ENCODING_UTF8:
-        WriteFile(hFile, bom_utf8, sizeof(bom_utf8), &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, bom_utf8, sizeof(bom_utf8), hash);
         break;
     case ENCODING_UTF16LE:
         bom = 0xFEFF;
-        WriteFile(hFile, &bom, sizeof(bom), &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, &bom, sizeof(bom), hash);
         break;
     case ENCODING_UTF16BE:
         bom = 0xFFFE;
-        WriteFile(hFile, &bom, sizeof(bom), &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, &bom, sizeof(bom), hash);
         break;
     }
 }
 
-static void PROFILE_WriteLine( HANDLE hFile, WCHAR * szLine, int len, ENCODING encoding)
+static void PROFILE_WriteLine( HANDLE hFile, WCHAR * szLine, int len, ENCODING encoding, ULONGLONG *hash)
 {
     char * write_buffer;
     int write_buffer_len;
-    DWORD dwBytesWritten;
 
     TRACE("writing: %s\n", debugstr_wn(szLine, len));
 
@@ -164,7 +199,7 @@ static void PROFILE_WriteLine( HANDLE hFile, WCHAR * szLine, int len, ENCODING e
         write_buffer = HeapAlloc(GetProcessHeap(), 0, write_buffer_len);
         if (!write_buffer) return;
         len = WideCharToMultiByte(CP_ACP, 0, szLine, len, write_buffer, write_buffer_len, NULL, NULL);
-        WriteFile(hFile, write_buffer, len, &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, write_buffer, len, hash);
         HeapFree(GetProcessHeap(), 0, write_buffer);
         break;
     case ENCODING_UTF8:
@@ -172,15 +207,15 @@ static void PROFILE_WriteLine( HANDLE hFile, WCHAR * szLine, int len, ENCODING e
         write_buffer = HeapAlloc(GetProcessHeap(), 0, write_buffer_len);
         if (!write_buffer) return;
         len = WideCharToMultiByte(CP_UTF8, 0, szLine, len, write_buffer, write_buffer_len, NULL, NULL);
-        WriteFile(hFile, write_buffer, len, &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, write_buffer, len, hash);
         HeapFree(GetProcessHeap(), 0, write_buffer);
         break;
     case ENCODING_UTF16LE:
-        WriteFile(hFile, szLine, len * sizeof(WCHAR), &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, szLine, len * sizeof(WCHAR), hash);
         break;
     case ENCODING_UTF16BE:
         PROFILE_ByteSwapShortBuffer(szLine, len);
-        WriteFile(hFile, szLine, len * sizeof(WCHAR), &dwBytesWritten, NULL);
+        PROFILE_WriteData(hFile, szLine, len * sizeof(WCHAR), hash);
         break;
     default:
         FIXME("encoding type %d not implemented\n", encoding);
@@ -190,14 +225,15 @@ static void PROFILE_WriteLine( HANDLE hFile, WCHAR * szLine, int len, ENCODING e
 /***********************************************************************
  *           PROFILE_Save
  *
- * Save a profile tree to a file.
+ * Save a profile tree to a file, and return the hash of what was written.
  */
-static void PROFILE_Save( HANDLE hFile, const PROFILESECTION *section, ENCODING encoding )
+static ULONGLONG PROFILE_Save( HANDLE hFile, const PROFILESECTION *section, ENCODING encoding )
 {
+    ULONGLONG hash = PROFILE_HASH_INIT;
     PROFILEKEY *key;
     WCHAR *buffer, *p;
 
-    PROFILE_WriteMarker(hFile, encoding);
+    PROFILE_WriteMarker(hFile, encoding, &hash);
 
     for ( ; section; section = section->next)
     {
@@ -212,7 +248,7 @@ static void PROFILE_Save( HANDLE hFile, const PROFILESECTION *section, ENCODING
         }
 
         buffer = HeapAlloc(GetProcessHeap(), 0, len * sizeof(WCHAR));
-        if (!buffer) return;
+        if (!buffer) return hash;
 
         p = buffer;
         if (section->name[0])
@@ -238,9 +274,32 @@ static void PROFILE_Save( HANDLE hFile, const PROFILESECTION *section, ENCODING
             *p++ = '\r';
             *p++ = '\n';
         }
-        PROFILE_WriteLine( hFile, buffer, len, encoding );
+        PROFILE_WriteLine( hFile, buffer, len, encoding, &hash );
         HeapFree(GetProcessHeap(), 0, buffer);
     }
+    return hash;
+}
+
+
+/***********************************************************************
+ *           PROFILE_HashFile
+ *
+ * Hash the whole contents of a profile file.
+ */
+static BOOL PROFILE_HashFile( HANDLE hFile, ULONGLONG *hash )
+{
+    BYTE buffer[4096];
+    DWORD count;
+
+    *hash = PROFILE_HASH_INIT;
+    if (SetFilePointer( hFile, 0, NULL, FILE_BEGIN ) == INVALID_SET_FILE_POINTER)
+        return FALSE;
+    for (;;)
+    {
+        if (!ReadFile( hFile, buffer, sizeof(buffer), &count, NULL )) return FALSE;
+        if (!count) return TRUE;
+        *hash = PROFILE_HashData( *hash, buffer, count );
+    }
 }
 
 
@@ -267,6 +326,163 @@ static void PROFILE_Free( PROFILESECTION *section )
     }
 }
 
+/***********************************************************************
+ *           PROFILE_Hash
+ *
+ * Case insensitive hash of a section, key or file name.
+ */
+static UINT PROFILE_Hash( LPCWSTR name, int len )
+{
+    UINT hash = 5381;
+
+    while (len-- > 0) hash = hash * 33 + tolowerW( *name++ );
+    return hash;
+}
+
+static inline UINT PROFILE_KeyHash( const PROFILESECTION *section, UINT name_hash )
+{
+    return name_hash ^ ((UINT)(ULONG_PTR)section * 0x9e3779b1);
+}
+
+
+/***********************************************************************
+ *           PROFILE_FreeIndex
+ *
+ * Drop the hash index of a profile, it is rebuilt on the next lookup.
+ */
+static void PROFILE_FreeIndex( PROFILE *profile )
+{
+    HeapFree( GetProcessHeap(), 0, profile->index );
+    profile->index = NULL;
+    profile->index_size = profile->index_count = 0;
+}
+
+
+/***********************************************************************
+ *           PROFILE_IndexFindSection
+ *
+ * Find the first section with the given name in the hash index.
+ */
+static PROFILESECTION *PROFILE_IndexFindSection( const PROFILE *profile, LPCWSTR name, int len )
+{
+    UINT hash = PROFILE_Hash( name, len ), i;
+    const PROFILEINDEX *entry;
+
+    for (i = hash & (profile->index_size - 1); (entry = &profile->index[i])->section;
+         i = (i + 1) & (profile->index_size - 1))
+    {
+        if (entry->key || entry->hash != hash) continue;
+        if (!strncmpiW( entry->section->name, name, len ) && !entry->section->name[len])
+            return entry->section;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           PROFILE_IndexFindKey
+ *
+ * Find the first key of a section with the given name in the hash index.
+ */
+static PROFILEKEY *PROFILE_IndexFindKey( const PROFILE *profile, const PROFILESECTION *section,
+                                         LPCWSTR name, int len )
+{
+    UINT hash = PROFILE_KeyHash( section, PROFILE_Hash( name, len ) ), i;
+    const PROFILEINDEX *entry;
+
+    for (i = hash & (profile->index_size - 1); (entry = &profile->index[i])->section;
+         i = (i + 1) & (profile->index_size - 1))
+    {
+        if (entry->section != section || !entry->key || entry->hash != hash) continue;
+        if (!strncmpiW( entry->key->name, name, len ) && !entry->key->name[len])
+            return entry->key;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           PROFILE_IndexAdd
+ *
+ * Add a section, or a key if key is not NULL, to the hash index unless
+ * an entry with the same name is already there. The index keeps the
+ * first entry in file order, like a walk of the profile tree would.
+ */
+static void PROFILE_IndexAdd( PROFILE *profile, PROFILESECTION *section, PROFILEKEY *key )
+{
+    PROFILEINDEX *entry;
+    UINT hash, i;
+    int len;
+
+    if (!profile->index) return;
+
+    if (key)
+    {
+        len = strlenW( key->name );
+        if (PROFILE_IndexFindKey( profile, section, key->name, len )) return;
+        hash = PROFILE_KeyHash( section, PROFILE_Hash( key->name, len ) );
+    }
+    else
+    {
+        if (!section->name[0]) return;
+        len = strlenW( section->name );
+        if (PROFILE_IndexFindSection( profile, section->name, len )) return;
+        hash = PROFILE_Hash( section->name, len );
+    }
+
+    /* keep the table at most half full, it is rebuilt at twice the size */
+    if ((profile->index_count + 1) * 2 > profile->index_size)
+    {
+        PROFILE_FreeIndex( profile );
+        return;
+    }
+
+    for (i = hash & (profile->index_size - 1); (entry = &profile->index[i])->section;
+         i = (i + 1) & (profile->index_size - 1))
+        ;
+    entry->hash = hash;
+    entry->section = section;
+    entry->key = key;
+    profile->index_count++;
+}
+
+
+/***********************************************************************
+ *           PROFILE_BuildIndex
+ *
+ * Build the hash index of the sections and keys of a profile.
+ */
+static BOOL PROFILE_BuildIndex( PROFILE *profile )
+{
+    PROFILESECTION *section;
+    PROFILEKEY *key;
+    UINT count = 0, size = 16;
+
+    if (profile->index) return TRUE;
+
+    for (section = profile->section; section; section = section->next)
+    {
+        count++;
+        for (key = section->key; key; key = key->next) count++;
+    }
+    while (size < count * 4) size *= 2;
+
+    if (!(profile->index = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*profile->index) )))
+        return FALSE;
+    profile->index_size = size;
+    profile->index_count = 0;
+
+    for (section = profile->section; section; section = section->next)
+    {
+        PROFILE_IndexAdd( profile, section, NULL );
+        for (key = section->key; key; key = key->next)
+            PROFILE_IndexAdd( profile, section, key );
+    }
+    TRACE("%s: %u entries in %u buckets\n", debugstr_w(profile->filename), profile->index_count, size);
+    return TRUE;
+}
+
+
 /* returns TRUE if a whitespace character, else FALSE */
 static inline BOOL PROFILE_isspaceW(WCHAR c)
 {
@@ -554,6 +770,8 @@ static BOOL PROFILE_DeleteKey( PROFILESECTION **section,
 static void PROFILE_DeleteAllKeys( LPCWSTR section_name)
 {
     PROFILESECTION **section= &CurProfile->section;
+
+    PROFILE_FreeIndex( CurProfile );
     while (*section)
     {
         if ((*section)->name[0] && !strcmpiW( (*section)->name, section_name ))
@@ -573,16 +791,55 @@ static void PROFILE_DeleteAllKeys( LPCWSTR section_name)
 }
 
 
+/***********************************************************************
+ *           PROFILE_FindSection
+ *
+ * Find the first section with the given name, using the hash index
+ * unless it could not be allocated.
+ */
+static PROFILESECTION *PROFILE_FindSection( PROFILE *profile, LPCWSTR name, int len )
+{
+    PROFILESECTION *section;
+
+    if (PROFILE_BuildIndex( profile )) return PROFILE_IndexFindSection( profile, name, len );
+
+    for (section = profile->section; section; section = section->next)
+        if (section->name[0] && !strncmpiW( section->name, name, len ) && !section->name[len])
+            return section;
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           PROFILE_FindKey
+ *
+ * Find the first key of a section with the given name.
+ */
+static PROFILEKEY *PROFILE_FindKey( PROFILE *profile, PROFILESECTION *section, LPCWSTR name, int len )
+{
+    PROFILEKEY *key;
+
+    if (PROFILE_BuildIndex( profile )) return PROFILE_IndexFindKey( profile, section, name, len );
+
+    for (key = section->key; key; key = key->next)
+        if (!strncmpiW( key->name, name, len ) && !key->name[len])
+            return key;
+    return NULL;
+}
+
+
 /***********************************************************************
  *           PROFILE_Find
  *
  * Find a key in a profile tree, optionally creating it.
  */
-static PROFILEKEY *PROFILE_Find( PROFILESECTION **section, LPCWSTR section_name,
+static PROFILEKEY *PROFILE_Find( PROFILE *profile, LPCWSTR section_name,
                                  LPCWSTR key_name, BOOL create, BOOL create_always )
 {
     LPCWSTR p;
     int seclen, keylen;
+    PROFILESECTION *section, **next_section;
+    PROFILEKEY *key, **next_key;
 
     while (PROFILE_isspaceW(*section_name)) section_name++;
     if (*section_name)
@@ -602,54 +859,49 @@ static PROFILEKEY *PROFILE_Find( PROFILESECTION **section, LPCWSTR section_name,
     while ((p > key_name) && PROFILE_isspaceW(*p)) p--;
     keylen = p - key_name + 1;
 
-    while (*section)
+    if ((section = PROFILE_FindSection( profile, section_name, seclen )))
     {
-        if ( ((*section)->name[0])
-             && (!(strncmpiW( (*section)->name, section_name, seclen )))
-             && (((*section)->name)[seclen] == '\0') )
-        {
-            PROFILEKEY **key = &(*section)->key;
-
-            while (*key)
-            {
-                /* If create_always is FALSE then we check if the keyname
-                 * already exists. Otherwise we add it regardless of its
-                 * existence, to allow keys to be added more than once in
-                 * some cases.
-                 */
-                if(!create_always)
-                {
-                    if ( (!(strncmpiW( (*key)->name, key_name, keylen )))
-                         && (((*key)->name)[keylen] == '\0') )
-                        return *key;
-                }
-                key = &(*key)->next;
-            }
-            if (!create) return NULL;
-            if (!(*key = HeapAlloc( GetProcessHeap(), 0, sizeof(PROFILEKEY) + strlenW(key_name) * sizeof(WCHAR) )))
-                return NULL;
-            strcpyW( (*key)->name, key_name );
-            (*key)->value = NULL;
-            (*key)->next  = NULL;
-            return *key;
-        }
-        section = &(*section)->next;
+        /* If create_always is FALSE then we check if the keyname
+         * already exists. Otherwise we add it regardless of its
+         * existence, to allow keys to be added more than once in
+         * some cases.
+         */
+        if (!create_always && (key = PROFILE_FindKey( profile, section, key_name, keylen )))
+            return key;
+        if (!create) return NULL;
+
+        for (next_key = &section->key; *next_key; next_key = &(*next_key)->next)
+            ;
+        if (!(key = HeapAlloc( GetProcessHeap(), 0, sizeof(PROFILEKEY) + strlenW(key_name) * sizeof(WCHAR) )))
+            return NULL;
+        strcpyW( key->name, key_name );
+        key->value = NULL;
+        key->next  = NULL;
+        *next_key = key;
+        PROFILE_IndexAdd( profile, section, key );
+        return key;
     }
     if (!create) return NULL;
-    *section = HeapAlloc( GetProcessHeap(), 0, sizeof(PROFILESECTION) + strlenW(section_name) * sizeof(WCHAR) );
-    if(*section == NULL) return NULL;
-    strcpyW( (*section)->name, section_name );
-    (*section)->next = NULL;
-    if (!((*section)->key  = HeapAlloc( GetProcessHeap(), 0,
-                                        sizeof(PROFILEKEY) + strlenW(key_name) * sizeof(WCHAR) )))
+
+    for (next_section = &profile->section; *next_section; next_section = &(*next_section)->next)
+        ;
+    section = HeapAlloc( GetProcessHeap(), 0, sizeof(PROFILESECTION) + strlenW(section_name) * sizeof(WCHAR) );
+    if(section == NULL) return NULL;
+    strcpyW( section->name, section_name );
+    section->next = NULL;
+    if (!(section->key  = HeapAlloc( GetProcessHeap(), 0,
+                                     sizeof(PROFILEKEY) + strlenW(key_name) * sizeof(WCHAR) )))
     {
-        HeapFree(GetProcessHeap(), 0, *section);
+        HeapFree(GetProcessHeap(), 0, section);
         return NULL;
     }
-    strcpyW( (*section)->key->name, key_name );
-    (*section)->key->value = NULL;
-    (*section)->key->next  = NULL;
-    return (*section)->key;
+    strcpyW( section->key->name, key_name );
+    section->key->value = NULL;
+    section->key->next  = NULL;
+    *next_section = section;
+    PROFILE_IndexAdd( profile, section, NULL );
+    PROFILE_IndexAdd( profile, section, section->key );
+    return section->key;
 }
 
 
@@ -662,6 +914,7 @@ static BOOL PROFILE_FlushFile(void)
 {
     HANDLE hFile = NULL;
     FILETIME LastWriteTime;
+    ULONGLONG hash;
 
     if(!CurProfile)
     {
@@ -681,9 +934,14 @@ static BOOL PROFILE_FlushFile(void)
     }
 
     TRACE("Saving %s\n", debugstr_w(CurProfile->filename));
-    PROFILE_Save( hFile, CurProfile->section, CurProfile->encoding );
+    hash = PROFILE_Save( hFile, CurProfile->section, CurProfile->encoding );
     if(GetFileTime(hFile, NULL, NULL, &LastWriteTime))
+    {
        CurProfile->LastWriteTime=LastWriteTime;
+       CurProfile->FileSize = GetFileSize(hFile, NULL);
+       CurProfile->ContentHash = hash;
+       CurProfile->flushed = TRUE;
+    }
     CloseHandle( hFile );
     CurProfile->changed = FALSE;
     return TRUE;
@@ -698,12 +956,15 @@ static BOOL PROFILE_FlushFile(void)
 static void PROFILE_ReleaseFile(void)
 {
     PROFILE_FlushFile();
+    PROFILE_FreeIndex( CurProfile );
     PROFILE_Free( CurProfile->section );
     HeapFree( GetProcessHeap(), 0, CurProfile->filename );
     CurProfile->changed = FALSE;
     CurProfile->section = NULL;
     CurProfile->filename  = NULL;
+    CurProfile->filename_hash = 0;
     CurProfile->encoding = ENCODING_ANSI;
+    CurProfile->flushed = FALSE;
     ZeroMemory(&CurProfile->LastWriteTime, sizeof(CurProfile->LastWriteTime));
 }
 
@@ -727,6 +988,73 @@ static BOOL is_not_current(FILETIME * ft)
     return ftll + 21000000 < nowll;
 }
 
+/***********************************************************************
+ *           PROFILE_IsFlushedContent
+ *
+ * Check whether a file still holds what PROFILE_FlushFile wrote to it,
+ * for files too recent for their time to be trusted.
+ */
+static BOOL PROFILE_IsFlushedContent( HANDLE hFile )
+{
+    ULONGLONG hash;
+
+    if (!CurProfile->flushed || GetFileSize(hFile, NULL) != CurProfile->FileSize)
+        return FALSE;
+    return PROFILE_HashFile(hFile, &hash) && hash == CurProfile->ContentHash;
+}
+
+/***********************************************************************
+ *           PROFILE_GetCacheSize
+ *
+ * Number of profile files kept parsed in memory.
+ */
+static UINT PROFILE_GetCacheSize(void)
+{
+    static const WCHAR profileW[] = {'S','o','f','t','w','a','r','e','\\',
+                                     'W','i','n','e','\\','P','r','o','f','i','l','e',0};
+    static const WCHAR cachesizeW[] = {'C','a','c','h','e','S','i','z','e',0};
+    char tmp[64];
+    HANDLE root, hkey;
+    DWORD dummy;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nameW;
+    UINT ret = N_CACHED_PROFILES;
+
+    attr.Length = sizeof(attr);
+    attr.RootDirectory = 0;
+    attr.ObjectName = &nameW;
+    attr.Attributes = 0;
+    attr.SecurityDescriptor = NULL;
+    attr.SecurityQualityOfService = NULL;
+    if (RtlOpenCurrentUser( KEY_READ, &root )) return ret;
+    attr.RootDirectory = root;
+    RtlInitUnicodeString( &nameW, profileW );
+
+    /* @@ Wine registry key: HKCU\Software\Wine\Profile */
+    if (!NtOpenKey( &hkey, KEY_READ, &attr ))
+    {
+        RtlInitUnicodeString( &nameW, cachesizeW );
+        if (!NtQueryValueKey( hkey, &nameW, KeyValuePartialInformation, tmp, sizeof(tmp) - sizeof(WCHAR), &dummy ))
+        {
+            KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)tmp;
+
+            if (info->Type == REG_DWORD && info->DataLength == sizeof(DWORD))
+                ret = *(DWORD *)info->Data;
+            else if (info->Type == REG_SZ)
+            {
+                info->Data[info->DataLength] = info->Data[info->DataLength + 1] = 0;
+                ret = atoiW( (WCHAR *)info->Data );
+            }
+        }
+        NtClose( hkey );
+    }
+    NtClose( root );
+
+    ret = max( 1, min( ret, MAX_CACHED_PROFILES ));
+    TRACE("caching %u profiles\n", ret);
+    return ret;
+}
+
 /***********************************************************************
  *           PROFILE_Open
  *
@@ -737,6 +1065,7 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     WCHAR buffer[MAX_PATH];
     HANDLE hFile = INVALID_HANDLE_VALUE;
     FILETIME LastWriteTime;
+    UINT filename_hash;
     int i,j;
     PROFILE *tempProfile;
     
@@ -745,16 +1074,17 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     /* First time around */
 
     if(!CurProfile)
-       for(i=0;i<N_CACHED_PROFILES;i++)
+    {
+       cached_profiles = PROFILE_GetCacheSize();
+       for(i=0;i<cached_profiles;i++)
        {
-          MRUProfile[i]=HeapAlloc( GetProcessHeap(), 0, sizeof(PROFILE) );
+          MRUProfile[i]=HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(PROFILE) );
           if(MRUProfile[i] == NULL) break;
-          MRUProfile[i]->changed=FALSE;
-          MRUProfile[i]->section=NULL;
-          MRUProfile[i]->filename=NULL;
           MRUProfile[i]->encoding=ENCODING_ANSI;
-          ZeroMemory(&MRUProfile[i]->LastWriteTime, sizeof(FILETIME));
        }
+       if (!i) return FALSE;
+       cached_profiles = i;
+    }
 
     if (!filename)
 	filename = wininiW;
@@ -776,6 +1106,7 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     }
         
     TRACE("path: %s\n", debugstr_w(buffer));
+    filename_hash = PROFILE_Hash( buffer, strlenW(buffer) );
 
     hFile = CreateFileW(buffer, GENERIC_READ | (write_access ? GENERIC_WRITE : 0),
                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
@@ -787,9 +1118,10 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
         return FALSE;
     }
 
-    for(i=0;i<N_CACHED_PROFILES;i++)
+    for(i=0;i<cached_profiles;i++)
     {
-        if ((MRUProfile[i]->filename && !strcmpiW( buffer, MRUProfile[i]->filename )))
+        if (MRUProfile[i]->filename_hash == filename_hash && MRUProfile[i]->filename &&
+            !strcmpiW( buffer, MRUProfile[i]->filename ))
         {
             TRACE("MRU Filename: %s, new filename: %s\n", debugstr_w(MRUProfile[i]->filename), debugstr_w(buffer));
             if(i)
@@ -804,17 +1136,22 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
             if (hFile != INVALID_HANDLE_VALUE)
             {
                 GetFileTime(hFile, NULL, NULL, &LastWriteTime);
+                /* A file whose time can't be trusted yet doesn't need to be
+                 * parsed again if it still holds what we last wrote to it. */
                 if (!memcmp( &CurProfile->LastWriteTime, &LastWriteTime, sizeof(FILETIME) ) &&
-                    is_not_current(&LastWriteTime))
+                    (is_not_current(&LastWriteTime) || PROFILE_IsFlushedContent(hFile)))
                     TRACE("(%s): already opened (mru=%d)\n",
                           debugstr_w(buffer), i);
                 else
                 {
                     TRACE("(%s): already opened, needs refreshing (mru=%d)\n",
                           debugstr_w(buffer), i);
+                    PROFILE_FreeIndex(CurProfile);
                     PROFILE_Free(CurProfile->section);
+                    SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
                     CurProfile->section = PROFILE_Load(hFile, &CurProfile->encoding);
                     CurProfile->LastWriteTime = LastWriteTime;
+                    CurProfile->flushed = FALSE;
                 }
                 CloseHandle(hFile);
                 return TRUE;
@@ -828,10 +1165,10 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     PROFILE_FlushFile();
 
     /* Make the oldest profile the current one only in order to get rid of it */
-    if(i==N_CACHED_PROFILES)
+    if(i==cached_profiles)
       {
-       tempProfile=MRUProfile[N_CACHED_PROFILES-1];
-       for(i=N_CACHED_PROFILES-1;i>0;i--)
+       tempProfile=MRUProfile[cached_profiles-1];
+       for(i=cached_profiles-1;i>0;i--)
           MRUProfile[i]=MRUProfile[i-1];
        CurProfile=tempProfile;
       }
@@ -840,6 +1177,7 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
     /* OK, now that CurProfile is definitely free we assign it our new file */
     CurProfile->filename  = HeapAlloc( GetProcessHeap(), 0, (strlenW(buffer)+1) * sizeof(WCHAR) );
     strcpyW( CurProfile->filename, buffer );
+    CurProfile->filename_hash = filename_hash;
 
     if (hFile != INVALID_HANDLE_VALUE)
     {
@@ -862,29 +1200,28 @@ static BOOL PROFILE_Open( LPCWSTR filename, BOOL write_access )
  * Returns all keys of a section.
  * If return_values is TRUE, also include the corresponding values.
  */
-static INT PROFILE_GetSection( PROFILESECTION *section, LPCWSTR section_name,
+static INT PROFILE_GetSection( PROFILE *profile, LPCWSTR section_name,
 			       LPWSTR buffer, UINT len, BOOL return_values )
 {
+    PROFILESECTION *section;
     PROFILEKEY *key;
 
     if(!buffer) return 0;
 
     TRACE("%s,%p,%u\n", debugstr_w(section_name), buffer, len);
 
-    while (section)
+    if ((section = PROFILE_FindSection( profile, section_name, strlenW(section_name) )))
     {
-        if (section->name[0] && !strcmpiW( section->name, section_name ))
+        UINT oldlen = len;
+        for (key = section->key; key; key = key->next)
         {
-            UINT oldlen = len;
-            for (key = section->key; key; key = key->next)
-            {
-                if (len <= 2) break;
-                if (!*key->name) continue;  /* Skip empty lines */
-                if (IS_ENTRY_COMMENT(key->name)) continue;  /* Skip comments */
-                if (!return_values && !key->value) continue;  /* Skip lines w.o. '=' */
-                PROFILE_CopyEntry( buffer, key->name, len - 1, 0 );
-                len -= strlenW(buffer) + 1;
-                buffer += strlenW(buffer) + 1;
+            if (len <= 2) break;
+            if (!*key->name) continue;  /* Skip empty lines */
+            if (IS_ENTRY_COMMENT(key->name)) continue;  /* Skip comments */
+            if (!return_values && !key->value) continue;  /* Skip lines w.o. '=' */
+            PROFILE_CopyEntry( buffer, key->name, len - 1, 0 );
+            len -= strlenW(buffer) + 1;
+            buffer += strlenW(buffer) + 1;
 		if (len < 2)
 		    break;
 		if (return_values && key->value) {
@@ -892,22 +1229,20 @@ static INT PROFILE_GetSection( PROFILESECTION *section, LPCWSTR section_name,
 			PROFILE_CopyEntry ( buffer, key->value, len - 1, 0 );
 			len -= strlenW(buffer) + 1;
 			buffer += strlenW(buffer) + 1;
-                }
             }
-            *buffer = '\0';
-            if (len <= 1)
-                /*If either lpszSection or lpszKey is NULL and the supplied
-                  destination buffer is too small to hold all the strings,
-                  the last string is truncated and followed by two null characters.
-                  In this case, the return value is equal to cchReturnBuffer
-                  minus two. */
-            {
+        }
+        *buffer = '\0';
+        if (len <= 1)
+            /*If either lpszSection or lpszKey is NULL and the supplied
+              destination buffer is too small to hold all the strings,
+              the last string is truncated and followed by two null characters.
+              In this case, the return value is equal to cchReturnBuffer
+              minus two. */
+        {
 		buffer[-1] = '\0';
-                return oldlen - 2;
-            }
-            return oldlen - len;
+            return oldlen - 2;
         }
-        section = section->next;
+        return oldlen - len;
     }
     buffer[0] = buffer[1] = '\0';
     return 0;
@@ -993,7 +1328,7 @@ static INT PROFILE_GetString( LPCWSTR section, LPCWSTR key_name,
             PROFILE_CopyEntry(buffer, def_val, len, TRUE);
             return strlenW(buffer);
         }
-        key = PROFILE_Find( &CurProfile->section, section, key_name, FALSE, FALSE);
+        key = PROFILE_Find( CurProfile, section, key_name, FALSE, FALSE);
         PROFILE_CopyEntry( buffer, (key && key->value) ? key->value : def_val,
                            len, TRUE );
         TRACE("(%s,%s,%s): returning %s\n",
@@ -1004,7 +1339,7 @@ static INT PROFILE_GetString( LPCWSTR section, LPCWSTR key_name,
     /* no "else" here ! */
     if (section && section[0])
     {
-        INT ret = PROFILE_GetSection(CurProfile->section, section, buffer, len, FALSE);
+        INT ret = PROFILE_GetSection(CurProfile, section, buffer, len, FALSE);
         if (!buffer[0]) /* no luck -> def_val */
         {
             PROFILE_CopyEntry(buffer, def_val, len, TRUE);
@@ -1028,6 +1363,7 @@ static BOOL PROFILE_SetString( LPCWSTR section_name, LPCWSTR key_name,
     if (!key_name)  /* Delete a whole section */
     {
         TRACE("(%s)\n", debugstr_w(section_name));
+        PROFILE_FreeIndex( CurProfile );
         CurProfile->changed |= PROFILE_DeleteSection( &CurProfile->section,
                                                       section_name );
         return TRUE;         /* Even if PROFILE_DeleteSection() has failed,
@@ -1036,13 +1372,14 @@ static BOOL PROFILE_SetString( LPCWSTR section_name, LPCWSTR key_name,
     else if (!value)  /* Delete a key */
     {
         TRACE("(%s,%s)\n", debugstr_w(section_name), debugstr_w(key_name) );
+        PROFILE_FreeIndex( CurProfile );
         CurProfile->changed |= PROFILE_DeleteKey( &CurProfile->section,
                                                   section_name, key_name );
         return TRUE;          /* same error handling as above */
     }
     else  /* Set the key value */
     {
-        PROFILEKEY *key = PROFILE_Find(&CurProfile->section, section_name,
+        PROFILEKEY *key = PROFILE_Find(CurProfile, section_name,
                                         key_name, TRUE, create_always );
         TRACE("(%s,%s,%s):\n",
               debugstr_w(section_name), debugstr_w(key_name), debugstr_w(value) );
@@ -1298,7 +1635,7 @@ INT WINAPI GetPrivateProfileSectionW( LPCWSTR section, LPWSTR buffer,
     RtlEnterCriticalSection( &PROFILE_CritSect );
 
     if (PROFILE_Open( filename, FALSE ))
-        ret = PROFILE_GetSection(CurProfile->section, section, buffer, len, TRUE);
+        ret = PROFILE_GetSection(CurProfile, section, buffer, len, TRUE);
 
     RtlLeaveCriticalSection( &PROFILE_CritSect );
 
@@ -1623,7 +1960,7 @@ BOOL WINAPI GetPrivateProfileStructW (LPCWSTR section, LPCWSTR key,
     RtlEnterCriticalSection( &PROFILE_CritSect );
 
     if (PROFILE_Open( filename, FALSE )) {
-        PROFILEKEY *k = PROFILE_Find ( &CurProfile->section, section, key, FALSE, FALSE);
+        PROFILEKEY *k = PROFILE_Find ( CurProfile, section, key, FALSE, FALSE);
 	if (k) {
 	    TRACE("value (at %p): %s\n", k->value, debugstr_w(k->value));
 	    if (((strlenW(k->value) - 2) / 2) == len)
@@ -1251,6 +1251,95 @@ static void test_dbcs_to_widechar(void)
     }
 }
 
+static void test_long_strings(void)
+{
+    static const struct
+    {
+        UINT cp;
+        const char *mb;
+        WCHAR wc;
+    } tests[] =
+    {
+        { CP_UTF8, "\xc3\xa9", 0x00e9 },
+        { CP_UTF8, "\xe3\x81\x82", 0x3042 },
+        { 1252, "\xe9", 0x00e9 },
+        { 932, "\x82\xa0", 0x3042 },
+    };
+    static char bufA[0x10000], expectA[100], resA[100];
+    static WCHAR bufW[0x10000], expectW[100], resW[100];
+    int i, j, pos, len, ret;
+
+    /* a single non-ASCII char at every position of an ASCII string */
+    for (i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        int mblen = strlen(tests[i].mb);
+
+        if (!IsValidCodePage(tests[i].cp))
+        {
+            skip("code page %u is not available\n", tests[i].cp);
+            continue;
+        }
+
+        for (pos = 0; pos < 64; pos++)
+        {
+            len = 0;
+            for (j = 0; j < pos; j++) expectA[len++] = 'a' + j % 26;
+            memcpy(expectA + len, tests[i].mb, mblen);
+            len += mblen;
+            for (j = 0; j < 20; j++) expectA[len++] = 'A' + j;
+
+            for (j = 0; j < pos; j++) expectW[j] = 'a' + j % 26;
+            expectW[pos] = tests[i].wc;
+            for (j = 0; j < 20; j++) expectW[pos + 1 + j] = 'A' + j;
+
+            ret = MultiByteToWideChar(tests[i].cp, 0, expectA, len, NULL, 0);
+            ok(ret == pos + 21, "%u/%d: wrong length %d\n", tests[i].cp, pos, ret);
+            memset(resW, 0xcc, sizeof(resW));
+            ret = MultiByteToWideChar(tests[i].cp, 0, expectA, len, resW, sizeof(resW)/sizeof(WCHAR));
+            ok(ret == pos + 21, "%u/%d: wrong length %d\n", tests[i].cp, pos, ret);
+            ok(!memcmp(resW, expectW, (pos + 21) * sizeof(WCHAR)), "%u/%d: wrong result\n", tests[i].cp, pos);
+            ok(resW[pos + 21] == 0xcccc, "%u/%d: buffer overrun\n", tests[i].cp, pos);
+
+            /* destination too small, only the part that fits may be written */
+            memset(resW, 0xcc, sizeof(resW));
+            SetLastError(0xdeadbeef);
+            ret = MultiByteToWideChar(tests[i].cp, 0, expectA, len, resW, pos + 20);
+            ok(!ret, "%u/%d: got %d\n", tests[i].cp, pos, ret);
+            ok(GetLastError() == ERROR_INSUFFICIENT_BUFFER, "%u/%d: got error %u\n",
+               tests[i].cp, pos, GetLastError());
+            ok(resW[pos + 20] == 0xcccc, "%u/%d: buffer overrun\n", tests[i].cp, pos);
+
+            ret = WideCharToMultiByte(tests[i].cp, 0, expectW, pos + 21, NULL, 0, NULL, NULL);
+            ok(ret == len, "%u/%d: wrong length %d\n", tests[i].cp, pos, ret);
+            memset(resA, 0xcc, sizeof(resA));
+            ret = WideCharToMultiByte(tests[i].cp, 0, expectW, pos + 21, resA, sizeof(resA), NULL, NULL);
+            ok(ret == len, "%u/%d: wrong length %d\n", tests[i].cp, pos, ret);
+            ok(!memcmp(resA, expectA, len), "%u/%d: wrong result\n", tests[i].cp, pos);
+            ok(resA[len] == (char)0xcc, "%u/%d: buffer overrun\n", tests[i].cp, pos);
+        }
+    }
+
+    /* long ASCII strings */
+    for (i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        if (i && tests[i].cp == tests[i - 1].cp) continue;
+        if (!IsValidCodePage(tests[i].cp)) continue;
+
+        for (j = 0; j < sizeof(bufA); j++) bufA[j] = 'a' + j % 26;
+        memset(bufW, 0xcc, sizeof(bufW));
+        ret = MultiByteToWideChar(tests[i].cp, 0, bufA, sizeof(bufA), bufW, sizeof(bufW)/sizeof(WCHAR));
+        ok(ret == sizeof(bufA), "%u: got %d\n", tests[i].cp, ret);
+        for (j = 0; j < sizeof(bufA); j++) if (bufW[j] != 'a' + j % 26) break;
+        ok(j == sizeof(bufA), "%u: wrong char at %d\n", tests[i].cp, j);
+
+        memset(bufA, 0xcc, sizeof(bufA));
+        ret = WideCharToMultiByte(tests[i].cp, 0, bufW, sizeof(bufW)/sizeof(WCHAR), bufA, sizeof(bufA), NULL, NULL);
+        ok(ret == sizeof(bufA), "%u: got %d\n", tests[i].cp, ret);
+        for (j = 0; j < sizeof(bufA); j++) if (bufA[j] != 'a' + j % 26) break;
+        ok(j == sizeof(bufA), "%u: wrong char at %d\n", tests[i].cp, j);
+    }
+}
+
 START_TEST(codepage)
 {
     BOOL bUsedDefaultChar;
@@ -1273,4 +1362,5 @@ START_TEST(codepage)
     test_threadcp();
 
     test_dbcs_to_widechar();
+    test_long_strings();
 }
@@ -52,6 +52,7 @@ static BOOL (WINAPI *pGetFileInformationByHandleEx)(HANDLE, FILE_INFO_BY_HANDLE_
 static HANDLE (WINAPI *pOpenFileById)(HANDLE, LPFILE_ID_DESCRIPTOR, DWORD, DWORD, LPSECURITY_ATTRIBUTES, DWORD);
 static BOOL (WINAPI *pSetFileValidData)(HANDLE, LONGLONG);
 static HRESULT (WINAPI *pCopyFile2)(PCWSTR,PCWSTR,COPYFILE2_EXTENDED_PARAMETERS*);
+static BOOL (WINAPI *pSetFileCompletionNotificationModes)(HANDLE, UCHAR);
 static HANDLE (WINAPI *pCreateFile2)(LPCWSTR, DWORD, DWORD, DWORD, CREATEFILE2_EXTENDED_PARAMETERS*);
 static DWORD (WINAPI *pGetFinalPathNameByHandleA)(HANDLE, LPSTR, DWORD, DWORD);
 static DWORD (WINAPI *pGetFinalPathNameByHandleW)(HANDLE, LPWSTR, DWORD, DWORD);
@@ -101,6 +102,7 @@ static void InitFunctionPointers(void)
     pOpenFileById = (void *) GetProcAddress(hkernel32, "OpenFileById");
     pSetFileValidData = (void *) GetProcAddress(hkernel32, "SetFileValidData");
     pCopyFile2 = (void *) GetProcAddress(hkernel32, "CopyFile2");
+    pSetFileCompletionNotificationModes = (void *) GetProcAddress(hkernel32, "SetFileCompletionNotificationModes");
     pCreateFile2 = (void *) GetProcAddress(hkernel32, "CreateFile2");
     pGetFinalPathNameByHandleA = (void *) GetProcAddress(hkernel32, "GetFinalPathNameByHandleA");
     pGetFinalPathNameByHandleW = (void *) GetProcAddress(hkernel32, "GetFinalPathNameByHandleW");
@@ -4389,6 +4391,75 @@ static void test_WriteFileGather(void)
     DeleteFileA( filename );
 }
 
+static void test_SetFileCompletionNotificationModes(void)
+{
+    char temp_path[MAX_PATH], filename[MAX_PATH], buffer[16];
+    OVERLAPPED ovl, *povl;
+    HANDLE file, port;
+    ULONG_PTR key;
+    DWORD size;
+    BOOL ret;
+
+    if (!pSetFileCompletionNotificationModes)
+    {
+        win_skip("SetFileCompletionNotificationModes is not available\n");
+        return;
+    }
+
+    ret = GetTempPathA( MAX_PATH, temp_path );
+    ok( ret != 0, "GetTempPathA error %d\n", GetLastError() );
+    ret = GetTempFileNameA( temp_path, "cnm", 0, filename );
+    ok( ret != 0, "GetTempFileNameA error %d\n", GetLastError() );
+
+    file = CreateFileA( filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_FLAG_OVERLAPPED | FILE_FLAG_DELETE_ON_CLOSE, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed err %u\n", GetLastError() );
+
+    port = CreateIoCompletionPort( file, NULL, 0xdead, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed err %u\n", GetLastError() );
+
+    ret = pSetFileCompletionNotificationModes( file, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                                                     FILE_SKIP_SET_EVENT_ON_HANDLE );
+    ok( ret, "SetFileCompletionNotificationModes failed err %u\n", GetLastError() );
+
+    memset( buffer, 0x11, sizeof(buffer) );
+    memset( &ovl, 0, sizeof(ovl) );
+    ret = WriteFile( file, buffer, sizeof(buffer), &size, &ovl );
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+    {
+        /* operations that don't complete immediately still queue a packet */
+        ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 1000 );
+        ok( ret, "GetQueuedCompletionStatus failed err %u\n", GetLastError() );
+        ok( povl == &ovl, "wrong ovl %p\n", povl );
+    }
+    else
+    {
+        ok( ret, "WriteFile failed err %u\n", GetLastError() );
+        ok( size == sizeof(buffer), "got size %u\n", size );
+        ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 0 );
+        ok( !ret && GetLastError() == WAIT_TIMEOUT, "got ret %d, err %u\n", ret, GetLastError() );
+    }
+
+    memset( &ovl, 0, sizeof(ovl) );
+    ret = ReadFile( file, buffer, sizeof(buffer), &size, &ovl );
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+    {
+        ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 1000 );
+        ok( ret, "GetQueuedCompletionStatus failed err %u\n", GetLastError() );
+        ok( povl == &ovl, "wrong ovl %p\n", povl );
+    }
+    else
+    {
+        ok( ret, "ReadFile failed err %u\n", GetLastError() );
+        ok( size == sizeof(buffer), "got size %u\n", size );
+        ret = GetQueuedCompletionStatus( port, &size, &key, &povl, 0 );
+        ok( !ret && GetLastError() == WAIT_TIMEOUT, "got ret %d, err %u\n", ret, GetLastError() );
+    }
+
+    CloseHandle( file );
+    CloseHandle( port );
+}
+
 static unsigned file_map_access(unsigned access)
 {
     if (access & GENERIC_READ)    access |= FILE_GENERIC_READ;
@@ -4861,6 +4932,7 @@ START_TEST(file)
     test_OpenFileById();
     test_SetFileValidData();
     test_WriteFileGather();
+    test_SetFileCompletionNotificationModes();
     test_file_access();
     test_GetFinalPathNameByHandleA();
     test_GetFinalPathNameByHandleW();
@@ -2010,6 +2010,43 @@ static void test_CompareStringW(void)
     ok(success, "VirtualFree failed with %u\n", GetLastError());
 }
 
+static void test_CompareStringW_long(void)
+{
+    static const struct
+    {
+        DWORD flags;
+        const char *first;
+        const char *second;
+        INT ret;
+    } tests[] =
+    {
+        { 0, "abcdefghijklmnopqr", "abcdefghijklmnopqR", CSTR_LESS_THAN },
+        { NORM_IGNORECASE, "abcdefghijklmnopqr", "abcdefghijklmnopqR", CSTR_EQUAL },
+        { 0, "abcdefghijklmnopqrstuvwxyz", "abcdefghijklmnopqrstuvwxy", CSTR_GREATER_THAN },
+        /* an earlier diacritic or case difference loses against a later primary one */
+        { 0, "abcdefghijklmnop\xe9" "a", "abcdefghijklmnopeb", CSTR_LESS_THAN },
+        { 0, "abcdefghijklmnopAb", "abcdefghijklmnopaa", CSTR_GREATER_THAN },
+        { 0, "abcdefghijklmnopEbc", "abcdefghijklmnopebc", CSTR_GREATER_THAN },
+        { NORM_IGNORECASE, "abcdefghijklmnopEbc", "abcdefghijklmnopebc", CSTR_EQUAL },
+        { NORM_IGNORECASE, "abcdefghijklmnopEbc", "abcdefghijklmnopebd", CSTR_LESS_THAN },
+    };
+    WCHAR first[32], second[32];
+    int i, j, ret;
+
+    for (i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        for (j = 0; tests[i].first[j]; j++) first[j] = (unsigned char)tests[i].first[j];
+        first[j] = 0;
+        for (j = 0; tests[i].second[j]; j++) second[j] = (unsigned char)tests[i].second[j];
+        second[j] = 0;
+
+        ret = CompareStringW(LOCALE_SYSTEM_DEFAULT, tests[i].flags, first, -1, second, -1);
+        ok(ret == tests[i].ret, "%d: got %d, expected %d\n", i, ret, tests[i].ret);
+        ret = CompareStringW(LOCALE_SYSTEM_DEFAULT, tests[i].flags, second, -1, first, -1);
+        ok(ret == 4 - tests[i].ret, "%d: got %d, expected %d\n", i, ret, 4 - tests[i].ret);
+    }
+}
+
 struct comparestringex_test {
     const char *locale;
     DWORD flags;
@@ -5282,6 +5319,7 @@ START_TEST(locale)
   test_GetNumberFormatEx();
   test_CompareStringA();
   test_CompareStringW();
+  test_CompareStringW_long();
   test_CompareStringEx();
   test_LCMapStringA();
   test_LCMapStringW();
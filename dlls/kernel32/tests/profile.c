@@ -1123,6 +1123,61 @@ static void test_WritePrivateProfileString(void)
     DeleteFileA(path);
 }
 
+static void test_profile_many_files(void)
+{
+    char path[MAX_PATH], section[32], key[32], value[32], buffer[32];
+    DWORD size;
+    BOOL ret;
+    int i, j;
+
+    /* more files than fit in the profile cache, with many keys each */
+    for (i = 0; i < 40; i++)
+    {
+        sprintf(path, ".\\winecache%d.ini", i);
+        for (j = 0; j < 50; j++)
+        {
+            sprintf(section, "section%d", j % 5);
+            sprintf(key, "Key%d", j);
+            sprintf(value, "%d.%d", i, j);
+            ret = WritePrivateProfileStringA(section, key, value, path);
+            ok(ret, "%d,%d: WritePrivateProfileString failed\n", i, j);
+        }
+        /* duplicate key, the first one is returned */
+        ret = WritePrivateProfileSectionA("dup", "a=1\0A=2\0", path);
+        ok(ret, "%d: WritePrivateProfileSection failed\n", i);
+    }
+
+    for (j = 49; j >= 0; j--)
+    {
+        for (i = 0; i < 40; i++)
+        {
+            sprintf(path, ".\\winecache%d.ini", i);
+            sprintf(section, "SECTION%d", j % 5);
+            sprintf(key, "key%d", j);
+            sprintf(value, "%d.%d", i, j);
+            size = GetPrivateProfileStringA(section, key, "", buffer, sizeof(buffer), path);
+            ok(size == strlen(value) && !strcmp(buffer, value), "%d,%d: got %u %s\n", i, j, size, buffer);
+        }
+    }
+
+    for (i = 0; i < 40; i++)
+    {
+        sprintf(path, ".\\winecache%d.ini", i);
+        size = GetPrivateProfileStringA("dup", "A", "", buffer, sizeof(buffer), path);
+        ok(size == 1 && !strcmp(buffer, "1"), "%d: got %u %s\n", i, size, buffer);
+
+        ret = WritePrivateProfileStringA("section2", "key2", NULL, path);
+        ok(ret, "%d: WritePrivateProfileString failed\n", i);
+        size = GetPrivateProfileStringA("section2", "key2", "none", buffer, sizeof(buffer), path);
+        ok(size == 4 && !strcmp(buffer, "none"), "%d: got %u %s\n", i, size, buffer);
+        size = GetPrivateProfileStringA("section2", "key7", "", buffer, sizeof(buffer), path);
+        sprintf(value, "%d.7", i);
+        ok(!strcmp(buffer, value), "%d: got %u %s\n", i, size, buffer);
+
+        ok(DeleteFileA(path), "%d: DeleteFile failed\n", i);
+    }
+}
+
 START_TEST(profile)
 {
     test_profile_int();
@@ -1132,6 +1187,7 @@ START_TEST(profile)
     test_profile_existing();
     test_profile_delete_on_close();
     test_profile_refresh();
+    test_profile_many_files();
     test_GetPrivateProfileString(
         "[section1]\r\n"
         "name1=val1\r\n"
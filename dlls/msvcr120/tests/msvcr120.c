@@ -113,6 +113,27 @@ typedef struct {
     critical_section lock;
 } _Condition_variable;
 
+typedef struct
+{
+    void *token;
+    unsigned int unk1;
+    void *unk2;
+    void *context;
+    int count;
+    int finished;
+    void *exception;
+    void *unk3;
+} _StructuredTaskCollection;
+
+typedef struct _UnrealizedChore
+{
+    const void *vtable;
+    void (__cdecl *chore_proc)(struct _UnrealizedChore*);
+    _StructuredTaskCollection *task_collection;
+    void (__cdecl *chore_wrapper)(struct _UnrealizedChore*);
+    void *unk[6];
+} _UnrealizedChore;
+
 static inline float __port_infinity(void)
 {
     static const unsigned __inf_bytes = 0x7f800000;
@@ -205,6 +226,15 @@ static MSVCRT_bool (__thiscall *p__Condition_variable_wait_for)(_Condition_varia
 static void (__thiscall *p__Condition_variable_notify_one)(_Condition_variable*);
 static void (__thiscall *p__Condition_variable_notify_all)(_Condition_variable*);
 
+static void (CDECL *p_CurrentScheduler_ScheduleTask)(void (CDECL*)(void*), void*);
+
+static _StructuredTaskCollection* (__thiscall *p__StructuredTaskCollection_ctor)(_StructuredTaskCollection*, void*);
+static void (__thiscall *p__StructuredTaskCollection_dtor)(_StructuredTaskCollection*);
+static void (__thiscall *p__StructuredTaskCollection__Schedule)(_StructuredTaskCollection*, _UnrealizedChore*);
+static int (__stdcall *p__StructuredTaskCollection__RunAndWait)(_StructuredTaskCollection*, _UnrealizedChore*);
+static void (__thiscall *p__StructuredTaskCollection__Cancel)(_StructuredTaskCollection*);
+static MSVCRT_bool (__thiscall *p__StructuredTaskCollection__IsCanceling)(_StructuredTaskCollection*);
+
 #define SETNOFAIL(x,y) x = (void*)GetProcAddress(module,y)
 #define SET(x,y) do { SETNOFAIL(x,y); ok(x != NULL, "Export '%s' not found\n", y); } while(0)
 
@@ -269,6 +299,20 @@ static BOOL init(void)
                 "?notify_one@_Condition_variable@details@Concurrency@@QEAAXXZ");
         SET(p__Condition_variable_notify_all,
                 "?notify_all@_Condition_variable@details@Concurrency@@QEAAXXZ");
+        SET(p_CurrentScheduler_ScheduleTask,
+                "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
+        SET(p__StructuredTaskCollection_ctor,
+                "??0_StructuredTaskCollection@details@Concurrency@@QEAA@PEAV_CancellationTokenState@12@@Z");
+        SET(p__StructuredTaskCollection_dtor,
+                "??1_StructuredTaskCollection@details@Concurrency@@QEAA@XZ");
+        SET(p__StructuredTaskCollection__Schedule,
+                "?_Schedule@_StructuredTaskCollection@details@Concurrency@@QEAAXPEAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__RunAndWait,
+                "?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QEAA?AW4_TaskCollectionStatus@23@PEAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__Cancel,
+                "?_Cancel@_StructuredTaskCollection@details@Concurrency@@QEAAXXZ");
+        SET(p__StructuredTaskCollection__IsCanceling,
+                "?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QEAA_NXZ");
     } else {
 #ifdef __arm__
         SET(p_critical_section_ctor,
@@ -301,6 +345,18 @@ static BOOL init(void)
                 "?notify_one@_Condition_variable@details@Concurrency@@QAAXXZ");
         SET(p__Condition_variable_notify_all,
                 "?notify_all@_Condition_variable@details@Concurrency@@QAAXXZ");
+        SET(p__StructuredTaskCollection_ctor,
+                "??0_StructuredTaskCollection@details@Concurrency@@QAA@PAV_CancellationTokenState@12@@Z");
+        SET(p__StructuredTaskCollection_dtor,
+                "??1_StructuredTaskCollection@details@Concurrency@@QAA@XZ");
+        SET(p__StructuredTaskCollection__Schedule,
+                "?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAAXPAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__RunAndWait,
+                "?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QAA?AW4_TaskCollectionStatus@23@PAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__Cancel,
+                "?_Cancel@_StructuredTaskCollection@details@Concurrency@@QAAXXZ");
+        SET(p__StructuredTaskCollection__IsCanceling,
+                "?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QAA_NXZ");
 #else
         SET(p_critical_section_ctor,
                 "??0critical_section@Concurrency@@QAE@XZ");
@@ -332,7 +388,21 @@ static BOOL init(void)
                 "?notify_one@_Condition_variable@details@Concurrency@@QAEXXZ");
         SET(p__Condition_variable_notify_all,
                 "?notify_all@_Condition_variable@details@Concurrency@@QAEXXZ");
+        SET(p__StructuredTaskCollection_ctor,
+                "??0_StructuredTaskCollection@details@Concurrency@@QAE@PAV_CancellationTokenState@12@@Z");
+        SET(p__StructuredTaskCollection_dtor,
+                "??1_StructuredTaskCollection@details@Concurrency@@QAE@XZ");
+        SET(p__StructuredTaskCollection__Schedule,
+                "?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAEXPAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__RunAndWait,
+                "?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QAG?AW4_TaskCollectionStatus@23@PAV_UnrealizedChore@23@@Z");
+        SET(p__StructuredTaskCollection__Cancel,
+                "?_Cancel@_StructuredTaskCollection@details@Concurrency@@QAEXXZ");
+        SET(p__StructuredTaskCollection__IsCanceling,
+                "?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QAE_NXZ");
 #endif
+        SET(p_CurrentScheduler_ScheduleTask,
+                "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
     }
 
     init_thiscall_thunk();
@@ -882,6 +952,130 @@ static void test__Condition_variable(void)
     CloseHandle(thread_initialized);
 }
 
+struct schedule_task_arg
+{
+    LONG count;
+    LONG nested;
+    HANDLE done;
+};
+
+static void CDECL schedule_task_proc(void *data)
+{
+    struct schedule_task_arg *arg = data;
+
+    /* tasks scheduled from a task go to the local queue of the worker */
+    if (InterlockedDecrement(&arg->nested) >= 0)
+        p_CurrentScheduler_ScheduleTask(schedule_task_proc, arg);
+    if (!InterlockedDecrement(&arg->count))
+        SetEvent(arg->done);
+}
+
+static void test_CurrentScheduler_ScheduleTask(void)
+{
+    struct schedule_task_arg arg;
+    DWORD ret;
+    int i;
+
+    arg.count = 200;
+    arg.nested = 100;
+    arg.done = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ok(arg.done != NULL, "CreateEvent failed\n");
+
+    for (i = 0; i < 100; i++)
+        p_CurrentScheduler_ScheduleTask(schedule_task_proc, &arg);
+
+    ret = WaitForSingleObject(arg.done, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    ok(!arg.count, "count = %d\n", arg.count);
+
+    CloseHandle(arg.done);
+}
+
+struct test_chore
+{
+    _UnrealizedChore chore;
+    LONG *count;
+};
+
+static void __cdecl count_chore_proc(_UnrealizedChore *chore)
+{
+    struct test_chore *test = CONTAINING_RECORD(chore, struct test_chore, chore);
+
+    InterlockedIncrement(test->count);
+}
+
+static void init_test_chore(struct test_chore *test, void (__cdecl *proc)(_UnrealizedChore*), LONG *count)
+{
+    memset(test, 0, sizeof(*test));
+    test->chore.chore_proc = proc;
+    test->count = count;
+}
+
+static void __cdecl nested_chore_proc(_UnrealizedChore *chore)
+{
+    struct test_chore *test = CONTAINING_RECORD(chore, struct test_chore, chore);
+    struct test_chore chores[10];
+    _StructuredTaskCollection collection;
+    int i, status;
+
+    /* chores scheduled from a chore go to the local queue of the worker */
+    call_func2(p__StructuredTaskCollection_ctor, &collection, NULL);
+    for (i = 0; i < sizeof(chores) / sizeof(chores[0]); i++)
+    {
+        init_test_chore(&chores[i], count_chore_proc, test->count);
+        call_func2(p__StructuredTaskCollection__Schedule, &collection, &chores[i].chore);
+    }
+    status = p__StructuredTaskCollection__RunAndWait(&collection, NULL);
+    ok(status == 1, "_RunAndWait returned %d\n", status);
+    call_func1(p__StructuredTaskCollection_dtor, &collection);
+
+    InterlockedIncrement(test->count);
+}
+
+static void test__StructuredTaskCollection(void)
+{
+    struct test_chore chores[20], inline_chore;
+    _StructuredTaskCollection collection;
+    MSVCRT_bool canceling;
+    LONG count;
+    int i, status;
+
+    count = 0;
+    call_func2(p__StructuredTaskCollection_ctor, &collection, NULL);
+    for (i = 0; i < sizeof(chores) / sizeof(chores[0]); i++)
+    {
+        init_test_chore(&chores[i], count_chore_proc, &count);
+        call_func2(p__StructuredTaskCollection__Schedule, &collection, &chores[i].chore);
+    }
+    init_test_chore(&inline_chore, count_chore_proc, &count);
+    status = p__StructuredTaskCollection__RunAndWait(&collection, &inline_chore.chore);
+    ok(status == 1, "_RunAndWait returned %d\n", status);
+    ok(count == sizeof(chores) / sizeof(chores[0]) + 1, "count = %d\n", count);
+    call_func1(p__StructuredTaskCollection_dtor, &collection);
+
+    count = 0;
+    call_func2(p__StructuredTaskCollection_ctor, &collection, NULL);
+    for (i = 0; i < sizeof(chores) / sizeof(chores[0]); i++)
+    {
+        init_test_chore(&chores[i], nested_chore_proc, &count);
+        call_func2(p__StructuredTaskCollection__Schedule, &collection, &chores[i].chore);
+    }
+    status = p__StructuredTaskCollection__RunAndWait(&collection, NULL);
+    ok(status == 1, "_RunAndWait returned %d\n", status);
+    ok(count == sizeof(chores) / sizeof(chores[0]) * 11, "count = %d\n", count);
+    call_func1(p__StructuredTaskCollection_dtor, &collection);
+
+    call_func2(p__StructuredTaskCollection_ctor, &collection, NULL);
+    canceling = call_func1(p__StructuredTaskCollection__IsCanceling, &collection);
+    ok(!canceling, "_IsCanceling returned %x\n", canceling);
+    call_func1(p__StructuredTaskCollection__Cancel, &collection);
+    canceling = call_func1(p__StructuredTaskCollection__IsCanceling, &collection);
+    ok(canceling, "_IsCanceling returned %x\n", canceling);
+    status = p__StructuredTaskCollection__RunAndWait(&collection, NULL);
+    ok(status == 2, "_RunAndWait returned %d\n", status);
+    call_func1(p__StructuredTaskCollection_dtor, &collection);
+}
+
 START_TEST(msvcr120)
 {
     if (!init()) return;
@@ -898,4 +1092,6 @@ START_TEST(msvcr120)
     test_fegetenv();
     test__wcreate_locale();
     test__Condition_variable();
+    test_CurrentScheduler_ScheduleTask();
+    test__StructuredTaskCollection();
 }
@@ -1270,13 +1270,6 @@ const char * __thiscall type_info_name_internal_method(type_info * _this, struct
     return MSVCRT_type_info_name(_this);
 }
 
-/* std::exception_ptr class helpers */
-typedef struct
-{
-    EXCEPTION_RECORD *rec;
-    int *ref; /* not binary compatible with native msvcr100 */
-} exception_ptr;
-
 /*********************************************************************
  * ?__ExceptionPtrCreate@@YAXPAX@Z
  * ?__ExceptionPtrCreate@@YAXPEAX@Z
@@ -1391,16 +1384,10 @@ static inline void call_copy_ctor( void *func, void *this, void *src, int has_vb
 }
 #endif
 
-/*********************************************************************
- * ?__ExceptionPtrCurrentException@@YAXPAX@Z
- * ?__ExceptionPtrCurrentException@@YAXPEAX@Z
- */
 #ifndef __x86_64__
-void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
+void exception_ptr_from_record(exception_ptr *ep, EXCEPTION_RECORD *rec)
 {
-    EXCEPTION_RECORD *rec = msvcrt_get_thread_data()->exc_record;
-
-    TRACE("(%p)\n", ep);
+    TRACE("(%p %p)\n", ep, rec);
 
     if (!rec)
     {
@@ -1442,11 +1429,9 @@ void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
     return;
 }
 #else
-void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
+void exception_ptr_from_record(exception_ptr *ep, EXCEPTION_RECORD *rec)
 {
-    EXCEPTION_RECORD *rec = msvcrt_get_thread_data()->exc_record;
-
-    TRACE("(%p)\n", ep);
+    TRACE("(%p %p)\n", ep, rec);
 
     if (!rec)
     {
@@ -1490,6 +1475,75 @@ void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
 }
 #endif
 
+/* Rethrows the exception stored in ep, which must hold the only reference,
+ * and releases it. Like the object of a throw statement the exception object
+ * lives on the stack, catch blocks keep using it after the stack is unwound. */
+void exception_ptr_rethrow_release(exception_ptr *ep)
+{
+    union
+    {
+        void *ptr;
+        ULONGLONG ull;
+        double d;
+        char data[512];
+    } object;
+    EXCEPTION_RECORD rec;
+
+    TRACE("(%p)\n", ep);
+
+    if (!ep->rec)
+        __ExceptionPtrRethrow(ep);
+
+    rec = *ep->rec;
+    if (rec.ExceptionCode == CXX_EXCEPTION)
+    {
+        const cxx_exception_type *et = (void*)rec.ExceptionInformation[2];
+        const cxx_type_info *ti;
+        void *copy_ctor, *obj = (void*)rec.ExceptionInformation[1];
+#ifdef __x86_64__
+        char *base = RtlPcToFileHeader((void*)et, (void**)&base);
+
+        ti = (const cxx_type_info*)(base + ((const cxx_type_info_table*)(base + et->type_info_table))->info[0]);
+        copy_ctor = ti->copy_ctor ? base + ti->copy_ctor : NULL;
+#else
+        ti = et->type_info_table->info[0];
+        copy_ctor = (void *)ti->copy_ctor;
+#endif
+
+        if (ti->size > sizeof(object))
+        {
+            FIXME("exception object is too large (%u bytes), leaking it\n", ti->size);
+            HeapFree(GetProcessHeap(), 0, ep->rec);
+            HeapFree(GetProcessHeap(), 0, ep->ref);
+            ep->rec = NULL;
+            ep->ref = NULL;
+        }
+        else
+        {
+            if (!(ti->flags & CLASS_IS_SIMPLE_TYPE) && copy_ctor)
+                call_copy_ctor(copy_ctor, &object, obj, ti->flags & CLASS_HAS_VIRTUAL_BASE_CLASS);
+            else
+                memcpy(&object, obj, ti->size);
+            rec.ExceptionInformation[1] = (ULONG_PTR)&object;
+        }
+    }
+    __ExceptionPtrDestroy(ep);
+
+    RaiseException(rec.ExceptionCode, rec.ExceptionFlags & (~EH_UNWINDING),
+            rec.NumberParameters, rec.ExceptionInformation);
+}
+
+/*********************************************************************
+ * ?__ExceptionPtrCurrentException@@YAXPAX@Z
+ * ?__ExceptionPtrCurrentException@@YAXPEAX@Z
+ */
+void __cdecl __ExceptionPtrCurrentException(exception_ptr *ep)
+{
+    TRACE("(%p)\n", ep);
+
+    exception_ptr_from_record(ep, msvcrt_get_thread_data()->exc_record);
+}
+
 /*********************************************************************
  * ?__ExceptionPtrToBool@@YA_NPBX@Z
  * ?__ExceptionPtrToBool@@YA_NPEBX@Z
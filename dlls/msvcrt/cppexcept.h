@@ -123,6 +123,18 @@ typedef struct
 void WINAPI _CxxThrowException(exception*,const cxx_exception_type*);
 int CDECL _XcptFilter(NTSTATUS, PEXCEPTION_POINTERS);
 
+/* std::exception_ptr class helpers */
+typedef struct
+{
+    EXCEPTION_RECORD *rec;
+    int *ref; /* not binary compatible with native msvcr100 */
+} exception_ptr;
+
+void exception_ptr_from_record(exception_ptr*,EXCEPTION_RECORD*) DECLSPEC_HIDDEN;
+void exception_ptr_rethrow_release(exception_ptr*) DECLSPEC_HIDDEN;
+void __cdecl __ExceptionPtrDestroy(exception_ptr*);
+void __cdecl __ExceptionPtrRethrow(const exception_ptr*);
+
 static inline const char *dbgstr_type_info( const type_info *info )
 {
     if (!info) return "{}";
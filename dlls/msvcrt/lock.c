@@ -22,6 +22,7 @@
 #include <stdarg.h>
 
 #include "wine/debug.h"
+#include "wine/exception.h"
 #include "windef.h"
 #include "winbase.h"
 #include "winternl.h"
@@ -722,6 +723,649 @@ void __thiscall _Condition_variable_notify_all(_Condition_variable *this)
 }
 #endif
 
+#if _MSVCR_VER >= 100
+/* Work-stealing task scheduler backing CurrentScheduler::ScheduleTask and the
+ * structured task collections behind parallel_for and parallel_invoke.
+ * Each worker owns a Chase-Lev deque: it pushes and pops chores at the
+ * bottom while idle workers steal from the top of the others. Threads which
+ * are not workers hand their tasks over through a shared injection deque. */
+struct sched_task
+{
+    void (__cdecl *proc)(void*);
+    void *arg;
+};
+
+struct sched_array
+{
+    LONG size;
+    struct sched_array *prev; /* thieves may still read old arrays, freed at exit */
+    struct sched_task tasks[1];
+};
+
+struct sched_deque
+{
+    volatile LONG top;
+    volatile LONG bottom;
+    struct sched_array *volatile array;
+};
+
+struct sched_worker
+{
+    struct sched_deque deque;
+    DWORD node;
+    DWORD cpu;
+};
+
+typedef struct _StructuredTaskCollection _StructuredTaskCollection;
+
+/* per thread state, only present on workers and while running a chore */
+struct sched_context
+{
+    struct sched_worker *worker;
+    _StructuredTaskCollection *collection;
+};
+
+#define SCHED_DEQUE_INITIAL_SIZE 256
+
+static struct sched_worker *sched_workers;
+static int sched_worker_count;
+static struct sched_deque sched_inject;
+static HANDLE sched_semaphore;
+static LONG sched_sleepers;
+static DWORD sched_tls = TLS_OUT_OF_INDEXES;
+static LONG sched_initialized;
+
+static CRITICAL_SECTION sched_cs;
+static CRITICAL_SECTION_DEBUG sched_cs_debug =
+{
+    0, 0, &sched_cs,
+    { &sched_cs_debug.ProcessLocksList, &sched_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": sched_cs") }
+};
+static CRITICAL_SECTION sched_cs = { &sched_cs_debug, -1, 0, 0, 0, 0 };
+
+static BOOL sched_deque_init(struct sched_deque *deque)
+{
+    struct sched_array *array;
+
+    array = HeapAlloc(GetProcessHeap(), 0,
+            FIELD_OFFSET(struct sched_array, tasks[SCHED_DEQUE_INITIAL_SIZE]));
+    if(!array)
+        return FALSE;
+    array->size = SCHED_DEQUE_INITIAL_SIZE;
+    array->prev = NULL;
+
+    deque->top = deque->bottom = 0;
+    deque->array = array;
+    return TRUE;
+}
+
+static void sched_deque_destroy(struct sched_deque *deque)
+{
+    struct sched_array *array = deque->array, *prev;
+
+    while(array) {
+        prev = array->prev;
+        HeapFree(GetProcessHeap(), 0, array);
+        array = prev;
+    }
+    deque->array = NULL;
+}
+
+/* only called by the owner of the deque */
+static BOOL sched_deque_push(struct sched_deque *deque, const struct sched_task *task)
+{
+    LONG bottom = deque->bottom, top = deque->top;
+    struct sched_array *array = deque->array;
+
+    if(bottom - top >= array->size - 1) {
+        struct sched_array *grown;
+        LONG i;
+
+        grown = HeapAlloc(GetProcessHeap(), 0,
+                FIELD_OFFSET(struct sched_array, tasks[array->size * 2]));
+        if(!grown)
+            return FALSE;
+        grown->size = array->size * 2;
+        grown->prev = array;
+        for(i = top; i != bottom; i++)
+            grown->tasks[i & (grown->size - 1)] = array->tasks[i & (array->size - 1)];
+        InterlockedExchangePointer((void **)&deque->array, grown);
+        array = grown;
+    }
+
+    array->tasks[bottom & (array->size - 1)] = *task;
+    InterlockedExchange(&deque->bottom, bottom + 1);
+    return TRUE;
+}
+
+/* only called by the owner of the deque */
+static BOOL sched_deque_pop(struct sched_deque *deque, struct sched_task *task)
+{
+    LONG bottom = deque->bottom - 1, top;
+    struct sched_array *array = deque->array;
+    BOOL ret = TRUE;
+
+    InterlockedExchange(&deque->bottom, bottom);
+    top = deque->top;
+    if(bottom - top < 0) {
+        deque->bottom = bottom + 1;
+        return FALSE;
+    }
+
+    *task = array->tasks[bottom & (array->size - 1)];
+    if(bottom != top)
+        return TRUE;
+
+    /* last task, race against the thieves for it */
+    ret = InterlockedCompareExchange(&deque->top, top + 1, top) == top;
+    deque->bottom = bottom + 1;
+    return ret;
+}
+
+static BOOL sched_deque_steal(struct sched_deque *deque, struct sched_task *task)
+{
+    LONG top = deque->top, bottom = deque->bottom;
+    struct sched_array *array;
+
+    if(bottom - top <= 0)
+        return FALSE;
+
+    array = deque->array;
+    *task = array->tasks[top & (array->size - 1)];
+    return InterlockedCompareExchange(&deque->top, top + 1, top) == top;
+}
+
+static BOOL sched_find_task(struct sched_worker *self, struct sched_task *task)
+{
+    int i, start;
+
+    if(self && sched_deque_pop(&self->deque, task))
+        return TRUE;
+    if(sched_deque_steal(&sched_inject, task))
+        return TRUE;
+
+    /* prefer victims on the same NUMA node */
+    start = self ? self - sched_workers + 1 : 0;
+    if(self) {
+        for(i = 0; i < sched_worker_count; i++) {
+            struct sched_worker *victim = &sched_workers[(start + i) % sched_worker_count];
+
+            if(victim != self && victim->node == self->node
+                    && sched_deque_steal(&victim->deque, task))
+                return TRUE;
+        }
+    }
+    for(i = 0; i < sched_worker_count; i++) {
+        struct sched_worker *victim = &sched_workers[(start + i) % sched_worker_count];
+
+        if(self && victim->node == self->node)
+            continue;
+        if(sched_deque_steal(&victim->deque, task))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL sched_push(const struct sched_task *task)
+{
+    struct sched_context *ctx;
+    BOOL ret;
+
+    /* nothing would ever pick the task up */
+    if(!sched_worker_count) {
+        task->proc(task->arg);
+        return TRUE;
+    }
+
+    ctx = TlsGetValue(sched_tls);
+    if(ctx && ctx->worker) {
+        ret = sched_deque_push(&ctx->worker->deque, task);
+    }else {
+        EnterCriticalSection(&sched_cs);
+        ret = sched_deque_push(&sched_inject, task);
+        LeaveCriticalSection(&sched_cs);
+    }
+
+    if(ret && sched_sleepers)
+        ReleaseSemaphore(sched_semaphore, 1, NULL);
+    return ret;
+}
+
+/* spin, then yield, then sleep until there is something to run */
+static BOOL sched_wait_for_task(struct sched_worker *worker, struct sched_task *task)
+{
+    SpinWait sw;
+    BOOL ret;
+
+    SpinWait_ctor_yield(&sw, &spin_wait_yield);
+    SpinWait__Reset(&sw);
+    while(SpinWait__SpinOnce(&sw)) {
+        if(sched_find_task(worker, task)) {
+            SpinWait_dtor(&sw);
+            return TRUE;
+        }
+    }
+    SpinWait_dtor(&sw);
+
+    /* sched_push checks for sleepers after publishing the task, so
+     * registering before the final check cannot miss a wakeup */
+    InterlockedIncrement(&sched_sleepers);
+    if(!(ret = sched_find_task(worker, task)))
+        WaitForSingleObject(sched_semaphore, INFINITE);
+    InterlockedDecrement(&sched_sleepers);
+    return ret;
+}
+
+static DWORD WINAPI sched_worker_proc(void *arg)
+{
+    struct sched_context ctx;
+    struct sched_task task;
+
+    ctx.worker = arg;
+    ctx.collection = NULL;
+    TlsSetValue(sched_tls, &ctx);
+
+    TRACE("starting worker %p on node %u\n", ctx.worker, ctx.worker->node);
+
+    while(1) {
+        if(sched_find_task(ctx.worker, &task) || sched_wait_for_task(ctx.worker, &task))
+            task.proc(task.arg);
+    }
+    return 0;
+}
+
+/* hand out the processors node by node so that neighbouring workers,
+ * which steal from each other first, share their caches */
+static void sched_place_workers(void)
+{
+    ULONGLONG mask;
+    ULONG highest;
+    int i = 0, cpu;
+    UCHAR node;
+
+    if(!GetNumaHighestNodeNumber(&highest))
+        highest = 0;
+
+    for(node = 0; node <= highest && i < sched_worker_count; node++) {
+        if(!GetNumaNodeProcessorMask(node, &mask))
+            continue;
+        for(cpu = 0; cpu < 64 && i < sched_worker_count; cpu++) {
+            if(!(mask & ((ULONGLONG)1 << cpu)))
+                continue;
+            sched_workers[i].node = node;
+            sched_workers[i].cpu = cpu;
+            i++;
+        }
+    }
+
+    for(; i < sched_worker_count; i++) {
+        sched_workers[i].node = 0;
+        sched_workers[i].cpu = i;
+    }
+}
+
+static void sched_init(void)
+{
+    SYSTEM_INFO si;
+    HMODULE module;
+    int i, count;
+
+    /* pairs with the InterlockedExchange below, everything set up before
+     * the flag was raised is visible once we see it */
+    if(InterlockedCompareExchange(&sched_initialized, 0, 0))
+        return;
+
+    EnterCriticalSection(&sched_cs);
+    if(sched_initialized) {
+        LeaveCriticalSection(&sched_cs);
+        return;
+    }
+
+    if(!keyed_event) {
+        HANDLE event;
+
+        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
+        if(InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
+            NtClose(event);
+    }
+
+    if((sched_tls = TlsAlloc()) == TLS_OUT_OF_INDEXES)
+        ERR("failed to allocate TLS index\n");
+    sched_deque_init(&sched_inject);
+
+    /* the thread waiting for a task collection runs chores itself */
+    GetSystemInfo(&si);
+    count = si.dwNumberOfProcessors > 1 ? si.dwNumberOfProcessors - 1 : 1;
+    sched_semaphore = CreateSemaphoreW(NULL, 0, count, NULL);
+    sched_workers = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(*sched_workers));
+    if(sched_workers && sched_semaphore && sched_tls != TLS_OUT_OF_INDEXES) {
+        sched_worker_count = count;
+        sched_place_workers();
+
+        /* the workers live until the process exits */
+        GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+                (const WCHAR *)sched_init, &module);
+        for(i = 0; i < count; i++) {
+            HANDLE thread;
+
+            if(!sched_deque_init(&sched_workers[i].deque))
+                break;
+            if(!(thread = CreateThread(NULL, 0, sched_worker_proc, &sched_workers[i],
+                            CREATE_SUSPENDED, NULL))) {
+                sched_deque_destroy(&sched_workers[i].deque);
+                break;
+            }
+            SetThreadIdealProcessor(thread, sched_workers[i].cpu);
+            ResumeThread(thread);
+            CloseHandle(thread);
+        }
+        sched_worker_count = i;
+    }
+    if(!sched_worker_count)
+        ERR("failed to start scheduler threads, tasks will run synchronously\n");
+
+    InterlockedExchange(&sched_initialized, TRUE);
+    LeaveCriticalSection(&sched_cs);
+}
+
+typedef enum
+{
+    TASK_COLLECTION_NOT_COMPLETE,
+    TASK_COLLECTION_COMPLETED,
+    TASK_COLLECTION_CANCELED
+} _TaskCollectionStatus;
+
+typedef struct _UnrealizedChore
+{
+    const vtable_ptr *vtable;
+    void (__cdecl *chore_proc)(struct _UnrealizedChore*);
+    _StructuredTaskCollection *task_collection;
+    void (__cdecl *chore_wrapper)(struct _UnrealizedChore*);
+    void *unk[6];
+} _UnrealizedChore;
+
+struct _StructuredTaskCollection
+{
+    void *token;
+    unsigned int unk1;
+    void *unk2;
+    void *context;
+    LONG count;
+    volatile LONG finished;
+    /* exception_ptr of the first failed chore, low bit set once canceled */
+    void *volatile exception;
+    void *unk3;
+};
+
+/* value of finished before the first chore was scheduled */
+#define COLLECTION_NOT_INITIALIZED  0x80000000
+/* set in finished while the owner sleeps on the keyed event */
+#define COLLECTION_WAITING          0x40000000
+#define COLLECTION_CANCELED         1
+
+static LONG CALLBACK execute_chore_except(EXCEPTION_POINTERS *ptrs)
+{
+    struct sched_context *ctx = TlsGetValue(sched_tls);
+    _StructuredTaskCollection *collection;
+    exception_ptr *ep;
+    void *prev;
+
+    if(!ctx || !ctx->collection)
+        return EXCEPTION_CONTINUE_SEARCH;
+    collection = ctx->collection;
+
+    if(!(ep = HeapAlloc(GetProcessHeap(), 0, sizeof(*ep))))
+        return EXCEPTION_CONTINUE_SEARCH;
+    exception_ptr_from_record(ep, ptrs->ExceptionRecord);
+
+    /* only the first exception is passed on, it also cancels the other chores */
+    do {
+        prev = collection->exception;
+        if((ULONG_PTR)prev & ~COLLECTION_CANCELED) {
+            __ExceptionPtrDestroy(ep);
+            HeapFree(GetProcessHeap(), 0, ep);
+            break;
+        }
+    } while(InterlockedCompareExchangePointer(&collection->exception,
+                (void *)((ULONG_PTR)ep | COLLECTION_CANCELED), prev) != prev);
+    return EXCEPTION_EXECUTE_HANDLER;
+}
+
+static void run_chore(_UnrealizedChore *chore, _StructuredTaskCollection *collection)
+{
+    struct sched_context *ctx = TlsGetValue(sched_tls), frame;
+    _StructuredTaskCollection *prev;
+
+    if((ULONG_PTR)collection->exception & COLLECTION_CANCELED)
+        return;
+
+    if(!ctx) {
+        frame.worker = NULL;
+        frame.collection = NULL;
+        ctx = &frame;
+        TlsSetValue(sched_tls, ctx);
+    }
+    prev = ctx->collection;
+    ctx->collection = collection;
+
+    __TRY
+    {
+        chore->chore_proc(chore);
+    }
+    __EXCEPT(execute_chore_except)
+    {
+    }
+    __ENDTRY
+
+    ctx->collection = prev;
+    if(ctx == &frame)
+        TlsSetValue(sched_tls, NULL);
+}
+
+static void __cdecl execute_chore(void *arg)
+{
+    _UnrealizedChore *chore = arg;
+    _StructuredTaskCollection *collection = chore->task_collection;
+    LONG count, finished;
+
+    run_chore(chore, collection);
+    chore->task_collection = NULL;
+
+    /* count is final once the owner has started waiting, and the
+     * collection must not be touched after the last chore finished */
+    do {
+        finished = collection->finished;
+        count = collection->count;
+    } while(InterlockedCompareExchange(&collection->finished, finished + 1, finished) != finished);
+
+    if((finished & COLLECTION_WAITING) && ((finished + 1) & ~COLLECTION_WAITING) == count)
+        NtReleaseKeyedEvent(keyed_event, collection, 0, NULL);
+}
+
+#if _MSVCR_VER >= 110
+/* ??0_StructuredTaskCollection@details@Concurrency@@QAE@PAV_CancellationTokenState@12@@Z */
+/* ??0_StructuredTaskCollection@details@Concurrency@@QEAA@PEAV_CancellationTokenState@12@@Z */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection_ctor, 8)
+_StructuredTaskCollection* __thiscall _StructuredTaskCollection_ctor(
+        _StructuredTaskCollection *this, void *token)
+{
+    TRACE("(%p %p)\n", this, token);
+
+    if(token)
+        FIXME("cancellation tokens are not supported\n");
+
+    memset(this, 0, sizeof(*this));
+    this->finished = COLLECTION_NOT_INITIALIZED;
+    return this;
+}
+#endif
+
+#if _MSVCR_VER >= 120
+/* ??1_StructuredTaskCollection@details@Concurrency@@QAE@XZ */
+/* ??1_StructuredTaskCollection@details@Concurrency@@QEAA@XZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection_dtor, 4)
+void __thiscall _StructuredTaskCollection_dtor(_StructuredTaskCollection *this)
+{
+    TRACE("(%p)\n", this);
+
+    if(this->count)
+        ERR("destroying task collection with %d chores still scheduled\n", this->count);
+}
+#endif
+
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAEXPAV_UnrealizedChore@23@@Z */
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QEAAXPEAV_UnrealizedChore@23@@Z */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Schedule, 8)
+void __thiscall _StructuredTaskCollection__Schedule(
+        _StructuredTaskCollection *this, _UnrealizedChore *chore)
+{
+    struct sched_task task;
+
+    TRACE("(%p %p)\n", this, chore);
+
+    sched_init();
+
+    if(this->finished == COLLECTION_NOT_INITIALIZED)
+        this->finished = 0;
+    chore->task_collection = this;
+    this->count++;
+
+    task.proc = execute_chore;
+    task.arg = chore;
+    if(!sched_push(&task))
+        execute_chore(chore);
+}
+
+#if _MSVCR_VER >= 110
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QAEXPAV_UnrealizedChore@23@PAVlocation@3@@Z */
+/* ?_Schedule@_StructuredTaskCollection@details@Concurrency@@QEAAXPEAV_UnrealizedChore@23@PEAVlocation@3@@Z */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Schedule_loc, 12)
+void __thiscall _StructuredTaskCollection__Schedule_loc(
+        _StructuredTaskCollection *this, _UnrealizedChore *chore, void *placement)
+{
+    TRACE("(%p %p %p)\n", this, chore, placement);
+    _StructuredTaskCollection__Schedule(this, chore);
+}
+#endif
+
+/* ?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QAG?AW4_TaskCollectionStatus@23@PAV_UnrealizedChore@23@@Z */
+/* ?_RunAndWait@_StructuredTaskCollection@details@Concurrency@@QEAA?AW4_TaskCollectionStatus@23@PEAV_UnrealizedChore@23@@Z */
+_TaskCollectionStatus __stdcall _StructuredTaskCollection__RunAndWait(
+        _StructuredTaskCollection *this, _UnrealizedChore *chore)
+{
+    struct sched_context *ctx;
+    struct sched_task task;
+    exception_ptr *ep;
+    void *exception;
+    LONG finished;
+    SpinWait sw;
+
+    TRACE("(%p %p)\n", this, chore);
+
+    sched_init();
+
+    if(chore)
+        run_chore(chore, this);
+
+    if(this->count) {
+        ctx = TlsGetValue(sched_tls);
+
+        /* help with the outstanding chores, or anything else, before sleeping */
+        SpinWait_ctor_yield(&sw, &spin_wait_yield);
+        SpinWait__Reset(&sw);
+        while((finished = this->finished) != this->count) {
+            if(sched_find_task(ctx ? ctx->worker : NULL, &task)) {
+                task.proc(task.arg);
+                SpinWait__Reset(&sw);
+                continue;
+            }
+            if(SpinWait__SpinOnce(&sw))
+                continue;
+
+            if(InterlockedCompareExchange(&this->finished,
+                        finished | COLLECTION_WAITING, finished) == finished) {
+                NtWaitForKeyedEvent(keyed_event, this, 0, NULL);
+                break;
+            }
+        }
+        SpinWait_dtor(&sw);
+    }
+
+    this->count = 0;
+    this->finished = 0;
+    exception = this->exception;
+    this->exception = NULL;
+
+    if((ep = (exception_ptr *)((ULONG_PTR)exception & ~COLLECTION_CANCELED))) {
+        exception_ptr copy = *ep;
+
+        HeapFree(GetProcessHeap(), 0, ep);
+        exception_ptr_rethrow_release(&copy);
+    }
+    return exception ? TASK_COLLECTION_CANCELED : TASK_COLLECTION_COMPLETED;
+}
+
+/* ?_Cancel@_StructuredTaskCollection@details@Concurrency@@QAEXXZ */
+/* ?_Cancel@_StructuredTaskCollection@details@Concurrency@@QEAAXXZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__Cancel, 4)
+void __thiscall _StructuredTaskCollection__Cancel(_StructuredTaskCollection *this)
+{
+    void *prev;
+
+    TRACE("(%p)\n", this);
+
+    do {
+        prev = this->exception;
+    } while(InterlockedCompareExchangePointer(&this->exception,
+                (void *)((ULONG_PTR)prev | COLLECTION_CANCELED), prev) != prev);
+}
+
+/* ?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QAE_NXZ */
+/* ?_IsCanceling@_StructuredTaskCollection@details@Concurrency@@QEAA_NXZ */
+DEFINE_THISCALL_WRAPPER(_StructuredTaskCollection__IsCanceling, 4)
+MSVCRT_bool __thiscall _StructuredTaskCollection__IsCanceling(_StructuredTaskCollection *this)
+{
+    TRACE("(%p)\n", this);
+    return ((ULONG_PTR)this->exception & COLLECTION_CANCELED) != 0;
+}
+
+/* ?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z */
+/* ?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z */
+void __cdecl CurrentScheduler_ScheduleTask(void (__cdecl *proc)(void*), void *data)
+{
+    struct sched_task task;
+
+    TRACE("(%p %p)\n", proc, data);
+
+    sched_init();
+
+    task.proc = proc;
+    task.arg = data;
+    if(!sched_push(&task))
+        throw_bad_alloc("bad allocation");
+}
+
+#if _MSVCR_VER >= 110
+/* ?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0AAVlocation@2@@Z */
+/* ?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0AEAVlocation@2@@Z */
+void __cdecl CurrentScheduler_ScheduleTask_loc(void (__cdecl *proc)(void*),
+        void *data, void *placement)
+{
+    TRACE("(%p %p %p)\n", proc, data, placement);
+    CurrentScheduler_ScheduleTask(proc, data);
+}
+
+/* ?_ScheduleTask@_CurrentScheduler@details@Concurrency@@SAXP6AXPAX@Z0@Z */
+/* ?_ScheduleTask@_CurrentScheduler@details@Concurrency@@SAXP6AXPEAX@Z0@Z */
+void __cdecl _CurrentScheduler__ScheduleTask(void (__cdecl *proc)(void*), void *data)
+{
+    TRACE("(%p %p)\n", proc, data);
+    CurrentScheduler_ScheduleTask(proc, data);
+}
+#endif
+#endif
+
 /**********************************************************************
  *     msvcrt_free_locks (internal)
  *
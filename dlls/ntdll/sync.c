@@ -1307,6 +1307,66 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve up to count completion messages from the
+ * completion object's queue, using a single server call per batch.
+ *
+ * PARAMS
+ *      port      [I] HANDLE to I/O completion object
+ *      info      [O] array receiving the completion messages
+ *      count     [I] number of entries in info
+ *      written   [O] number of completion messages retrieved
+ *      timeout   [I] optional wait time in NTDLL format
+ *      alertable [I] whether the wait is alertable
+ *
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE port, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                        ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    struct io_completion stack_comps[16], *comps = stack_comps;
+    NTSTATUS status;
+    ULONG i, n = 0;
+
+    TRACE( "(%p %p %u %p %p %u)\n", port, info, count, written, timeout, alertable );
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+
+    if (count > sizeof(stack_comps) / sizeof(stack_comps[0]) &&
+        !(comps = RtlAllocateHeap( GetProcessHeap(), 0, count * sizeof(*comps) )))
+        return STATUS_NO_MEMORY;
+
+    for (;;)
+    {
+        SERVER_START_REQ( remove_completions )
+        {
+            req->handle = wine_server_obj_handle( port );
+            wine_server_set_reply( req, comps, count * sizeof(*comps) );
+            if (!(status = wine_server_call( req )))
+                n = wine_server_reply_size( reply ) / sizeof(*comps);
+        }
+        SERVER_END_REQ;
+        if (status != STATUS_PENDING) break;
+
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != WAIT_OBJECT_0) break;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        info[i].CompletionKey             = comps[i].ckey;
+        info[i].CompletionValue           = comps[i].cvalue;
+        info[i].IoStatusBlock.Information = comps[i].information;
+        info[i].IoStatusBlock.u.Status    = comps[i].status;
+    }
+    *written = n;
+
+    if (comps != stack_comps) RtlFreeHeap( GetProcessHeap(), 0, comps );
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
@@ -1392,7 +1452,7 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE CompletionPort, IO_COMPLETION_INFORM
 }
 
 NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                              NTSTATUS CompletionStatus, ULONG Information )
+                              NTSTATUS CompletionStatus, ULONG Information, BOOL async )
 {
     NTSTATUS status;
 
@@ -1402,6 +1462,7 @@ NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         status = wine_server_call( req );
     }
     SERVER_END_REQ;
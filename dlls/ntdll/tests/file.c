@@ -72,6 +72,7 @@ static NTSTATUS (WINAPI *pNtCreateIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_AT
 static NTSTATUS (WINAPI *pNtOpenIoCompletion)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES);
 static NTSTATUS (WINAPI *pNtQueryIoCompletion)(HANDLE, IO_COMPLETION_INFORMATION_CLASS, PVOID, ULONG, PULONG);
 static NTSTATUS (WINAPI *pNtRemoveIoCompletion)(HANDLE, PULONG_PTR, PULONG_PTR, PIO_STATUS_BLOCK, PLARGE_INTEGER);
+static NTSTATUS (WINAPI *pNtRemoveIoCompletionEx)(HANDLE, FILE_IO_COMPLETION_INFORMATION *, ULONG, ULONG *, LARGE_INTEGER *, BOOLEAN);
 static NTSTATUS (WINAPI *pNtSetIoCompletion)(HANDLE, ULONG_PTR, ULONG_PTR, NTSTATUS, SIZE_T);
 static NTSTATUS (WINAPI *pNtSetInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
 static NTSTATUS (WINAPI *pNtQueryInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
@@ -1178,6 +1179,69 @@ static void test_iocp_setcompletion(HANDLE h)
     ok( !count, "Unexpected msg count: %d\n", count );
 }
 
+static void test_iocp_removeex(HANDLE h)
+{
+    FILE_IO_COMPLETION_INFORMATION info[64];
+    LARGE_INTEGER timeout;
+    ULONG count, i, next = 0;
+    NTSTATUS res;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        win_skip("NtRemoveIoCompletionEx is not available\n");
+        return;
+    }
+
+    /* queue enough packets for the queue to grow while it wraps around */
+    for (i = 0; i < 10; i++)
+    {
+        res = pNtSetIoCompletion( h, CKEY_FIRST, i, STATUS_SUCCESS, i );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %x\n", res );
+    }
+    count = 0;
+    res = pNtRemoveIoCompletionEx( h, info, 5, &count, NULL, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 5, "Unexpected msg count: %u\n", count );
+    for (i = 0; i < count; i++, next++)
+        ok( info[i].CompletionValue == next, "%u: got value %lx\n", i, info[i].CompletionValue );
+    for (i = 10; i < 100; i++)
+    {
+        res = pNtSetIoCompletion( h, CKEY_FIRST, i, STATUS_SUCCESS, i );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %x\n", res );
+    }
+
+    count = get_pending_msgs(h);
+    ok( count == 95, "Unexpected msg count: %u\n", count );
+
+    count = 0;
+    res = pNtRemoveIoCompletionEx( h, info, 64, &count, NULL, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 64, "Unexpected msg count: %u\n", count );
+    for (i = 0; i < count; i++, next++)
+    {
+        ok( info[i].CompletionKey == CKEY_FIRST, "%u: got key %lx\n", i, info[i].CompletionKey );
+        ok( info[i].CompletionValue == next, "%u: got value %lx\n", i, info[i].CompletionValue );
+        ok( info[i].IoStatusBlock.Information == next, "%u: got information %lu\n",
+            i, info[i].IoStatusBlock.Information );
+        ok( U(info[i].IoStatusBlock).Status == STATUS_SUCCESS, "%u: got status %x\n",
+            i, U(info[i].IoStatusBlock).Status );
+    }
+
+    count = 0;
+    res = pNtRemoveIoCompletionEx( h, info, 64, &count, NULL, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %x\n", res );
+    ok( count == 31, "Unexpected msg count: %u\n", count );
+    for (i = 0; i < count; i++, next++)
+        ok( info[i].CompletionValue == next, "%u: got value %lx\n", i, info[i].CompletionValue );
+
+    timeout.QuadPart = 0;
+    res = pNtRemoveIoCompletionEx( h, info, 64, &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx returned %x\n", res );
+
+    count = get_pending_msgs(h);
+    ok( !count, "Unexpected msg count: %u\n", count );
+}
+
 static void test_iocp_fileio(HANDLE h)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -2992,6 +3056,7 @@ static void test_iocompletion(void)
     if ( h && h != INVALID_HANDLE_VALUE)
     {
         test_iocp_setcompletion(h);
+        test_iocp_removeex(h);
         test_iocp_fileio(h);
         pNtClose(h);
     }
@@ -4189,6 +4254,7 @@ START_TEST(file)
     pNtOpenIoCompletion     = (void *)GetProcAddress(hntdll, "NtOpenIoCompletion");
     pNtQueryIoCompletion    = (void *)GetProcAddress(hntdll, "NtQueryIoCompletion");
     pNtRemoveIoCompletion   = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletion");
+    pNtRemoveIoCompletionEx = (void *)GetProcAddress(hntdll, "NtRemoveIoCompletionEx");
     pNtSetIoCompletion      = (void *)GetProcAddress(hntdll, "NtSetIoCompletion");
     pNtSetInformationFile   = (void *)GetProcAddress(hntdll, "NtSetInformationFile");
     pNtQueryInformationFile = (void *)GetProcAddress(hntdll, "NtQueryInformationFile");
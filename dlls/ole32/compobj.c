@@ -150,6 +150,13 @@ struct progidredirect_data
     ULONG clsid_offset;
 };
 
+enum class_reg_data_origin
+{
+    CLASS_REG_ACTCTX,
+    CLASS_REG_REGISTRY,
+    CLASS_REG_CACHE
+};
+
 struct class_reg_data
 {
     union
@@ -161,8 +168,14 @@ struct class_reg_data
             HANDLE hactctx;
         } actctx;
         HKEY hkey;
+        struct
+        {
+            enum comclass_threadingmodel model;
+            DWORD path_ret;
+            WCHAR dllpath[MAX_PATH+1];
+        } cache;
     } u;
-    BOOL hkey;
+    enum class_reg_data_origin origin;
 };
 
 struct registered_psclsid
@@ -1334,6 +1347,9 @@ static HRESULT apartment_getclassobject(struct apartment *apt, LPCWSTR dllpath,
         if (!strcmpiW(dllpath, apartment_loaded_dll->dll->library_name))
         {
             TRACE("found %s already loaded\n", debugstr_w(dllpath));
+            /* keep the most recently used dlls at the front of the list */
+            list_remove(&apartment_loaded_dll->entry);
+            list_add_head(&apt->loaded_dlls, &apartment_loaded_dll->entry);
             found = TRUE;
             break;
         }
@@ -1387,7 +1403,12 @@ static DWORD COM_RegReadPath(const struct class_reg_data *regdata, WCHAR *dst, D
 {
     DWORD ret;
 
-    if (regdata->hkey)
+    if (regdata->origin == CLASS_REG_CACHE)
+    {
+        lstrcpynW(dst, regdata->u.cache.dllpath, dstlen);
+        return regdata->u.cache.path_ret;
+    }
+    else if (regdata->origin == CLASS_REG_REGISTRY)
     {
 	DWORD keytype;
 	WCHAR src[MAX_PATH];
@@ -2853,7 +2874,9 @@ HRESULT WINAPI CoRegisterClassObject(
 
 static enum comclass_threadingmodel get_threading_model(const struct class_reg_data *data)
 {
-    if (data->hkey)
+    if (data->origin == CLASS_REG_CACHE)
+        return data->u.cache.model;
+    else if (data->origin == CLASS_REG_REGISTRY)
     {
         static const WCHAR wszThreadingModel[] = {'T','h','r','e','a','d','i','n','g','M','o','d','e','l',0};
         static const WCHAR wszApartment[] = {'A','p','a','r','t','m','e','n','t',0};
@@ -2880,6 +2903,216 @@ static enum comclass_threadingmodel get_threading_model(const struct class_reg_d
         return data->u.actctx.data->model;
 }
 
+/*****************************************************************************
+ * This section contains the class registration cache.
+ *
+ * The InprocServer32 and InprocHandler32 registrations of classes are cached
+ * per process, so activating the same class again doesn't have to go through
+ * the registry. The whole cache is flushed whenever anything under
+ * HKCR\CLSID changes.
+ */
+
+#define CLASS_CACHE_BUCKETS 64
+#define CLASS_CACHE_MAX_ENTRIES 1024
+
+struct class_cache_entry
+{
+    struct list entry;
+    CLSID clsid;
+    BOOL handler; /* InprocHandler32 rather than InprocServer32 registration */
+    HRESULT hr; /* result of opening the registration key */
+    struct class_reg_data regdata;
+};
+
+static struct list class_cache[CLASS_CACHE_BUCKETS]; /* protected by csClassCache */
+static unsigned int class_cache_count; /* protected by csClassCache */
+static unsigned int class_cache_generation; /* incremented each time the cache is flushed */
+static HKEY class_cache_key; /* HKCR\CLSID, watched for changes */
+static HANDLE class_cache_event; /* signaled when class_cache_key changes */
+static BOOL class_cache_disabled;
+
+static CRITICAL_SECTION csClassCache;
+static CRITICAL_SECTION_DEBUG class_cache_cs_debug =
+{
+    0, 0, &csClassCache,
+    { &class_cache_cs_debug.ProcessLocksList, &class_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": csClassCache") }
+};
+static CRITICAL_SECTION csClassCache = { &class_cache_cs_debug, -1, 0, 0, 0, 0 };
+
+/* must be called with csClassCache held */
+static void class_cache_flush(void)
+{
+    struct class_cache_entry *entry, *next;
+    unsigned int i;
+
+    for (i = 0; i < CLASS_CACHE_BUCKETS; i++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE(entry, next, &class_cache[i], struct class_cache_entry, entry)
+        {
+            list_remove(&entry->entry);
+            HeapFree(GetProcessHeap(), 0, entry);
+        }
+    }
+    class_cache_count = 0;
+    class_cache_generation++;
+}
+
+/* flushes the cache if the registry changed since the last call, returns
+ * FALSE if the cache can't be used. Must be called with csClassCache held */
+static BOOL class_cache_validate(void)
+{
+    static const WCHAR wszCLSID[] = {'C','L','S','I','D',0};
+    unsigned int i;
+    HKEY key;
+    LONG res;
+
+    if (class_cache_disabled) return FALSE;
+
+    if (!class_cache_event)
+    {
+        for (i = 0; i < CLASS_CACHE_BUCKETS; i++)
+            list_init(&class_cache[i]);
+
+        if (open_classes_key(HKEY_CLASSES_ROOT, wszCLSID, KEY_NOTIFY, &key) != ERROR_SUCCESS)
+        {
+            WARN("couldn't open the CLSID key, not caching class registrations\n");
+            class_cache_disabled = TRUE;
+            return FALSE;
+        }
+        /* created signaled, so that the notification gets armed below */
+        if (!(class_cache_event = CreateEventW(NULL, FALSE, TRUE, NULL)))
+        {
+            RegCloseKey(key);
+            class_cache_disabled = TRUE;
+            return FALSE;
+        }
+        class_cache_key = key;
+    }
+
+    if (WaitForSingleObject(class_cache_event, 0) != WAIT_OBJECT_0) return TRUE;
+
+    /* the notification is armed before anything is read from the registry, so
+     * any change made after this point flushes the entries added from now on */
+    class_cache_flush();
+    res = RegNotifyChangeKeyValue(class_cache_key, TRUE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                                  class_cache_event, TRUE);
+    if (res != ERROR_SUCCESS)
+    {
+        WARN("couldn't watch the CLSID key, error %d, not caching class registrations\n", res);
+        class_cache_disabled = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* frees memory associated with the class registration cache */
+static void class_cache_free(void)
+{
+    EnterCriticalSection(&csClassCache);
+    if (class_cache_event)
+    {
+        class_cache_flush();
+        RegCloseKey(class_cache_key);
+        CloseHandle(class_cache_event);
+        class_cache_event = NULL;
+    }
+    LeaveCriticalSection(&csClassCache);
+    DeleteCriticalSection(&csClassCache);
+}
+
+/* reads the InprocServer32 or InprocHandler32 registration of a class,
+ * from the cache if possible */
+static HRESULT get_inproc_class_reg_data(REFCLSID rclsid, BOOL handler, struct class_reg_data *regdata)
+{
+    static const WCHAR wszInprocServer32[] = {'I','n','p','r','o','c','S','e','r','v','e','r','3','2',0};
+    static const WCHAR wszInprocHandler32[] = {'I','n','p','r','o','c','H','a','n','d','l','e','r','3','2',0};
+    struct class_cache_entry *entry, *new_entry;
+    struct list *bucket = NULL;
+    unsigned int generation = 0;
+    HRESULT hr;
+    HKEY hkey;
+
+    EnterCriticalSection(&csClassCache);
+    if (class_cache_validate())
+    {
+        bucket = &class_cache[rclsid->Data1 % CLASS_CACHE_BUCKETS];
+        generation = class_cache_generation;
+        LIST_FOR_EACH_ENTRY(entry, bucket, struct class_cache_entry, entry)
+        {
+            if (entry->handler == handler && IsEqualCLSID(&entry->clsid, rclsid))
+            {
+                *regdata = entry->regdata;
+                hr = entry->hr;
+                LeaveCriticalSection(&csClassCache);
+                return hr;
+            }
+        }
+    }
+    LeaveCriticalSection(&csClassCache);
+
+    regdata->origin = CLASS_REG_CACHE;
+    regdata->u.cache.model = ThreadingModel_No;
+    regdata->u.cache.path_ret = ERROR_FILE_NOT_FOUND;
+    regdata->u.cache.dllpath[0] = 0;
+
+    hr = COM_OpenKeyForCLSID(rclsid, handler ? wszInprocHandler32 : wszInprocServer32, KEY_READ, &hkey);
+    if (SUCCEEDED(hr))
+    {
+        struct class_reg_data keydata;
+
+        keydata.u.hkey = hkey;
+        keydata.origin = CLASS_REG_REGISTRY;
+        regdata->u.cache.model = get_threading_model(&keydata);
+        regdata->u.cache.path_ret = COM_RegReadPath(&keydata, regdata->u.cache.dllpath,
+                                                    ARRAYSIZE(regdata->u.cache.dllpath));
+        RegCloseKey(hkey);
+    }
+
+    /* don't cache failures that may be transient */
+    if (!bucket || (FAILED(hr) && hr != REGDB_E_CLASSNOTREG && hr != REGDB_E_KEYMISSING))
+        return hr;
+
+    if (!(new_entry = HeapAlloc(GetProcessHeap(), 0, sizeof(*new_entry))))
+        return hr;
+    new_entry->clsid = *rclsid;
+    new_entry->handler = handler;
+    new_entry->hr = hr;
+    new_entry->regdata = *regdata;
+
+    EnterCriticalSection(&csClassCache);
+    /* the registration may be stale if the cache was flushed while it was read */
+    if (generation == class_cache_generation)
+    {
+        BOOL found = FALSE;
+
+        /* another thread may have added it first */
+        LIST_FOR_EACH_ENTRY(entry, bucket, struct class_cache_entry, entry)
+        {
+            if (entry->handler == handler && IsEqualCLSID(&entry->clsid, rclsid))
+            {
+                found = TRUE;
+                break;
+            }
+        }
+        if (!found)
+        {
+            if (class_cache_count >= CLASS_CACHE_MAX_ENTRIES)
+            {
+                TRACE("class cache full, flushing\n");
+                class_cache_flush();
+            }
+            list_add_head(bucket, &new_entry->entry);
+            class_cache_count++;
+            new_entry = NULL;
+        }
+    }
+    LeaveCriticalSection(&csClassCache);
+
+    HeapFree(GetProcessHeap(), 0, new_entry);
+    return hr;
+}
+
 static HRESULT get_inproc_class_object(APARTMENT *apt, const struct class_reg_data *regdata,
                                        REFCLSID rclsid, REFIID riid,
                                        BOOL hostifnecessary, void **ppv)
@@ -3013,7 +3246,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
             clsreg.u.actctx.hactctx = data.hActCtx;
             clsreg.u.actctx.data = data.lpData;
             clsreg.u.actctx.section = data.lpSectionBase;
-            clsreg.hkey = FALSE;
+            clsreg.origin = CLASS_REG_ACTCTX;
 
             hres = get_inproc_class_object(apt, &clsreg, &comclass->clsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
             ReleaseActCtx(data.hActCtx);
@@ -3045,10 +3278,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
     /* First try in-process server */
     if (CLSCTX_INPROC_SERVER & dwClsContext)
     {
-        static const WCHAR wszInprocServer32[] = {'I','n','p','r','o','c','S','e','r','v','e','r','3','2',0};
-        HKEY hkey;
-
-        hres = COM_OpenKeyForCLSID(rclsid, wszInprocServer32, KEY_READ, &hkey);
+        hres = get_inproc_class_reg_data(rclsid, FALSE, &clsreg);
         if (FAILED(hres))
         {
             if (hres == REGDB_E_CLASSNOTREG)
@@ -3061,13 +3291,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
         }
 
         if (SUCCEEDED(hres))
-        {
-            clsreg.u.hkey = hkey;
-            clsreg.hkey = TRUE;
-
             hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
-            RegCloseKey(hkey);
-        }
 
         /* return if we got a class, otherwise fall through to one of the
          * other types */
@@ -3081,10 +3305,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
     /* Next try in-process handler */
     if (CLSCTX_INPROC_HANDLER & dwClsContext)
     {
-        static const WCHAR wszInprocHandler32[] = {'I','n','p','r','o','c','H','a','n','d','l','e','r','3','2',0};
-        HKEY hkey;
-
-        hres = COM_OpenKeyForCLSID(rclsid, wszInprocHandler32, KEY_READ, &hkey);
+        hres = get_inproc_class_reg_data(rclsid, TRUE, &clsreg);
         if (FAILED(hres))
         {
             if (hres == REGDB_E_CLASSNOTREG)
@@ -3097,13 +3318,7 @@ HRESULT WINAPI DECLSPEC_HOTPATCH CoGetClassObject(
         }
 
         if (SUCCEEDED(hres))
-        {
-            clsreg.u.hkey = hkey;
-            clsreg.hkey = TRUE;
-
             hres = get_inproc_class_object(apt, &clsreg, rclsid, iid, !(dwClsContext & WINE_CLSCTX_DONT_HOST), ppv);
-            RegCloseKey(hkey);
-        }
 
         /* return if we got a class, otherwise fall through to one of the
          * other types */
@@ -5024,7 +5239,7 @@ HRESULT Handler_DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID *ppv)
         WCHAR dllpath[MAX_PATH+1];
 
         regdata.u.hkey = hkey;
-        regdata.hkey = TRUE;
+        regdata.origin = CLASS_REG_REGISTRY;
 
         if (COM_RegReadPath(&regdata, dllpath, ARRAYSIZE(dllpath)) == ERROR_SUCCESS)
         {
@@ -5090,6 +5305,7 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID reserved)
         UnregisterClassW( wszAptWinClass, hProxyDll );
         RPC_UnregisterAllChannelHooks();
         COMPOBJ_DllList_Free();
+        class_cache_free();
         DeleteCriticalSection(&csRegisteredClassList);
         DeleteCriticalSection(&csApartment);
 	break;
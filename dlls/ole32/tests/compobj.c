@@ -825,6 +825,82 @@ static void test_CoGetClassObject(void)
     CoUninitialize();
 }
 
+static void test_CoGetClassObject_registry_change(void)
+{
+    static const GUID CLSID_testclass = {0x5e1c2c1b,0x1d5a,0x4f0b,{0x9b,0x7f,0x2c,0x52,0x8d,0x31,0x6a,0x10}};
+    static const char testclassA[] = "{5E1C2C1B-1D5A-4F0B-9B7F-2C528D316A10}";
+    HKEY clsidkey, classkey, serverkey;
+    IUnknown *pUnk;
+    HRESULT hr;
+    LONG res;
+
+    CoInitialize(NULL);
+
+    /* the failure is remembered, but registering the class must still be noticed */
+    hr = CoGetClassObject(&CLSID_testclass, CLSCTX_INPROC_SERVER, NULL, &IID_IUnknown, (void **)&pUnk);
+    ok(hr == REGDB_E_CLASSNOTREG, "got 0x%08x\n", hr);
+
+    res = RegOpenKeyExA(HKEY_CLASSES_ROOT, "CLSID", 0, KEY_READ, &clsidkey);
+    ok(!res, "Couldn't open CLSID key, error %d\n", res);
+
+    res = RegCreateKeyExA(clsidkey, testclassA, 0, NULL, 0, KEY_ALL_ACCESS, NULL, &classkey, NULL);
+    if (res)
+    {
+        skip("failed to create a test key, error %d\n", res);
+        RegCloseKey(clsidkey);
+        CoUninitialize();
+        return;
+    }
+
+    res = RegCreateKeyExA(classkey, "InprocServer32", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &serverkey, NULL);
+    ok(!res, "RegCreateKeyEx returned %d\n", res);
+    res = RegSetValueExA(serverkey, NULL, 0, REG_SZ, (const BYTE *)"ole32.dll", sizeof("ole32.dll"));
+    ok(!res, "RegSetValueEx returned %d\n", res);
+    RegCloseKey(serverkey);
+
+    /* native picks up registry changes asynchronously */
+    Sleep(200);
+
+    pUnk = NULL;
+    hr = CoGetClassObject(&CLSID_testclass, CLSCTX_INPROC_SERVER, NULL, &IID_IUnknown, (void **)&pUnk);
+    ok(hr != REGDB_E_CLASSNOTREG, "class registration wasn't noticed\n");
+    if (SUCCEEDED(hr)) IUnknown_Release(pUnk);
+
+    res = RegDeleteKeyA(classkey, "InprocServer32");
+    ok(!res, "RegDeleteKey returned %d\n", res);
+    RegCloseKey(classkey);
+    res = RegDeleteKeyA(clsidkey, testclassA);
+    ok(!res, "RegDeleteKey returned %d\n", res);
+    RegCloseKey(clsidkey);
+
+    Sleep(200);
+
+    hr = CoGetClassObject(&CLSID_testclass, CLSCTX_INPROC_SERVER, NULL, &IID_IUnknown, (void **)&pUnk);
+    ok(hr == REGDB_E_CLASSNOTREG, "got 0x%08x\n", hr);
+
+    CoUninitialize();
+}
+
+static void test_repeated_activation(void)
+{
+    IUnknown *pUnk;
+    HRESULT hr;
+    int i;
+
+    CoInitialize(NULL);
+
+    /* later activations are served from the class registration cache */
+    for (i = 0; i < 1000; i++)
+    {
+        hr = CoGetClassObject(&CLSID_InProcFreeMarshaler, CLSCTX_INPROC_SERVER, NULL, &IID_IUnknown, (void **)&pUnk);
+        if (hr != S_OK) break;
+        IUnknown_Release(pUnk);
+    }
+    ok(hr == S_OK, "got 0x%08x after %d activations\n", hr, i);
+
+    CoUninitialize();
+}
+
 static void test_CoCreateInstanceEx(void)
 {
     MULTI_QI qi_res = { &IID_IMoniker };
@@ -3602,6 +3678,8 @@ START_TEST(compobj)
     test_CoCreateInstance();
     test_ole_menu();
     test_CoGetClassObject();
+    test_CoGetClassObject_registry_change();
+    test_repeated_activation();
     test_CoCreateInstanceEx();
     test_CoRegisterMessageFilter();
     test_CoRegisterPSClsid();
@@ -602,6 +602,302 @@ PFORMAT_STRING convert_old_args( PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING pFo
     return (PFORMAT_STRING)args;
 }
 
+/* The parsed form of a procedure description is cached, so that the header
+ * and the parameter list only have to be interpreted the first time a
+ * procedure is called.  Entries are keyed on the address of the format string
+ * and are never freed; they keep a copy of the format bytes they were built
+ * from in case another module gets loaded at the same address. */
+
+#define PROC_PLAN_HASH_SIZE 256
+
+struct proc_param
+{
+    NDR_PARAM_OIF oif;
+    unsigned char wire_size;   /* buffer size of a base type */
+    unsigned char copy_size;   /* non-zero if the base type is copied unchanged */
+};
+
+struct proc_plan
+{
+    struct proc_plan *next;
+    const MIDL_STUB_DESC *stub_desc;
+    PFORMAT_STRING format;                   /* start of the procedure description */
+    const unsigned char *format_copy;
+    unsigned int format_size;
+    PFORMAT_STRING args;                     /* description following the handle */
+    const NDR_PROC_HEADER_EXTS *extensions;
+    INTERPRETER_OPT_FLAGS Oif_flags;
+    INTERPRETER_OPT_FLAGS2 ext_flags;
+    BOOL in_fixed;                           /* all [in] params are base types */
+    BOOL out_fixed;                          /* all [out] and return params are base types */
+    ULONG in_size;
+    ULONG out_size;
+    unsigned int count;
+    struct proc_param params[1];
+};
+
+static struct proc_plan *proc_plans[PROC_PLAN_HASH_SIZE];
+
+/* returns the buffer size of a base type, or -1 if it has no fixed size */
+static int base_type_wire_size( unsigned char fc, unsigned char *copy_size )
+{
+    *copy_size = 0;
+    switch (fc)
+    {
+    case RPC_FC_BYTE:
+    case RPC_FC_CHAR:
+    case RPC_FC_SMALL:
+    case RPC_FC_USMALL:
+        return *copy_size = sizeof(UCHAR);
+    case RPC_FC_WCHAR:
+    case RPC_FC_SHORT:
+    case RPC_FC_USHORT:
+        return *copy_size = sizeof(USHORT);
+    case RPC_FC_LONG:
+    case RPC_FC_ULONG:
+    case RPC_FC_ENUM32:
+        return *copy_size = sizeof(ULONG);
+    case RPC_FC_FLOAT:
+        return *copy_size = sizeof(float);
+    case RPC_FC_DOUBLE:
+        return *copy_size = sizeof(double);
+    case RPC_FC_HYPER:
+        return *copy_size = sizeof(ULONGLONG);
+    case RPC_FC_ENUM16:
+        return sizeof(USHORT);
+    case RPC_FC_INT3264:
+    case RPC_FC_UINT3264:
+        return sizeof(ULONG);
+    case RPC_FC_ERROR_STATUS_T:
+        return sizeof(error_status_t);
+    case RPC_FC_IGNORE:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+static void add_wire_size( ULONG *size, unsigned int wire_size )
+{
+    if (!wire_size) return;
+    *size = (*size + wire_size - 1) & ~(wire_size - 1);
+    *size += wire_size;
+}
+
+static struct proc_plan *create_proc_plan( PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING format,
+                                           PFORMAT_STRING args, unsigned int stack_size, BOOL object_proc )
+{
+    NDR_PARAM_OIF old_params[256];
+    const NDR_PARAM_OIF *params;
+    INTERPRETER_OPT_FLAGS Oif_flags = { 0 };
+    INTERPRETER_OPT_FLAGS2 ext_flags = { 0 };
+    const NDR_PROC_HEADER_EXTS *extensions = NULL;
+    struct proc_plan *plan;
+    PFORMAT_STRING end;
+    unsigned int i, count;
+
+    if (is_oicf_stubdesc( pStubMsg->StubDesc ))
+    {
+        const NDR_PROC_PARTIAL_OIF_HEADER *pOIFHeader = (const NDR_PROC_PARTIAL_OIF_HEADER *)args;
+
+        Oif_flags = pOIFHeader->Oi2Flags;
+        count = pOIFHeader->number_of_params;
+        end = args + sizeof(NDR_PROC_PARTIAL_OIF_HEADER);
+        if (Oif_flags.HasExtensions)
+        {
+            extensions = (const NDR_PROC_HEADER_EXTS *)end;
+            ext_flags = extensions->Flags2;
+            end += extensions->Size;
+        }
+        params = (const NDR_PARAM_OIF *)end;
+        end += count * sizeof(NDR_PARAM_OIF);
+    }
+    else
+    {
+        params = (const NDR_PARAM_OIF *)convert_old_args( pStubMsg, args, stack_size, object_proc,
+                                                          old_params, sizeof(old_params), &count );
+        end = args;
+        for (i = 0; i < count; i++)
+            end += params[i].attr.IsBasetype ? sizeof(NDR_PARAM_OI_BASETYPE) : sizeof(NDR_PARAM_OI_OTHER);
+    }
+
+    if (!(plan = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct proc_plan, params[count] ) +
+                            (end - format) )))
+        RpcRaiseException( RPC_S_OUT_OF_MEMORY );
+
+    plan->stub_desc   = pStubMsg->StubDesc;
+    plan->format      = format;
+    plan->format_size = end - format;
+    plan->format_copy = memcpy( &plan->params[count], format, plan->format_size );
+    plan->args        = args;
+    plan->extensions  = extensions;
+    plan->Oif_flags   = Oif_flags;
+    plan->ext_flags   = ext_flags;
+    plan->in_fixed    = TRUE;
+    plan->out_fixed   = TRUE;
+    plan->in_size     = 0;
+    plan->out_size    = 0;
+    plan->count       = count;
+
+    for (i = 0; i < count; i++)
+    {
+        struct proc_param *param = &plan->params[i];
+        int size = -1;
+
+        param->oif = params[i];
+        param->wire_size = param->copy_size = 0;
+        if (param->oif.attr.IsBasetype)
+            size = base_type_wire_size( param->oif.u.type_format_char, &param->copy_size );
+        if (size >= 0) param->wire_size = size;
+
+        if (param->oif.attr.IsIn)
+        {
+            if (size < 0) plan->in_fixed = FALSE;
+            else add_wire_size( &plan->in_size, size );
+        }
+        if (param->oif.attr.IsOut || param->oif.attr.IsReturn)
+        {
+            if (size < 0) plan->out_fixed = FALSE;
+            else add_wire_size( &plan->out_size, size );
+        }
+    }
+
+    TRACE( "%p: %u params, in size %d, out size %d\n", format, count,
+           plan->in_fixed ? plan->in_size : -1, plan->out_fixed ? plan->out_size : -1 );
+    return plan;
+}
+
+static const struct proc_plan *get_proc_plan( PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING format,
+                                              PFORMAT_STRING args, unsigned int stack_size, BOOL object_proc )
+{
+    struct proc_plan **bucket = &proc_plans[((ULONG_PTR)format >> 2) % PROC_PLAN_HASH_SIZE];
+    struct proc_plan *plan;
+
+    for (plan = *bucket; plan; plan = plan->next)
+    {
+        if (plan->format == format && plan->stub_desc == pStubMsg->StubDesc &&
+            plan->args == args && !memcmp( plan->format_copy, format, plan->format_size ))
+            return plan;
+    }
+
+    plan = create_proc_plan( pStubMsg, format, args, stack_size, object_proc );
+
+    /* entries are only ever added at the head, so lookups don't need a lock */
+    do plan->next = *bucket;
+    while (InterlockedCompareExchangePointer( (void **)bucket, plan, plan->next ) != plan->next);
+    return plan;
+}
+
+/* copies a base type that has the same layout in memory and in the buffer */
+static inline void marshal_base_type( PMIDL_STUB_MESSAGE pStubMsg, const unsigned char *pMemory,
+                                      unsigned int size )
+{
+    ULONG_PTR mask = size - 1;
+    unsigned char *buffer = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + mask) & ~mask);
+
+    if (buffer + size > (unsigned char *)pStubMsg->RpcMsg->Buffer + pStubMsg->BufferLength)
+    {
+        ERR( "buffer overflow - Buffer = %p, size = %u\n", pStubMsg->Buffer, size );
+        RpcRaiseException( RPC_X_BAD_STUB_DATA );
+    }
+    memset( pStubMsg->Buffer, 0, buffer - pStubMsg->Buffer );
+    memcpy( buffer, pMemory, size );
+    pStubMsg->Buffer = buffer + size;
+}
+
+static inline void unmarshal_base_type( PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory,
+                                        unsigned int size )
+{
+    ULONG_PTR mask = size - 1;
+    unsigned char *buffer = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + mask) & ~mask);
+
+    if (buffer + size < buffer || buffer + size > pStubMsg->BufferEnd)
+    {
+        ERR( "buffer overflow - Buffer = %p, BufferEnd = %p, size = %u\n",
+             pStubMsg->Buffer, pStubMsg->BufferEnd, size );
+        RpcRaiseException( RPC_X_BAD_STUB_DATA );
+    }
+    memcpy( pMemory, buffer, size );
+    pStubMsg->Buffer = buffer + size;
+}
+
+static void client_do_plan_args( PMIDL_STUB_MESSAGE pStubMsg, const struct proc_plan *plan,
+                                 enum stubless_phase phase, void **fpu_args, unsigned char *pRetVal )
+{
+    BOOL presized = FALSE;
+    unsigned int i;
+
+    /* the buffer size of base types doesn't depend on their value */
+    if (phase == STUBLESS_CALCSIZE && plan->in_fixed && !pStubMsg->BufferLength)
+    {
+        pStubMsg->BufferLength = plan->in_size;
+        presized = TRUE;
+    }
+
+    for (i = 0; i < plan->count; i++)
+    {
+        const struct proc_param *param = &plan->params[i];
+        unsigned char *pArg = pStubMsg->StackTop + param->oif.stack_offset;
+        PFORMAT_STRING pTypeFormat = (PFORMAT_STRING)&pStubMsg->StubDesc->pFormatTypes[param->oif.u.type_offset];
+
+#ifdef __x86_64__  /* floats are passed as doubles through varargs functions */
+        float f;
+
+        if (param->oif.attr.IsBasetype &&
+            param->oif.u.type_format_char == RPC_FC_FLOAT &&
+            !param->oif.attr.IsSimpleRef &&
+            !fpu_args)
+        {
+            f = *(double *)pArg;
+            pArg = (unsigned char *)&f;
+        }
+#endif
+
+        TRACE("param[%d]: %p type %02x %s\n", i, pArg,
+              param->oif.attr.IsBasetype ? param->oif.u.type_format_char : *pTypeFormat,
+              debugstr_PROC_PF( param->oif.attr ));
+
+        switch (phase)
+        {
+        case STUBLESS_INITOUT:
+            if (!param->oif.attr.IsBasetype && param->oif.attr.IsOut &&
+                !param->oif.attr.IsIn && !param->oif.attr.IsByValue)
+            {
+                memset( *(unsigned char **)pArg, 0, calc_arg_size( pStubMsg, pTypeFormat ));
+            }
+            break;
+        case STUBLESS_CALCSIZE:
+            if (param->oif.attr.IsSimpleRef && !*(unsigned char **)pArg)
+                RpcRaiseException(RPC_X_NULL_REF_POINTER);
+            if (param->oif.attr.IsIn && !presized) call_buffer_sizer(pStubMsg, pArg, &param->oif);
+            break;
+        case STUBLESS_MARSHAL:
+            if (!param->oif.attr.IsIn) break;
+            if (param->copy_size)
+                marshal_base_type( pStubMsg, param->oif.attr.IsSimpleRef ? *(unsigned char **)pArg : pArg,
+                                   param->copy_size );
+            else
+                call_marshaller(pStubMsg, pArg, &param->oif);
+            break;
+        case STUBLESS_UNMARSHAL:
+            if (!param->oif.attr.IsOut) break;
+            if (param->oif.attr.IsReturn && pRetVal) pArg = pRetVal;
+            if (param->copy_size)
+                unmarshal_base_type( pStubMsg, param->oif.attr.IsSimpleRef ? *(unsigned char **)pArg : pArg,
+                                     param->copy_size );
+            else
+                call_unmarshaller(pStubMsg, &pArg, &param->oif, 0);
+            break;
+        case STUBLESS_FREE:
+            if (!param->oif.attr.IsBasetype && param->oif.attr.IsOut && !param->oif.attr.IsByValue)
+                NdrClearOutParameters( pStubMsg, pTypeFormat, *(unsigned char **)pArg );
+            break;
+        default:
+            RpcRaiseException(RPC_S_INTERNAL_ERROR);
+        }
+    }
+}
+
 LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pFormat,
                                 void **stack_top, void **fpu_stack )
 {
@@ -613,14 +909,14 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
     unsigned short procedure_number;
     /* size of stack */
     unsigned short stack_size;
-    /* number of parameters. optional for client to give it to us */
-    unsigned int number_of_params;
     /* cache of Oif_flags from v2 procedure header */
-    INTERPRETER_OPT_FLAGS Oif_flags = { 0 };
+    INTERPRETER_OPT_FLAGS Oif_flags;
     /* cache of extension flags from NDR_PROC_HEADER_EXTS */
-    INTERPRETER_OPT_FLAGS2 ext_flags = { 0 };
+    INTERPRETER_OPT_FLAGS2 ext_flags;
     /* header for procedure string */
     const NDR_PROC_HEADER * pProcHeader = (const NDR_PROC_HEADER *)&pFormat[0];
+    /* parsed procedure description */
+    const struct proc_plan *plan;
     /* the value to return to the client from the remote procedure */
     LONG_PTR RetVal = 0;
     /* the pointer to the object when in OLE mode */
@@ -675,45 +971,27 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
         if (!pFormat) goto done;
     }
 
-    if (is_oicf_stubdesc(pStubDesc))  /* -Oicf format */
-    {
-        const NDR_PROC_PARTIAL_OIF_HEADER *pOIFHeader =
-            (const NDR_PROC_PARTIAL_OIF_HEADER *)pFormat;
-
-        Oif_flags = pOIFHeader->Oi2Flags;
-        number_of_params = pOIFHeader->number_of_params;
+    plan = get_proc_plan( &stubMsg, (PFORMAT_STRING)pProcHeader, pFormat, stack_size,
+                          pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT );
+    Oif_flags = plan->Oif_flags;
+    ext_flags = plan->ext_flags;
+    pFormat = plan->args;
 
-        pFormat += sizeof(NDR_PROC_PARTIAL_OIF_HEADER);
+    TRACE("Oif_flags = %s\n", debugstr_INTERPRETER_OPT_FLAGS(Oif_flags) );
 
-        TRACE("Oif_flags = %s\n", debugstr_INTERPRETER_OPT_FLAGS(Oif_flags) );
-
-        if (Oif_flags.HasExtensions)
-        {
-            const NDR_PROC_HEADER_EXTS *pExtensions = (const NDR_PROC_HEADER_EXTS *)pFormat;
-            ext_flags = pExtensions->Flags2;
-            pFormat += pExtensions->Size;
 #ifdef __x86_64__
-            if (pExtensions->Size > sizeof(*pExtensions) && fpu_stack)
+    if (plan->extensions && plan->extensions->Size > sizeof(*plan->extensions) && fpu_stack)
+    {
+        int i;
+        unsigned short fpu_mask = *(unsigned short *)(plan->extensions + 1);
+        for (i = 0; i < 4; i++, fpu_mask >>= 2)
+            switch (fpu_mask & 3)
             {
-                int i;
-                unsigned short fpu_mask = *(unsigned short *)(pExtensions + 1);
-                for (i = 0; i < 4; i++, fpu_mask >>= 2)
-                    switch (fpu_mask & 3)
-                    {
-                    case 1: *(float *)&stack_top[i] = *(float *)&fpu_stack[i]; break;
-                    case 2: *(double *)&stack_top[i] = *(double *)&fpu_stack[i]; break;
-                    }
+            case 1: *(float *)&stack_top[i] = *(float *)&fpu_stack[i]; break;
+            case 2: *(double *)&stack_top[i] = *(double *)&fpu_stack[i]; break;
             }
-#endif
-        }
-    }
-    else
-    {
-        pFormat = convert_old_args( &stubMsg, pFormat, stack_size,
-                                    pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT,
-                                    /* reuse the correlation cache, it's not needed for v1 format */
-                                    NdrCorrCache, sizeof(NdrCorrCache), &number_of_params );
     }
+#endif
 
     stubMsg.BufferLength = 0;
 
@@ -756,16 +1034,16 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
         if (pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT)
         {
             TRACE( "INITOUT\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_INITOUT, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_plan_args(&stubMsg, plan, STUBLESS_INITOUT, fpu_stack,
+                                (unsigned char *)&RetVal);
         }
 
         __TRY
         {
             /* 2. CALCSIZE */
             TRACE( "CALCSIZE\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_plan_args(&stubMsg, plan, STUBLESS_CALCSIZE, fpu_stack,
+                                (unsigned char *)&RetVal);
 
             /* 3. GETBUFFER */
             TRACE( "GETBUFFER\n" );
@@ -795,8 +1073,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
             /* 4. MARSHAL */
             TRACE( "MARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_plan_args(&stubMsg, plan, STUBLESS_MARSHAL, fpu_stack,
+                                (unsigned char *)&RetVal);
 
             /* 5. SENDRECEIVE */
             TRACE( "SENDRECEIVE\n" );
@@ -833,8 +1111,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
             /* 6. UNMARSHAL */
             TRACE( "UNMARSHAL\n" );
-            client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                           number_of_params, (unsigned char *)&RetVal);
+            client_do_plan_args(&stubMsg, plan, STUBLESS_UNMARSHAL, fpu_stack,
+                                (unsigned char *)&RetVal);
         }
         __EXCEPT_ALL
         {
@@ -842,8 +1120,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
             {
                 /* 7. FREE */
                 TRACE( "FREE\n" );
-                client_do_args(&stubMsg, pFormat, STUBLESS_FREE, fpu_stack,
-                               number_of_params, (unsigned char *)&RetVal);
+                client_do_plan_args(&stubMsg, plan, STUBLESS_FREE, fpu_stack,
+                                    (unsigned char *)&RetVal);
                 RetVal = NdrProxyErrorHandler(GetExceptionCode());
             }
             else
@@ -878,8 +1156,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
     {
         /* 2. CALCSIZE */
         TRACE( "CALCSIZE\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_CALCSIZE, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_plan_args(&stubMsg, plan, STUBLESS_CALCSIZE, fpu_stack,
+                            (unsigned char *)&RetVal);
 
         /* 3. GETBUFFER */
         TRACE( "GETBUFFER\n" );
@@ -900,8 +1178,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
         /* 4. MARSHAL */
         TRACE( "MARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_MARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_plan_args(&stubMsg, plan, STUBLESS_MARSHAL, fpu_stack,
+                            (unsigned char *)&RetVal);
 
         /* 5. SENDRECEIVE */
         TRACE( "SENDRECEIVE\n" );
@@ -927,8 +1205,8 @@ LONG_PTR CDECL ndr_client_call( PMIDL_STUB_DESC pStubDesc, PFORMAT_STRING pForma
 
         /* 6. UNMARSHAL */
         TRACE( "UNMARSHAL\n" );
-        client_do_args(&stubMsg, pFormat, STUBLESS_UNMARSHAL, fpu_stack,
-                       number_of_params, (unsigned char *)&RetVal);
+        client_do_plan_args(&stubMsg, plan, STUBLESS_UNMARSHAL, fpu_stack,
+                            (unsigned char *)&RetVal);
     }
 
     if (ext_flags.HasNewCorrDesc)
@@ -1138,54 +1416,65 @@ LONG_PTR __cdecl call_server_func(SERVER_ROUTINE func, unsigned char * args, uns
 #endif
 
 static LONG_PTR *stub_do_args(MIDL_STUB_MESSAGE *pStubMsg,
-                              PFORMAT_STRING pFormat, enum stubless_phase phase,
-                              unsigned short number_of_params)
+                              const struct proc_plan *plan, enum stubless_phase phase)
 {
-    const NDR_PARAM_OIF *params = (const NDR_PARAM_OIF *)pFormat;
+    BOOL presized = FALSE;
     unsigned int i;
     LONG_PTR *retval_ptr = NULL;
 
-    for (i = 0; i < number_of_params; i++)
+    /* the buffer size of base types doesn't depend on their value */
+    if (phase == STUBLESS_CALCSIZE && plan->out_fixed && !pStubMsg->BufferLength)
     {
-        unsigned char *pArg = pStubMsg->StackTop + params[i].stack_offset;
-        const unsigned char *pTypeFormat = &pStubMsg->StubDesc->pFormatTypes[params[i].u.type_offset];
+        pStubMsg->BufferLength = plan->out_size;
+        presized = TRUE;
+    }
+
+    for (i = 0; i < plan->count; i++)
+    {
+        const struct proc_param *param = &plan->params[i];
+        unsigned char *pArg = pStubMsg->StackTop + param->oif.stack_offset;
+        const unsigned char *pTypeFormat = &pStubMsg->StubDesc->pFormatTypes[param->oif.u.type_offset];
 
         TRACE("param[%d]: %p -> %p type %02x %s\n", i,
               pArg, *(unsigned char **)pArg,
-              params[i].attr.IsBasetype ? params[i].u.type_format_char : *pTypeFormat,
-              debugstr_PROC_PF( params[i].attr ));
+              param->oif.attr.IsBasetype ? param->oif.u.type_format_char : *pTypeFormat,
+              debugstr_PROC_PF( param->oif.attr ));
 
         switch (phase)
         {
         case STUBLESS_MARSHAL:
-            if (params[i].attr.IsOut || params[i].attr.IsReturn)
-                call_marshaller(pStubMsg, pArg, &params[i]);
+            if (!param->oif.attr.IsOut && !param->oif.attr.IsReturn) break;
+            if (param->copy_size)
+                marshal_base_type( pStubMsg, param->oif.attr.IsSimpleRef ? *(unsigned char **)pArg : pArg,
+                                   param->copy_size );
+            else
+                call_marshaller(pStubMsg, pArg, &param->oif);
             break;
         case STUBLESS_MUSTFREE:
-            if (params[i].attr.MustFree)
+            if (param->oif.attr.MustFree)
             {
-                call_freer(pStubMsg, pArg, &params[i]);
+                call_freer(pStubMsg, pArg, &param->oif);
             }
             break;
         case STUBLESS_FREE:
-            if (params[i].attr.ServerAllocSize)
+            if (param->oif.attr.ServerAllocSize)
             {
                 HeapFree(GetProcessHeap(), 0, *(void **)pArg);
             }
-            else if (params[i].attr.IsOut &&
-                     !params[i].attr.IsIn &&
-                     !params[i].attr.IsBasetype &&
-                     !params[i].attr.IsByValue)
+            else if (param->oif.attr.IsOut &&
+                     !param->oif.attr.IsIn &&
+                     !param->oif.attr.IsBasetype &&
+                     !param->oif.attr.IsByValue)
             {
                 if (*pTypeFormat != RPC_FC_BIND_CONTEXT) pStubMsg->pfnFree(*(void **)pArg);
             }
             break;
         case STUBLESS_INITOUT:
-            if (!params[i].attr.IsIn &&
-                params[i].attr.IsOut &&
-                !params[i].attr.IsBasetype &&
-                !params[i].attr.ServerAllocSize &&
-                !params[i].attr.IsByValue)
+            if (!param->oif.attr.IsIn &&
+                param->oif.attr.IsOut &&
+                !param->oif.attr.IsBasetype &&
+                !param->oif.attr.ServerAllocSize &&
+                !param->oif.attr.IsByValue)
             {
                 if (*pTypeFormat == RPC_FC_BIND_CONTEXT)
                 {
@@ -1204,16 +1493,20 @@ static LONG_PTR *stub_do_args(MIDL_STUB_MESSAGE *pStubMsg,
             }
             break;
         case STUBLESS_UNMARSHAL:
-            if (params[i].attr.ServerAllocSize)
+            if (param->oif.attr.ServerAllocSize)
                 *(void **)pArg = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
-                                           params[i].attr.ServerAllocSize * 8);
+                                           param->oif.attr.ServerAllocSize * 8);
 
-            if (params[i].attr.IsIn)
-                call_unmarshaller(pStubMsg, &pArg, &params[i], 0);
+            if (!param->oif.attr.IsIn) break;
+            /* simple ref base types point into the buffer on the server side */
+            if (param->copy_size && !param->oif.attr.IsSimpleRef)
+                unmarshal_base_type( pStubMsg, pArg, param->copy_size );
+            else
+                call_unmarshaller(pStubMsg, &pArg, &param->oif, 0);
             break;
         case STUBLESS_CALCSIZE:
-            if (params[i].attr.IsOut || params[i].attr.IsReturn)
-                call_buffer_sizer(pStubMsg, pArg, &params[i]);
+            if ((param->oif.attr.IsOut || param->oif.attr.IsReturn) && !presized)
+                call_buffer_sizer(pStubMsg, pArg, &param->oif);
             break;
         default:
             RpcRaiseException(RPC_S_INTERNAL_ERROR);
@@ -1221,7 +1514,7 @@ static LONG_PTR *stub_do_args(MIDL_STUB_MESSAGE *pStubMsg,
         TRACE("\tmemory addr (after): %p -> %p\n", pArg, *(unsigned char **)pArg);
 
         /* make a note of the address of the return value parameter for later */
-        if (params[i].attr.IsReturn) retval_ptr = (LONG_PTR *)pArg;
+        if (param->oif.attr.IsReturn) retval_ptr = (LONG_PTR *)pArg;
     }
     return retval_ptr;
 }
@@ -1249,12 +1542,12 @@ LONG WINAPI NdrStubCall2(
     unsigned char * args;
     /* size of stack */
     unsigned short stack_size;
-    /* number of parameters. optional for client to give it to us */
-    unsigned int number_of_params;
     /* cache of Oif_flags from v2 procedure header */
-    INTERPRETER_OPT_FLAGS Oif_flags = { 0 };
+    INTERPRETER_OPT_FLAGS Oif_flags;
     /* cache of extension flags from NDR_PROC_HEADER_EXTS */
-    INTERPRETER_OPT_FLAGS2 ext_flags = { 0 };
+    INTERPRETER_OPT_FLAGS2 ext_flags;
+    /* parsed procedure description */
+    const struct proc_plan *plan;
     /* the type of pass we are currently doing */
     enum stubless_phase phase;
     /* header for procedure string */
@@ -1354,45 +1647,27 @@ LONG WINAPI NdrStubCall2(
     if (pThis)
         *(void **)args = ((CStdStubBuffer *)pThis)->pvServerObject;
 
-    if (is_oicf_stubdesc(pStubDesc))
-    {
-        const NDR_PROC_PARTIAL_OIF_HEADER *pOIFHeader = (const NDR_PROC_PARTIAL_OIF_HEADER *)pFormat;
-
-        Oif_flags = pOIFHeader->Oi2Flags;
-        number_of_params = pOIFHeader->number_of_params;
-
-        pFormat += sizeof(NDR_PROC_PARTIAL_OIF_HEADER);
-
-        TRACE("Oif_flags = %s\n", debugstr_INTERPRETER_OPT_FLAGS(Oif_flags) );
+    plan = get_proc_plan( &stubMsg, (PFORMAT_STRING)pProcHeader, pFormat, stack_size,
+                          pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT );
+    Oif_flags = plan->Oif_flags;
+    ext_flags = plan->ext_flags;
+    pFormat = plan->args;
 
-        if (Oif_flags.HasExtensions)
-        {
-            const NDR_PROC_HEADER_EXTS *pExtensions = (const NDR_PROC_HEADER_EXTS *)pFormat;
-            ext_flags = pExtensions->Flags2;
-            pFormat += pExtensions->Size;
-        }
+    TRACE("Oif_flags = %s\n", debugstr_INTERPRETER_OPT_FLAGS(Oif_flags) );
 
-        if (Oif_flags.HasPipes)
-        {
-            FIXME("pipes not supported yet\n");
-            RpcRaiseException(RPC_X_WRONG_STUB_VERSION); /* FIXME: remove when implemented */
-            /* init pipes package */
-            /* NdrPipesInitialize(...) */
-        }
-        if (ext_flags.HasNewCorrDesc)
-        {
-            /* initialize extra correlation package */
-            NdrCorrelationInitialize(&stubMsg, NdrCorrCache, sizeof(NdrCorrCache), 0);
-            if (ext_flags.Unused & 0x2) /* has range on conformance */
-                stubMsg.CorrDespIncrement = 12;
-        }
+    if (Oif_flags.HasPipes)
+    {
+        FIXME("pipes not supported yet\n");
+        RpcRaiseException(RPC_X_WRONG_STUB_VERSION); /* FIXME: remove when implemented */
+        /* init pipes package */
+        /* NdrPipesInitialize(...) */
     }
-    else
+    if (ext_flags.HasNewCorrDesc)
     {
-        pFormat = convert_old_args( &stubMsg, pFormat, stack_size,
-                                    pProcHeader->Oi_flags & RPC_FC_PROC_OIF_OBJECT,
-                                    /* reuse the correlation cache, it's not needed for v1 format */
-                                    NdrCorrCache, sizeof(NdrCorrCache), &number_of_params );
+        /* initialize extra correlation package */
+        NdrCorrelationInitialize(&stubMsg, NdrCorrCache, sizeof(NdrCorrCache), 0);
+        if (ext_flags.Unused & 0x2) /* has range on conformance */
+            stubMsg.CorrDespIncrement = 12;
     }
 
     /* convert strings, floating point values and endianness into our
@@ -1459,7 +1734,7 @@ LONG WINAPI NdrStubCall2(
         case STUBLESS_MARSHAL:
         case STUBLESS_MUSTFREE:
         case STUBLESS_FREE:
-            retval_ptr = stub_do_args(&stubMsg, pFormat, phase, number_of_params);
+            retval_ptr = stub_do_args(&stubMsg, plan, phase);
             break;
         default:
             ERR("shouldn't reach here. phase %d\n", phase);
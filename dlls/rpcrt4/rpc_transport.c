@@ -86,6 +86,7 @@
 #include "winerror.h"
 #include "wininet.h"
 #include "winternl.h"
+#include "ntsecapi.h"
 #include "wine/unicode.h"
 
 #include "rpc.h"
@@ -113,12 +114,54 @@ static RPC_STATUS RPCRT4_SpawnConnection(RpcConnection** Connection, RpcConnecti
 
 /**** ncacn_np support ****/
 
+/* ncalrpc connections are established over a named pipe, after which the
+ * client offers a shared memory channel that carries all further traffic.
+ * The section and events are unnamed; the server duplicates them out of the
+ * client process and checks the cookie before trusting them. */
+
+#define LRPC_SHM_MAGIC      0x4350524c /* "LRPC" */
+#define LRPC_SHM_RING_SIZE  0x10000
+#define LRPC_SHM_SPIN_COUNT 4000
+
+struct lrpc_shm_ring
+{
+  volatile LONG head;           /* total bytes written, updated by the writer */
+  volatile LONG tail;           /* total bytes read, updated by the reader */
+  volatile LONG reader_waiting;
+  volatile LONG writer_waiting;
+  char data[LRPC_SHM_RING_SIZE];
+};
+
+struct lrpc_shm
+{
+  ULONG cookie[4];              /* random, also sent over the pipe */
+  volatile LONG closed;
+  struct lrpc_shm_ring ring[2]; /* client to server, server to client */
+};
+
+struct lrpc_shm_request
+{
+  DWORD magic;
+  DWORD pid;
+  DWORD mapping;                /* handles in the client process */
+  DWORD events[4];
+  ULONG cookie[4];
+};
+
 typedef struct _RpcConnection_np
 {
   RpcConnection common;
   HANDLE pipe;
   HANDLE listen_thread;
   BOOL listening;
+  /* ncalrpc only */
+  struct lrpc_shm *shm;
+  HANDLE shm_mapping;
+  HANDLE shm_events[4];         /* data and space events for each ring */
+  HANDLE shm_peer;              /* peer process, signaled if it dies */
+  BOOL shm_negotiated;
+  unsigned int stash_len;       /* bytes read ahead while negotiating */
+  char stash[sizeof(struct lrpc_shm_request)];
 } RpcConnection_np;
 
 static RpcConnection *rpcrt4_conn_np_alloc(void)
@@ -529,6 +572,329 @@ static int rpcrt4_conn_np_wait_for_incoming_data(RpcConnection *Connection)
     return -1;
 }
 
+/* client side: creates the channel objects and describes them in the offer */
+static BOOL lrpc_shm_create(RpcConnection_np *npc, struct lrpc_shm_request *request)
+{
+  unsigned int i;
+
+  npc->shm_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                        0, sizeof(struct lrpc_shm), NULL);
+  if (!npc->shm_mapping) return FALSE;
+
+  npc->shm = MapViewOfFile(npc->shm_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(struct lrpc_shm));
+  if (!npc->shm) return FALSE;
+
+  for (i = 0; i < sizeof(npc->shm_events) / sizeof(npc->shm_events[0]); i++)
+  {
+    npc->shm_events[i] = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!npc->shm_events[i]) return FALSE;
+    request->events[i] = HandleToULong(npc->shm_events[i]);
+  }
+
+  if (!RtlGenRandom(npc->shm->cookie, sizeof(npc->shm->cookie))) return FALSE;
+
+  request->magic = LRPC_SHM_MAGIC;
+  request->pid = GetCurrentProcessId();
+  request->mapping = HandleToULong(npc->shm_mapping);
+  memcpy(request->cookie, npc->shm->cookie, sizeof(request->cookie));
+  return TRUE;
+}
+
+/* server side: duplicates the channel objects out of the client process */
+static BOOL lrpc_shm_import(RpcConnection_np *npc, const struct lrpc_shm_request *request)
+{
+  HANDLE process;
+  unsigned int i;
+
+  /* also used to notice when the client dies */
+  npc->shm_peer = process = OpenProcess(PROCESS_DUP_HANDLE | SYNCHRONIZE, FALSE, request->pid);
+  if (!process) return FALSE;
+
+  if (!DuplicateHandle(process, ULongToHandle(request->mapping), GetCurrentProcess(), &npc->shm_mapping,
+                       FILE_MAP_READ | FILE_MAP_WRITE, FALSE, 0))
+    return FALSE;
+
+  npc->shm = MapViewOfFile(npc->shm_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(struct lrpc_shm));
+  if (!npc->shm) return FALSE;
+
+  /* the pid comes from the client, so make sure the section really is its
+   * channel before using anything else from that process */
+  if (memcmp(npc->shm->cookie, request->cookie, sizeof(request->cookie)))
+  {
+    WARN("shared memory cookie mismatch\n");
+    /* don't let lrpc_shm_close() mark someone else's channel as closed */
+    UnmapViewOfFile(npc->shm);
+    npc->shm = NULL;
+    SetLastError(ERROR_ACCESS_DENIED);
+    return FALSE;
+  }
+
+  for (i = 0; i < sizeof(npc->shm_events) / sizeof(npc->shm_events[0]); i++)
+  {
+    if (!DuplicateHandle(process, ULongToHandle(request->events[i]), GetCurrentProcess(), &npc->shm_events[i],
+                         EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, 0))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static void lrpc_shm_close(RpcConnection_np *npc)
+{
+  unsigned int i;
+
+  if (npc->shm)
+  {
+    /* wake up the peer in case it is waiting on us */
+    InterlockedExchange(&npc->shm->closed, 1);
+    for (i = 0; i < sizeof(npc->shm_events) / sizeof(npc->shm_events[0]); i++)
+      if (npc->shm_events[i]) SetEvent(npc->shm_events[i]);
+    UnmapViewOfFile(npc->shm);
+    npc->shm = NULL;
+  }
+  for (i = 0; i < sizeof(npc->shm_events) / sizeof(npc->shm_events[0]); i++)
+  {
+    if (npc->shm_events[i]) CloseHandle(npc->shm_events[i]);
+    npc->shm_events[i] = NULL;
+  }
+  if (npc->shm_mapping) CloseHandle(npc->shm_mapping);
+  npc->shm_mapping = NULL;
+  if (npc->shm_peer) CloseHandle(npc->shm_peer);
+  npc->shm_peer = NULL;
+}
+
+/* client side: offer a shared memory channel to the server, keep using the
+ * pipe if anything goes wrong */
+static void lrpc_shm_connect(RpcConnection_np *npc)
+{
+  struct lrpc_shm_request request, reply;
+  IO_STATUS_BLOCK io_status;
+  DWORD written;
+  NTSTATUS status;
+
+  if (!lrpc_shm_create(npc, &request))
+  {
+    WARN("failed to create shared memory channel, error %u\n", GetLastError());
+    lrpc_shm_close(npc);
+    return;
+  }
+
+  if (!WriteFile(npc->pipe, &request, sizeof(request), &written, NULL) || written != sizeof(request))
+  {
+    lrpc_shm_close(npc);
+    return;
+  }
+
+  status = NtReadFile(npc->pipe, NULL, NULL, NULL, &io_status, &reply, sizeof(reply), NULL, NULL);
+  if (status || io_status.Information != sizeof(reply) || reply.magic != LRPC_SHM_MAGIC)
+  {
+    WARN("server refused shared memory channel\n");
+    lrpc_shm_close(npc);
+    return;
+  }
+
+  npc->shm_peer = OpenProcess(SYNCHRONIZE, FALSE, reply.pid);
+  TRACE("using shared memory channel\n");
+}
+
+/* server side: the first message on a new connection may be a shared memory
+ * offer, anything else is kept for the following reads */
+static BOOL lrpc_shm_accept(RpcConnection_np *npc)
+{
+  struct lrpc_shm_request request;
+  IO_STATUS_BLOCK io_status;
+  NTSTATUS status;
+  DWORD written;
+  BOOL ret;
+
+  npc->shm_negotiated = TRUE;
+
+  status = NtReadFile(npc->pipe, NULL, NULL, NULL, &io_status, &request, sizeof(request), NULL, NULL);
+  if (status && status != STATUS_BUFFER_OVERFLOW)
+    return FALSE;
+
+  if (status || io_status.Information != sizeof(request) || request.magic != LRPC_SHM_MAGIC)
+  {
+    memcpy(npc->stash, &request, io_status.Information);
+    npc->stash_len = io_status.Information;
+    return TRUE;
+  }
+
+  ret = lrpc_shm_import(npc, &request);
+  if (!ret)
+  {
+    WARN("failed to open shared memory channel of process %04x, error %u\n", request.pid, GetLastError());
+    lrpc_shm_close(npc);
+  }
+
+  memset(&request, 0, sizeof(request));
+  request.magic = ret ? LRPC_SHM_MAGIC : 0;
+  request.pid = GetCurrentProcessId();
+  if (!WriteFile(npc->pipe, &request, sizeof(request), &written, NULL) || written != sizeof(request))
+  {
+    lrpc_shm_close(npc);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* waits until *value changes from old, spinning for a while before blocking */
+static BOOL lrpc_shm_wait(RpcConnection_np *npc, volatile LONG *value, LONG old,
+                          volatile LONG *waiting, HANDLE event)
+{
+  HANDLE handles[2] = { event, npc->shm_peer };
+  unsigned int spin;
+
+  for (spin = 0; spin < LRPC_SHM_SPIN_COUNT; spin++)
+  {
+    if (*value != old) return TRUE;
+    if (npc->shm->closed) return FALSE;
+    YieldProcessor();
+  }
+
+  for (;;)
+  {
+    InterlockedExchange(waiting, 1);
+    if (*value != old)
+    {
+      InterlockedExchange(waiting, 0);
+      return TRUE;
+    }
+    if (npc->shm->closed) return FALSE;
+    if (WaitForMultipleObjects(npc->shm_peer ? 2 : 1, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+    {
+      WARN("peer process went away\n");
+      return FALSE;
+    }
+  }
+}
+
+static void lrpc_shm_wake(volatile LONG *waiting, HANDLE event)
+{
+  if (InterlockedExchange(waiting, 0)) SetEvent(event);
+}
+
+static int lrpc_shm_read(RpcConnection_np *npc, void *buffer, unsigned int count)
+{
+  unsigned int idx = npc->common.server ? 0 : 1;
+  struct lrpc_shm_ring *ring = &npc->shm->ring[idx];
+  HANDLE data_event = npc->shm_events[idx * 2], space_event = npc->shm_events[idx * 2 + 1];
+  char *buf = buffer;
+  unsigned int bytes_left = count;
+
+  while (bytes_left)
+  {
+    ULONG tail = ring->tail, head = InterlockedCompareExchange(&ring->head, 0, 0);
+    ULONG pos = tail & (LRPC_SHM_RING_SIZE - 1), len = min(head - tail, LRPC_SHM_RING_SIZE - pos);
+
+    if (!len)
+    {
+      if (!lrpc_shm_wait(npc, &ring->head, head, &ring->reader_waiting, data_event))
+        return -1;
+      continue;
+    }
+    len = min(len, bytes_left);
+    memcpy(buf, ring->data + pos, len);
+    InterlockedExchange(&ring->tail, tail + len);
+    lrpc_shm_wake(&ring->writer_waiting, space_event);
+    buf += len;
+    bytes_left -= len;
+  }
+  return count;
+}
+
+static int lrpc_shm_write(RpcConnection_np *npc, const void *buffer, unsigned int count)
+{
+  unsigned int idx = npc->common.server ? 1 : 0;
+  struct lrpc_shm_ring *ring = &npc->shm->ring[idx];
+  HANDLE data_event = npc->shm_events[idx * 2], space_event = npc->shm_events[idx * 2 + 1];
+  const char *buf = buffer;
+  unsigned int bytes_left = count;
+
+  if (npc->shm->closed) return -1;
+
+  while (bytes_left)
+  {
+    ULONG head = ring->head, tail = InterlockedCompareExchange(&ring->tail, 0, 0);
+    ULONG pos = head & (LRPC_SHM_RING_SIZE - 1);
+    ULONG len = min(LRPC_SHM_RING_SIZE - (head - tail), LRPC_SHM_RING_SIZE - pos);
+
+    if (!len)
+    {
+      if (!lrpc_shm_wait(npc, &ring->tail, tail, &ring->writer_waiting, space_event))
+        return -1;
+      continue;
+    }
+    len = min(len, bytes_left);
+    memcpy(ring->data + pos, buf, len);
+    InterlockedExchange(&ring->head, head + len);
+    lrpc_shm_wake(&ring->reader_waiting, data_event);
+    buf += len;
+    bytes_left -= len;
+  }
+  return count;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_conn_open(RpcConnection* Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  RPC_STATUS r;
+
+  /* already connected? */
+  if (npc->pipe)
+    return RPC_S_OK;
+
+  r = rpcrt4_ncalrpc_open(Connection);
+  if (r == RPC_S_OK)
+    lrpc_shm_connect(npc);
+  return r;
+}
+
+static int rpcrt4_ncalrpc_read(RpcConnection *Connection,
+                               void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  unsigned int len;
+  int ret;
+
+  if (Connection->server && !npc->shm_negotiated && !lrpc_shm_accept(npc))
+    return -1;
+
+  if (npc->shm)
+    return lrpc_shm_read(npc, buffer, count);
+
+  if (!npc->stash_len)
+    return rpcrt4_conn_np_read(Connection, buffer, count);
+
+  len = min(count, npc->stash_len);
+  memcpy(buffer, npc->stash, len);
+  memmove(npc->stash, npc->stash + len, npc->stash_len - len);
+  npc->stash_len -= len;
+  if (len == count) return count;
+
+  ret = rpcrt4_conn_np_read(Connection, (char *)buffer + len, count - len);
+  return ret < 0 ? ret : count;
+}
+
+static int rpcrt4_ncalrpc_write(RpcConnection *Connection,
+                                const void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  if (npc->shm)
+    return lrpc_shm_write(npc, buffer, count);
+  return rpcrt4_conn_np_write(Connection, buffer, count);
+}
+
+static int rpcrt4_ncalrpc_close(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  lrpc_shm_close(npc);
+  npc->shm_negotiated = FALSE;
+  npc->stash_len = 0;
+  return rpcrt4_conn_np_close(Connection);
+}
+
 static size_t rpcrt4_ncacn_np_get_top_of_tower(unsigned char *tower_data,
                                                const char *networkaddr,
                                                const char *endpoint)
@@ -3426,11 +3792,11 @@ static const struct connection_ops conn_protseq_list[] = {
   { "ncalrpc",
     { EPM_PROTOCOL_NCALRPC, EPM_PROTOCOL_PIPE },
     rpcrt4_conn_np_alloc,
-    rpcrt4_ncalrpc_open,
+    rpcrt4_ncalrpc_conn_open,
     rpcrt4_ncalrpc_handoff,
-    rpcrt4_conn_np_read,
-    rpcrt4_conn_np_write,
-    rpcrt4_conn_np_close,
+    rpcrt4_ncalrpc_read,
+    rpcrt4_ncalrpc_write,
+    rpcrt4_ncalrpc_close,
     rpcrt4_conn_np_cancel_call,
     rpcrt4_ncalrpc_np_is_server_listening,
     rpcrt4_conn_np_wait_for_incoming_data,
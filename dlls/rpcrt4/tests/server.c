@@ -1565,6 +1565,25 @@ run_tests(void)
   context_handle_test();
 }
 
+static void
+round_trip_tests(const char *protseq)
+{
+  static int data[0x4000];
+  int i, sum = 0, expected = 0;
+
+  for (i = 0; i < sizeof(data) / sizeof(data[0]); i++)
+    expected += data[i] = i;
+
+  /* many small requests in a row, then requests larger than 64k */
+  for (i = 0; i < 500; i++)
+    sum += int_return();
+  ok(sum == 500 * INT_CODE, "%s: RPC int_return\n", protseq);
+
+  for (i = 0; i < 50; i++)
+    if ((sum = sum_conf_array(data, sizeof(data) / sizeof(data[0]))) != expected) break;
+  ok(sum == expected, "%s: RPC sum_conf_array\n", protseq);
+}
+
 static void
 set_auth_info(RPC_BINDING_HANDLE handle)
 {
@@ -1645,6 +1664,7 @@ client(const char *test)
     ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
     run_tests(); /* can cause RPC_X_BAD_STUB_DATA exception */
+    round_trip_tests("ncalrpc");
     authinfo_test(RPC_PROTSEQ_LRPC, 0);
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
 
@@ -1670,6 +1690,7 @@ client(const char *test)
 
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
     run_tests();
+    round_trip_tests("ncacn_np");
     authinfo_test(RPC_PROTSEQ_NMP, 0);
     test_is_server_listening(IServer_IfHandle, RPC_S_OK);
     stop();
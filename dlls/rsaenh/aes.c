@@ -30,6 +30,13 @@
 
 #include "tomcrypt.h"
 
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_AESNI
+#include <cpuid.h>
+#include <wmmintrin.h>
+#endif
+
 static const ulong32 TE0[256] = {
     0xc66363a5UL, 0xf87c7c84UL, 0xee777799UL, 0xf67b7b8dUL,
     0xfff2f20dUL, 0xd66b6bbdUL, 0xde6f6fb1UL, 0x91c5c554UL,
@@ -926,6 +933,97 @@ static const ulong32 rcon[] = {
     0x1B000000UL, 0x36000000UL
 };
 
+#ifdef USE_AESNI
+static int aesni_available(void)
+{
+    static int available = -1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (available == -1)
+        available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES);
+    return available;
+}
+
+__attribute__((target("aes,sse2")))
+static void aesni_ecb_encrypt(const unsigned char *pt, unsigned char *ct, const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->ni_eK;
+    __m128i s;
+    int i;
+
+    s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pt), _mm_loadu_si128(rk));
+    for (i = 1; i < skey->Nr; i++)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(rk + i));
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128(rk + skey->Nr));
+    _mm_storeu_si128((__m128i *)ct, s);
+}
+
+__attribute__((target("aes,sse2")))
+static __m128i aesni_decrypt(__m128i s, const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->ni_dK;
+    int i;
+
+    s = _mm_xor_si128(s, _mm_loadu_si128(rk));
+    for (i = 1; i < skey->Nr; i++)
+        s = _mm_aesdec_si128(s, _mm_loadu_si128(rk + i));
+    return _mm_aesdeclast_si128(s, _mm_loadu_si128(rk + skey->Nr));
+}
+
+__attribute__((target("aes,sse2")))
+static void aesni_ecb_decrypt(const unsigned char *ct, unsigned char *pt, const aes_key *skey)
+{
+    _mm_storeu_si128((__m128i *)pt, aesni_decrypt(_mm_loadu_si128((const __m128i *)ct), skey));
+}
+
+/* CBC decryption has no dependency between blocks, so keep four of them in
+ * flight to hide the latency of the aesdec instruction */
+__attribute__((target("aes,sse2")))
+static void aesni_cbc_decrypt(const unsigned char *ct, unsigned char *pt, unsigned long blocks,
+                              unsigned char *iv, const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->ni_dK;
+    __m128i chain, c0, c1, c2, c3, s0, s1, s2, s3, k;
+    int i;
+
+    chain = _mm_loadu_si128((const __m128i *)iv);
+    for (; blocks >= 4; blocks -= 4, ct += 64, pt += 64) {
+        c0 = _mm_loadu_si128((const __m128i *)ct);
+        c1 = _mm_loadu_si128((const __m128i *)(ct + 16));
+        c2 = _mm_loadu_si128((const __m128i *)(ct + 32));
+        c3 = _mm_loadu_si128((const __m128i *)(ct + 48));
+        k  = _mm_loadu_si128(rk);
+        s0 = _mm_xor_si128(c0, k);
+        s1 = _mm_xor_si128(c1, k);
+        s2 = _mm_xor_si128(c2, k);
+        s3 = _mm_xor_si128(c3, k);
+        for (i = 1; i < skey->Nr; i++) {
+            k  = _mm_loadu_si128(rk + i);
+            s0 = _mm_aesdec_si128(s0, k);
+            s1 = _mm_aesdec_si128(s1, k);
+            s2 = _mm_aesdec_si128(s2, k);
+            s3 = _mm_aesdec_si128(s3, k);
+        }
+        k  = _mm_loadu_si128(rk + skey->Nr);
+        s0 = _mm_aesdeclast_si128(s0, k);
+        s1 = _mm_aesdeclast_si128(s1, k);
+        s2 = _mm_aesdeclast_si128(s2, k);
+        s3 = _mm_aesdeclast_si128(s3, k);
+        _mm_storeu_si128((__m128i *)pt, _mm_xor_si128(s0, chain));
+        _mm_storeu_si128((__m128i *)(pt + 16), _mm_xor_si128(s1, c0));
+        _mm_storeu_si128((__m128i *)(pt + 32), _mm_xor_si128(s2, c1));
+        _mm_storeu_si128((__m128i *)(pt + 48), _mm_xor_si128(s3, c2));
+        chain = c3;
+    }
+    for (; blocks; blocks--, ct += 16, pt += 16) {
+        c0 = _mm_loadu_si128((const __m128i *)ct);
+        _mm_storeu_si128((__m128i *)pt, _mm_xor_si128(aesni_decrypt(c0, skey), chain));
+        chain = c0;
+    }
+    _mm_storeu_si128((__m128i *)iv, chain);
+}
+#endif
+
 static ulong32 setup_mix(ulong32 temp)
 {
    return (Te4_3[byte(temp, 2)]) ^
@@ -1058,6 +1156,18 @@ int aes_setup(const unsigned char *key, int keylen, int rounds, aes_key *skey)
     *rk++ = *rrk++;
     *rk   = *rrk;
 
+    skey->use_ni = 0;
+#ifdef USE_AESNI
+    /* dK already holds the inverse mixed round keys aesdec expects */
+    if (aesni_available()) {
+        for (i = 0; i < (skey->Nr + 1) * 4; i++) {
+            STORE32H(skey->eK[i], skey->ni_eK + 4 * i);
+            STORE32H(skey->dK[i], skey->ni_dK + 4 * i);
+        }
+        skey->use_ni = 1;
+    }
+#endif
+
     return CRYPT_OK;
 }
 
@@ -1066,6 +1176,13 @@ void aes_ecb_encrypt(const unsigned char *pt, unsigned char *ct, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef USE_AESNI
+    if (skey->use_ni) {
+        aesni_ecb_encrypt(pt, ct, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->eK;
 
@@ -1167,6 +1284,13 @@ void aes_ecb_decrypt(const unsigned char *ct, unsigned char *pt, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef USE_AESNI
+    if (skey->use_ni) {
+        aesni_ecb_decrypt(ct, pt, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->dK;
 
@@ -1264,3 +1388,24 @@ void aes_ecb_decrypt(const unsigned char *ct, unsigned char *pt, aes_key *skey)
         rk[3];
     STORE32H(s3, pt+12);
 }
+
+void aes_cbc_decrypt(const unsigned char *ct, unsigned char *pt, unsigned long blocks,
+                     unsigned char *iv, aes_key *skey)
+{
+    unsigned char block[16];
+    int i;
+
+#ifdef USE_AESNI
+    if (skey->use_ni) {
+        aesni_cbc_decrypt(ct, pt, blocks, iv, skey);
+        return;
+    }
+#endif
+
+    for (; blocks; blocks--, ct += 16, pt += 16) {
+        memcpy(block, ct, 16);
+        aes_ecb_decrypt(ct, pt, skey);
+        for (i = 0; i < 16; i++) pt[i] ^= iv[i];
+        memcpy(iv, block, 16);
+    }
+}
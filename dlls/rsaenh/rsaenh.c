@@ -2368,7 +2368,14 @@ BOOL WINAPI RSAENH_CPDecrypt(HCRYPTPROV hProv, HCRYPTKEY hKey, HCRYPTHASH hHash,
     dwMax=*pdwDataLen;
 
     if (GET_ALG_TYPE(pCryptKey->aiAlgid) == ALG_TYPE_BLOCK) {
-        for (i=0, in=pbData; i<*pdwDataLen; i+=pCryptKey->dwBlockLen, in+=pCryptKey->dwBlockLen) {
+        /* let the cipher implementation decrypt the whole chain at once if it can */
+        if (pCryptKey->dwMode == CRYPT_MODE_CBC && !(*pdwDataLen % pCryptKey->dwBlockLen) &&
+            decrypt_cbc_impl(pCryptKey->aiAlgid, &pCryptKey->context, pbData, *pdwDataLen,
+                             pCryptKey->abChainVector))
+            i = *pdwDataLen;
+        else
+            i = 0;
+        for (in=pbData+i; i<*pdwDataLen; i+=pCryptKey->dwBlockLen, in+=pCryptKey->dwBlockLen) {
             switch (pCryptKey->dwMode) {
                 case CRYPT_MODE_ECB:
                     encrypt_block_impl(pCryptKey->aiAlgid, 0, &pCryptKey->context, in, out, 
@@ -132,6 +132,9 @@ typedef struct tag_des3_key {
 typedef struct tag_aes_key {
    ulong32 eK[64], dK[64];
    int Nr;
+   int use_ni;
+   /* round keys in the byte order used by the AES-NI instructions */
+   unsigned char ni_eK[15 * 16], ni_dK[15 * 16];
 } aes_key;
 
 int rc2_setup(const unsigned char *key, int keylen, int bits, int num_rounds, rc2_key *skey);
@@ -149,6 +152,8 @@ void des3_ecb_decrypt(const unsigned char *ct, unsigned char *pt, const des3_key
 int aes_setup(const unsigned char *key, int keylen, int rounds, aes_key *skey);
 void aes_ecb_encrypt(const unsigned char *pt, unsigned char *ct, aes_key *skey);
 void aes_ecb_decrypt(const unsigned char *ct, unsigned char *pt, aes_key *skey);
+void aes_cbc_decrypt(const unsigned char *ct, unsigned char *pt, unsigned long blocks,
+                     unsigned char *iv, aes_key *skey);
 
 typedef struct tag_md2_state {
     unsigned char chksum[16], X[48], buf[16];
@@ -181,9 +186,17 @@ unsigned long rc4_read(unsigned char *buf, unsigned long len, prng_state *prng);
  * At the very least a mp_digit must be able to hold 7 bits
  * [any size beyond that is ok provided it doesn't overflow the data type]
  */
+#if defined(__x86_64__) && defined(__GNUC__)
+/* 60 bit digits with 128 bit products need about a quarter of the digit
+ * multiplications of the 28 bit configuration for RSA sized numbers */
+typedef ulong64            mp_digit;
+typedef unsigned __int128  mp_word;
+#define DIGIT_BIT 60
+#else
 typedef unsigned long      mp_digit;
 typedef ulong64            mp_word;
 #define DIGIT_BIT 28
+#endif
    
 #define MP_DIGIT_BIT     DIGIT_BIT
 #define MP_MASK          ((((mp_digit)1)<<((mp_digit)DIGIT_BIT))-((mp_digit)1))
@@ -1127,8 +1127,18 @@ static SECURITY_STATUS SEC_ENTRY schan_EncryptMessage(PCtxtHandle context_handle
     buffer = &message->pBuffers[idx];
 
     data_size = buffer->cbBuffer;
-    data = HeapAlloc(GetProcessHeap(), 0, data_size);
-    memcpy(data, buffer->pvBuffer, data_size);
+
+    /* The output is written over the plaintext, which is fine as long as the
+     * backend consumes all of it before pushing the first record. That holds
+     * for anything that fits in a single record, so avoid the copy then. */
+    if (data_size <= schan_imp_get_max_message_size(ctx->session))
+        data = NULL;
+    else
+    {
+        data = HeapAlloc(GetProcessHeap(), 0, data_size);
+        if (!data) return SEC_E_INSUFFICIENT_MEMORY;
+        memcpy(data, buffer->pvBuffer, data_size);
+    }
 
     transport.ctx = ctx;
     init_schan_buffers(&transport.in, NULL, NULL);
@@ -1139,7 +1149,7 @@ static SECURITY_STATUS SEC_ENTRY schan_EncryptMessage(PCtxtHandle context_handle
     schan_imp_set_session_transport(ctx->session, &transport);
 
     length = data_size;
-    status = schan_imp_send(ctx->session, data, &length);
+    status = schan_imp_send(ctx->session, data ? data : buffer->pvBuffer, &length);
 
     TRACE("Sent %ld bytes.\n", length);
 
@@ -1263,8 +1273,10 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
         return SEC_E_INCOMPLETE_MESSAGE;
     }
 
+    /* The record is pulled in full before any of it is decrypted, so the
+     * plaintext can be written straight over the ciphertext. */
     data_size = expected_size - 5;
-    data = HeapAlloc(GetProcessHeap(), 0, data_size);
+    data = (char *)buf_ptr + 5;
 
     transport.ctx = ctx;
     init_schan_buffers(&transport.in, message, schan_decrypt_message_get_next_buffer);
@@ -1282,7 +1294,6 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
 
         if (status != SEC_E_OK)
         {
-            HeapFree(GetProcessHeap(), 0, data);
             ERR("Returning %x\n", status);
             return status;
         }
@@ -1295,9 +1306,6 @@ static SECURITY_STATUS SEC_ENTRY schan_DecryptMessage(PCtxtHandle context_handle
 
     TRACE("Received %ld bytes\n", received);
 
-    memcpy(buf_ptr + 5, data, received);
-    HeapFree(GetProcessHeap(), 0, data);
-
     schan_decrypt_fill_buffer(message, SECBUFFER_DATA,
         buf_ptr + 5, received);
 
@@ -43,6 +43,7 @@ static DWORD   vcomp_context_tls = TLS_OUT_OF_INDEXES;
 static HMODULE vcomp_module;
 static int     vcomp_max_threads;
 static int     vcomp_num_threads;
+static int     vcomp_spin_count;
 static BOOL    vcomp_nested_fork = FALSE;
 
 static RTL_CRITICAL_SECTION vcomp_section;
@@ -59,9 +60,23 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* number of pause iterations before waiting threads go to sleep */
+#define VCOMP_SPIN_COUNT                4000
+
+/* barrier tree nodes embedded in each team */
+#define VCOMP_BARRIER_NODES             32
+#define VCOMP_BARRIER_ARITY             4
+
+struct vcomp_barrier_node
+{
+    LONG                    count;
+    LONG                    expected;
+    int                     parent;
+};
+
 struct vcomp_thread_data
 {
-    struct vcomp_team_data  *team;
+    struct vcomp_team_data  *volatile team;
     struct vcomp_task_data  *task;
     int                     thread_num;
     BOOL                    parallel;
@@ -88,7 +103,7 @@ struct vcomp_team_data
 {
     CONDITION_VARIABLE      cond;
     int                     num_threads;
-    int                     finished_threads;
+    volatile int            finished_threads;
 
     /* callback arguments */
     int                     nargs;
@@ -96,8 +111,10 @@ struct vcomp_team_data
     __ms_va_list            valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    volatile LONG           barrier;
+    LONG                    barrier_sleepers;
+    int                     barrier_arity;
+    struct vcomp_barrier_node barrier_nodes[VCOMP_BARRIER_NODES];
 };
 
 struct vcomp_task_data
@@ -110,8 +127,9 @@ struct vcomp_task_data
     int                     num_sections;
     int                     section_index;
 
-    /* dynamic */
-    unsigned int            dynamic;
+    /* dynamic, the loop generation is kept in the upper and the number
+     * of dispensed iterations in the lower half of dynamic_state */
+    LONG64                  dynamic_state;
     unsigned int            dynamic_first;
     unsigned int            dynamic_last;
     unsigned int            dynamic_iterations;
@@ -362,7 +380,7 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
 
     data->task.single           = 0;
     data->task.section          = 0;
-    data->task.dynamic          = 0;
+    data->task.dynamic_state    = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -388,6 +406,20 @@ static void vcomp_free_thread_data(void)
     vcomp_set_thread_data(NULL);
 }
 
+static inline void vcomp_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "rep;nop" : : : "memory" );
+#else
+    __asm__ __volatile__( "" : : : "memory" );
+#endif
+}
+
+static inline LONG64 vcomp_dynamic_state(unsigned int generation, unsigned int dispensed)
+{
+    return ((LONG64)generation << 32) | dispensed;
+}
+
 void CDECL _vcomp_atomic_add_i1(char *dest, char val)
 {
     interlocked_xchg_add8(dest, val);
@@ -1008,27 +1040,55 @@ void CDECL _vcomp_flush(void)
 
 void CDECL _vcomp_barrier(void)
 {
-    struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    struct vcomp_barrier_node *node;
+    LONG barrier;
+    int i;
 
     TRACE("()\n");
 
-    if (!team_data)
+    if (!team_data || team_data->num_threads == 1)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    barrier = team_data->barrier;
+    node = &team_data->barrier_nodes[thread_data->thread_num / team_data->barrier_arity];
+
+    /* the last thread arriving at a node continues to its parent, the last
+     * one arriving at the root releases everyone */
+    while (InterlockedIncrement(&node->count) == node->expected)
     {
-        team_data->barrier++;
-        team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        node->count = 0;
+        if (node->parent < 0)
+        {
+            InterlockedIncrement(&team_data->barrier);
+            if (team_data->barrier_sleepers)
+            {
+                EnterCriticalSection(&vcomp_section);
+                WakeAllConditionVariable(&team_data->cond);
+                LeaveCriticalSection(&vcomp_section);
+            }
+            return;
+        }
+        node = &team_data->barrier_nodes[node->parent];
     }
-    else
+
+    /* spinning only helps when each thread has a processor of its own */
+    if (team_data->num_threads <= vcomp_max_threads)
+    {
+        for (i = 0; i < vcomp_spin_count && team_data->barrier == barrier; i++)
+            vcomp_pause();
+    }
+
+    if (team_data->barrier == barrier)
     {
-        unsigned int barrier = team_data->barrier;
+        EnterCriticalSection(&vcomp_section);
+        InterlockedIncrement(&team_data->barrier_sleepers);
         while (team_data->barrier == barrier)
             SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+        InterlockedDecrement(&team_data->barrier_sleepers);
+        LeaveCriticalSection(&vcomp_section);
     }
-    LeaveCriticalSection(&vcomp_section);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1290,9 +1350,18 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
         EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+        if ((int)(thread_data->dynamic - (unsigned int)(task_data->dynamic_state >> 32)) > 0)
         {
-            task_data->dynamic              = thread_data->dynamic;
+            LONG64 state;
+
+            /* advance the generation before touching the loop parameters, so
+             * that threads still working on the previous loop can't claim
+             * iterations using a mix of old and new parameters. Threads of
+             * the new loop are held back by vcomp_section until we're done. */
+            do state = task_data->dynamic_state;
+            while (interlocked_cmpxchg64(&task_data->dynamic_state,
+                                         vcomp_dynamic_state(thread_data->dynamic, 0), state) != state);
+
             task_data->dynamic_first        = first;
             task_data->dynamic_last         = last;
             task_data->dynamic_iterations   = iterations;
@@ -1322,26 +1391,34 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        unsigned int iterations, remaining, dispensed;
+        LONG64 state;
+
+        /* the loop parameters are only valid if the state didn't change
+         * by the time the iterations are claimed */
+        do
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            state = *(volatile LONG64 *)&task_data->dynamic_state;
+            if (thread_data->dynamic != (unsigned int)(state >> 32))
+                return 0;
+            dispensed = (unsigned int)state;
+            remaining = task_data->dynamic_iterations - dispensed;
+            if (!remaining)
+                return 0;
+
+            iterations = min(remaining, task_data->dynamic_chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * task_data->dynamic_chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (remaining + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
+            *begin = task_data->dynamic_first + dispensed * task_data->dynamic_step;
+            *end   = *begin + (iterations - 1) * task_data->dynamic_step;
+            if (iterations == remaining)
                 *end = task_data->dynamic_last;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+        while (interlocked_cmpxchg64(&task_data->dynamic_state, state + iterations, state) != state);
+        return 1;
     }
 
     return 0;
@@ -1360,28 +1437,42 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
 
     TRACE("starting worker thread for %p\n", thread_data);
 
-    EnterCriticalSection(&vcomp_section);
     for (;;)
     {
-        struct vcomp_team_data *team = thread_data->team;
-        if (team != NULL)
-        {
-            LeaveCriticalSection(&vcomp_section);
-            _vcomp_fork_call_wrapper(team->wrapper, team->nargs, team->valist);
-            EnterCriticalSection(&vcomp_section);
+        struct vcomp_team_data *team = NULL;
+        int i;
 
-            thread_data->team = NULL;
-            list_remove(&thread_data->entry);
-            list_add_tail(&vcomp_idle_threads, &thread_data->entry);
-            if (++team->finished_threads >= team->num_threads)
-                WakeAllConditionVariable(&team->cond);
-        }
+        /* parallel regions often follow each other closely, so spin for a
+         * while before going to sleep */
+        for (i = 0; i < vcomp_spin_count && !(team = thread_data->team); i++)
+            vcomp_pause();
 
-        if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
-            GetLastError() == ERROR_TIMEOUT && !thread_data->team)
+        if (!team)
         {
-            break;
+            EnterCriticalSection(&vcomp_section);
+            while (!(team = thread_data->team))
+            {
+                if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
+                    GetLastError() == ERROR_TIMEOUT && !thread_data->team)
+                {
+                    break;
+                }
+            }
+            if (!team) break;
+            LeaveCriticalSection(&vcomp_section);
         }
+
+        _vcomp_fork_call_wrapper(team->wrapper, team->nargs, team->valist);
+
+        /* idle threads are reused most recently finished first, as those
+         * are the ones still spinning */
+        EnterCriticalSection(&vcomp_section);
+        thread_data->team = NULL;
+        list_remove(&thread_data->entry);
+        list_add_head(&vcomp_idle_threads, &thread_data->entry);
+        if (++team->finished_threads >= team->num_threads)
+            WakeAllConditionVariable(&team->cond);
+        LeaveCriticalSection(&vcomp_section);
     }
     list_remove(&thread_data->entry);
     LeaveCriticalSection(&vcomp_section);
@@ -1394,6 +1485,45 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
     return 0;
 }
 
+static void vcomp_init_barrier(struct vcomp_team_data *team)
+{
+    int first, count, nodes, i;
+
+    /* widen the tree if the team is too large for the embedded nodes */
+    for (;;)
+    {
+        nodes = 0;
+        count = team->num_threads;
+        do
+        {
+            count = (count + team->barrier_arity - 1) / team->barrier_arity;
+            nodes += count;
+        }
+        while (count > 1);
+        if (nodes <= VCOMP_BARRIER_NODES) break;
+        team->barrier_arity *= 2;
+    }
+
+    /* each level is stored after the one below it, starting with the leaves */
+    first = 0;
+    count = team->num_threads;
+    do
+    {
+        int children = count;
+
+        count = (count + team->barrier_arity - 1) / team->barrier_arity;
+        for (i = 0; i < count; i++)
+        {
+            struct vcomp_barrier_node *node = &team->barrier_nodes[first + i];
+            node->count    = 0;
+            node->expected = min(team->barrier_arity, children - i * team->barrier_arity);
+            node->parent   = count > 1 ? first + count + i / team->barrier_arity : -1;
+        }
+        first += count;
+    }
+    while (count > 1);
+}
+
 void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 {
     struct vcomp_thread_data *prev_thread_data = vcomp_init_thread_data();
@@ -1421,11 +1551,12 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     team_data.wrapper           = wrapper;
     __ms_va_start(team_data.valist, wrapper);
     team_data.barrier           = 0;
-    team_data.barrier_count     = 0;
+    team_data.barrier_sleepers  = 0;
+    team_data.barrier_arity     = VCOMP_BARRIER_ARITY;
 
     task_data.single            = 0;
     task_data.section           = 0;
-    task_data.dynamic           = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -1448,7 +1579,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
         while (team_data.num_threads < num_threads && (ptr = list_head(&vcomp_idle_threads)))
         {
             struct vcomp_thread_data *data = LIST_ENTRY(ptr, struct vcomp_thread_data, entry);
-            data->team          = &team_data;
             data->task          = &task_data;
             data->thread_num    = team_data.num_threads++;
             data->parallel      = thread_data.parallel;
@@ -1459,7 +1589,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->dynamic_type  = 0;
             list_remove(&data->entry);
             list_add_tail(&thread_data.entry, &data->entry);
-            WakeAllConditionVariable(&data->cond);
         }
 
         /* spawn additional threads */
@@ -1472,7 +1601,7 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data = HeapAlloc(GetProcessHeap(), 0, sizeof(*data));
             if (!data) break;
 
-            data->team          = &team_data;
+            data->team          = NULL;
             data->task          = &task_data;
             data->thread_num    = team_data.num_threads;
             data->parallel      = thread_data.parallel;
@@ -1497,6 +1626,15 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             CloseHandle(thread);
         }
 
+        /* only start the threads once the team is complete */
+        vcomp_init_barrier(&team_data);
+        LIST_FOR_EACH(ptr, &thread_data.entry)
+        {
+            struct vcomp_thread_data *data = LIST_ENTRY(ptr, struct vcomp_thread_data, entry);
+            interlocked_xchg_ptr((void **)&data->team, &team_data);
+            WakeAllConditionVariable(&data->cond);
+        }
+
         LeaveCriticalSection(&vcomp_section);
     }
 
@@ -1507,6 +1645,11 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     if (team_data.num_threads > 1)
     {
+        int i, spin_count = team_data.num_threads <= vcomp_max_threads ? vcomp_spin_count : 0;
+
+        for (i = 0; i < spin_count && team_data.finished_threads < team_data.num_threads - 1; i++)
+            vcomp_pause();
+
         EnterCriticalSection(&vcomp_section);
 
         team_data.finished_threads++;
@@ -1641,6 +1784,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_module      = instance;
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
+            vcomp_spin_count  = sysinfo.dwNumberOfProcessors > 1 ? VCOMP_SPIN_COUNT : 0;
             break;
         }
 
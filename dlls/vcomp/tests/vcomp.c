@@ -1278,6 +1278,63 @@ static void test_vcomp_for_dynamic_init(void)
     pomp_set_num_threads(max_threads);
 }
 
+static void CDECL barrier_cb(LONG *count, LONG *errors)
+{
+    int num_threads = pomp_get_num_threads();
+    int i;
+
+    for (i = 1; i <= 100; i++)
+    {
+        InterlockedIncrement(count);
+        p_vcomp_barrier();
+        if (*count != i * num_threads) InterlockedIncrement(errors);
+        p_vcomp_barrier();
+    }
+}
+
+static void CDECL fork_latency_cb(LONG *count)
+{
+    unsigned int begin, end;
+
+    p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_CHUNKED | VCOMP_DYNAMIC_FLAGS_INCREMENT, 0, 63, 1, 4);
+    while (p_vcomp_for_dynamic_next(&begin, &end))
+        InterlockedExchangeAdd(count, end - begin + 1);
+    p_vcomp_barrier();
+}
+
+static void test_vcomp_barrier(void)
+{
+    int max_threads = pomp_get_max_threads();
+    LONG count, errors;
+    int i, j;
+
+    for (i = 1; i <= 8; i++)
+    {
+        pomp_set_num_threads(i);
+
+        count = errors = 0;
+        p_vcomp_fork(TRUE, 2, barrier_cb, &count, &errors);
+        ok(count == 100 * i, "expected count == %d, got %d\n", 100 * i, count);
+        ok(!errors, "got %d errors\n", errors);
+    }
+
+    /* many short parallel regions in a row reuse the same threads */
+    for (i = 1; i <= max_threads; i *= 2)
+    {
+        pomp_set_num_threads(i);
+
+        for (j = 0; j < 100; j++)
+        {
+            count = 0;
+            p_vcomp_fork(TRUE, 1, fork_latency_cb, &count);
+            if (count != 64) break;
+        }
+        ok(count == 64, "%d threads, region %d: expected count == 64, got %d\n", i, j, count);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void CDECL master_cb(HANDLE semaphore)
 {
     int num_threads = pomp_get_num_threads();
@@ -2184,6 +2241,7 @@ START_TEST(vcomp)
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
     test_vcomp_for_dynamic_init();
+    test_vcomp_barrier();
     test_vcomp_master_begin();
     test_vcomp_single_begin();
     test_vcomp_enter_critsect();
@@ -32,6 +32,13 @@
 
 #include "wine/debug.h"
 
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SIMD
+#include <cpuid.h>
+#include <tmmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
 struct FormatConverter;
@@ -129,6 +136,343 @@ static void to_sRGB(BYTE *bgr)
 }
 #endif
 
+/* Converting linear gray to 8-bit sRGB is a monotonic function, so it is
+ * computed from the smallest input giving each output value. The table gives
+ * a starting point for each 1/4096 step of the input. */
+#define SRGB_LUT_SIZE 4096
+
+static float srgb_thresholds[257];
+static BYTE srgb_lut[SRGB_LUT_SIZE + 1];
+
+static inline BYTE to_sRGB_byte_slow(float f)
+{
+    return (BYTE)floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+static void init_srgb_tables(void)
+{
+    UINT i, v, lo, hi, mid;
+    float f, one = 1.0f;
+
+    /* non-negative floats compare like their bit patterns */
+    memcpy(&hi, &one, sizeof(hi));
+    srgb_thresholds[0] = 0.0f;
+    for (v = 1, lo = 0; v < 256; v++)
+    {
+        UINT end = hi;
+
+        while (lo < end)
+        {
+            mid = lo + (end - lo) / 2;
+            memcpy(&f, &mid, sizeof(f));
+            if (to_sRGB_byte_slow(f) >= v) end = mid;
+            else lo = mid + 1;
+        }
+        memcpy(&srgb_thresholds[v], &lo, sizeof(f));
+    }
+    srgb_thresholds[256] = 2.0f;
+
+    for (i = 0, v = 0; i <= SRGB_LUT_SIZE; i++)
+    {
+        while (i / (float)SRGB_LUT_SIZE >= srgb_thresholds[v + 1]) v++;
+        srgb_lut[i] = v;
+    }
+}
+
+/* same as to_sRGB_byte_slow(), the tables are set up by init_converters() */
+static inline BYTE to_sRGB_byte(float f)
+{
+    UINT v;
+
+    if (!(f >= 0.0f && f <= 1.0f)) return to_sRGB_byte_slow(f);
+    v = srgb_lut[(UINT)(f * SRGB_LUT_SIZE)];
+    while (f >= srgb_thresholds[v + 1]) v++;
+    return v;
+}
+
+/* Scanline converters, used on bands of rows in parallel. */
+typedef void (*row_converter)(const BYTE *src, BYTE *dst, UINT width);
+
+static void convert_bgr24_to_bgra32(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+    }
+}
+
+static void convert_rgb24_to_bgra32(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3, dst += 4)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 255;
+    }
+}
+
+static void convert_bgra32_to_bgr24(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+static void convert_bgra32_to_rgb24(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+static void convert_bgrx32_to_bgra32(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+        ((DWORD *)dst)[x] = ((const DWORD *)src)[x] | 0xff000000;
+}
+
+static void convert_bgra32_to_pbgra32(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 4)
+    {
+        BYTE alpha = src[3];
+        dst[0] = src[0] * alpha / 255;
+        dst[1] = src[1] * alpha / 255;
+        dst[2] = src[2] * alpha / 255;
+        dst[3] = alpha;
+    }
+}
+
+static void convert_bgr24_to_gray8(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        dst[x] = to_sRGB_byte((src[2] * 0.2126f + src[1] * 0.7152f + src[0] * 0.0722f) / 255.0f);
+}
+
+static void convert_grayfloat_to_bgr24(const BYTE *src, BYTE *dst, UINT width)
+{
+    const float *gray_float = (const float *)src;
+    UINT x;
+
+    for (x = 0; x < width; x++, dst += 3)
+        dst[0] = dst[1] = dst[2] = to_sRGB_byte(gray_float[x]);
+}
+
+#ifdef USE_SIMD
+
+__attribute__((target("ssse3")))
+static void shuffle_24_to_32_ssse3(const BYTE *src, BYTE *dst, UINT width, __m128i mask,
+                                   row_converter convert_tail)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    /* 12 bytes are used out of each 16 byte load */
+    for (x = 0; x + 6 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 3 * x));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+    convert_tail(src + 3 * x, dst + 4 * x, width - x);
+}
+
+__attribute__((target("ssse3")))
+static void convert_bgr24_to_bgra32_ssse3(const BYTE *src, BYTE *dst, UINT width)
+{
+    shuffle_24_to_32_ssse3(src, dst, width, _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                           convert_bgr24_to_bgra32);
+}
+
+__attribute__((target("ssse3")))
+static void convert_rgb24_to_bgra32_ssse3(const BYTE *src, BYTE *dst, UINT width)
+{
+    shuffle_24_to_32_ssse3(src, dst, width, _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1),
+                           convert_rgb24_to_bgra32);
+}
+
+__attribute__((target("ssse3")))
+static void shuffle_32_to_24_ssse3(const BYTE *src, BYTE *dst, UINT width, __m128i mask,
+                                   row_converter convert_tail)
+{
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 4 * x)), mask);
+        DWORD last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+
+        _mm_storel_epi64((__m128i *)(dst + 3 * x), v);
+        memcpy(dst + 3 * x + 8, &last, sizeof(last));
+    }
+    convert_tail(src + 4 * x, dst + 3 * x, width - x);
+}
+
+__attribute__((target("ssse3")))
+static void convert_bgra32_to_bgr24_ssse3(const BYTE *src, BYTE *dst, UINT width)
+{
+    shuffle_32_to_24_ssse3(src, dst, width,
+                           _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1),
+                           convert_bgra32_to_bgr24);
+}
+
+__attribute__((target("ssse3")))
+static void convert_bgra32_to_rgb24_ssse3(const BYTE *src, BYTE *dst, UINT width)
+{
+    shuffle_32_to_24_ssse3(src, dst, width,
+                           _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1),
+                           convert_bgra32_to_rgb24);
+}
+
+__attribute__((target("sse2")))
+static void convert_bgrx32_to_bgra32_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_or_si128(v, alpha));
+    }
+    convert_bgrx32_to_bgra32(src + 4 * x, dst + 4 * x, width - x);
+}
+
+/* c * alpha / 255 on 16-bit lanes, exact for all 8-bit values */
+__attribute__((target("sse2")))
+static inline __m128i premultiply_sse2(__m128i v, __m128i alpha_lanes, __m128i alpha_one)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xff), 0xff);
+    __m128i t = _mm_mullo_epi16(v, _mm_or_si128(_mm_andnot_si128(alpha_lanes, alpha), alpha_one));
+
+    t = _mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), _mm_set1_epi16(1));
+    return _mm_srli_epi16(t, 8);
+}
+
+__attribute__((target("sse2")))
+static void convert_bgra32_to_pbgra32_sse2(const BYTE *src, BYTE *dst, UINT width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_lanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    const __m128i alpha_one = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * x));
+        __m128i lo = premultiply_sse2(_mm_unpacklo_epi8(v, zero), alpha_lanes, alpha_one);
+        __m128i hi = premultiply_sse2(_mm_unpackhi_epi8(v, zero), alpha_lanes, alpha_one);
+        _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm_packus_epi16(lo, hi));
+    }
+    convert_bgra32_to_pbgra32(src + 4 * x, dst + 4 * x, width - x);
+}
+
+#endif /* USE_SIMD */
+
+static struct
+{
+    row_converter bgr24_to_bgra32;
+    row_converter rgb24_to_bgra32;
+    row_converter bgra32_to_bgr24;
+    row_converter bgra32_to_rgb24;
+    row_converter bgrx32_to_bgra32;
+    row_converter bgra32_to_pbgra32;
+} row_converters =
+{
+    convert_bgr24_to_bgra32,
+    convert_rgb24_to_bgra32,
+    convert_bgra32_to_bgr24,
+    convert_bgra32_to_rgb24,
+    convert_bgrx32_to_bgra32,
+    convert_bgra32_to_pbgra32
+};
+
+static BOOL WINAPI init_converters_once(INIT_ONCE *once, void *param, void **context)
+{
+#ifdef USE_SIMD
+    unsigned int eax, ebx, ecx, edx;
+#endif
+
+    init_srgb_tables();
+
+#ifdef USE_SIMD
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & bit_SSE2)) return TRUE;
+
+    row_converters.bgrx32_to_bgra32 = convert_bgrx32_to_bgra32_sse2;
+    row_converters.bgra32_to_pbgra32 = convert_bgra32_to_pbgra32_sse2;
+    if (ecx & bit_SSSE3)
+    {
+        row_converters.bgr24_to_bgra32 = convert_bgr24_to_bgra32_ssse3;
+        row_converters.rgb24_to_bgra32 = convert_rgb24_to_bgra32_ssse3;
+        row_converters.bgra32_to_bgr24 = convert_bgra32_to_bgr24_ssse3;
+        row_converters.bgra32_to_rgb24 = convert_bgra32_to_rgb24_ssse3;
+    }
+#endif
+    return TRUE;
+}
+
+static void init_converters(void)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+    InitOnceExecuteOnce(&init_once, init_converters_once, NULL, NULL);
+}
+
+struct convert_rows_params
+{
+    row_converter convert;
+    const BYTE *src;
+    BYTE *dst;
+    UINT src_stride, dst_stride, width;
+};
+
+static void convert_rows_band(void *context, UINT start, UINT end)
+{
+    const struct convert_rows_params *params = context;
+    UINT y;
+
+    for (y = start; y < end; y++)
+        params->convert(params->src + params->src_stride * y, params->dst + params->dst_stride * y,
+                        params->width);
+}
+
+/* src and dst may be the same buffer with the same stride */
+static void convert_rows(row_converter convert, const BYTE *src, UINT src_stride,
+    BYTE *dst, UINT dst_stride, UINT width, UINT height)
+{
+    struct convert_rows_params params;
+
+    params.convert = convert;
+    params.src = src;
+    params.dst = dst;
+    params.src_stride = src_stride;
+    params.dst_stride = dst_stride;
+    params.width = width;
+    process_scanline_bands(width, height, convert_rows_band, &params);
+}
+
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
@@ -615,13 +959,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -632,22 +971,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(row_converters.bgr24_to_bgra32, srcdata, srcstride, pbBuffer, cbStride,
+                             prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -658,14 +983,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -676,26 +995,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(row_converters.rgb24_to_bgra32, srcdata, srcstride, pbBuffer, cbStride,
+                             prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -706,15 +1007,13 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            convert_rows(row_converters.bgrx32_to_bgra32, pbBuffer, cbStride, pbBuffer, cbStride,
+                         prc->Width, prc->Height);
         }
         return S_OK;
     case format_32bppBGRA:
@@ -888,21 +1187,8 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
+            convert_rows(row_converters.bgra32_to_pbgra32, pbBuffer, cbStride, pbBuffer, cbStride,
+                         prc->Width, prc->Height);
         return hr;
     }
 }
@@ -930,13 +1216,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -947,22 +1228,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(row_converters.bgra32_to_bgr24, srcdata, srcstride, pbBuffer, cbStride,
+                             prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -985,26 +1252,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
             hr = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(hr))
-            {
-                INT x, y;
-                BYTE *src = srcdata, *dst = pbBuffer;
-
-                for (y = 0; y < prc->Height; y++)
-                {
-                    float *gray_float = (float *)src;
-                    BYTE *bgr = dst;
-
-                    for (x = 0; x < prc->Width; x++)
-                    {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
-                        *bgr++ = gray;
-                        *bgr++ = gray;
-                        *bgr++ = gray;
-                    }
-                    src += srcstride;
-                    dst += cbStride;
-                }
-            }
+                convert_rows(convert_grayfloat_to_bgr24, srcdata, srcstride, pbBuffer, cbStride,
+                             prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -1041,14 +1290,8 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1059,26 +1302,8 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* blue */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-
-                        *dstpixel++=tmppixel[2]; /* red */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* blue */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rows(row_converters.bgra32_to_rgb24, srcdata, srcstride, pbBuffer, cbStride,
+                             prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -1157,26 +1382,8 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
 
     hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
     if (SUCCEEDED(hr) && prc)
-    {
-        INT x, y;
-        BYTE *src = srcdata, *dst = pbBuffer;
-
-        for (y = 0; y < prc->Height; y++)
-        {
-            BYTE *bgr = src;
-
-            for (x = 0; x < prc->Width; x++)
-            {
-                float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
-
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
-                bgr += 3;
-            }
-            src += srcstride;
-            dst += cbStride;
-        }
-    }
+        convert_rows(convert_bgr24_to_gray8, srcdata, srcstride, pbBuffer, cbStride,
+                     prc->Width, prc->Height);
 
     HeapFree(GetProcessHeap(), 0, srcdata);
     return hr;
@@ -1469,6 +1676,8 @@ HRESULT FormatConverter_CreateInstance(REFIID iid, void** ppv)
 
     *ppv = NULL;
 
+    init_converters();
+
     This = HeapAlloc(GetProcessHeap(), 0, sizeof(FormatConverter));
     if (!This) return E_OUTOFMEMORY;
 
@@ -61,6 +61,7 @@ WINE_DECLARE_DEBUG_CHANNEL(jpeg);
 static void *libjpeg_handle;
 
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f
+MAKE_FUNCPTR(jpeg_abort_decompress);
 MAKE_FUNCPTR(jpeg_CreateCompress);
 MAKE_FUNCPTR(jpeg_CreateDecompress);
 MAKE_FUNCPTR(jpeg_destroy_compress);
@@ -86,6 +87,7 @@ static void *load_libjpeg(void)
         return NULL; \
     }
 
+        LOAD_FUNCPTR(jpeg_abort_decompress);
         LOAD_FUNCPTR(jpeg_CreateCompress);
         LOAD_FUNCPTR(jpeg_CreateDecompress);
         LOAD_FUNCPTR(jpeg_destroy_compress);
@@ -140,6 +142,7 @@ typedef struct {
     IWICBitmapDecoder IWICBitmapDecoder_iface;
     IWICBitmapFrameDecode IWICBitmapFrameDecode_iface;
     IWICMetadataBlockReader IWICMetadataBlockReader_iface;
+    IWICBitmapSourceTransform IWICBitmapSourceTransform_iface;
     LONG ref;
     BOOL initialized;
     BOOL cinfo_initialized;
@@ -148,7 +151,10 @@ typedef struct {
     struct jpeg_error_mgr jerr;
     struct jpeg_source_mgr source_mgr;
     BYTE source_buffer[1024];
-    BYTE *image_data;
+    UINT width, height;  /* full size of the image */
+    UINT scale;          /* the output is 1/scale of the full size */
+    BOOL restart;        /* decoding has to start over */
+    struct decoded_rows rows;
     CRITICAL_SECTION lock;
 } JpegDecoder;
 
@@ -172,6 +178,11 @@ static inline JpegDecoder *impl_from_IWICMetadataBlockReader(IWICMetadataBlockRe
     return CONTAINING_RECORD(iface, JpegDecoder, IWICMetadataBlockReader_iface);
 }
 
+static inline JpegDecoder *impl_from_IWICBitmapSourceTransform(IWICBitmapSourceTransform *iface)
+{
+    return CONTAINING_RECORD(iface, JpegDecoder, IWICBitmapSourceTransform_iface);
+}
+
 static HRESULT WINAPI JpegDecoder_QueryInterface(IWICBitmapDecoder *iface, REFIID iid,
     void **ppv)
 {
@@ -218,7 +229,7 @@ static ULONG WINAPI JpegDecoder_Release(IWICBitmapDecoder *iface)
         DeleteCriticalSection(&This->lock);
         if (This->cinfo_initialized) pjpeg_destroy_decompress(&This->cinfo);
         if (This->stream) IStream_Release(This->stream);
-        HeapFree(GetProcessHeap(), 0, This->image_data);
+        decoded_rows_free(&This->rows);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -289,6 +300,53 @@ static void source_mgr_term_source(j_decompress_ptr cinfo)
 {
 }
 
+static BOOL set_out_color_space(j_decompress_ptr cinfo)
+{
+    switch (cinfo->jpeg_color_space)
+    {
+    case JCS_GRAYSCALE:
+        cinfo->out_color_space = JCS_GRAYSCALE;
+        return TRUE;
+    case JCS_RGB:
+    case JCS_YCbCr:
+        cinfo->out_color_space = JCS_RGB;
+        return TRUE;
+    case JCS_CMYK:
+    case JCS_YCCK:
+        cinfo->out_color_space = JCS_CMYK;
+        return TRUE;
+    default:
+        ERR("Unknown JPEG color space %i\n", cinfo->jpeg_color_space);
+        return FALSE;
+    }
+}
+
+/* Starts decoding again from the beginning of the stream, at 1/scale of the
+ * full size. libjpeg scales in the DCT domain, for scales up to 8. */
+static BOOL restart_decompress(JpegDecoder *This, UINT scale)
+{
+    LARGE_INTEGER seek;
+
+    TRACE("(%p,%u)\n", This, scale);
+
+    pjpeg_abort_decompress(&This->cinfo);
+
+    seek.QuadPart = 0;
+    if (FAILED(IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL))) return FALSE;
+    This->source_mgr.bytes_in_buffer = 0;
+
+    if (pjpeg_read_header(&This->cinfo, TRUE) != JPEG_HEADER_OK) return FALSE;
+    if (!set_out_color_space(&This->cinfo)) return FALSE;
+    This->cinfo.scale_num = 1;
+    This->cinfo.scale_denom = scale;
+    if (!pjpeg_start_decompress(&This->cinfo)) return FALSE;
+
+    This->scale = scale;
+    This->restart = FALSE;
+    decoded_rows_reset(&This->rows, This->rows.stride);
+    return TRUE;
+}
+
 static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
     WICDecodeOptions cacheOptions)
 {
@@ -348,21 +406,8 @@ static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *
         return E_FAIL;
     }
 
-    switch (This->cinfo.jpeg_color_space)
+    if (!set_out_color_space(&This->cinfo))
     {
-    case JCS_GRAYSCALE:
-        This->cinfo.out_color_space = JCS_GRAYSCALE;
-        break;
-    case JCS_RGB:
-    case JCS_YCbCr:
-        This->cinfo.out_color_space = JCS_RGB;
-        break;
-    case JCS_CMYK:
-    case JCS_YCCK:
-        This->cinfo.out_color_space = JCS_CMYK;
-        break;
-    default:
-        ERR("Unknown JPEG color space %i\n", This->cinfo.jpeg_color_space);
         LeaveCriticalSection(&This->lock);
         return E_FAIL;
     }
@@ -374,6 +419,11 @@ static HRESULT WINAPI JpegDecoder_Initialize(IWICBitmapDecoder *iface, IStream *
         return E_FAIL;
     }
 
+    This->width = This->cinfo.output_width;
+    This->height = This->cinfo.output_height;
+    This->scale = 1;
+    This->restart = FALSE;
+
     This->initialized = TRUE;
 
     LeaveCriticalSection(&This->lock);
@@ -500,6 +550,10 @@ static HRESULT WINAPI JpegDecoder_Frame_QueryInterface(IWICBitmapFrameDecode *if
     {
         *ppv = &This->IWICBitmapFrameDecode_iface;
     }
+    else if (IsEqualIID(&IID_IWICBitmapSourceTransform, iid))
+    {
+        *ppv = &This->IWICBitmapSourceTransform_iface;
+    }
     else
     {
         *ppv = NULL;
@@ -526,8 +580,8 @@ static HRESULT WINAPI JpegDecoder_Frame_GetSize(IWICBitmapFrameDecode *iface,
     UINT *puiWidth, UINT *puiHeight)
 {
     JpegDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
-    *puiWidth = This->cinfo.output_width;
-    *puiHeight = This->cinfo.output_height;
+    *puiWidth = This->width;
+    *puiHeight = This->height;
     TRACE("(%p)->(%u,%u)\n", iface, *puiWidth, *puiHeight);
     return S_OK;
 }
@@ -586,30 +640,34 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPalette(IWICBitmapFrameDecode *iface
     return E_NOTIMPL;
 }
 
-static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
-    const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
+/* Decodes the image at 1/scale of its size up to the last row of the
+ * rectangle, keeping only the rows from its first one. */
+static HRESULT copy_scaled_pixels(JpegDecoder *This, UINT scale, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
-    JpegDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
     UINT bpp;
     UINT stride;
-    UINT data_size;
+    UINT width, height;
     UINT max_row_needed;
     jmp_buf jmpbuf;
     WICRect rect;
-    TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
+    HRESULT hr;
+
+    width = (This->width + scale - 1) / scale;
+    height = (This->height + scale - 1) / scale;
 
     if (!prc)
     {
         rect.X = 0;
         rect.Y = 0;
-        rect.Width = This->cinfo.output_width;
-        rect.Height = This->cinfo.output_height;
+        rect.Width = width;
+        rect.Height = height;
         prc = &rect;
     }
     else
     {
-        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->cinfo.output_width ||
-            prc->Y+prc->Height > This->cinfo.output_height)
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > width ||
+            prc->Y+prc->Height > height)
             return E_INVALIDARG;
     }
 
@@ -617,49 +675,60 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     else if (This->cinfo.out_color_space == JCS_CMYK) bpp = 32;
     else bpp = 24;
 
-    stride = bpp * This->cinfo.output_width;
-    data_size = stride * This->cinfo.output_height;
+    stride = (bpp * width + 7) / 8;
 
     max_row_needed = prc->Y + prc->Height;
-    if (max_row_needed > This->cinfo.output_height) return E_INVALIDARG;
 
     EnterCriticalSection(&This->lock);
 
-    if (!This->image_data)
-    {
-        This->image_data = HeapAlloc(GetProcessHeap(), 0, data_size);
-        if (!This->image_data)
-        {
-            LeaveCriticalSection(&This->lock);
-            return E_OUTOFMEMORY;
-        }
-    }
-
     This->cinfo.client_data = jmpbuf;
 
     if (setjmp(jmpbuf))
     {
+        This->restart = TRUE;
         LeaveCriticalSection(&This->lock);
         return E_FAIL;
     }
 
+    /* rows before the ones in the cache have to be decoded again */
+    if (This->restart || scale != This->scale || prc->Y < This->rows.first ||
+        stride != This->rows.stride)
+    {
+        decoded_rows_reset(&This->rows, stride);
+        if (!restart_decompress(This, scale))
+        {
+            ERR("failed to restart decoding\n");
+            This->restart = TRUE;
+            LeaveCriticalSection(&This->lock);
+            return E_FAIL;
+        }
+    }
+
+    decoded_rows_release(&This->rows, prc->Y);
+
     while (max_row_needed > This->cinfo.output_scanline)
     {
-        UINT first_scanline = This->cinfo.output_scanline;
         UINT max_rows;
         JSAMPROW out_rows[4];
+        BYTE *bits;
         UINT i;
         JDIMENSION ret;
 
-        max_rows = min(This->cinfo.output_height-first_scanline, 4);
+        max_rows = min(This->cinfo.output_height-This->cinfo.output_scanline, 4);
+        if (!(bits = decoded_rows_reserve(&This->rows, max_rows)))
+        {
+            LeaveCriticalSection(&This->lock);
+            return E_OUTOFMEMORY;
+        }
         for (i=0; i<max_rows; i++)
-            out_rows[i] = This->image_data + stride * (first_scanline+i);
+            out_rows[i] = bits + stride * i;
 
         ret = pjpeg_read_scanlines(&This->cinfo, out_rows, max_rows);
 
         if (ret == 0)
         {
             ERR("read_scanlines failed\n");
+            This->restart = TRUE;
             LeaveCriticalSection(&This->lock);
             return E_FAIL;
         }
@@ -667,22 +736,34 @@ static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
         if (bpp == 24)
         {
             /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
-            reverse_bgr8(3, This->image_data + stride * first_scanline,
-                This->cinfo.output_width, This->cinfo.output_scanline - first_scanline,
-                stride);
+            reverse_bgr8(3, bits, width, ret, stride);
         }
 
         if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
             /* Adobe JPEG's have inverted CMYK data. */
-            for (i=0; i<data_size; i++)
-                This->image_data[i] ^= 0xff;
+            for (i=0; i<stride * ret; i++)
+                bits[i] ^= 0xff;
+
+        This->rows.count += ret;
+
+        /* rows above the rectangle are not needed */
+        decoded_rows_release(&This->rows, prc->Y);
     }
 
+    hr = decoded_rows_copy(&This->rows, bpp, width, prc, cbStride, cbBufferSize, pbBuffer);
+
     LeaveCriticalSection(&This->lock);
 
-    return copy_pixels(bpp, This->image_data,
-        This->cinfo.output_width, This->cinfo.output_height, stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    return hr;
+}
+
+static HRESULT WINAPI JpegDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
+    const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
+{
+    JpegDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
+
+    return copy_scaled_pixels(This, 1, prc, cbStride, cbBufferSize, pbBuffer);
 }
 
 static HRESULT WINAPI JpegDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -793,6 +874,113 @@ static const IWICMetadataBlockReaderVtbl JpegDecoder_Block_Vtbl = {
     JpegDecoder_Block_GetEnumerator,
 };
 
+static HRESULT WINAPI JpegDecoder_Transform_QueryInterface(IWICBitmapSourceTransform *iface, REFIID iid,
+    void **ppv)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapFrameDecode_QueryInterface(&This->IWICBitmapFrameDecode_iface, iid, ppv);
+}
+
+static ULONG WINAPI JpegDecoder_Transform_AddRef(IWICBitmapSourceTransform *iface)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapDecoder_AddRef(&This->IWICBitmapDecoder_iface);
+}
+
+static ULONG WINAPI JpegDecoder_Transform_Release(IWICBitmapSourceTransform *iface)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    return IWICBitmapDecoder_Release(&This->IWICBitmapDecoder_iface);
+}
+
+/* libjpeg can decode at 1/1, 1/2, 1/4 and 1/8 of the size */
+static UINT get_scale_for_size(JpegDecoder *This, UINT width, UINT height)
+{
+    UINT scale;
+
+    for (scale = 1; scale <= 8; scale *= 2)
+        if ((This->width + scale - 1) / scale == width && (This->height + scale - 1) / scale == height)
+            return scale;
+    return 0;
+}
+
+static HRESULT WINAPI JpegDecoder_Transform_CopyPixels(IWICBitmapSourceTransform *iface,
+    const WICRect *prc, UINT uiWidth, UINT uiHeight, WICPixelFormatGUID *pguidDstFormat,
+    WICBitmapTransformOptions dstTransform, UINT nStride, UINT cbBufferSize, BYTE *pbBuffer)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    WICPixelFormatGUID format;
+    UINT scale;
+
+    TRACE("(%p,%p,%u,%u,%s,%u,%u,%u,%p)\n", iface, prc, uiWidth, uiHeight,
+        debugstr_guid(pguidDstFormat), dstTransform, nStride, cbBufferSize, pbBuffer);
+
+    if (!(scale = get_scale_for_size(This, uiWidth, uiHeight)))
+        return E_INVALIDARG;
+
+    if (dstTransform != WICBitmapTransformRotate0)
+        return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+
+    IWICBitmapFrameDecode_GetPixelFormat(&This->IWICBitmapFrameDecode_iface, &format);
+    if (pguidDstFormat && !IsEqualGUID(pguidDstFormat, &format))
+        return WINCODEC_ERR_UNSUPPORTEDPIXELFORMAT;
+
+    return copy_scaled_pixels(This, scale, prc, nStride, cbBufferSize, pbBuffer);
+}
+
+static HRESULT WINAPI JpegDecoder_Transform_GetClosestSize(IWICBitmapSourceTransform *iface,
+    UINT *puiWidth, UINT *puiHeight)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+    UINT scale;
+
+    TRACE("(%p,%p,%p)\n", iface, puiWidth, puiHeight);
+
+    if (!puiWidth || !puiHeight) return E_INVALIDARG;
+
+    /* the smallest size that is not smaller than the requested one */
+    for (scale = 8; scale > 1; scale /= 2)
+        if ((This->width + scale - 1) / scale >= *puiWidth && (This->height + scale - 1) / scale >= *puiHeight)
+            break;
+
+    *puiWidth = (This->width + scale - 1) / scale;
+    *puiHeight = (This->height + scale - 1) / scale;
+    return S_OK;
+}
+
+static HRESULT WINAPI JpegDecoder_Transform_GetClosestPixelFormat(IWICBitmapSourceTransform *iface,
+    WICPixelFormatGUID *pguidDstFormat)
+{
+    JpegDecoder *This = impl_from_IWICBitmapSourceTransform(iface);
+
+    TRACE("(%p,%p)\n", iface, pguidDstFormat);
+
+    if (!pguidDstFormat) return E_INVALIDARG;
+
+    return IWICBitmapFrameDecode_GetPixelFormat(&This->IWICBitmapFrameDecode_iface, pguidDstFormat);
+}
+
+static HRESULT WINAPI JpegDecoder_Transform_DoesSupportTransform(IWICBitmapSourceTransform *iface,
+    WICBitmapTransformOptions dstTransform, BOOL *pfIsSupported)
+{
+    TRACE("(%p,%u,%p)\n", iface, dstTransform, pfIsSupported);
+
+    if (!pfIsSupported) return E_INVALIDARG;
+
+    *pfIsSupported = (dstTransform == WICBitmapTransformRotate0);
+    return S_OK;
+}
+
+static const IWICBitmapSourceTransformVtbl JpegDecoder_Transform_Vtbl = {
+    JpegDecoder_Transform_QueryInterface,
+    JpegDecoder_Transform_AddRef,
+    JpegDecoder_Transform_Release,
+    JpegDecoder_Transform_CopyPixels,
+    JpegDecoder_Transform_GetClosestSize,
+    JpegDecoder_Transform_GetClosestPixelFormat,
+    JpegDecoder_Transform_DoesSupportTransform
+};
+
 HRESULT JpegDecoder_CreateInstance(REFIID iid, void** ppv)
 {
     JpegDecoder *This;
@@ -814,11 +1002,12 @@ HRESULT JpegDecoder_CreateInstance(REFIID iid, void** ppv)
     This->IWICBitmapDecoder_iface.lpVtbl = &JpegDecoder_Vtbl;
     This->IWICBitmapFrameDecode_iface.lpVtbl = &JpegDecoder_Frame_Vtbl;
     This->IWICMetadataBlockReader_iface.lpVtbl = &JpegDecoder_Block_Vtbl;
+    This->IWICBitmapSourceTransform_iface.lpVtbl = &JpegDecoder_Transform_Vtbl;
     This->ref = 1;
     This->initialized = FALSE;
     This->cinfo_initialized = FALSE;
     This->stream = NULL;
-    This->image_data = NULL;
+    decoded_rows_init(&This->rows, 0);
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": JpegDecoder.lock");
 
@@ -117,6 +117,83 @@ HRESULT copy_pixels(UINT bpp, const BYTE *srcbuffer,
     }
 }
 
+void decoded_rows_init(struct decoded_rows *rows, UINT stride)
+{
+    rows->bits = NULL;
+    rows->stride = stride;
+    rows->first = rows->count = rows->size = 0;
+}
+
+void decoded_rows_free(struct decoded_rows *rows)
+{
+    HeapFree(GetProcessHeap(), 0, rows->bits);
+    decoded_rows_init(rows, rows->stride);
+}
+
+void decoded_rows_reset(struct decoded_rows *rows, UINT stride)
+{
+    if (stride != rows->stride) decoded_rows_free(rows);
+    rows->stride = stride;
+    rows->first = rows->count = 0;
+}
+
+BYTE *decoded_rows_reserve(struct decoded_rows *rows, UINT count)
+{
+    if (rows->count + count > rows->size)
+    {
+        UINT size = max(rows->count + count, max(16, rows->size * 2));
+        BYTE *bits;
+
+        if (rows->bits)
+            bits = HeapReAlloc(GetProcessHeap(), 0, rows->bits, (SIZE_T)size * rows->stride);
+        else
+            bits = HeapAlloc(GetProcessHeap(), 0, (SIZE_T)size * rows->stride);
+        if (!bits) return NULL;
+        rows->bits = bits;
+        rows->size = size;
+    }
+    return rows->bits + (SIZE_T)rows->count * rows->stride;
+}
+
+void decoded_rows_release(struct decoded_rows *rows, UINT row)
+{
+    UINT count;
+
+    if (row <= rows->first) return;
+    count = min(row - rows->first, rows->count);
+
+    memmove(rows->bits, rows->bits + (SIZE_T)count * rows->stride,
+        (SIZE_T)(rows->count - count) * rows->stride);
+    rows->first += count;
+    rows->count -= count;
+
+    /* give back the memory of a large request once smaller ones follow */
+    if (rows->size > 64 && rows->count * 4 < rows->size)
+    {
+        UINT size = max(16, rows->count * 2);
+        BYTE *bits = HeapReAlloc(GetProcessHeap(), 0, rows->bits, (SIZE_T)size * rows->stride);
+
+        if (bits)
+        {
+            rows->bits = bits;
+            rows->size = size;
+        }
+    }
+}
+
+HRESULT decoded_rows_copy(const struct decoded_rows *rows, UINT bpp, UINT width,
+    const WICRect *rc, UINT dststride, UINT dstbuffersize, BYTE *dstbuffer)
+{
+    WICRect rect = *rc;
+
+    if (rc->Y < rows->first || rc->Y + rc->Height > rows->first + rows->count)
+        return E_FAIL;
+
+    rect.Y -= rows->first;
+    return copy_pixels(bpp, rows->bits, width, rows->count, rows->stride,
+        &rect, dststride, dstbuffersize, dstbuffer);
+}
+
 HRESULT configure_write_source(IWICBitmapFrameEncode *iface,
     IWICBitmapSource *source, const WICRect *prc,
     const WICPixelFormatGUID *format,
@@ -225,6 +302,114 @@ void reverse_bgr8(UINT bytesperpixel, LPBYTE bits, UINT width, UINT height, INT
     }
 }
 
+/* Pixel operations on large images are split in bands of scanlines which are
+ * processed in parallel by the thread pool and the calling thread. */
+#define BAND_MIN_PIXELS 0x10000
+
+struct band_work
+{
+    LONG ref;
+    void (*func)(void *context, UINT start, UINT end);
+    void *context;
+    UINT height;
+    LONG band_count;
+    LONG next;    /* next band to process */
+    LONG pending; /* bands not processed yet */
+    HANDLE done;
+};
+
+static void release_band_work(struct band_work *work)
+{
+    if (InterlockedDecrement(&work->ref)) return;
+    CloseHandle(work->done);
+    HeapFree(GetProcessHeap(), 0, work);
+}
+
+static void process_bands(struct band_work *work)
+{
+    LONG band;
+
+    while ((band = InterlockedIncrement(&work->next) - 1) < work->band_count)
+    {
+        work->func(work->context, (ULONGLONG)band * work->height / work->band_count,
+                   (ULONGLONG)(band + 1) * work->height / work->band_count);
+        if (!InterlockedDecrement(&work->pending)) SetEvent(work->done);
+    }
+}
+
+static void CALLBACK band_work_callback(TP_CALLBACK_INSTANCE *instance, void *context)
+{
+    struct band_work *work = context;
+
+    process_bands(work);
+    release_band_work(work);
+}
+
+static UINT get_cpu_count(void)
+{
+    static UINT count;
+
+    if (!count)
+    {
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+        count = max(1, info.dwNumberOfProcessors);
+    }
+    return count;
+}
+
+/* number of times process_scanline_bands() calls func for an image */
+UINT get_scanline_band_count(UINT width, UINT height)
+{
+    ULONGLONG pixels = (ULONGLONG)width * height;
+
+    return max(1, min(get_cpu_count(), min(pixels / BAND_MIN_PIXELS, height)));
+}
+
+void process_scanline_bands(UINT width, UINT height,
+    void (*func)(void *context, UINT start, UINT end), void *context)
+{
+    struct band_work *work;
+    UINT band_count, i;
+
+    band_count = get_scanline_band_count(width, height);
+    if (band_count < 2 || !(work = HeapAlloc(GetProcessHeap(), 0, sizeof(*work))))
+    {
+        func(context, 0, height);
+        return;
+    }
+
+    work->ref = 1;
+    work->func = func;
+    work->context = context;
+    work->height = height;
+    work->band_count = band_count;
+    work->next = 0;
+    work->pending = band_count;
+    if (!(work->done = CreateEventW(NULL, TRUE, FALSE, NULL)))
+    {
+        HeapFree(GetProcessHeap(), 0, work);
+        func(context, 0, height);
+        return;
+    }
+
+    for (i = 1; i < band_count; i++)
+    {
+        InterlockedIncrement(&work->ref);
+        if (!TrySubmitThreadpoolCallback(band_work_callback, work, NULL))
+        {
+            InterlockedDecrement(&work->ref);
+            break;
+        }
+    }
+
+    /* whatever the pool did not pick up yet is processed here */
+    process_bands(work);
+    WaitForSingleObject(work->done, INFINITE);
+    release_band_work(work);
+}
+
 HRESULT get_pixelformat_bpp(const GUID *pixelformat, UINT *bpp)
 {
     HRESULT hr;
@@ -337,6 +337,7 @@ MAKE_FUNCPTR(png_set_write_fn);
 MAKE_FUNCPTR(png_read_end);
 MAKE_FUNCPTR(png_read_image);
 MAKE_FUNCPTR(png_read_info);
+MAKE_FUNCPTR(png_read_row);
 MAKE_FUNCPTR(png_write_end);
 MAKE_FUNCPTR(png_write_info);
 MAKE_FUNCPTR(png_write_rows);
@@ -406,6 +407,7 @@ static void *load_libpng(void)
         LOAD_FUNCPTR(png_read_end);
         LOAD_FUNCPTR(png_read_image);
         LOAD_FUNCPTR(png_read_info);
+        LOAD_FUNCPTR(png_read_row);
         LOAD_FUNCPTR(png_write_end);
         LOAD_FUNCPTR(png_write_info);
         LOAD_FUNCPTR(png_write_rows);
@@ -456,7 +458,10 @@ typedef struct {
     int width, height;
     UINT stride;
     const WICPixelFormatGUID *format;
-    BYTE *image_bits;
+    BOOL interlaced;
+    BOOL restart;                /* decoding has to start over */
+    ULARGE_INTEGER read_pos;     /* stream position where libpng continues reading */
+    struct decoded_rows rows;
     CRITICAL_SECTION lock; /* must be held when png structures are accessed or initialized is set */
     ULONG metadata_count;
     metadata_block_info* metadata_blocks;
@@ -527,7 +532,7 @@ static ULONG WINAPI PngDecoder_Release(IWICBitmapDecoder *iface)
             ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
-        HeapFree(GetProcessHeap(), 0, This->image_bits);
+        decoded_rows_free(&This->rows);
         for (i=0; i<This->metadata_count; i++)
         {
             if (This->metadata_blocks[i].reader)
@@ -571,45 +576,30 @@ static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t lengt
     }
 }
 
-static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
-    WICDecodeOptions cacheOptions)
+/* Sets up libpng to read the image from the start of the stream and
+ * reads the header, leaving the stream at the first image row. */
+static HRESULT read_png_header(PngDecoder *This, IStream *stream)
 {
-    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
     LARGE_INTEGER seek;
-    HRESULT hr=S_OK;
-    png_bytep *row_pointers=NULL;
-    UINT image_size;
-    UINT i;
+    HRESULT hr;
     int color_type, bit_depth;
     png_bytep trans;
     int num_trans;
     png_uint_32 transparency;
     png_color_16p trans_values;
     jmp_buf jmpbuf;
-    BYTE chunk_type[4];
-    ULONG chunk_size;
-    ULARGE_INTEGER chunk_start;
-    ULONG metadata_blocks_size = 0;
-
-    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
-
-    EnterCriticalSection(&This->lock);
 
     /* initialize libpng */
     This->png_ptr = ppng_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!This->png_ptr)
-    {
-        hr = E_FAIL;
-        goto end;
-    }
+        return E_FAIL;
 
     This->info_ptr = ppng_create_info_struct(This->png_ptr);
     if (!This->info_ptr)
     {
         ppng_destroy_read_struct(&This->png_ptr, NULL, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     This->end_info = ppng_create_info_struct(This->png_ptr);
@@ -617,29 +607,26 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, NULL);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
     /* set up setjmp/longjmp error handling */
     if (setjmp(jmpbuf))
     {
         ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
-        HeapFree(GetProcessHeap(), 0, row_pointers);
         This->png_ptr = NULL;
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
     ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
     ppng_set_crc_action(This->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
 
     /* seek to the start of the stream */
     seek.QuadPart = 0;
-    hr = IStream_Seek(pIStream, seek, STREAM_SEEK_SET, NULL);
-    if (FAILED(hr)) goto end;
+    hr = IStream_Seek(stream, seek, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr)) return hr;
 
     /* set up custom i/o handling */
-    ppng_set_read_fn(This->png_ptr, pIStream, user_read_data);
+    ppng_set_read_fn(This->png_ptr, stream, user_read_data);
 
     /* read the header */
     ppng_read_info(This->png_ptr, This->info_ptr);
@@ -684,8 +671,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat16bppGray; break;
         default:
             ERR("invalid grayscale bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_GRAY_ALPHA:
@@ -703,8 +689,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat64bppRGBA; break;
         default:
             ERR("invalid RGBA bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_PALETTE:
@@ -717,8 +702,7 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 8: This->format = &GUID_WICPixelFormat8bppIndexed; break;
         default:
             ERR("invalid indexed color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     case PNG_COLOR_TYPE_RGB:
@@ -732,45 +716,57 @@ static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *p
         case 16: This->format = &GUID_WICPixelFormat48bppRGB; break;
         default:
             ERR("invalid RGB color bit depth: %i\n", bit_depth);
-            hr = E_FAIL;
-            goto end;
+            return E_FAIL;
         }
         break;
     default:
         ERR("invalid color type %i\n", color_type);
-        hr = E_FAIL;
-        goto end;
+        return E_FAIL;
     }
 
-    /* read the image data */
     This->width = ppng_get_image_width(This->png_ptr, This->info_ptr);
     This->height = ppng_get_image_height(This->png_ptr, This->info_ptr);
     This->stride = (This->width * This->bpp + 7) / 8;
-    image_size = This->stride * This->height;
+    This->interlaced = ppng_set_interlace_handling(This->png_ptr) > 1;
 
-    This->image_bits = HeapAlloc(GetProcessHeap(), 0, image_size);
-    if (!This->image_bits)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+    seek.QuadPart = 0;
+    return IStream_Seek(stream, seek, STREAM_SEEK_CUR, &This->read_pos);
+}
 
-    row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
-    if (!row_pointers)
-    {
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+/* Starts decoding again from the first row. */
+static HRESULT restart_png_read(PngDecoder *This)
+{
+    TRACE("(%p)\n", This);
 
-    for (i=0; i<This->height; i++)
-        row_pointers[i] = This->image_bits + i * This->stride;
+    if (This->png_ptr)
+        ppng_destroy_read_struct(&This->png_ptr, &This->info_ptr, &This->end_info);
+    This->png_ptr = NULL;
 
-    ppng_read_image(This->png_ptr, row_pointers);
+    decoded_rows_reset(&This->rows, This->stride);
+    This->restart = FALSE;
+    return read_png_header(This, This->stream);
+}
 
-    HeapFree(GetProcessHeap(), 0, row_pointers);
-    row_pointers = NULL;
+static HRESULT WINAPI PngDecoder_Initialize(IWICBitmapDecoder *iface, IStream *pIStream,
+    WICDecodeOptions cacheOptions)
+{
+    PngDecoder *This = impl_from_IWICBitmapDecoder(iface);
+    LARGE_INTEGER seek;
+    HRESULT hr=S_OK;
+    BYTE chunk_type[4];
+    ULONG chunk_size;
+    ULARGE_INTEGER chunk_start;
+    ULONG metadata_blocks_size = 0;
 
-    ppng_read_end(This->png_ptr, This->end_info);
+    TRACE("(%p,%p,%x)\n", iface, pIStream, cacheOptions);
+
+    EnterCriticalSection(&This->lock);
+
+    /* the image rows are decoded on demand in CopyPixels */
+    hr = read_png_header(This, pIStream);
+    if (FAILED(hr)) goto end;
+
+    decoded_rows_reset(&This->rows, This->stride);
 
     /* Find the metadata chunks in the file. */
     seek.QuadPart = 8;
@@ -1089,11 +1085,114 @@ static HRESULT WINAPI PngDecoder_Frame_CopyPixels(IWICBitmapFrameDecode *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
     PngDecoder *This = impl_from_IWICBitmapFrameDecode(iface);
+    png_bytep *row_pointers=NULL;
+    LARGE_INTEGER seek;
+    jmp_buf jmpbuf;
+    WICRect rect;
+    BYTE *bits;
+    HRESULT hr;
+    UINT i;
+
     TRACE("(%p,%p,%u,%u,%p)\n", iface, prc, cbStride, cbBufferSize, pbBuffer);
 
-    return copy_pixels(This->bpp, This->image_bits,
-        This->width, This->height, This->stride,
-        prc, cbStride, cbBufferSize, pbBuffer);
+    if (!prc)
+    {
+        rect.X = 0;
+        rect.Y = 0;
+        rect.Width = This->width;
+        rect.Height = This->height;
+        prc = &rect;
+    }
+    else
+    {
+        if (prc->X < 0 || prc->Y < 0 || prc->X+prc->Width > This->width ||
+            prc->Y+prc->Height > This->height)
+            return E_INVALIDARG;
+    }
+
+    EnterCriticalSection(&This->lock);
+
+    /* rows before the ones in the cache have to be decoded again */
+    if (This->restart || prc->Y < This->rows.first)
+    {
+        hr = restart_png_read(This);
+        if (FAILED(hr))
+        {
+            This->restart = TRUE;
+            goto end;
+        }
+    }
+
+    if (setjmp(jmpbuf))
+    {
+        HeapFree(GetProcessHeap(), 0, row_pointers);
+        This->restart = TRUE;
+        hr = E_FAIL;
+        goto end;
+    }
+    ppng_set_error_fn(This->png_ptr, jmpbuf, user_error_fn, user_warning_fn);
+
+    /* the stream is shared with the metadata readers */
+    seek.QuadPart = This->read_pos.QuadPart;
+    hr = IStream_Seek(This->stream, seek, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr)) goto end;
+
+    if (This->interlaced)
+    {
+        /* every pass covers the whole image, so decode all of it once */
+        if (!This->rows.count)
+        {
+            bits = decoded_rows_reserve(&This->rows, This->height);
+            row_pointers = HeapAlloc(GetProcessHeap(), 0, sizeof(png_bytep)*This->height);
+            if (!bits || !row_pointers)
+            {
+                HeapFree(GetProcessHeap(), 0, row_pointers);
+                hr = E_OUTOFMEMORY;
+                goto end;
+            }
+
+            for (i=0; i<This->height; i++)
+                row_pointers[i] = bits + i * This->stride;
+
+            ppng_read_image(This->png_ptr, row_pointers);
+
+            HeapFree(GetProcessHeap(), 0, row_pointers);
+            row_pointers = NULL;
+            This->rows.count = This->height;
+        }
+    }
+    else
+    {
+        decoded_rows_release(&This->rows, prc->Y);
+
+        while (This->rows.first + This->rows.count < prc->Y + prc->Height)
+        {
+            bits = decoded_rows_reserve(&This->rows, 1);
+            if (!bits)
+            {
+                hr = E_OUTOFMEMORY;
+                goto end;
+            }
+
+            ppng_read_row(This->png_ptr, bits, NULL);
+            This->rows.count++;
+
+            /* rows above the rectangle are not needed */
+            decoded_rows_release(&This->rows, prc->Y);
+        }
+    }
+
+    seek.QuadPart = 0;
+    hr = IStream_Seek(This->stream, seek, STREAM_SEEK_CUR, &This->read_pos);
+    if (FAILED(hr)) goto end;
+
+    hr = decoded_rows_copy(&This->rows, This->bpp, This->width, prc,
+        cbStride, cbBufferSize, pbBuffer);
+
+end:
+    LeaveCriticalSection(&This->lock);
+
+    return hr;
 }
 
 static HRESULT WINAPI PngDecoder_Frame_GetMetadataQueryReader(IWICBitmapFrameDecode *iface,
@@ -1306,7 +1405,8 @@ HRESULT PngDecoder_CreateInstance(REFIID iid, void** ppv)
     This->end_info = NULL;
     This->stream = NULL;
     This->initialized = FALSE;
-    This->image_bits = NULL;
+    This->restart = FALSE;
+    decoded_rows_init(&This->rows, 0);
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": PngDecoder.lock");
     This->metadata_count = 0;
@@ -19,6 +19,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -30,8 +31,28 @@
 
 #include "wine/debug.h"
 
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SIMD
+#include <emmintrin.h>
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* Filter weights are 14-bit fixed point. The vertical pass keeps 6 bits of
+ * fraction in 16-bit intermediates, which the horizontal pass rounds off. */
+#define FILTER_BITS   14
+#define FILTER_ONE    (1 << FILTER_BITS)
+#define VERTICAL_BITS 6
+
+/* for each destination coordinate, the first of 'taps' source coordinates and their weights */
+struct filter
+{
+    UINT taps;
+    UINT *first;
+    SHORT *weights;
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -40,8 +61,9 @@ typedef struct BitmapScaler {
     UINT src_width, src_height;
     WICBitmapInterpolationMode mode;
     UINT bpp;
+    struct filter filter_x, filter_y;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
-    void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,SHORT*,BYTE*);
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -50,6 +72,14 @@ static inline BitmapScaler *impl_from_IWICBitmapScaler(IWICBitmapScaler *iface)
     return CONTAINING_RECORD(iface, BitmapScaler, IWICBitmapScaler_iface);
 }
 
+static void free_filter(struct filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->first);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    filter->first = NULL;
+    filter->weights = NULL;
+}
+
 static HRESULT WINAPI BitmapScaler_QueryInterface(IWICBitmapScaler *iface, REFIID iid,
     void **ppv)
 {
@@ -96,6 +126,8 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter(&This->filter_x);
+        free_filter(&This->filter_y);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -175,7 +207,7 @@ static void NearestNeighbor_GetRequiredSourceRect(BitmapScaler *This,
 
 static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     UINT dst_x, UINT dst_y, UINT dst_width,
-    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, SHORT *temp, BYTE *pbBuffer)
 {
     UINT i;
     UINT bytesperpixel = This->bpp/8;
@@ -190,6 +222,238 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+static double linear_weight(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Catmull-Rom spline */
+static double cubic_weight(double x)
+{
+    x = fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+/* Computes the filter for scaling src_size pixels to dst_size. Linear and
+ * Cubic sample the source around the center of each destination pixel, Fant
+ * averages the source area covered by each destination pixel. */
+static BOOL init_filter(struct filter *filter, WICBitmapInterpolationMode mode,
+    UINT src_size, UINT dst_size)
+{
+    double scale = (double)src_size / dst_size, *weights;
+    UINT i, k, support;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear: support = 2; break;
+    case WICBitmapInterpolationModeCubic: support = 4; break;
+    default: support = (UINT)ceil(scale) + 1; break;
+    }
+    filter->taps = min(support, src_size);
+
+    filter->first = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*filter->first));
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * filter->taps * sizeof(*filter->weights));
+    weights = HeapAlloc(GetProcessHeap(), 0, filter->taps * sizeof(*weights));
+    if (!filter->first || !filter->weights || !weights)
+    {
+        HeapFree(GetProcessHeap(), 0, weights);
+        free_filter(filter);
+        return FALSE;
+    }
+
+    for (i = 0; i < dst_size; i++)
+    {
+        double center = (i + 0.5) * scale, total = 0.0;
+        SHORT *fixed = filter->weights + i * filter->taps;
+        int start, first, sum = 0, largest = 0;
+
+        if (mode == WICBitmapInterpolationModeFant)
+            start = (int)floor(center - scale / 2);
+        else
+            start = (int)floor(center - 0.5) - (int)support / 2 + 1;
+
+        /* taps outside of the source are folded into the edge pixels */
+        first = max(0, min(start, (int)(src_size - filter->taps)));
+        memset(weights, 0, filter->taps * sizeof(*weights));
+        for (k = 0; k < support; k++)
+        {
+            int pos = start + k;
+            double w;
+
+            if (mode == WICBitmapInterpolationModeLinear)
+                w = linear_weight(pos + 0.5 - center);
+            else if (mode == WICBitmapInterpolationModeCubic)
+                w = cubic_weight(pos + 0.5 - center);
+            else
+                w = max(0.0, min(pos + 1.0, center + scale / 2) - max((double)pos, center - scale / 2));
+
+            pos = max(0, min(pos, (int)src_size - 1));
+            weights[pos - first] += w;
+            total += w;
+        }
+
+        /* normalize, making the fixed point weights add up exactly to one */
+        for (k = 0; k < filter->taps; k++)
+        {
+            fixed[k] = (SHORT)floor(weights[k] / total * FILTER_ONE + 0.5);
+            sum += fixed[k];
+            if (abs(fixed[k]) > abs(fixed[largest])) largest = k;
+        }
+        fixed[largest] += FILTER_ONE - sum;
+        filter->first[i] = first;
+    }
+
+    HeapFree(GetProcessHeap(), 0, weights);
+    return TRUE;
+}
+
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->filter_x.first[x];
+    src_rect->Y = This->filter_y.first[y];
+    src_rect->Width = This->filter_x.taps;
+    src_rect->Height = This->filter_y.taps;
+}
+
+static void filter_vertical(BYTE **rows, const SHORT *weights, UINT taps,
+    UINT start, UINT count, SHORT *dst)
+{
+    UINT i, k;
+
+    for (i = 0; i < count; i++)
+    {
+        int sum = 0;
+        for (k = 0; k < taps; k++) sum += weights[k] * rows[k][start + i];
+        dst[i] = (sum + (1 << (FILTER_BITS - VERTICAL_BITS - 1))) >> (FILTER_BITS - VERTICAL_BITS);
+    }
+}
+
+#ifdef USE_SIMD
+/* processes two source rows at once with pmaddwd */
+__attribute__((target("sse2")))
+static void filter_vertical_sse2(BYTE **rows, const SHORT *weights, UINT taps,
+    UINT start, UINT count, SHORT *dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (FILTER_BITS - VERTICAL_BITS - 1));
+    UINT i, k;
+
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        __m128i lo = round, hi = round;
+
+        for (k = 0; k < taps; k += 2)
+        {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(rows[k] + start + i)), zero);
+            __m128i b = zero, w;
+
+            if (k + 1 < taps)
+            {
+                b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(rows[k + 1] + start + i)), zero);
+                w = _mm_set1_epi32((weights[k + 1] << 16) | (USHORT)weights[k]);
+            }
+            else w = _mm_set1_epi32((USHORT)weights[k]);
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        lo = _mm_srai_epi32(lo, FILTER_BITS - VERTICAL_BITS);
+        hi = _mm_srai_epi32(hi, FILTER_BITS - VERTICAL_BITS);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    filter_vertical(rows, weights, taps, start + i, count - i, dst + i);
+}
+#endif
+
+static void (*get_filter_vertical(void))(BYTE **, const SHORT *, UINT, UINT, UINT, SHORT *)
+{
+#ifdef USE_SIMD
+#ifdef __i386__
+    if (!IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE)) return filter_vertical;
+#endif
+    return filter_vertical_sse2;
+#else
+    return filter_vertical;
+#endif
+}
+
+static void Filter_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, SHORT *temp, BYTE *pbBuffer)
+{
+    static void (*vertical)(BYTE **, const SHORT *, UINT, UINT, UINT, SHORT *);
+    const struct filter *fx = &This->filter_x, *fy = &This->filter_y;
+    UINT channels = This->bpp / 8, first_x = fx->first[dst_x];
+    UINT count = fx->first[dst_x + dst_width - 1] + fx->taps - first_x;
+    UINT i, c, k;
+
+    if (!vertical) vertical = get_filter_vertical();
+
+    vertical(src_data + fy->first[dst_y] - src_data_y, fy->weights + dst_y * fy->taps, fy->taps,
+             (first_x - src_data_x) * channels, count * channels, temp);
+
+    for (i = 0; i < dst_width; i++)
+    {
+        const SHORT *weights = fx->weights + (dst_x + i) * fx->taps;
+        const SHORT *src = temp + (fx->first[dst_x + i] - first_x) * channels;
+
+        for (c = 0; c < channels; c++)
+        {
+            int sum = 1 << (FILTER_BITS + VERTICAL_BITS - 1);
+
+            for (k = 0; k < fx->taps; k++) sum += weights[k] * src[k * channels + c];
+            sum >>= FILTER_BITS + VERTICAL_BITS;
+            pbBuffer[i * channels + c] = max(0, min(sum, 255));
+        }
+    }
+}
+
+/* filtering works on formats with 8-bit channels, others are converted first */
+static BOOL can_filter_format(const WICPixelFormatGUID *format)
+{
+    return IsEqualGUID(format, &GUID_WICPixelFormat8bppGray) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat24bppBGR) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat24bppRGB) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppBGR) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppBGRA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppPBGRA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppRGBA) ||
+           IsEqualGUID(format, &GUID_WICPixelFormat32bppPRGBA);
+}
+
+struct scale_rows_params
+{
+    BitmapScaler *This;
+    const WICRect *dest_rect, *src_rect;
+    BYTE **src_rows;
+    BYTE *buffer;
+    UINT stride;
+    /* filter scratch space, one slice of temp_size for each band */
+    SHORT *temp;
+    UINT temp_size;
+    LONG next_temp;
+};
+
+static void scale_rows_band(void *context, UINT start, UINT end)
+{
+    struct scale_rows_params *params = context;
+    BitmapScaler *This = params->This;
+    SHORT *temp = NULL;
+    UINT y;
+
+    if (params->temp)
+        temp = params->temp + (InterlockedIncrement(&params->next_temp) - 1) * params->temp_size;
+
+    for (y = start; y < end; y++)
+        This->fn_copy_scanline(This, params->dest_rect->X, params->dest_rect->Y + y, params->dest_rect->Width,
+            params->src_rows, params->src_rect->X, params->src_rect->Y, temp,
+            params->buffer + params->stride * y);
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -197,6 +461,7 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     HRESULT hr;
     WICRect dest_rect;
     WICRect src_rect_ul, src_rect_br, src_rect;
+    struct scale_rows_params params;
     BYTE **src_rows;
     BYTE *src_bits;
     ULONG bytesperrow;
@@ -281,15 +546,28 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
         buffer_size, src_bits);
 
+    params.temp = NULL;
+    if (SUCCEEDED(hr) && This->fn_copy_scanline == Filter_CopyScanline)
+    {
+        params.temp_size = src_rect.Width * (This->bpp / 8);
+        params.temp = HeapAlloc(GetProcessHeap(), 0, get_scanline_band_count(dest_rect.Width, dest_rect.Height) *
+                                params.temp_size * sizeof(*params.temp));
+        if (!params.temp) hr = E_OUTOFMEMORY;
+    }
+
     if (SUCCEEDED(hr))
     {
-        for (y=0; y < dest_rect.Height; y++)
-        {
-            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
-                src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
-        }
+        params.This = This;
+        params.dest_rect = &dest_rect;
+        params.src_rect = &src_rect;
+        params.src_rows = src_rows;
+        params.buffer = pbBuffer;
+        params.stride = cbStride;
+        params.next_temp = 0;
+        process_scanline_bands(dest_rect.Width, dest_rect.Height, scale_rows_band, &params);
     }
 
+    HeapFree(GetProcessHeap(), 0, params.temp);
     HeapFree(GetProcessHeap(), 0, src_rows);
     HeapFree(GetProcessHeap(), 0, src_bits);
 
@@ -335,6 +613,37 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+            if (!uiWidth || !uiHeight)
+            {
+                hr = E_INVALIDARG;
+                break;
+            }
+            if (can_filter_format(&src_pixelformat))
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+            }
+            else
+            {
+                hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppPBGRA,
+                    pISource, &This->source);
+                This->bpp = 32;
+            }
+            if (SUCCEEDED(hr) &&
+                (!init_filter(&This->filter_x, mode, This->src_width, uiWidth) ||
+                 !init_filter(&This->filter_y, mode, This->src_height, uiHeight)))
+            {
+                free_filter(&This->filter_x);
+                IWICBitmapSource_Release(This->source);
+                This->source = NULL;
+                hr = E_OUTOFMEMORY;
+            }
+            This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+            This->fn_copy_scanline = Filter_CopyScanline;
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
@@ -390,6 +699,8 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->filter_x.first = This->filter_y.first = NULL;
+    This->filter_x.weights = This->filter_y.weights = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
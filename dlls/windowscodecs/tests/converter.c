@@ -411,6 +411,176 @@ static void test_default_converter(void)
     DeleteTestBitmap(src_obj);
 }
 
+static void test_large_bitmaps(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor, WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic, WICBitmapInterpolationModeFant
+    };
+    static const UINT sizes[][2] = {{640, 480}, {1000, 1000}};
+    const UINT width = 1024, height = 768;
+    struct bitmap_data data_24bppBGR = { &GUID_WICPixelFormat24bppBGR, 24, NULL, width, height, 96.0, 96.0 };
+    struct bitmap_data data_32bppBGRA = { &GUID_WICPixelFormat32bppBGRA, 32, NULL, width, height, 96.0, 96.0 };
+    IWICImagingFactory *factory;
+    IWICBitmapScaler *scaler;
+    IWICBitmapSource *dst_bitmap;
+    BitmapTestSrc *src_obj;
+    WICPixelFormatGUID format;
+    BYTE *src_bits, *dst_bits;
+    UINT i, j, x, y, errors, dst_size = width * height * 4;
+    HRESULT hr;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        dst_size = max(dst_size, sizes[i][0] * sizes[i][1] * 4);
+    src_bits = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    dst_bits = HeapAlloc(GetProcessHeap(), 0, dst_size);
+    for (i = 0; i < width * height * 3; i++) src_bits[i] = i * 7 + i / 3;
+
+    /* 24bppBGR -> 32bppBGRA */
+    data_24bppBGR.bits = src_bits;
+    CreateTestBitmap(&data_24bppBGR, &src_obj);
+    hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA, &src_obj->IWICBitmapSource_iface, &dst_bitmap);
+    ok(hr == S_OK, "WICConvertBitmapSource failed, hr=%x\n", hr);
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, NULL, width * 4, width * height * 4, dst_bits);
+    ok(hr == S_OK, "CopyPixels failed, hr=%x\n", hr);
+    for (i = errors = 0; i < width * height; i++)
+        if (memcmp(dst_bits + i * 4, src_bits + i * 3, 3) || dst_bits[i * 4 + 3] != 0xff) errors++;
+    ok(!errors, "got %u wrong pixels\n", errors);
+    IWICBitmapSource_Release(dst_bitmap);
+    DeleteTestBitmap(src_obj);
+
+    /* 32bppBGRA -> 24bppRGB */
+    for (i = 0; i < width * height * 4; i++) src_bits[i] = i * 5 + i / 4;
+    data_32bppBGRA.bits = src_bits;
+    CreateTestBitmap(&data_32bppBGRA, &src_obj);
+    hr = WICConvertBitmapSource(&GUID_WICPixelFormat24bppRGB, &src_obj->IWICBitmapSource_iface, &dst_bitmap);
+    ok(hr == S_OK, "WICConvertBitmapSource failed, hr=%x\n", hr);
+    hr = IWICBitmapSource_CopyPixels(dst_bitmap, NULL, width * 3, width * height * 3, dst_bits);
+    ok(hr == S_OK, "CopyPixels failed, hr=%x\n", hr);
+    for (i = errors = 0; i < width * height; i++)
+        if (dst_bits[i * 3] != src_bits[i * 4 + 2] || dst_bits[i * 3 + 1] != src_bits[i * 4 + 1] ||
+            dst_bits[i * 3 + 2] != src_bits[i * 4]) errors++;
+    ok(!errors, "got %u wrong pixels\n", errors);
+    IWICBitmapSource_Release(dst_bitmap);
+    DeleteTestBitmap(src_obj);
+
+    /* scaling an opaque uniform bitmap gives the same color in all modes */
+    for (i = 0; i < width * height; i++) ((DWORD *)src_bits)[i] = 0xff336699;
+    CreateTestBitmap(&data_32bppBGRA, &src_obj);
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+        &IID_IWICImagingFactory, (void **)&factory);
+    ok(hr == S_OK, "CoCreateInstance failed, hr=%x\n", hr);
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+        {
+            hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+            ok(hr == S_OK, "CreateBitmapScaler failed, hr=%x\n", hr);
+            hr = IWICBitmapScaler_Initialize(scaler, &src_obj->IWICBitmapSource_iface,
+                sizes[j][0], sizes[j][1], modes[i]);
+            ok(hr == S_OK, "mode %u: Initialize failed, hr=%x\n", modes[i], hr);
+            hr = IWICBitmapScaler_GetPixelFormat(scaler, &format);
+            ok(hr == S_OK, "GetPixelFormat failed, hr=%x\n", hr);
+            ok(IsEqualGUID(&format, &GUID_WICPixelFormat32bppBGRA) ||
+               IsEqualGUID(&format, &GUID_WICPixelFormat32bppPBGRA),
+               "mode %u: unexpected format %s\n", modes[i], wine_dbgstr_guid(&format));
+
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, sizes[j][0] * 4, sizes[j][0] * sizes[j][1] * 4, dst_bits);
+            ok(hr == S_OK, "mode %u: CopyPixels failed, hr=%x\n", modes[i], hr);
+
+            errors = 0;
+            for (y = 0; y < sizes[j][1]; y++)
+                for (x = 0; x < sizes[j][0]; x++)
+                    if (((DWORD *)dst_bits)[y * sizes[j][0] + x] != 0xff336699) errors++;
+            ok(!errors, "mode %u: got %u wrong pixels\n", modes[i], errors);
+
+            IWICBitmapScaler_Release(scaler);
+        }
+    }
+
+    IWICImagingFactory_Release(factory);
+    DeleteTestBitmap(src_obj);
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, dst_bits);
+}
+
+static void scale_gray_bitmap(IWICImagingFactory *factory, BYTE *src, UINT src_width,
+    WICBitmapInterpolationMode mode, UINT dst_width, BYTE *dst)
+{
+    const UINT height = 4;
+    struct bitmap_data data = { &GUID_WICPixelFormat32bppBGRA, 32, NULL, src_width, height, 96.0, 96.0 };
+    DWORD *src_bits, *dst_bits;
+    IWICBitmapScaler *scaler;
+    BitmapTestSrc *src_obj;
+    UINT x, y;
+    HRESULT hr;
+
+    /* the same gray scanline repeated on each row */
+    src_bits = HeapAlloc(GetProcessHeap(), 0, src_width * height * 4);
+    dst_bits = HeapAlloc(GetProcessHeap(), 0, dst_width * height * 4);
+    for (y = 0; y < height; y++)
+        for (x = 0; x < src_width; x++)
+            src_bits[y * src_width + x] = 0xff000000 | src[x] * 0x010101;
+    data.bits = (BYTE *)src_bits;
+    CreateTestBitmap(&data, &src_obj);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "CreateBitmapScaler failed, hr=%x\n", hr);
+    hr = IWICBitmapScaler_Initialize(scaler, &src_obj->IWICBitmapSource_iface, dst_width, height, mode);
+    ok(hr == S_OK, "mode %u: Initialize failed, hr=%x\n", mode, hr);
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, dst_width * 4, dst_width * height * 4, (BYTE *)dst_bits);
+    ok(hr == S_OK, "mode %u: CopyPixels failed, hr=%x\n", mode, hr);
+    for (x = 0; x < dst_width; x++) dst[x] = dst_bits[(height / 2) * dst_width + x];
+    IWICBitmapScaler_Release(scaler);
+
+    DeleteTestBitmap(src_obj);
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, dst_bits);
+}
+
+static void test_scaler_filters(void)
+{
+    IWICImagingFactory *factory;
+    BYTE src[64], dst[256];
+    UINT i, errors;
+    HRESULT hr;
+
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+        &IID_IWICImagingFactory, (void **)&factory);
+    ok(hr == S_OK, "CoCreateInstance failed, hr=%x\n", hr);
+
+    /* on a ramp, interpolating at the destination pixel centers gives a ramp again */
+    for (i = 0; i < 64; i++) src[i] = i * 4;
+
+    scale_gray_bitmap(factory, src, 64, WICBitmapInterpolationModeLinear, 256, dst);
+    for (i = 8, errors = 0; i < 248; i++)
+        if (abs(2 * dst[i] - (2 * (int)i - 3)) > 2) errors++;
+    ok(!errors, "linear: got %u wrong pixels, %u %u %u %u\n", errors, dst[8], dst[9], dst[10], dst[11]);
+
+    scale_gray_bitmap(factory, src, 64, WICBitmapInterpolationModeCubic, 256, dst);
+    for (i = 8, errors = 0; i < 248; i++)
+        if (abs(2 * dst[i] - (2 * (int)i - 3)) > 2) errors++;
+    ok(!errors, "cubic: got %u wrong pixels, %u %u %u %u\n", errors, dst[8], dst[9], dst[10], dst[11]);
+
+    /* each destination pixel is the average of four source pixels */
+    scale_gray_bitmap(factory, src, 64, WICBitmapInterpolationModeFant, 16, dst);
+    for (i = 0, errors = 0; i < 16; i++)
+        if (abs(dst[i] - (16 * (int)i + 6)) > 1) errors++;
+    ok(!errors, "fant: got %u wrong pixels, %u %u %u %u\n", errors, dst[0], dst[1], dst[2], dst[3]);
+
+    /* a step edge is spread over the two destination pixels on each side of it */
+    for (i = 0; i < 64; i++) src[i] = i < 32 ? 0x00 : 0xff;
+
+    scale_gray_bitmap(factory, src, 64, WICBitmapInterpolationModeLinear, 256, dst);
+    ok(dst[125] == 0x00 && dst[130] == 0xff, "linear: got %u %u\n", dst[125], dst[130]);
+    ok(abs(dst[126] - 32) <= 1 && abs(dst[127] - 96) <= 1 && abs(dst[128] - 159) <= 1 && abs(dst[129] - 223) <= 1,
+       "linear: got %u %u %u %u\n", dst[126], dst[127], dst[128], dst[129]);
+
+    IWICImagingFactory_Release(factory);
+}
+
 typedef struct property_opt_test_data
 {
     LPCOLESTR name;
@@ -807,6 +977,8 @@ START_TEST(converter)
 
     test_invalid_conversion();
     test_default_converter();
+    test_large_bitmaps();
+    test_scaler_filters();
 
     test_encoder(&testdata_32bppBGR, &CLSID_WICBmpEncoder,
                  &testdata_32bppBGR, &CLSID_WICBmpDecoder, "BMP encoder 32bppBGR");
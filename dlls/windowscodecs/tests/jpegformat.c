@@ -0,0 +1,263 @@
+/*
+ * Unit tests for the JPEG decoder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#define COBJMACROS
+
+#include "windef.h"
+#include "wincodec.h"
+#include "wine/test.h"
+
+static IWICImagingFactory *factory;
+
+#define TEST_WIDTH 120
+#define TEST_HEIGHT 90
+
+/* a smooth image, so that scaled down versions stay close to it */
+static BYTE test_pixel(UINT x, UINT y, UINT channel)
+{
+    switch (channel)
+    {
+    case 0: return x * 2;
+    case 1: return y * 2;
+    default: return (x + y);
+    }
+}
+
+static IWICBitmapDecoder *create_test_decoder(void)
+{
+    IWICBitmapEncoder *encoder;
+    IWICBitmapFrameEncode *frame;
+    IWICBitmapDecoder *decoder = NULL;
+    IPropertyBag2 *options;
+    WICPixelFormatGUID format;
+    LARGE_INTEGER seek;
+    IStream *stream;
+    BYTE *bits;
+    UINT x, y, c;
+    HRESULT hr;
+
+    bits = HeapAlloc(GetProcessHeap(), 0, TEST_WIDTH * TEST_HEIGHT * 3);
+    for (y = 0; y < TEST_HEIGHT; y++)
+        for (x = 0; x < TEST_WIDTH; x++)
+            for (c = 0; c < 3; c++)
+                bits[(y * TEST_WIDTH + x) * 3 + c] = test_pixel(x, y, c);
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStreamOnHGlobal error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatJpeg, NULL, &encoder);
+    ok(hr == S_OK, "CreateEncoder error %#x\n", hr);
+    hr = IWICBitmapEncoder_Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame, &options);
+    ok(hr == S_OK, "CreateNewFrame error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Initialize(frame, options);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_SetSize(frame, TEST_WIDTH, TEST_HEIGHT);
+    ok(hr == S_OK, "SetSize error %#x\n", hr);
+    format = GUID_WICPixelFormat24bppBGR;
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame, &format);
+    ok(hr == S_OK, "SetPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR), "got wrong format %s\n", wine_dbgstr_guid(&format));
+    hr = IWICBitmapFrameEncode_WritePixels(frame, TEST_HEIGHT, TEST_WIDTH * 3, TEST_WIDTH * TEST_HEIGHT * 3, bits);
+    ok(hr == S_OK, "WritePixels error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Commit(frame);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+
+    IPropertyBag2_Release(options);
+    IWICBitmapFrameEncode_Release(frame);
+    IWICBitmapEncoder_Release(encoder);
+    HeapFree(GetProcessHeap(), 0, bits);
+
+    seek.QuadPart = 0;
+    IStream_Seek(stream, seek, STREAM_SEEK_SET, NULL);
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+
+    IStream_Release(stream);
+    return decoder;
+}
+
+static void test_jpeg_rects(void)
+{
+    static const struct
+    {
+        INT y, height;
+    } rects[] = {
+        { 40, 8 }, { 48, 20 }, { 10, 5 }, { 80, 10 }, { 0, 1 }, { 89, 1 }, { 0, TEST_HEIGHT }
+    };
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    BYTE *full, *part;
+    WICRect rc;
+    UINT width, height, i, y;
+    HRESULT hr;
+
+    decoder = create_test_decoder();
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    hr = IWICBitmapFrameDecode_GetSize(frame, &width, &height);
+    ok(hr == S_OK, "GetSize error %#x\n", hr);
+    ok(width == TEST_WIDTH && height == TEST_HEIGHT, "got %ux%u\n", width, height);
+
+    full = HeapAlloc(GetProcessHeap(), 0, TEST_WIDTH * TEST_HEIGHT * 3);
+    part = HeapAlloc(GetProcessHeap(), 0, TEST_WIDTH * TEST_HEIGHT * 3);
+
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, TEST_WIDTH * 3, TEST_WIDTH * TEST_HEIGHT * 3, full);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+
+    /* rectangles out of order have to give the same rows as a full decode */
+    for (i = 0; i < sizeof(rects)/sizeof(rects[0]); i++)
+    {
+        rc.X = 3;
+        rc.Y = rects[i].y;
+        rc.Width = TEST_WIDTH - 5;
+        rc.Height = rects[i].height;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, TEST_WIDTH * 3, TEST_WIDTH * TEST_HEIGHT * 3, part);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+
+        for (y = 0; y < rc.Height; y++)
+            ok(!memcmp(part + y * TEST_WIDTH * 3, full + (rc.Y + y) * TEST_WIDTH * 3 + rc.X * 3, rc.Width * 3),
+               "%u: row %u differs\n", i, rc.Y + y);
+    }
+
+    rc.X = 0;
+    rc.Y = TEST_HEIGHT - 4;
+    rc.Width = TEST_WIDTH;
+    rc.Height = 5;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, TEST_WIDTH * 3, TEST_WIDTH * TEST_HEIGHT * 3, part);
+    ok(hr == E_INVALIDARG, "expected E_INVALIDARG, got %#x\n", hr);
+
+    HeapFree(GetProcessHeap(), 0, part);
+    HeapFree(GetProcessHeap(), 0, full);
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
+static void test_jpeg_source_transform(void)
+{
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapSourceTransform *transform;
+    WICPixelFormatGUID format;
+    UINT width, height, x, y, c, scale;
+    BOOL supported;
+    BYTE *bits;
+    int diff, max_diff;
+    HRESULT hr;
+
+    decoder = create_test_decoder();
+    if (!decoder) return;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    hr = IWICBitmapFrameDecode_QueryInterface(frame, &IID_IWICBitmapSourceTransform, (void **)&transform);
+    if (hr != S_OK)
+    {
+        win_skip("IWICBitmapSourceTransform is not supported\n");
+        IWICBitmapFrameDecode_Release(frame);
+        IWICBitmapDecoder_Release(decoder);
+        return;
+    }
+
+    hr = IWICBitmapSourceTransform_DoesSupportTransform(transform, WICBitmapTransformRotate0, &supported);
+    ok(hr == S_OK, "DoesSupportTransform error %#x\n", hr);
+    ok(supported, "expected Rotate0 to be supported\n");
+
+    format = GUID_WICPixelFormat24bppBGR;
+    hr = IWICBitmapSourceTransform_GetClosestPixelFormat(transform, &format);
+    ok(hr == S_OK, "GetClosestPixelFormat error %#x\n", hr);
+    ok(IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR), "got wrong format %s\n", wine_dbgstr_guid(&format));
+
+    width = height = 1;
+    hr = IWICBitmapSourceTransform_GetClosestSize(transform, &width, &height);
+    ok(hr == S_OK, "GetClosestSize error %#x\n", hr);
+    ok(width >= 1 && width <= TEST_WIDTH && height >= 1 && height <= TEST_HEIGHT,
+       "got %ux%u\n", width, height);
+
+    bits = HeapAlloc(GetProcessHeap(), 0, TEST_WIDTH * TEST_HEIGHT * 3);
+
+    for (scale = 1; scale <= 8; scale *= 2)
+    {
+        width = (TEST_WIDTH + scale - 1) / scale;
+        height = (TEST_HEIGHT + scale - 1) / scale;
+        hr = IWICBitmapSourceTransform_GetClosestSize(transform, &width, &height);
+        ok(hr == S_OK, "GetClosestSize error %#x\n", hr);
+        if (width != (TEST_WIDTH + scale - 1) / scale || height != (TEST_HEIGHT + scale - 1) / scale)
+        {
+            skip("1/%u scale is not supported, got %ux%u\n", scale, width, height);
+            continue;
+        }
+
+        hr = IWICBitmapSourceTransform_CopyPixels(transform, NULL, width, height, NULL,
+            WICBitmapTransformRotate0, width * 3, width * height * 3, bits);
+        ok(hr == S_OK, "1/%u: CopyPixels error %#x\n", scale, hr);
+        if (hr != S_OK) continue;
+
+        max_diff = 0;
+        for (y = 1; y < height - 1; y++)
+            for (x = 1; x < width - 1; x++)
+                for (c = 0; c < 3; c++)
+                {
+                    diff = abs(bits[(y * width + x) * 3 + c] -
+                               test_pixel(x * scale + scale / 2, y * scale + scale / 2, c));
+                    if (diff > max_diff) max_diff = diff;
+                }
+        ok(max_diff <= 24, "1/%u: pixels differ by %d\n", scale, max_diff);
+    }
+
+    hr = IWICBitmapSourceTransform_CopyPixels(transform, NULL, TEST_WIDTH - 1, TEST_HEIGHT, NULL,
+        WICBitmapTransformRotate0, TEST_WIDTH * 3, TEST_WIDTH * TEST_HEIGHT * 3, bits);
+    ok(hr == E_INVALIDARG, "expected E_INVALIDARG, got %#x\n", hr);
+
+    /* the frame still decodes at the full size */
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, TEST_WIDTH * 3, TEST_WIDTH * TEST_HEIGHT * 3, bits);
+    ok(hr == S_OK, "CopyPixels error %#x\n", hr);
+
+    HeapFree(GetProcessHeap(), 0, bits);
+    IWICBitmapSourceTransform_Release(transform);
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
+START_TEST(jpegformat)
+{
+    HRESULT hr;
+
+    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+                          &IID_IWICImagingFactory, (void **)&factory);
+    ok(hr == S_OK, "CoCreateInstance error %#x\n", hr);
+    if (FAILED(hr)) return;
+
+    test_jpeg_rects();
+    test_jpeg_source_transform();
+
+    IWICImagingFactory_Release(factory);
+    CoUninitialize();
+}
@@ -579,6 +579,103 @@ static void test_png_palette(void)
     IWICBitmapDecoder_Release(decoder);
 }
 
+static void test_png_rects(BOOL interlace)
+{
+    static const WCHAR interlace_option[] = {'I','n','t','e','r','l','a','c','e','O','p','t','i','o','n',0};
+    static const struct
+    {
+        INT y, height;
+    } rects[] = {
+        { 40, 8 }, { 48, 20 }, { 10, 5 }, { 80, 10 }, { 0, 1 }, { 89, 1 }, { 0, 90 }
+    };
+    const UINT width = 70, height = 90, stride = width * 3;
+    IWICBitmapEncoder *encoder;
+    IWICBitmapFrameEncode *frame_encode;
+    IWICBitmapDecoder *decoder;
+    IWICBitmapFrameDecode *frame;
+    IPropertyBag2 *options;
+    WICPixelFormatGUID format;
+    LARGE_INTEGER seek;
+    IStream *stream;
+    PROPBAG2 option;
+    VARIANT var;
+    BYTE *bits, *part;
+    WICRect rc;
+    UINT i, y;
+    HRESULT hr;
+
+    bits = HeapAlloc(GetProcessHeap(), 0, stride * height);
+    part = HeapAlloc(GetProcessHeap(), 0, stride * height);
+    for (i = 0; i < stride * height; i++)
+        bits[i] = i * 7 + i / stride;
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "CreateStreamOnHGlobal error %#x\n", hr);
+
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatPng, NULL, &encoder);
+    ok(hr == S_OK, "CreateEncoder error %#x\n", hr);
+    hr = IWICBitmapEncoder_Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame_encode, &options);
+    ok(hr == S_OK, "CreateNewFrame error %#x\n", hr);
+
+    memset(&option, 0, sizeof(option));
+    option.pstrName = (LPOLESTR)interlace_option;
+    V_VT(&var) = VT_BOOL;
+    V_BOOL(&var) = interlace ? VARIANT_TRUE : VARIANT_FALSE;
+    hr = IPropertyBag2_Write(options, 1, &option, &var);
+    ok(hr == S_OK, "Write error %#x\n", hr);
+
+    hr = IWICBitmapFrameEncode_Initialize(frame_encode, options);
+    ok(hr == S_OK, "Initialize error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_SetSize(frame_encode, width, height);
+    ok(hr == S_OK, "SetSize error %#x\n", hr);
+    format = GUID_WICPixelFormat24bppBGR;
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame_encode, &format);
+    ok(hr == S_OK, "SetPixelFormat error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_WritePixels(frame_encode, height, stride, stride * height, bits);
+    ok(hr == S_OK, "WritePixels error %#x\n", hr);
+    hr = IWICBitmapFrameEncode_Commit(frame_encode);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Commit error %#x\n", hr);
+
+    IPropertyBag2_Release(options);
+    IWICBitmapFrameEncode_Release(frame_encode);
+    IWICBitmapEncoder_Release(encoder);
+
+    seek.QuadPart = 0;
+    IStream_Seek(stream, seek, STREAM_SEEK_SET, NULL);
+    hr = IWICImagingFactory_CreateDecoderFromStream(factory, stream, NULL, 0, &decoder);
+    ok(hr == S_OK, "CreateDecoderFromStream error %#x\n", hr);
+    IStream_Release(stream);
+    if (FAILED(hr)) goto done;
+
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#x\n", hr);
+
+    /* rectangles out of order have to give the rows that were written */
+    for (i = 0; i < sizeof(rects)/sizeof(rects[0]); i++)
+    {
+        rc.X = 3;
+        rc.Y = rects[i].y;
+        rc.Width = width - 5;
+        rc.Height = rects[i].height;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rc, stride, stride * height, part);
+        ok(hr == S_OK, "%u: CopyPixels error %#x\n", i, hr);
+
+        for (y = 0; y < rc.Height; y++)
+            ok(!memcmp(part + y * stride, bits + (rc.Y + y) * stride + rc.X * 3, rc.Width * 3),
+               "%u: row %u differs\n", i, rc.Y + y);
+    }
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+done:
+    HeapFree(GetProcessHeap(), 0, part);
+    HeapFree(GetProcessHeap(), 0, bits);
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -591,6 +688,8 @@ START_TEST(pngformat)
 
     test_color_contexts();
     test_png_palette();
+    test_png_rects(FALSE);
+    test_png_rects(TRUE);
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
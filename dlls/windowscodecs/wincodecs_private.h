@@ -105,6 +105,25 @@ extern HRESULT copy_pixels(UINT bpp, const BYTE *srcbuffer,
     UINT srcwidth, UINT srcheight, INT srcstride,
     const WICRect *rc, UINT dststride, UINT dstbuffersize, BYTE *dstbuffer) DECLSPEC_HIDDEN;
 
+/* Scanlines of a progressively decoded image, from 'first' up to the
+ * current position of the decoder. */
+struct decoded_rows
+{
+    BYTE *bits;
+    UINT stride;
+    UINT first;
+    UINT count;
+    UINT size;
+};
+
+extern void decoded_rows_init(struct decoded_rows *rows, UINT stride) DECLSPEC_HIDDEN;
+extern void decoded_rows_free(struct decoded_rows *rows) DECLSPEC_HIDDEN;
+extern void decoded_rows_reset(struct decoded_rows *rows, UINT stride) DECLSPEC_HIDDEN;
+extern BYTE *decoded_rows_reserve(struct decoded_rows *rows, UINT count) DECLSPEC_HIDDEN;
+extern void decoded_rows_release(struct decoded_rows *rows, UINT row) DECLSPEC_HIDDEN;
+extern HRESULT decoded_rows_copy(const struct decoded_rows *rows, UINT bpp, UINT width,
+    const WICRect *rc, UINT dststride, UINT dstbuffersize, BYTE *dstbuffer) DECLSPEC_HIDDEN;
+
 extern HRESULT configure_write_source(IWICBitmapFrameEncode *iface,
     IWICBitmapSource *source, const WICRect *prc,
     const WICPixelFormatGUID *format,
@@ -119,6 +138,10 @@ extern void reverse_bgr8(UINT bytesperpixel, LPBYTE bits, UINT width, UINT heigh
 
 extern HRESULT get_pixelformat_bpp(const GUID *pixelformat, UINT *bpp) DECLSPEC_HIDDEN;
 
+extern UINT get_scanline_band_count(UINT width, UINT height) DECLSPEC_HIDDEN;
+extern void process_scanline_bands(UINT width, UINT height,
+    void (*func)(void *context, UINT start, UINT end), void *context) DECLSPEC_HIDDEN;
+
 extern HRESULT CreatePropertyBag2(PROPBAG2 *options, UINT count,
                                   IPropertyBag2 **property) DECLSPEC_HIDDEN;
 
@@ -452,6 +452,24 @@ static void context_generate_fbo_key(const struct wined3d_context *context,
         context_set_fbo_key_for_surface(context, key, i + 1, render_targets[i], color_location);
 }
 
+static unsigned int context_hash_fbo_key(const struct wined3d_fbo_entry_key *key, unsigned int object_count)
+{
+    const DWORD *data = (const DWORD *)key;
+    unsigned int i, size = FIELD_OFFSET(struct wined3d_fbo_entry_key, objects[object_count]) / sizeof(*data);
+    unsigned int hash = 2166136261u;
+
+    /* FNV-1a over the key dwords. */
+    for (i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 16777619u;
+
+    return hash ^ (hash >> 16);
+}
+
+static inline struct list *context_get_fbo_hash_bucket(struct wined3d_context *context, unsigned int hash)
+{
+    return &context->fbo_hash[hash & (WINED3D_FBO_HASH_SIZE - 1)];
+}
+
 static struct fbo_entry *context_create_fbo_entry(const struct wined3d_context *context,
         struct wined3d_surface **render_targets, struct wined3d_surface *depth_stencil,
         DWORD color_location, DWORD ds_location)
@@ -509,8 +527,11 @@ static void context_destroy_fbo_entry(struct wined3d_context *context, struct fb
         TRACE("Destroy FBO %u.\n", entry->id);
         context_destroy_fbo(context, entry->id);
     }
+    if (context->current_fbo == entry)
+        context->current_fbo = NULL;
     --context->fbo_entry_count;
     list_remove(&entry->entry);
+    list_remove(&entry->hash_entry);
     HeapFree(GetProcessHeap(), 0, entry);
 }
 
@@ -521,9 +542,11 @@ static struct fbo_entry *context_find_fbo_entry(struct wined3d_context *context,
 {
     const struct wined3d_gl_info *gl_info = context->gl_info;
     unsigned int object_count = gl_info->limits.buffers + 1;
+    struct wined3d_device *device = context->device;
     struct wined3d_texture *rt_texture, *ds_texture;
+    unsigned int i, hash, key_size;
     struct fbo_entry *entry;
-    unsigned int i;
+    struct list *bucket;
 
     if (depth_stencil && render_targets[0])
     {
@@ -583,16 +606,30 @@ static struct fbo_entry *context_find_fbo_entry(struct wined3d_context *context,
         }
     }
 
-    LIST_FOR_EACH_ENTRY(entry, &context->fbo_list, struct fbo_entry, entry)
+    key_size = FIELD_OFFSET(struct wined3d_fbo_entry_key, objects[object_count]);
+    hash = context_hash_fbo_key(context->fbo_key, object_count);
+
+    /* Render target changes frequently go back and forth between the same
+     * few attachment sets, so check the currently bound entry first. */
+    if ((entry = context->current_fbo) && entry->hash == hash && !memcmp(context->fbo_key, &entry->key, key_size))
     {
-        if (memcmp(context->fbo_key, &entry->key, FIELD_OFFSET(struct wined3d_fbo_entry_key, objects[object_count])))
+        ++device->fbo_stats.hits;
+        return entry;
+    }
+
+    bucket = context_get_fbo_hash_bucket(context, hash);
+    LIST_FOR_EACH_ENTRY(entry, bucket, struct fbo_entry, hash_entry)
+    {
+        if (entry->hash != hash || memcmp(context->fbo_key, &entry->key, key_size))
             continue;
 
+        ++device->fbo_stats.hits;
         list_remove(&entry->entry);
         list_add_head(&context->fbo_list, &entry->entry);
         return entry;
     }
 
+    ++device->fbo_stats.misses;
     if (context->fbo_entry_count < WINED3D_MAX_FBO_ENTRIES)
     {
         entry = context_create_fbo_entry(context, render_targets, depth_stencil, color_location, ds_location);
@@ -601,11 +638,16 @@ static struct fbo_entry *context_find_fbo_entry(struct wined3d_context *context,
     }
     else
     {
+        /* Evict the least recently used entry. */
+        ++device->fbo_stats.evictions;
         entry = LIST_ENTRY(list_tail(&context->fbo_list), struct fbo_entry, entry);
         context_reuse_fbo_entry(context, target, render_targets, depth_stencil, color_location, ds_location, entry);
         list_remove(&entry->entry);
         list_add_head(&context->fbo_list, &entry->entry);
+        list_remove(&entry->hash_entry);
     }
+    entry->hash = hash;
+    list_add_head(bucket, &entry->hash_entry);
 
     return entry;
 }
@@ -899,6 +941,8 @@ static void context_queue_fbo_entry_destruction(struct wined3d_context *context,
 {
     list_remove(&entry->entry);
     list_add_head(&context->fbo_destroy_list, &entry->entry);
+    list_remove(&entry->hash_entry);
+    list_init(&entry->hash_entry);
 }
 
 void context_resource_released(const struct wined3d_device *device,
@@ -1419,16 +1463,7 @@ static void context_enter(struct wined3d_context *context)
 
 void context_invalidate_state(struct wined3d_context *context, DWORD state)
 {
-    DWORD rep = context->state_table[state].representative;
-    DWORD idx;
-    BYTE shift;
-
-    if (isStateDirty(context, rep)) return;
-
-    context->dirtyArray[context->numDirtyEntries++] = rep;
-    idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
-    shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
-    context->isStateDirty[idx] |= (1u << shift);
+    context_mark_state_dirty(context, context->state_table[state].representative);
 }
 
 /* This function takes care of wined3d pixel format selection. */
@@ -1662,7 +1697,7 @@ struct wined3d_context *context_create(struct wined3d_swapchain *swapchain,
     HGLRC ctx, share_ctx;
     DWORD target_usage;
     int pixel_format;
-    unsigned int s;
+    unsigned int i, s;
     DWORD state;
     HDC hdc = 0;
 
@@ -1704,6 +1739,8 @@ struct wined3d_context *context_create(struct wined3d_swapchain *swapchain,
     list_init(&ret->event_queries);
     list_init(&ret->fbo_list);
     list_init(&ret->fbo_destroy_list);
+    for (i = 0; i < WINED3D_FBO_HASH_SIZE; ++i)
+        list_init(&ret->fbo_hash[i]);
 
     if (!device->shader_backend->shader_allocate_context_data(ret))
     {
@@ -2052,6 +2089,8 @@ void context_destroy(struct wined3d_device *device, struct wined3d_context *cont
     BOOL destroy;
 
     TRACE("Destroying ctx %p\n", context);
+    TRACE_(d3d_perf)("Device %p FBO cache: %u hits, %u misses, %u evictions.\n", device,
+            device->fbo_stats.hits, device->fbo_stats.misses, device->fbo_stats.evictions);
 
     /* We delay destroying a context when it is active. The context_release()
      * function invokes context_destroy() again while leaving the last level. */
@@ -3579,11 +3618,140 @@ static void context_bind_unordered_access_views(struct wined3d_context *context,
     checkGLcall("Bind unordered access views");
 }
 
+static enum wined3d_state_class context_get_state_class(DWORD rep)
+{
+    if (STATE_IS_RENDER(rep))
+        return WINED3D_STATE_CLASS_RENDER;
+    if (STATE_IS_TEXTURESTAGE(rep))
+        return WINED3D_STATE_CLASS_TEXTURE_STAGE;
+    if (STATE_IS_SAMPLER(rep))
+        return WINED3D_STATE_CLASS_SAMPLER;
+    if (STATE_IS_SHADER(rep) || STATE_IS_CONSTANT_BUFFER(rep))
+        return WINED3D_STATE_CLASS_SHADER;
+    if (STATE_IS_SHADER_RESOURCE_BINDING(rep) || STATE_IS_UNORDERED_ACCESS_VIEW_BINDING(rep))
+        return WINED3D_STATE_CLASS_RESOURCE_BINDING;
+    if (STATE_IS_TRANSFORM(rep))
+        return WINED3D_STATE_CLASS_TRANSFORM;
+    if (STATE_IS_STREAMSRC(rep) || STATE_IS_INDEXBUFFER(rep) || STATE_IS_VDECL(rep)
+            || STATE_IS_BASEVERTEXINDEX(rep))
+        return WINED3D_STATE_CLASS_VERTEX_INPUT;
+    if (STATE_IS_VIEWPORT(rep) || STATE_IS_SCISSORRECT(rep))
+        return WINED3D_STATE_CLASS_VIEWPORT;
+    if (STATE_IS_LIGHT_TYPE(rep) || STATE_IS_ACTIVELIGHT(rep) || STATE_IS_MATERIAL(rep))
+        return WINED3D_STATE_CLASS_LIGHTING;
+    if (STATE_IS_CLIPPLANE(rep))
+        return WINED3D_STATE_CLASS_CLIP_PLANE;
+    if (STATE_IS_FRAMEBUFFER(rep))
+        return WINED3D_STATE_CLASS_FRAMEBUFFER;
+    return WINED3D_STATE_CLASS_OTHER;
+}
+
+/* Applies all dirty states. The bitmap is scanned a word at a time, and each
+ * state is marked clean right before it is applied, so that state handlers
+ * can still check which other states are pending. Handlers may dirty further
+ * states, including ones in words that were already scanned, so keep going
+ * until no dirty states are left.
+ *
+ * States are applied in state index order rather than in the order they were
+ * invalidated. The invalidation order is the order in which the application
+ * happened to change state, so handlers can't depend on it; they only use
+ * isStateDirty() to leave work to a handler that is still pending, or to
+ * reapply a dependent state that is not. Both hold for any order. New
+ * contexts already applied all states in index order. */
+static void context_apply_dirty_states(struct wined3d_context *context, const struct wined3d_state *state)
+{
+    const unsigned int bits = sizeof(*context->isStateDirty) * CHAR_BIT;
+    const struct StateEntry *state_table = context->state_table;
+    unsigned int i, shift;
+    DWORD map, rep;
+
+    for (i = 0; context->numDirtyEntries; i = (i + 1) % ARRAY_SIZE(context->isStateDirty))
+    {
+        while ((map = context->isStateDirty[i]))
+        {
+            shift = wined3d_bit_scan(&map);
+            context->isStateDirty[i] &= ~(1u << shift);
+            --context->numDirtyEntries;
+            rep = i * bits + shift;
+            state_table[rep].apply(context, state, rep);
+        }
+    }
+}
+
+/* Same as context_apply_dirty_states(), but accounts the CPU time spent in
+ * the state handlers to the state classes. */
+static void context_apply_dirty_states_timed(struct wined3d_context *context, const struct wined3d_state *state)
+{
+    const unsigned int bits = sizeof(*context->isStateDirty) * CHAR_BIT;
+    const struct StateEntry *state_table = context->state_table;
+    struct wined3d_device *device = context->device;
+    LARGE_INTEGER start, end;
+    enum wined3d_state_class state_class;
+    unsigned int i, shift;
+    DWORD map, rep;
+
+    for (i = 0; context->numDirtyEntries; i = (i + 1) % ARRAY_SIZE(context->isStateDirty))
+    {
+        while ((map = context->isStateDirty[i]))
+        {
+            shift = wined3d_bit_scan(&map);
+            context->isStateDirty[i] &= ~(1u << shift);
+            --context->numDirtyEntries;
+            rep = i * bits + shift;
+
+            QueryPerformanceCounter(&start);
+            state_table[rep].apply(context, state, rep);
+            QueryPerformanceCounter(&end);
+
+            state_class = context_get_state_class(rep);
+            device->state_stats.time[state_class] += end.QuadPart - start.QuadPart;
+            ++device->state_stats.count[state_class];
+        }
+    }
+    ++device->state_stats.draws;
+}
+
+void context_report_state_stats(struct wined3d_device *device)
+{
+    static const char * const class_names[] =
+    {
+        "render",
+        "texture stage",
+        "sampler",
+        "shader",
+        "resource binding",
+        "transform",
+        "vertex input",
+        "viewport",
+        "lighting",
+        "clip plane",
+        "framebuffer",
+        "other",
+    };
+    C_ASSERT(ARRAY_SIZE(class_names) == WINED3D_STATE_CLASS_COUNT);
+    LARGE_INTEGER frequency;
+    unsigned int i;
+
+    if (!device->state_stats.draws)
+        return;
+
+    QueryPerformanceFrequency(&frequency);
+    TRACE_(d3d_perf)("Device %p applied state for %u draws this frame.\n", device, device->state_stats.draws);
+    for (i = 0; i < WINED3D_STATE_CLASS_COUNT; ++i)
+    {
+        if (!device->state_stats.count[i])
+            continue;
+        TRACE_(d3d_perf)("    %s: %u states, %s us.\n", class_names[i], device->state_stats.count[i],
+                wine_dbgstr_longlong(device->state_stats.time[i] * 1000000 / frequency.QuadPart));
+    }
+
+    memset(&device->state_stats, 0, sizeof(device->state_stats));
+}
+
 /* Context activation is done by the caller. */
 BOOL context_apply_draw_state(struct wined3d_context *context,
         const struct wined3d_device *device, const struct wined3d_state *state)
 {
-    const struct StateEntry *state_table = context->state_table;
     const struct wined3d_fb_state *fb = state->fb;
     unsigned int i;
     WORD map;
@@ -3628,14 +3796,10 @@ BOOL context_apply_draw_state(struct wined3d_context *context,
             wined3d_buffer_load_sysmem(state->index_buffer, context);
     }
 
-    for (i = 0; i < context->numDirtyEntries; ++i)
-    {
-        DWORD rep = context->dirtyArray[i];
-        DWORD idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
-        BYTE shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
-        context->isStateDirty[idx] &= ~(1u << shift);
-        state_table[rep].apply(context, state, rep);
-    }
+    if (TRACE_ON(d3d_perf))
+        context_apply_dirty_states_timed(context, state);
+    else
+        context_apply_dirty_states(context, state);
 
     if (context->shader_update_mask)
     {
@@ -3666,7 +3830,6 @@ BOOL context_apply_draw_state(struct wined3d_context *context,
         context_check_fbo_status(context, GL_FRAMEBUFFER);
     }
 
-    context->numDirtyEntries = 0; /* This makes the whole list clean */
     context->last_was_blit = FALSE;
 
     return TRUE;
@@ -5212,21 +5212,10 @@ err:
 void device_invalidate_state(const struct wined3d_device *device, DWORD state)
 {
     DWORD rep = device->StateTable[state].representative;
-    struct wined3d_context *context;
-    DWORD idx;
-    BYTE shift;
     UINT i;
 
     for (i = 0; i < device->context_count; ++i)
-    {
-        context = device->contexts[i];
-        if(isStateDirty(context, rep)) continue;
-
-        context->dirtyArray[context->numDirtyEntries++] = rep;
-        idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
-        shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
-        context->isStateDirty[idx] |= (1u << shift);
-    }
+        context_mark_state_dirty(device->contexts[i], rep);
 }
 
 LRESULT device_process_message(struct wined3d_device *device, HWND window, BOOL unicode,
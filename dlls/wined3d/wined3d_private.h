@@ -1425,6 +1425,23 @@ DWORD get_flexible_vertex_size(DWORD d3dvtVertexType) DECLSPEC_HIDDEN;
 
 #define STATE_HIGHEST (STATE_COLOR_KEY)
 
+enum wined3d_state_class
+{
+    WINED3D_STATE_CLASS_RENDER,
+    WINED3D_STATE_CLASS_TEXTURE_STAGE,
+    WINED3D_STATE_CLASS_SAMPLER,
+    WINED3D_STATE_CLASS_SHADER,
+    WINED3D_STATE_CLASS_RESOURCE_BINDING,
+    WINED3D_STATE_CLASS_TRANSFORM,
+    WINED3D_STATE_CLASS_VERTEX_INPUT,
+    WINED3D_STATE_CLASS_VIEWPORT,
+    WINED3D_STATE_CLASS_LIGHTING,
+    WINED3D_STATE_CLASS_CLIP_PLANE,
+    WINED3D_STATE_CLASS_FRAMEBUFFER,
+    WINED3D_STATE_CLASS_OTHER,
+    WINED3D_STATE_CLASS_COUNT,
+};
+
 enum fogsource {
     FOGSOURCE_FFP,
     FOGSOURCE_VS,
@@ -1520,12 +1537,10 @@ struct wined3d_context
     const struct wined3d_d3d_info *d3d_info;
     const struct StateEntry *state_table;
     /* State dirtification
-     * dirtyArray is an array that contains markers for dirty states. numDirtyEntries states are dirty, their numbers are in indices
-     * 0...numDirtyEntries - 1. isStateDirty is a redundant copy of the dirtyArray. Technically only one of them would be needed,
-     * but with the help of both it is easy to find out if a state is dirty(just check the array index), and for applying dirty states
-     * only numDirtyEntries array elements have to be checked, not STATE_HIGHEST states.
+     * isStateDirty is a bitmap of the dirty representative states, numDirtyEntries is the number of bits set in it.
+     * The STATE_* ranges keep states of the same class next to each other, so applying dirty states only has to
+     * look at the set bits of the non-zero words instead of checking all STATE_HIGHEST states.
      */
-    DWORD                   dirtyArray[STATE_HIGHEST + 1]; /* Won't get bigger than that, a state is never marked dirty 2 times */
     DWORD                   numDirtyEntries;
     DWORD isStateDirty[STATE_HIGHEST / (sizeof(DWORD) * CHAR_BIT) + 1]; /* Bitmap to find out quickly if a state is dirty */
 
@@ -1597,8 +1612,10 @@ struct wined3d_context
     void *fragment_pipe_data;
 
     /* FBOs */
+#define WINED3D_FBO_HASH_SIZE 32
     UINT                    fbo_entry_count;
-    struct list             fbo_list;
+    struct list             fbo_list; /* Most recently used first. */
+    struct list             fbo_hash[WINED3D_FBO_HASH_SIZE];
     struct list             fbo_destroy_list;
     struct fbo_entry        *current_fbo;
     GLuint                  fbo_read_binding;
@@ -1809,6 +1826,7 @@ void context_gl_resource_released(struct wined3d_device *device,
         GLuint name, BOOL rb_namespace) DECLSPEC_HIDDEN;
 void context_invalidate_state(struct wined3d_context *context, DWORD state_id) DECLSPEC_HIDDEN;
 void context_release(struct wined3d_context *context) DECLSPEC_HIDDEN;
+void context_report_state_stats(struct wined3d_device *device) DECLSPEC_HIDDEN;
 void context_resource_released(const struct wined3d_device *device,
         struct wined3d_resource *resource, enum wined3d_resource_type type) DECLSPEC_HIDDEN;
 void context_restore(struct wined3d_context *context, struct wined3d_surface *restore) DECLSPEC_HIDDEN;
@@ -2609,6 +2627,23 @@ struct wined3d_device
     /* Context management */
     struct wined3d_context **contexts;
     UINT context_count;
+
+    /* FBO cache statistics, accumulated over all contexts */
+    struct
+    {
+        unsigned int hits;
+        unsigned int misses;
+        unsigned int evictions;
+    } fbo_stats;
+
+    /* State application statistics for the current frame, only gathered
+     * when d3d_perf tracing is enabled */
+    struct
+    {
+        LONGLONG time[WINED3D_STATE_CLASS_COUNT];
+        unsigned int count[WINED3D_STATE_CLASS_COUNT];
+        unsigned int draws;
+    } state_stats;
 };
 
 void device_clear_render_targets(struct wined3d_device *device, UINT rt_count, const struct wined3d_fb_state *fb,
@@ -2634,6 +2669,27 @@ static inline BOOL isStateDirty(const struct wined3d_context *context, DWORD sta
     return context->isStateDirty[idx] & (1u << shift);
 }
 
+static inline void context_mark_state_dirty(struct wined3d_context *context, DWORD rep)
+{
+    DWORD idx = rep / (sizeof(*context->isStateDirty) * CHAR_BIT);
+    BYTE shift = rep & ((sizeof(*context->isStateDirty) * CHAR_BIT) - 1);
+
+    if (context->isStateDirty[idx] & (1u << shift))
+        return;
+
+    context->isStateDirty[idx] |= (1u << shift);
+    ++context->numDirtyEntries;
+}
+
+/* Returns the index of the lowest set bit and clears it. */
+static inline unsigned int wined3d_bit_scan(DWORD *x)
+{
+    unsigned int bit_offset = ffs(*x) - 1;
+
+    *x ^= 1u << bit_offset;
+    return bit_offset;
+}
+
 #define WINED3D_RESOURCE_ACCESS_GPU     0x1
 #define WINED3D_RESOURCE_ACCESS_CPU     0x2
 
@@ -2927,6 +2983,8 @@ struct wined3d_fbo_resource
 struct fbo_entry
 {
     struct list entry;
+    struct list hash_entry;
+    unsigned int hash;
     DWORD flags;
     DWORD rt_mask;
     GLuint id;
@@ -57,6 +57,7 @@
 #include "winsock2.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(winhttp);
+WINE_DECLARE_DEBUG_CHANNEL(dnscache);
 
 #ifndef HAVE_GETADDRINFO
 
@@ -296,8 +297,11 @@ BOOL netconn_init( netconn_t *conn )
     return TRUE;
 }
 
+static void clear_resolve_cache( void );
+
 void netconn_unload( void )
 {
+    clear_resolve_cache();
     if(cred_handle_initialized)
         FreeCredentialsHandle(&cred_handle);
     DeleteCriticalSection(&init_sechandle_cs);
@@ -311,6 +315,21 @@ BOOL netconn_connected( netconn_t *conn )
     return (conn->socket != -1);
 }
 
+/* check that an idle connection hasn't been closed by the server */
+BOOL netconn_is_alive( netconn_t *conn )
+{
+    ULONG state = 1;
+    char b;
+    int len, err = 0;
+
+    ioctlsocket( conn->socket, FIONBIO, &state );
+    if ((len = sock_recv( conn->socket, &b, 1, MSG_PEEK )) == -1) err = sock_get_error( errno );
+    state = 0;
+    ioctlsocket( conn->socket, FIONBIO, &state );
+
+    return len == 1 || err == WSAEWOULDBLOCK;
+}
+
 BOOL netconn_create( netconn_t *conn, int domain, int type, int protocol )
 {
     if ((conn->socket = socket( domain, type, protocol )) == -1)
@@ -328,13 +347,10 @@ BOOL netconn_close( netconn_t *conn )
 
     if (conn->secure)
     {
-        heap_free( conn->peek_msg_mem );
-        conn->peek_msg_mem = NULL;
         conn->peek_msg = NULL;
         conn->peek_len = 0;
         heap_free(conn->ssl_buf);
         conn->ssl_buf = NULL;
-        heap_free(conn->extra_buf);
         conn->extra_buf = NULL;
         conn->extra_len = 0;
         DeleteSecurityContext(&conn->ssl_ctx);
@@ -410,6 +426,28 @@ BOOL netconn_connect( netconn_t *conn, const struct sockaddr *sockaddr, unsigned
     return ret;
 }
 
+/* ssl_buf holds this many records for receiving, followed by as many for
+ * sending, so that a single recv or send can carry several of them and
+ * received records can be decrypted in place without further copies */
+#define SSL_BUF_RECORDS 4
+
+static inline SIZE_T ssl_record_size( const netconn_t *conn )
+{
+    return conn->ssl_sizes.cbHeader + conn->ssl_sizes.cbMaximumMessage + conn->ssl_sizes.cbTrailer;
+}
+
+static inline char *ssl_send_buf( const netconn_t *conn )
+{
+    return conn->ssl_buf + SSL_BUF_RECORDS * ssl_record_size( conn );
+}
+
+/* whether the buffered data starts with a complete TLS record */
+static BOOL have_ssl_record( const char *data, SIZE_T len )
+{
+    const BYTE *ptr = (const BYTE *)data;
+    return len >= 5 && len >= 5 + ((ptr[3] << 8) | ptr[4]);
+}
+
 BOOL netconn_secure_connect( netconn_t *conn, WCHAR *hostname )
 {
     SecBuffer out_buf = {0, SECBUFFER_TOKEN, NULL}, in_bufs[2] = {{0, SECBUFFER_TOKEN}, {0, SECBUFFER_EMPTY}};
@@ -521,7 +559,7 @@ BOOL netconn_secure_connect( netconn_t *conn, WCHAR *hostname )
                 break;
             }
 
-            conn->ssl_buf = heap_alloc(conn->ssl_sizes.cbHeader + conn->ssl_sizes.cbMaximumMessage + conn->ssl_sizes.cbTrailer);
+            conn->ssl_buf = heap_alloc(2 * SSL_BUF_RECORDS * ssl_record_size(conn));
             if(!conn->ssl_buf) {
                 res = GetLastError();
                 break;
@@ -547,12 +585,12 @@ BOOL netconn_secure_connect( netconn_t *conn, WCHAR *hostname )
     return TRUE;
 }
 
-static BOOL send_ssl_chunk(netconn_t *conn, const void *msg, size_t size)
+static BOOL encrypt_ssl_chunk(netconn_t *conn, char *out, const void *msg, size_t size, size_t *out_len)
 {
     SecBuffer bufs[4] = {
-        {conn->ssl_sizes.cbHeader, SECBUFFER_STREAM_HEADER, conn->ssl_buf},
-        {size,  SECBUFFER_DATA, conn->ssl_buf+conn->ssl_sizes.cbHeader},
-        {conn->ssl_sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, conn->ssl_buf+conn->ssl_sizes.cbHeader+size},
+        {conn->ssl_sizes.cbHeader, SECBUFFER_STREAM_HEADER, out},
+        {size,  SECBUFFER_DATA, out+conn->ssl_sizes.cbHeader},
+        {conn->ssl_sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, out+conn->ssl_sizes.cbHeader+size},
         {0, SECBUFFER_EMPTY, NULL}
     };
     SecBufferDesc buf_desc = {SECBUFFER_VERSION, sizeof(bufs)/sizeof(*bufs), bufs};
@@ -565,11 +603,7 @@ static BOOL send_ssl_chunk(netconn_t *conn, const void *msg, size_t size)
         return FALSE;
     }
 
-    if(sock_send(conn->socket, conn->ssl_buf, bufs[0].cbBuffer+bufs[1].cbBuffer+bufs[2].cbBuffer, 0) < 1) {
-        WARN("send failed\n");
-        return FALSE;
-    }
-
+    *out_len = bufs[0].cbBuffer+bufs[1].cbBuffer+bufs[2].cbBuffer;
     return TRUE;
 }
 
@@ -578,19 +612,31 @@ BOOL netconn_send( netconn_t *conn, const void *msg, size_t len, int *sent )
     if (!netconn_connected( conn )) return FALSE;
     if (conn->secure)
     {
+        const SIZE_T record_size = ssl_record_size(conn);
         const BYTE *ptr = msg;
-        size_t chunk_size;
+        size_t chunk_size, enc_size, buf_len, batch;
 
         *sent = 0;
 
         while(len) {
-            chunk_size = min(len, conn->ssl_sizes.cbMaximumMessage);
-            if(!send_ssl_chunk(conn, ptr, chunk_size))
-                return FALSE;
+            /* encrypt as many records as fit in ssl_buf and send them at once */
+            buf_len = batch = 0;
+            while(len && buf_len + record_size <= SSL_BUF_RECORDS * record_size) {
+                chunk_size = min(len, conn->ssl_sizes.cbMaximumMessage);
+                if(!encrypt_ssl_chunk(conn, ssl_send_buf(conn)+buf_len, ptr, chunk_size, &enc_size))
+                    return FALSE;
 
-            *sent += chunk_size;
-            ptr += chunk_size;
-            len -= chunk_size;
+                buf_len += enc_size;
+                batch += chunk_size;
+                ptr += chunk_size;
+                len -= chunk_size;
+            }
+
+            if(sock_send(conn->socket, ssl_send_buf(conn), buf_len, 0) < 1) {
+                WARN("send failed\n");
+                return FALSE;
+            }
+            *sent += batch;
         }
 
         return TRUE;
@@ -603,25 +649,30 @@ BOOL netconn_send( netconn_t *conn, const void *msg, size_t len, int *sent )
     return TRUE;
 }
 
+/* Records are decrypted in place in ssl_buf. Whatever is left of the
+ * plaintext is kept there as the peek buffer and the following records as the
+ * extra buffer, so that data is only copied once, into the caller's buffer. */
 static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, SIZE_T *ret_size, BOOL *eof)
 {
-    const SIZE_T ssl_buf_size = conn->ssl_sizes.cbHeader+conn->ssl_sizes.cbMaximumMessage+conn->ssl_sizes.cbTrailer;
+    const SIZE_T ssl_buf_size = SSL_BUF_RECORDS * ssl_record_size(conn);
     SecBuffer bufs[4];
     SecBufferDesc buf_desc = {SECBUFFER_VERSION, sizeof(bufs)/sizeof(*bufs), bufs};
     SSIZE_T size, buf_len;
+    char *data;
     unsigned int i;
     SECURITY_STATUS res;
 
     assert(conn->extra_len < ssl_buf_size);
+    assert(!conn->peek_len);
 
     if(conn->extra_len) {
-        memcpy(conn->ssl_buf, conn->extra_buf, conn->extra_len);
+        data = conn->extra_buf;
         buf_len = conn->extra_len;
-        conn->extra_len = 0;
-        heap_free(conn->extra_buf);
         conn->extra_buf = NULL;
+        conn->extra_len = 0;
     }else {
-        buf_len = sock_recv(conn->socket, conn->ssl_buf+conn->extra_len, ssl_buf_size-conn->extra_len, 0);
+        data = conn->ssl_buf;
+        buf_len = sock_recv(conn->socket, data, ssl_buf_size, 0);
         if(buf_len < 0) {
             WARN("recv failed\n");
             return FALSE;
@@ -640,7 +691,7 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, SIZE_T *
         memset(bufs, 0, sizeof(bufs));
         bufs[0].BufferType = SECBUFFER_DATA;
         bufs[0].cbBuffer = buf_len;
-        bufs[0].pvBuffer = conn->ssl_buf;
+        bufs[0].pvBuffer = data;
 
         res = DecryptMessage(&conn->ssl_ctx, &buf_desc, 0, NULL);
         switch(res) {
@@ -651,9 +702,14 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, SIZE_T *
             *eof = TRUE;
             return TRUE;
         case SEC_E_INCOMPLETE_MESSAGE:
+            /* move the partial record to the front to make room for the rest */
+            if(data != conn->ssl_buf) {
+                memmove(conn->ssl_buf, data, buf_len);
+                data = conn->ssl_buf;
+            }
             assert(buf_len < ssl_buf_size);
 
-            size = sock_recv(conn->socket, conn->ssl_buf+buf_len, ssl_buf_size-buf_len, 0);
+            size = sock_recv(conn->socket, data+buf_len, ssl_buf_size-buf_len, 0);
             if(size < 1)
                 return FALSE;
 
@@ -670,12 +726,8 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, SIZE_T *
             size = min(buf_size, bufs[i].cbBuffer);
             memcpy(buf, bufs[i].pvBuffer, size);
             if(size < bufs[i].cbBuffer) {
-                assert(!conn->peek_len);
-                conn->peek_msg_mem = conn->peek_msg = heap_alloc(bufs[i].cbBuffer - size);
-                if(!conn->peek_msg)
-                    return FALSE;
+                conn->peek_msg = (char*)bufs[i].pvBuffer+size;
                 conn->peek_len = bufs[i].cbBuffer-size;
-                memcpy(conn->peek_msg, (char*)bufs[i].pvBuffer+size, conn->peek_len);
             }
 
             *ret_size = size;
@@ -684,12 +736,8 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, SIZE_T *
 
     for(i=0; i < sizeof(bufs)/sizeof(*bufs); i++) {
         if(bufs[i].BufferType == SECBUFFER_EXTRA) {
-            conn->extra_buf = heap_alloc(bufs[i].cbBuffer);
-            if(!conn->extra_buf)
-                return FALSE;
-
+            conn->extra_buf = bufs[i].pvBuffer;
             conn->extra_len = bufs[i].cbBuffer;
-            memcpy(conn->extra_buf, bufs[i].pvBuffer, conn->extra_len);
         }
     }
 
@@ -714,12 +762,7 @@ BOOL netconn_recv( netconn_t *conn, void *buf, size_t len, int flags, int *recvd
             conn->peek_len -= *recvd;
             conn->peek_msg += *recvd;
 
-            if (conn->peek_len == 0)
-            {
-                heap_free( conn->peek_msg_mem );
-                conn->peek_msg_mem = NULL;
-                conn->peek_msg = NULL;
-            }
+            if (conn->peek_len == 0) conn->peek_msg = NULL;
             /* check if we have enough data from the peek buffer */
             if (!(flags & MSG_WAITALL) || *recvd == len) return TRUE;
         }
@@ -740,7 +783,8 @@ BOOL netconn_recv( netconn_t *conn, void *buf, size_t len, int flags, int *recvd
             }
 
             size += cread;
-        }while(!size || ((flags & MSG_WAITALL) && size < len));
+            /* keep going without blocking while whole records are already buffered */
+        }while(!size || (size < len && ((flags & MSG_WAITALL) || have_ssl_record(conn->extra_buf, conn->extra_len))));
 
         TRACE("received %ld bytes\n", size);
         *recvd = size;
@@ -781,7 +825,7 @@ DWORD netconn_set_timeout( netconn_t *netconn, BOOL send, int value )
     return ERROR_SUCCESS;
 }
 
-static DWORD resolve_hostname( const WCHAR *hostnameW, INTERNET_PORT port, struct sockaddr *sa, socklen_t *sa_len )
+static DWORD resolve_hostname( const WCHAR *hostnameW, struct sockaddr *sa, socklen_t *sa_len )
 {
     char *hostname;
 #ifdef HAVE_GETADDRINFO
@@ -823,16 +867,6 @@ static DWORD resolve_hostname( const WCHAR *hostnameW, INTERNET_PORT port, struc
     }
     *sa_len = res->ai_addrlen;
     memcpy( sa, res->ai_addr, res->ai_addrlen );
-    /* Copy port */
-    switch (res->ai_family)
-    {
-    case AF_INET:
-        ((struct sockaddr_in *)sa)->sin_port = htons( port );
-        break;
-    case AF_INET6:
-        ((struct sockaddr_in6 *)sa)->sin6_port = htons( port );
-        break;
-    }
 
     freeaddrinfo( res );
     return ERROR_SUCCESS;
@@ -857,51 +891,199 @@ static DWORD resolve_hostname( const WCHAR *hostnameW, INTERNET_PORT port, struc
     memset( sa, 0, sizeof(struct sockaddr_in) );
     memcpy( &sin->sin_addr, he->h_addr, he->h_length );
     sin->sin_family = he->h_addrtype;
-    sin->sin_port = htons( port );
 
     LeaveCriticalSection( &cs_gethostbyname );
     return ERROR_SUCCESS;
 #endif
 }
 
-struct resolve_args
+/*
+ * Host names are resolved by the thread pool, and the results are cached
+ * process-wide for a short while, failures for a shorter one. Concurrent
+ * lookups of the same name share a single resolver query.
+ */
+#define RESOLVE_CACHE_TTL          60000 /* ms */
+#define RESOLVE_CACHE_NEGATIVE_TTL 5000  /* ms */
+#define RESOLVE_CACHE_SIZE         64
+
+struct resolve_entry
 {
-    const WCHAR     *hostname;
-    INTERNET_PORT    port;
-    struct sockaddr *sa;
-    socklen_t       *sa_len;
+    struct list             entry;
+    LONG                    refs;
+    WCHAR                  *hostname;
+    HANDLE                  done;    /* signaled once the lookup completed */
+    BOOL                    pending;
+    DWORD                   error;
+    struct sockaddr_storage addr;
+    socklen_t               addr_len;
+    ULONGLONG               expires;
 };
 
-static DWORD CALLBACK resolve_proc( LPVOID arg )
+static struct list resolve_cache = LIST_INIT( resolve_cache );
+static unsigned int resolve_cache_count;
+static unsigned int resolve_cache_hits, resolve_cache_misses, resolve_cache_coalesced;
+
+static CRITICAL_SECTION resolve_cache_cs;
+static CRITICAL_SECTION_DEBUG resolve_cache_cs_debug =
 {
-    struct resolve_args *ra = arg;
-    return resolve_hostname( ra->hostname, ra->port, ra->sa, ra->sa_len );
+    0, 0, &resolve_cache_cs,
+    { &resolve_cache_cs_debug.ProcessLocksList, &resolve_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": resolve_cache_cs") }
+};
+static CRITICAL_SECTION resolve_cache_cs = { &resolve_cache_cs_debug, -1, 0, 0, 0, 0 };
+
+static void release_resolve_entry( struct resolve_entry *entry )
+{
+    if (InterlockedDecrement( &entry->refs )) return;
+    if (entry->done) CloseHandle( entry->done );
+    heap_free( entry->hostname );
+    heap_free( entry );
 }
 
-BOOL netconn_resolve( WCHAR *hostname, INTERNET_PORT port, struct sockaddr *sa, socklen_t *sa_len, int timeout )
+/* must be called with resolve_cache_cs held */
+static void remove_resolve_entry( struct resolve_entry *entry )
 {
-    DWORD ret;
+    list_remove( &entry->entry );
+    resolve_cache_count--;
+    release_resolve_entry( entry );
+}
+
+/* drop expired entries, and the oldest ones if the cache is full */
+/* must be called with resolve_cache_cs held */
+static void trim_resolve_cache( ULONGLONG now )
+{
+    struct resolve_entry *entry, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( entry, next, &resolve_cache, struct resolve_entry, entry )
+    {
+        if (resolve_cache_count <= RESOLVE_CACHE_SIZE && entry->expires > now) continue;
+        if (!entry->pending) remove_resolve_entry( entry );
+    }
+}
+
+static void CALLBACK resolve_proc( TP_CALLBACK_INSTANCE *instance, void *arg )
+{
+    struct resolve_entry *entry = arg;
+    socklen_t len = sizeof(entry->addr);
+    DWORD error;
+    ULONGLONG now;
+
+    error = resolve_hostname( entry->hostname, (struct sockaddr *)&entry->addr, &len );
+    now = GetTickCount64();
+
+    EnterCriticalSection( &resolve_cache_cs );
+    entry->error = error;
+    entry->addr_len = len;
+    if (!error) entry->expires = now + RESOLVE_CACHE_TTL;
+    else if (error == ERROR_WINHTTP_NAME_NOT_RESOLVED) entry->expires = now + RESOLVE_CACHE_NEGATIVE_TTL;
+    else entry->expires = now;
+    entry->pending = FALSE;
+    LeaveCriticalSection( &resolve_cache_cs );
+
+    SetEvent( entry->done );
+    release_resolve_entry( entry );
+}
+
+/* find the cache entry for a host name, starting a lookup if needed */
+static struct resolve_entry *get_resolve_entry( const WCHAR *hostname )
+{
+    struct resolve_entry *entry;
+    TP_CALLBACK_ENVIRON env;
+    ULONGLONG now;
+
+    EnterCriticalSection( &resolve_cache_cs );
+    now = GetTickCount64();
+    LIST_FOR_EACH_ENTRY( entry, &resolve_cache, struct resolve_entry, entry )
+    {
+        if (strcmpiW( entry->hostname, hostname )) continue;
+        if (entry->pending || entry->expires > now)
+        {
+            InterlockedIncrement( &entry->refs );
+            if (entry->pending) resolve_cache_coalesced++;
+            else resolve_cache_hits++;
+            TRACE_(dnscache)( "%s: %s, hits %u, misses %u, coalesced %u\n", debugstr_w(hostname),
+                              entry->pending ? "pending" : "hit", resolve_cache_hits,
+                              resolve_cache_misses, resolve_cache_coalesced );
+            LeaveCriticalSection( &resolve_cache_cs );
+            return entry;
+        }
+        remove_resolve_entry( entry );
+        break;
+    }
 
-    if (timeout)
+    if (!(entry = heap_alloc_zero( sizeof(*entry) )) ||
+        !(entry->hostname = strdupW( hostname )) ||
+        !(entry->done = CreateEventW( NULL, TRUE, FALSE, NULL )))
     {
-        DWORD status;
-        HANDLE thread;
-        struct resolve_args ra;
+        LeaveCriticalSection( &resolve_cache_cs );
+        if (entry)
+        {
+            heap_free( entry->hostname );
+            heap_free( entry );
+        }
+        set_last_error( ERROR_OUTOFMEMORY );
+        return NULL;
+    }
+    entry->refs = 3; /* cache, caller and lookup */
+    entry->pending = TRUE;
+    list_add_head( &resolve_cache, &entry->entry );
+    resolve_cache_count++;
+    trim_resolve_cache( now );
+    resolve_cache_misses++;
+    TRACE_(dnscache)( "%s: miss, hits %u, misses %u, coalesced %u\n", debugstr_w(hostname),
+                      resolve_cache_hits, resolve_cache_misses, resolve_cache_coalesced );
+    LeaveCriticalSection( &resolve_cache_cs );
+
+    /* callers may time out and unload us while the lookup is still running,
+     * so keep a reference to the module until it is done */
+    memset( &env, 0, sizeof(env) );
+    env.Version = 1;
+    env.RaceDll = winhttp_instance;
+    if (!TrySubmitThreadpoolCallback( resolve_proc, entry, &env )) resolve_proc( NULL, entry );
+    return entry;
+}
+
+static void clear_resolve_cache( void )
+{
+    struct resolve_entry *entry, *next;
 
-        ra.hostname = hostname;
-        ra.port     = port;
-        ra.sa       = sa;
-        ra.sa_len   = sa_len;
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &resolve_cache, struct resolve_entry, entry )
+        remove_resolve_entry( entry );
+    DeleteCriticalSection( &resolve_cache_cs );
+}
+
+BOOL netconn_resolve( WCHAR *hostname, INTERNET_PORT port, struct sockaddr *sa, socklen_t *sa_len, int timeout )
+{
+    struct resolve_entry *entry;
+    DWORD ret;
 
-        thread = CreateThread( NULL, 0, resolve_proc, &ra, 0, NULL );
-        if (!thread) return FALSE;
+    if (!(entry = get_resolve_entry( hostname ))) return FALSE;
 
-        status = WaitForSingleObject( thread, timeout );
-        if (status == WAIT_OBJECT_0) GetExitCodeThread( thread, &ret );
-        else ret = ERROR_WINHTTP_TIMEOUT;
-        CloseHandle( thread );
+    if (WaitForSingleObject( entry->done, timeout ? timeout : INFINITE ) != WAIT_OBJECT_0)
+        ret = ERROR_WINHTTP_TIMEOUT;
+    else if (!(ret = entry->error))
+    {
+        if (*sa_len < entry->addr_len)
+        {
+            WARN("address too small\n");
+            ret = ERROR_WINHTTP_NAME_NOT_RESOLVED;
+        }
+        else
+        {
+            *sa_len = entry->addr_len;
+            memcpy( sa, &entry->addr, entry->addr_len );
+            switch (sa->sa_family)
+            {
+            case AF_INET:
+                ((struct sockaddr_in *)sa)->sin_port = htons( port );
+                break;
+            case AF_INET6:
+                ((struct sockaddr_in6 *)sa)->sin6_port = htons( port );
+                break;
+            }
+        }
     }
-    else ret = resolve_hostname( hostname, port, sa, sa_len );
+    release_resolve_entry( entry );
 
     if (ret)
     {
@@ -995,6 +995,158 @@ static WCHAR *addr_to_str( struct sockaddr *addr )
     return strdupAW( buf );
 }
 
+#define POOL_IDLE_TIMEOUT 60000 /* idle persistent connections are closed after this many ms */
+#define POOL_MAX_IDLE     16    /* idle persistent connections kept per session */
+
+static CRITICAL_SECTION connection_pool_cs;
+static CRITICAL_SECTION_DEBUG connection_pool_debug =
+{
+    0, 0, &connection_pool_cs,
+    { &connection_pool_debug.ProcessLocksList, &connection_pool_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": connection_pool_cs") }
+};
+static CRITICAL_SECTION connection_pool_cs = { &connection_pool_debug, -1, 0, 0, 0, 0 };
+
+struct pooled_connection
+{
+    struct list entry;
+    WCHAR *servername;    /* server we're connected to */
+    INTERNET_PORT port;
+    WCHAR *hostname;      /* final destination, secure connections are bound to it */
+    ULONGLONG keep_until;
+    netconn_t netconn;
+};
+
+static INTERNET_PORT get_server_port( request_t *request )
+{
+    connect_t *connect = request->connect;
+    return connect->serverport ? connect->serverport : (request->hdr.flags & WINHTTP_FLAG_SECURE ? 443 : 80);
+}
+
+static void free_pooled_connection( struct pooled_connection *conn )
+{
+    netconn_close( &conn->netconn );
+    heap_free( conn->servername );
+    heap_free( conn->hostname );
+    heap_free( conn );
+}
+
+/* close the idle connections that timed out, or all of them */
+/* must be called with connection_pool_cs held */
+static void collect_connections( session_t *session, BOOL all )
+{
+    struct pooled_connection *conn, *next;
+    ULONGLONG now = GetTickCount64();
+
+    LIST_FOR_EACH_ENTRY_SAFE( conn, next, &session->conn_pool, struct pooled_connection, entry )
+    {
+        if (!all && conn->keep_until > now) continue;
+        TRACE("closing idle connection %p\n", conn);
+        list_remove( &conn->entry );
+        free_pooled_connection( conn );
+    }
+}
+
+void close_connection_pool( session_t *session )
+{
+    EnterCriticalSection( &connection_pool_cs );
+    collect_connections( session, TRUE );
+    LeaveCriticalSection( &connection_pool_cs );
+}
+
+static BOOL match_connection( const struct pooled_connection *conn, request_t *request, INTERNET_PORT port )
+{
+    connect_t *connect = request->connect;
+    BOOL secure = (request->hdr.flags & WINHTTP_FLAG_SECURE) != 0;
+
+    if (conn->port != port || conn->netconn.secure != secure) return FALSE;
+    if (strcmpiW( conn->servername, connect->servername )) return FALSE;
+    if (!secure) return TRUE;
+    return !strcmpiW( conn->hostname, connect->hostname ) &&
+           conn->netconn.security_flags == request->netconn.security_flags;
+}
+
+/* take an idle connection to the request's server out of the session pool */
+static BOOL get_pooled_connection( request_t *request, INTERNET_PORT port )
+{
+    session_t *session = request->connect->session;
+    struct pooled_connection *conn, *found;
+
+    for (;;)
+    {
+        found = NULL;
+        EnterCriticalSection( &connection_pool_cs );
+        collect_connections( session, FALSE );
+        LIST_FOR_EACH_ENTRY( conn, &session->conn_pool, struct pooled_connection, entry )
+        {
+            if (!match_connection( conn, request, port )) continue;
+            list_remove( &conn->entry );
+            found = conn;
+            break;
+        }
+        LeaveCriticalSection( &connection_pool_cs );
+
+        if (!found) return FALSE;
+        if (netconn_is_alive( &found->netconn )) break;
+
+        TRACE("connection %p closed while idle\n", found);
+        free_pooled_connection( found );
+    }
+
+    TRACE("reusing connection %p\n", found);
+    request->netconn = found->netconn;
+    heap_free( found->servername );
+    heap_free( found->hostname );
+    heap_free( found );
+    return TRUE;
+}
+
+/* hand the request's connection over to the session pool if it can be reused, close it otherwise */
+void release_connection( request_t *request )
+{
+    connect_t *connect = request->connect;
+    session_t *session = connect->session;
+    struct pooled_connection *conn;
+    DWORD security_flags = request->netconn.security_flags;
+
+    if (!netconn_connected( &request->netconn )) return;
+
+    if (!request->keep_alive || !(conn = heap_alloc( sizeof(*conn) )))
+    {
+        netconn_close( &request->netconn );
+        return;
+    }
+    conn->servername = strdupW( connect->servername );
+    conn->hostname = strdupW( connect->hostname );
+    if (!conn->servername || !conn->hostname)
+    {
+        heap_free( conn->servername );
+        heap_free( conn->hostname );
+        heap_free( conn );
+        netconn_close( &request->netconn );
+        return;
+    }
+    conn->port = get_server_port( request );
+    conn->keep_until = GetTickCount64() + POOL_IDLE_TIMEOUT;
+    conn->netconn = request->netconn;
+    TRACE("pooling connection %p\n", conn);
+
+    netconn_init( &request->netconn );
+    request->netconn.security_flags = security_flags;
+    request->keep_alive = FALSE;
+
+    EnterCriticalSection( &connection_pool_cs );
+    collect_connections( session, FALSE );
+    list_add_head( &session->conn_pool, &conn->entry );
+    if (list_count( &session->conn_pool ) > POOL_MAX_IDLE)
+    {
+        conn = LIST_ENTRY( list_tail( &session->conn_pool ), struct pooled_connection, entry );
+        list_remove( &conn->entry );
+        free_pooled_connection( conn );
+    }
+    LeaveCriticalSection( &connection_pool_cs );
+}
+
 static BOOL open_connection( request_t *request )
 {
     connect_t *connect;
@@ -1007,7 +1159,14 @@ static BOOL open_connection( request_t *request )
     if (netconn_connected( &request->netconn )) goto done;
 
     connect = request->connect;
-    port = connect->serverport ? connect->serverport : (request->hdr.flags & WINHTTP_FLAG_SECURE ? 443 : 80);
+    port = get_server_port( request );
+
+    if (get_pooled_connection( request, port ))
+    {
+        netconn_set_timeout( &request->netconn, TRUE, request->send_timeout );
+        netconn_set_timeout( &request->netconn, FALSE, request->recv_timeout );
+        goto done;
+    }
     saddr = (struct sockaddr *)&connect->sockaddr;
     slen = sizeof(struct sockaddr);
 
@@ -1063,6 +1222,7 @@ static BOOL open_connection( request_t *request )
     send_callback( &request->hdr, WINHTTP_CALLBACK_STATUS_CONNECTED_TO_SERVER, addressW, strlenW(addressW) + 1 );
 
 done:
+    request->keep_alive = FALSE;
     request->read_pos = request->read_size = 0;
     request->read_chunked = FALSE;
     request->read_chunked_size = ~0u;
@@ -2200,6 +2360,7 @@ static void finished_reading( request_t *request )
     }
     else if (!strcmpW( request->version, http1_0 )) close = TRUE;
     if (close) close_connection( request );
+    else request->keep_alive = TRUE;
 }
 
 static BOOL read_data( request_t *request, void *buffer, DWORD size, DWORD *read, BOOL async )
@@ -2342,13 +2503,13 @@ static BOOL handle_redirect( request_t *request, DWORD status )
         port = uc.nPort ? uc.nPort : (uc.nScheme == INTERNET_SCHEME_HTTPS ? 443 : 80);
         if (strcmpiW( connect->hostname, hostname ) || connect->serverport != port)
         {
+            release_connection( request );
+
             heap_free( connect->hostname );
             connect->hostname = hostname;
             connect->hostport = port;
             if (!(ret = set_server_for_hostname( connect, hostname, port ))) goto end;
 
-            netconn_close( &request->netconn );
-            if (!(ret = netconn_init( &request->netconn ))) goto end;
             request->read_pos = request->read_size = 0;
             request->read_chunked = FALSE;
             request->read_chunked_eof = FALSE;
@@ -100,6 +100,7 @@ static void session_destroy( object_header_t *hdr )
 
     if (session->unload_event) SetEvent( session->unload_event );
 
+    close_connection_pool( session );
     LIST_FOR_EACH_SAFE( item, next, &session->cookie_cache )
     {
         domain = LIST_ENTRY( item, domain_t, entry );
@@ -248,6 +249,7 @@ HINTERNET WINAPI WinHttpOpen( LPCWSTR agent, DWORD access, LPCWSTR proxy, LPCWST
     session->send_timeout = DEFAULT_SEND_TIMEOUT;
     session->recv_timeout = DEFAULT_RECEIVE_TIMEOUT;
     list_init( &session->cookie_cache );
+    list_init( &session->conn_pool );
 
     if (agent && !(session->agent = strdupW( agent ))) goto end;
     if (access == WINHTTP_ACCESS_TYPE_DEFAULT_PROXY)
@@ -583,6 +585,7 @@ static void request_destroy( object_header_t *hdr )
         CloseHandle( thread );
         return;
     }
+    release_connection( request );
     release_object( &request->connect->hdr );
 
     destroy_authinfo( request->authinfo );
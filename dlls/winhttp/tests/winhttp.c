@@ -2043,6 +2043,12 @@ static const char headmsg[] =
 "\r\n";
 
 static const char unauthorized[] = "Unauthorized";
+static const char keepalivemsg[] =
+"HTTP/1.1 200 OK\r\n"
+"Server: winetest\r\n"
+"Content-Length: 11\r\n"
+"\r\n";
+
 static const char hello_world[] = "Hello World";
 
 struct server_info
@@ -2117,6 +2123,12 @@ static DWORD CALLBACK server_thread(LPVOID param)
             }
             continue;
         }
+        if (strstr(buffer, "GET /keepalive"))
+        {
+            send(c, keepalivemsg, sizeof keepalivemsg - 1, 0);
+            send(c, hello_world, sizeof hello_world - 1, 0);
+            continue;
+        }
         if (strstr(buffer, "/big"))
         {
             char msg[BIG_BUFFER_LEN];
@@ -2808,6 +2820,60 @@ static void test_multiple_reads(int port)
     WinHttpCloseHandle(ses);
 }
 
+static void test_connection_pool(int port)
+{
+    static const WCHAR keepaliveW[] = {'/','k','e','e','p','a','l','i','v','e',0};
+    static const WCHAR basicW[] = {'/','b','a','s','i','c',0};
+    HINTERNET ses, con, req;
+    DWORD status, size, bytes_read;
+    char buffer[32];
+    BOOL ret;
+
+    ses = WinHttpOpen(test_useragent, WINHTTP_ACCESS_TYPE_NO_PROXY, NULL, NULL, 0);
+    ok(ses != NULL, "failed to open session %u\n", GetLastError());
+
+    ret = WinHttpSetTimeouts(ses, 5000, 5000, 5000, 5000);
+    ok(ret, "failed to set timeouts %u\n", GetLastError());
+
+    con = WinHttpConnect(ses, localhostW, port, 0);
+    ok(con != NULL, "failed to open a connection %u\n", GetLastError());
+
+    req = WinHttpOpenRequest(con, NULL, keepaliveW, NULL, NULL, NULL, 0);
+    ok(req != NULL, "failed to open a request %u\n", GetLastError());
+
+    ret = WinHttpSendRequest(req, NULL, 0, NULL, 0, 0, 0);
+    ok(ret, "failed to send request %u\n", GetLastError());
+
+    ret = WinHttpReceiveResponse(req, NULL);
+    ok(ret, "failed to receive response %u\n", GetLastError());
+
+    bytes_read = 0;
+    ret = WinHttpReadData(req, buffer, sizeof(buffer), &bytes_read);
+    ok(ret, "failed to read data %u\n", GetLastError());
+    ok(bytes_read == sizeof(hello_world) - 1, "got %u bytes\n", bytes_read);
+    WinHttpCloseHandle(req);
+
+    /* the server keeps waiting on the first connection, so this only succeeds if it is reused */
+    req = WinHttpOpenRequest(con, NULL, basicW, NULL, NULL, NULL, 0);
+    ok(req != NULL, "failed to open a request %u\n", GetLastError());
+
+    ret = WinHttpSendRequest(req, NULL, 0, NULL, 0, 0, 0);
+    ok(ret, "failed to send request %u\n", GetLastError());
+
+    ret = WinHttpReceiveResponse(req, NULL);
+    ok(ret, "failed to receive response %u\n", GetLastError());
+
+    status = 0xdeadbeef;
+    size = sizeof(status);
+    ret = WinHttpQueryHeaders(req, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, NULL, &status, &size, NULL);
+    ok(ret, "failed to query status code %u\n", GetLastError());
+    ok(status == HTTP_STATUS_OK, "request failed unexpectedly %u\n", status);
+
+    WinHttpCloseHandle(req);
+    WinHttpCloseHandle(con);
+    WinHttpCloseHandle(ses);
+}
+
 static void test_cookies( int port )
 {
     static const WCHAR cookieW[] = {'/','c','o','o','k','i','e',0};
@@ -4243,6 +4309,7 @@ START_TEST (winhttp)
     test_basic_authentication(si.port);
     test_bad_header(si.port);
     test_multiple_reads(si.port);
+    test_connection_pool(si.port);
     test_cookies(si.port);
 
     /* send the basic request again to shutdown the server thread */
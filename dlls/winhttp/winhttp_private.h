@@ -110,6 +110,7 @@ typedef struct
     LPWSTR proxy_username;
     LPWSTR proxy_password;
     struct list cookie_cache;
+    struct list conn_pool; /* idle persistent connections */
     HANDLE unload_event;
 } session_t;
 
@@ -134,10 +135,9 @@ typedef struct
     CtxtHandle ssl_ctx;
     SecPkgContext_StreamSizes ssl_sizes;
     char *ssl_buf;
-    char *extra_buf;
+    char *extra_buf; /* points into ssl_buf */
     size_t extra_len;
-    char *peek_msg;
-    char *peek_msg_mem;
+    char *peek_msg; /* points into ssl_buf */
     size_t peek_len;
     DWORD security_flags;
 } netconn_t;
@@ -192,6 +192,7 @@ typedef struct
     void *optional;
     DWORD optional_len;
     netconn_t netconn;
+    BOOL keep_alive; /* connection can be reused once the response has been read */
     int resolve_timeout;
     int connect_timeout;
     int send_timeout;
@@ -280,12 +281,15 @@ void set_last_error( DWORD ) DECLSPEC_HIDDEN;
 DWORD get_last_error( void ) DECLSPEC_HIDDEN;
 void send_callback( object_header_t *, DWORD, LPVOID, DWORD ) DECLSPEC_HIDDEN;
 void close_connection( request_t * ) DECLSPEC_HIDDEN;
+void release_connection( request_t * ) DECLSPEC_HIDDEN;
+void close_connection_pool( session_t * ) DECLSPEC_HIDDEN;
 
 BOOL netconn_close( netconn_t * ) DECLSPEC_HIDDEN;
 BOOL netconn_connect( netconn_t *, const struct sockaddr *, unsigned int, int ) DECLSPEC_HIDDEN;
 BOOL netconn_connected( netconn_t * ) DECLSPEC_HIDDEN;
 BOOL netconn_create( netconn_t *, int, int, int ) DECLSPEC_HIDDEN;
 BOOL netconn_init( netconn_t * ) DECLSPEC_HIDDEN;
+BOOL netconn_is_alive( netconn_t * ) DECLSPEC_HIDDEN;
 void netconn_unload( void ) DECLSPEC_HIDDEN;
 ULONG netconn_query_data_available( netconn_t * ) DECLSPEC_HIDDEN;
 BOOL netconn_recv( netconn_t *, void *, size_t, int, int * ) DECLSPEC_HIDDEN;
@@ -303,6 +307,7 @@ void delete_domain( domain_t * ) DECLSPEC_HIDDEN;
 BOOL set_server_for_hostname( connect_t *, LPCWSTR, INTERNET_PORT ) DECLSPEC_HIDDEN;
 void destroy_authinfo( struct authinfo * ) DECLSPEC_HIDDEN;
 
+extern HINSTANCE winhttp_instance DECLSPEC_HIDDEN;
 extern HRESULT WinHttpRequest_create( void ** ) DECLSPEC_HIDDEN;
 void release_typelib( void ) DECLSPEC_HIDDEN;
 
@@ -73,10 +73,9 @@ typedef struct
     SecPkgContext_StreamSizes ssl_sizes;
     server_t *server;
     char *ssl_buf;
-    char *extra_buf;
+    char *extra_buf; /* points into ssl_buf */
     size_t extra_len;
-    char *peek_msg;
-    char *peek_msg_mem;
+    char *peek_msg; /* points into ssl_buf */
     size_t peek_len;
     DWORD security_flags;
     BOOL mask_errors;
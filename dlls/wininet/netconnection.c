@@ -383,13 +383,10 @@ void free_netconn(netconn_t *netconn)
     server_release(netconn->server);
 
     if (netconn->secure) {
-        heap_free(netconn->peek_msg_mem);
-        netconn->peek_msg_mem = NULL;
         netconn->peek_msg = NULL;
         netconn->peek_len = 0;
         heap_free(netconn->ssl_buf);
         netconn->ssl_buf = NULL;
-        heap_free(netconn->extra_buf);
         netconn->extra_buf = NULL;
         netconn->extra_len = 0;
         if (SecIsValidHandle(&netconn->ssl_ctx))
@@ -433,6 +430,28 @@ int sock_recv(int fd, void *msg, size_t len, int flags)
     return ret;
 }
 
+/* ssl_buf holds this many records for receiving, followed by as many for
+ * sending, so that a single recv or send can carry several of them and
+ * received records can be decrypted in place without further copies */
+#define SSL_BUF_RECORDS 4
+
+static inline SIZE_T ssl_record_size(const netconn_t *conn)
+{
+    return conn->ssl_sizes.cbHeader + conn->ssl_sizes.cbMaximumMessage + conn->ssl_sizes.cbTrailer;
+}
+
+static inline char *ssl_send_buf(const netconn_t *conn)
+{
+    return conn->ssl_buf + SSL_BUF_RECORDS * ssl_record_size(conn);
+}
+
+/* whether the buffered data starts with a complete TLS record */
+static BOOL have_ssl_record(const char *data, SIZE_T len)
+{
+    const BYTE *ptr = (const BYTE *)data;
+    return len >= 5 && len >= 5 + ((ptr[3] << 8) | ptr[4]);
+}
+
 static DWORD netcon_secure_connect_setup(netconn_t *connection, BOOL compat_mode)
 {
     SecBuffer out_buf = {0, SECBUFFER_TOKEN, NULL}, in_bufs[2] = {{0, SECBUFFER_TOKEN}, {0, SECBUFFER_EMPTY}};
@@ -558,8 +577,7 @@ static DWORD netcon_secure_connect_setup(netconn_t *connection, BOOL compat_mode
                 break;
             }
 
-            connection->ssl_buf = heap_alloc(connection->ssl_sizes.cbHeader + connection->ssl_sizes.cbMaximumMessage
-                    + connection->ssl_sizes.cbTrailer);
+            connection->ssl_buf = heap_alloc(2 * SSL_BUF_RECORDS * ssl_record_size(connection));
             if(!connection->ssl_buf) {
                 res = GetLastError();
                 break;
@@ -631,12 +649,12 @@ DWORD NETCON_secure_connect(netconn_t *connection, server_t *server)
     return res;
 }
 
-static BOOL send_ssl_chunk(netconn_t *conn, const void *msg, size_t size)
+static BOOL encrypt_ssl_chunk(netconn_t *conn, char *out, const void *msg, size_t size, size_t *out_len)
 {
     SecBuffer bufs[4] = {
-        {conn->ssl_sizes.cbHeader, SECBUFFER_STREAM_HEADER, conn->ssl_buf},
-        {size,  SECBUFFER_DATA, conn->ssl_buf+conn->ssl_sizes.cbHeader},
-        {conn->ssl_sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, conn->ssl_buf+conn->ssl_sizes.cbHeader+size},
+        {conn->ssl_sizes.cbHeader, SECBUFFER_STREAM_HEADER, out},
+        {size,  SECBUFFER_DATA, out+conn->ssl_sizes.cbHeader},
+        {conn->ssl_sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, out+conn->ssl_sizes.cbHeader+size},
         {0, SECBUFFER_EMPTY, NULL}
     };
     SecBufferDesc buf_desc = {SECBUFFER_VERSION, sizeof(bufs)/sizeof(*bufs), bufs};
@@ -649,11 +667,7 @@ static BOOL send_ssl_chunk(netconn_t *conn, const void *msg, size_t size)
         return FALSE;
     }
 
-    if(sock_send(conn->socket, conn->ssl_buf, bufs[0].cbBuffer+bufs[1].cbBuffer+bufs[2].cbBuffer, 0) < 1) {
-        WARN("send failed\n");
-        return FALSE;
-    }
-
+    *out_len = bufs[0].cbBuffer+bufs[1].cbBuffer+bufs[2].cbBuffer;
     return TRUE;
 }
 
@@ -675,57 +689,81 @@ DWORD NETCON_send(netconn_t *connection, const void *msg, size_t len, int flags,
     }
     else
     {
+        const SIZE_T record_size = ssl_record_size(connection);
         const BYTE *ptr = msg;
-        size_t chunk_size;
+        size_t chunk_size, enc_size, buf_len, batch;
 
         *sent = 0;
 
         while(len) {
-            chunk_size = min(len, connection->ssl_sizes.cbMaximumMessage);
-            if(!send_ssl_chunk(connection, ptr, chunk_size))
-                return ERROR_INTERNET_SECURITY_CHANNEL_ERROR;
+            /* encrypt as many records as fit in the send buffer and send them at once */
+            buf_len = batch = 0;
+            while(len && buf_len + record_size <= SSL_BUF_RECORDS * record_size) {
+                chunk_size = min(len, connection->ssl_sizes.cbMaximumMessage);
+                if(!encrypt_ssl_chunk(connection, ssl_send_buf(connection)+buf_len, ptr, chunk_size, &enc_size))
+                    return ERROR_INTERNET_SECURITY_CHANNEL_ERROR;
+
+                buf_len += enc_size;
+                batch += chunk_size;
+                ptr += chunk_size;
+                len -= chunk_size;
+            }
 
-            *sent += chunk_size;
-            ptr += chunk_size;
-            len -= chunk_size;
+            if(sock_send(connection->socket, ssl_send_buf(connection), buf_len, 0) < 1) {
+                WARN("send failed\n");
+                return ERROR_INTERNET_SECURITY_CHANNEL_ERROR;
+            }
+            *sent += batch;
         }
 
         return ERROR_SUCCESS;
     }
 }
 
+/* Records are decrypted in place in ssl_buf. Whatever is left of the
+ * plaintext is kept there as the peek buffer and the following records as the
+ * extra buffer, so that data is only copied once, into the caller's buffer. */
 static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blocking, SIZE_T *ret_size, BOOL *eof)
 {
-    const SIZE_T ssl_buf_size = conn->ssl_sizes.cbHeader+conn->ssl_sizes.cbMaximumMessage+conn->ssl_sizes.cbTrailer;
+    const SIZE_T ssl_buf_size = SSL_BUF_RECORDS * ssl_record_size(conn);
     SecBuffer bufs[4];
     SecBufferDesc buf_desc = {SECBUFFER_VERSION, sizeof(bufs)/sizeof(*bufs), bufs};
     SSIZE_T size, buf_len = 0;
+    char *data = conn->ssl_buf;
     int i;
     SECURITY_STATUS res;
 
     assert(conn->extra_len < ssl_buf_size);
+    assert(!conn->peek_len);
 
     if(conn->extra_len) {
-        memcpy(conn->ssl_buf, conn->extra_buf, conn->extra_len);
+        data = conn->extra_buf;
         buf_len = conn->extra_len;
-        conn->extra_len = 0;
-        heap_free(conn->extra_buf);
         conn->extra_buf = NULL;
+        conn->extra_len = 0;
     }
 
-    set_socket_blocking(conn, blocking && !buf_len);
-    size = sock_recv(conn->socket, conn->ssl_buf+buf_len, ssl_buf_size-buf_len, 0);
-    if(size < 0) {
-        if(!buf_len) {
-            if(WSAGetLastError() == WSAEWOULDBLOCK) {
-                TRACE("would block\n");
-                return WSAEWOULDBLOCK;
+    /* no need to touch the socket if a whole record is already buffered */
+    if(!have_ssl_record(data, buf_len)) {
+        if(data != conn->ssl_buf) {
+            memmove(conn->ssl_buf, data, buf_len);
+            data = conn->ssl_buf;
+        }
+
+        set_socket_blocking(conn, blocking && !buf_len);
+        size = sock_recv(conn->socket, data+buf_len, ssl_buf_size-buf_len, 0);
+        if(size < 0) {
+            if(!buf_len) {
+                if(WSAGetLastError() == WSAEWOULDBLOCK) {
+                    TRACE("would block\n");
+                    return WSAEWOULDBLOCK;
+                }
+                WARN("recv failed\n");
+                return ERROR_INTERNET_CONNECTION_ABORTED;
             }
-            WARN("recv failed\n");
-            return ERROR_INTERNET_CONNECTION_ABORTED;
+        }else {
+            buf_len += size;
         }
-    }else {
-        buf_len += size;
     }
 
     if(!buf_len) {
@@ -741,7 +779,7 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
         memset(bufs, 0, sizeof(bufs));
         bufs[0].BufferType = SECBUFFER_DATA;
         bufs[0].cbBuffer = buf_len;
-        bufs[0].pvBuffer = conn->ssl_buf;
+        bufs[0].pvBuffer = data;
 
         res = DecryptMessage(&conn->ssl_ctx, &buf_desc, 0, NULL);
         switch(res) {
@@ -752,21 +790,21 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
             *eof = TRUE;
             return ERROR_SUCCESS;
         case SEC_E_INCOMPLETE_MESSAGE:
+            if(data != conn->ssl_buf) {
+                memmove(conn->ssl_buf, data, buf_len);
+                data = conn->ssl_buf;
+            }
             assert(buf_len < ssl_buf_size);
 
             set_socket_blocking(conn, blocking);
-            size = sock_recv(conn->socket, conn->ssl_buf+buf_len, ssl_buf_size-buf_len, 0);
+            size = sock_recv(conn->socket, data+buf_len, ssl_buf_size-buf_len, 0);
             if(size < 1) {
                 if(size < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
                     TRACE("would block\n");
 
-                    /* FIXME: Optimize extra_buf usage. */
-                    conn->extra_buf = heap_alloc(buf_len);
-                    if(!conn->extra_buf)
-                        return ERROR_NOT_ENOUGH_MEMORY;
-
+                    /* keep the partial record for the next call */
+                    conn->extra_buf = data;
                     conn->extra_len = buf_len;
-                    memcpy(conn->extra_buf, conn->ssl_buf, conn->extra_len);
                     return WSAEWOULDBLOCK;
                 }
 
@@ -786,12 +824,8 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
             size = min(buf_size, bufs[i].cbBuffer);
             memcpy(buf, bufs[i].pvBuffer, size);
             if(size < bufs[i].cbBuffer) {
-                assert(!conn->peek_len);
-                conn->peek_msg_mem = conn->peek_msg = heap_alloc(bufs[i].cbBuffer - size);
-                if(!conn->peek_msg)
-                    return ERROR_NOT_ENOUGH_MEMORY;
+                conn->peek_msg = (char*)bufs[i].pvBuffer+size;
                 conn->peek_len = bufs[i].cbBuffer-size;
-                memcpy(conn->peek_msg, (char*)bufs[i].pvBuffer+size, conn->peek_len);
             }
 
             *ret_size = size;
@@ -800,12 +834,8 @@ static BOOL read_ssl_chunk(netconn_t *conn, void *buf, SIZE_T buf_size, BOOL blo
 
     for(i=0; i < sizeof(bufs)/sizeof(*bufs); i++) {
         if(bufs[i].BufferType == SECBUFFER_EXTRA) {
-            conn->extra_buf = heap_alloc(bufs[i].cbBuffer);
-            if(!conn->extra_buf)
-                return ERROR_NOT_ENOUGH_MEMORY;
-
+            conn->extra_buf = bufs[i].pvBuffer;
             conn->extra_len = bufs[i].cbBuffer;
-            memcpy(conn->extra_buf, bufs[i].pvBuffer, conn->extra_len);
         }
     }
 
@@ -831,7 +861,7 @@ DWORD NETCON_recv(netconn_t *connection, void *buf, size_t len, BOOL blocking, i
     }
     else
     {
-        SIZE_T size = 0;
+        SIZE_T size = 0, cread;
         BOOL eof;
         DWORD res;
 
@@ -841,17 +871,16 @@ DWORD NETCON_recv(netconn_t *connection, void *buf, size_t len, BOOL blocking, i
             connection->peek_len -= size;
             connection->peek_msg += size;
 
-            if(!connection->peek_len) {
-                heap_free(connection->peek_msg_mem);
-                connection->peek_msg_mem = connection->peek_msg = NULL;
-            }
+            if(!connection->peek_len)
+                connection->peek_msg = NULL;
 
             *recvd = size;
             return ERROR_SUCCESS;
         }
 
         do {
-            res = read_ssl_chunk(connection, (BYTE*)buf, len, blocking, &size, &eof);
+            cread = 0;
+            res = read_ssl_chunk(connection, (BYTE*)buf+size, len-size, blocking, &cread, &eof);
             if(res != ERROR_SUCCESS) {
                 if(res == WSAEWOULDBLOCK) {
                     if(size)
@@ -861,7 +890,9 @@ DWORD NETCON_recv(netconn_t *connection, void *buf, size_t len, BOOL blocking, i
                 }
                 break;
             }
-        }while(!size && !eof);
+            size += cread;
+            /* keep going without blocking while whole records are already buffered */
+        }while(!eof && (!size || (size < len && have_ssl_record(connection->extra_buf, connection->extra_len))));
 
         TRACE("received %ld bytes\n", size);
         *recvd = size;
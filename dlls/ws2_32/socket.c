@@ -157,6 +157,7 @@
 #include "wine/server.h"
 #include "wine/debug.h"
 #include "wine/exception.h"
+#include "wine/list.h"
 #include "wine/unicode.h"
 
 #if defined(linux) && !defined(IP_UNICAST_IF)
@@ -180,6 +181,7 @@
 #define FILE_USE_FILE_POINTER_POSITION ((LONGLONG)-2)
 
 WINE_DEFAULT_DEBUG_CHANNEL(winsock);
+WINE_DECLARE_DEBUG_CHANNEL(dnscache);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 /* names of the protocols */
@@ -614,7 +616,8 @@ static int ws_protocol_info(SOCKET s, int unicode, WSAPROTOCOL_INFOW *buffer, in
 int WSAIOCTL_GetInterfaceCount(void);
 int WSAIOCTL_GetInterfaceName(int intNumber, char *intName);
 
-static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus, ULONG Information );
+static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus,
+                              ULONG Information, BOOL async );
 
 #define MAP_OPTION(opt) { WS_##opt, opt }
 
@@ -2435,7 +2438,8 @@ static NTSTATUS WS2_async_accept_recv( void *user, IO_STATUS_BLOCK *iosb,
         return status;
 
     if (wsa->cvalue)
-        WS_AddCompletion( HANDLE2SOCKET(wsa->listen_socket), wsa->cvalue, iosb->u.Status, iosb->Information );
+        WS_AddCompletion( HANDLE2SOCKET(wsa->listen_socket), wsa->cvalue, iosb->u.Status,
+                          iosb->Information, TRUE );
 
     release_async_io( &wsa->io );
     return status;
@@ -5112,7 +5116,7 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         overlapped->Internal = status;
         overlapped->InternalHigh = total;
         if (overlapped->hEvent) NtSetEvent( overlapped->hEvent, NULL );
-        if (cvalue) WS_AddCompletion( HANDLE2SOCKET(s), cvalue, status, total );
+        if (cvalue) WS_AddCompletion( HANDLE2SOCKET(s), cvalue, status, total, FALSE );
     }
 
     if (!status)
@@ -5201,13 +5205,30 @@ int WINAPI WS_recvfrom(SOCKET s, char *buf, INT len, int flags,
         return n;
 }
 
+/* get a per-thread poll array that can hold count entries, reused across calls */
+static struct pollfd *get_poll_array( unsigned int count )
+{
+    struct per_thread_data *ptb = get_per_thread_data();
+    struct pollfd *fds;
+
+    /* check if the cache can hold all descriptors, if not do the resizing */
+    if (ptb->fd_count < count)
+    {
+        if (!(fds = HeapAlloc(GetProcessHeap(), 0, count * sizeof(fds[0]))))
+            return NULL;
+        HeapFree(GetProcessHeap(), 0, ptb->fd_cache);
+        ptb->fd_cache = fds;
+        ptb->fd_count = count;
+    }
+    return ptb->fd_cache;
+}
+
 /* allocate a poll array for the corresponding fd sets */
 static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set *writefds,
                                        const WS_fd_set *exceptfds, int *count_ptr )
 {
     unsigned int i, j = 0, count = 0;
     struct pollfd *fds;
-    struct per_thread_data *ptb = get_per_thread_data();
 
     if (readfds) count += readfds->fd_count;
     if (writefds) count += writefds->fd_count;
@@ -5219,20 +5240,11 @@ static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set
         return NULL;
     }
 
-    /* check if the cache can hold all descriptors, if not do the resizing */
-    if (ptb->fd_count < count)
+    if (!(fds = get_poll_array( count )))
     {
-        if (!(fds = HeapAlloc(GetProcessHeap(), 0, count * sizeof(fds[0]))))
-        {
-            SetLastError( ERROR_NOT_ENOUGH_MEMORY );
-            return NULL;
-        }
-        HeapFree(GetProcessHeap(), 0, ptb->fd_cache);
-        ptb->fd_cache = fds;
-        ptb->fd_count = count;
+        SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+        return NULL;
     }
-    else
-        fds = ptb->fd_cache;
 
     if (readfds)
         for (i = 0; i < readfds->fd_count; i++, j++)
@@ -5462,7 +5474,7 @@ int WINAPI WSAPoll(WSAPOLLFD *wfds, ULONG count, int timeout)
         return SOCKET_ERROR;
     }
 
-    if (!(ufds = HeapAlloc(GetProcessHeap(), 0, count * sizeof(ufds[0]))))
+    if (!(ufds = get_poll_array( count )))
     {
         SetLastError(WSAENOBUFS);
         return SOCKET_ERROR;
@@ -5501,13 +5513,12 @@ int WINAPI WSAPoll(WSAPOLLFD *wfds, ULONG count, int timeout)
             wfds[i].revents = WS_POLLNVAL;
     }
 
-    HeapFree(GetProcessHeap(), 0, ufds);
     return ret;
 }
 
 /* helper to send completion messages for client-only i/o operation case */
 static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus,
-                              ULONG Information )
+                              ULONG Information, BOOL async )
 {
     SERVER_START_REQ( add_fd_completion )
     {
@@ -5515,6 +5526,7 @@ static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS C
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         wine_server_call( req );
     }
     SERVER_END_REQ;
@@ -5664,7 +5676,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         if (lpNumberOfBytesSent) *lpNumberOfBytesSent = n;
         if (!wsa->completion_func)
         {
-            if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+            if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n, FALSE );
             if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
             HeapFree( GetProcessHeap(), 0, wsa );
         }
@@ -6604,12 +6616,232 @@ static char *get_hostname(void)
     return ret;
 }
 
+#ifdef HAVE_GETADDRINFO
+
+/*
+ * Results of getaddrinfo() are cached for a short while, since the host
+ * resolver doesn't tell us the record TTLs. Failures are cached for a
+ * shorter time, and only when the name definitely doesn't resolve.
+ * Concurrent lookups of the same name wait for the first one instead of
+ * querying the resolver again.
+ */
+#define ADDRINFO_CACHE_TTL          60000 /* ms */
+#define ADDRINFO_CACHE_NEGATIVE_TTL 5000  /* ms */
+#define ADDRINFO_CACHE_SIZE         64
+
+struct addrinfo_cache_entry
+{
+    struct list      entry;
+    LONG             refs;
+    char            *node;
+    char            *service;
+    struct addrinfo  hints;   /* only flags, family, socktype and protocol are used */
+    HANDLE           event;   /* signaled once the lookup completed */
+    BOOL             pending;
+    int              result;
+    struct addrinfo *ai;      /* private copy of the results */
+    ULONGLONG        expires;
+};
+
+static struct list addrinfo_cache = LIST_INIT( addrinfo_cache );
+static unsigned int addrinfo_cache_count;
+static unsigned int addrinfo_cache_hits, addrinfo_cache_misses, addrinfo_cache_coalesced;
+
+static CRITICAL_SECTION addrinfo_cache_cs;
+static CRITICAL_SECTION_DEBUG addrinfo_cache_cs_debug =
+{
+    0, 0, &addrinfo_cache_cs,
+    { &addrinfo_cache_cs_debug.ProcessLocksList, &addrinfo_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": addrinfo_cache_cs") }
+};
+static CRITICAL_SECTION addrinfo_cache_cs = { &addrinfo_cache_cs_debug, -1, 0, 0, 0, 0 };
+
+static char *strdup_a( const char *str )
+{
+    char *ret;
+
+    if (!str) return NULL;
+    if ((ret = HeapAlloc( GetProcessHeap(), 0, strlen(str) + 1 ))) strcpy( ret, str );
+    return ret;
+}
+
+static void free_addrinfo_copy( struct addrinfo *ai )
+{
+    struct addrinfo *next;
+
+    for (; ai; ai = next)
+    {
+        next = ai->ai_next;
+        HeapFree( GetProcessHeap(), 0, ai->ai_canonname );
+        HeapFree( GetProcessHeap(), 0, ai );
+    }
+}
+
+/* copy a unix addrinfo list, the address is stored right after each element */
+static struct addrinfo *copy_addrinfo( const struct addrinfo *src )
+{
+    struct addrinfo *ret = NULL, **next = &ret, *ai;
+
+    for (; src; src = src->ai_next)
+    {
+        if (!(ai = HeapAlloc( GetProcessHeap(), 0, sizeof(*ai) + src->ai_addrlen ))) goto failed;
+        *ai = *src;
+        ai->ai_next = NULL;
+        ai->ai_addr = (struct sockaddr *)(ai + 1);
+        memcpy( ai->ai_addr, src->ai_addr, src->ai_addrlen );
+        ai->ai_canonname = NULL;
+        *next = ai;
+        next = &ai->ai_next;
+        if (src->ai_canonname && !(ai->ai_canonname = strdup_a( src->ai_canonname ))) goto failed;
+    }
+    return ret;
+
+failed:
+    free_addrinfo_copy( ret );
+    return NULL;
+}
+
+static void release_addrinfo_entry( struct addrinfo_cache_entry *entry )
+{
+    if (!entry || InterlockedDecrement( &entry->refs )) return;
+    if (entry->event) CloseHandle( entry->event );
+    free_addrinfo_copy( entry->ai );
+    HeapFree( GetProcessHeap(), 0, entry->node );
+    HeapFree( GetProcessHeap(), 0, entry->service );
+    HeapFree( GetProcessHeap(), 0, entry );
+}
+
+static BOOL match_addrinfo_entry( const struct addrinfo_cache_entry *entry, const char *node,
+                                  const char *service, const struct addrinfo *hints )
+{
+    if (strcasecmp( entry->node, node )) return FALSE;
+    if (service ? !entry->service || strcmp( entry->service, service ) : entry->service != NULL) return FALSE;
+    return entry->hints.ai_flags == hints->ai_flags && entry->hints.ai_family == hints->ai_family &&
+           entry->hints.ai_socktype == hints->ai_socktype && entry->hints.ai_protocol == hints->ai_protocol;
+}
+
+/* must be called with addrinfo_cache_cs held */
+static void remove_addrinfo_entry( struct addrinfo_cache_entry *entry )
+{
+    list_remove( &entry->entry );
+    addrinfo_cache_count--;
+    release_addrinfo_entry( entry );
+}
+
+/* must be called with addrinfo_cache_cs held */
+static void trim_addrinfo_cache( ULONGLONG now )
+{
+    struct addrinfo_cache_entry *entry, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( entry, next, &addrinfo_cache, struct addrinfo_cache_entry, entry )
+    {
+        if (addrinfo_cache_count <= ADDRINFO_CACHE_SIZE && entry->expires > now) continue;
+        if (!entry->pending) remove_addrinfo_entry( entry );
+    }
+}
+
+/* getaddrinfo() going through the cache, the results stay valid until the entry is released */
+/* *ret is set to NULL if no entry could be allocated */
+static int cached_getaddrinfo( const char *node, const char *service, const struct addrinfo *hints,
+                               struct addrinfo_cache_entry **ret )
+{
+    static const struct addrinfo no_hints;
+    struct addrinfo_cache_entry *entry, *found = NULL;
+    struct addrinfo *res;
+    ULONGLONG now;
+    BOOL pending;
+    int result;
+
+    *ret = NULL;
+    if (!hints) hints = &no_hints;
+
+    if (!(entry = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*entry) ))) return EAI_MEMORY;
+    entry->refs = 1;
+    entry->pending = TRUE;
+    entry->hints.ai_flags    = hints->ai_flags;
+    entry->hints.ai_family   = hints->ai_family;
+    entry->hints.ai_socktype = hints->ai_socktype;
+    entry->hints.ai_protocol = hints->ai_protocol;
+
+    /* passive and numeric lookups don't query the resolver */
+    if (node && !(hints->ai_flags & AI_NUMERICHOST))
+    {
+        EnterCriticalSection( &addrinfo_cache_cs );
+        now = GetTickCount64();
+        LIST_FOR_EACH_ENTRY( found, &addrinfo_cache, struct addrinfo_cache_entry, entry )
+        {
+            if (!match_addrinfo_entry( found, node, service, hints )) continue;
+            if (found->pending || found->expires > now)
+            {
+                InterlockedIncrement( &found->refs );
+                pending = found->pending;
+                if (pending) addrinfo_cache_coalesced++;
+                else addrinfo_cache_hits++;
+                TRACE_(dnscache)( "%s %s: %s, hits %u, misses %u, coalesced %u\n", debugstr_a(node),
+                                  debugstr_a(service), pending ? "pending" : "hit", addrinfo_cache_hits,
+                                  addrinfo_cache_misses, addrinfo_cache_coalesced );
+                LeaveCriticalSection( &addrinfo_cache_cs );
+
+                release_addrinfo_entry( entry );
+                if (pending) WaitForSingleObject( found->event, INFINITE );
+                *ret = found;
+                return found->result;
+            }
+            remove_addrinfo_entry( found );
+            break;
+        }
+
+        entry->node = strdup_a( node );
+        entry->service = strdup_a( service );
+        entry->event = CreateEventW( NULL, TRUE, FALSE, NULL );
+        if (entry->node && (!service || entry->service) && entry->event)
+        {
+            InterlockedIncrement( &entry->refs );
+            list_add_head( &addrinfo_cache, &entry->entry );
+            addrinfo_cache_count++;
+            trim_addrinfo_cache( now );
+        }
+        addrinfo_cache_misses++;
+        TRACE_(dnscache)( "%s %s: miss, hits %u, misses %u, coalesced %u\n", debugstr_a(node),
+                          debugstr_a(service), addrinfo_cache_hits, addrinfo_cache_misses,
+                          addrinfo_cache_coalesced );
+        LeaveCriticalSection( &addrinfo_cache_cs );
+    }
+
+    /* getaddrinfo(3) is thread safe, no need to wrap in CS */
+    if (!(result = getaddrinfo( node, service, hints == &no_hints ? NULL : hints, &res )))
+    {
+        if (!(entry->ai = copy_addrinfo( res ))) result = EAI_MEMORY;
+        freeaddrinfo( res );
+    }
+
+    now = GetTickCount64();
+    entry->result = result;
+    if (!result)
+        entry->expires = now + ADDRINFO_CACHE_TTL;
+    else if (result == EAI_NONAME)
+        entry->expires = now + ADDRINFO_CACHE_NEGATIVE_TTL;
+    else
+        entry->expires = now;  /* don't keep temporary failures around */
+
+    EnterCriticalSection( &addrinfo_cache_cs );
+    entry->pending = FALSE;
+    LeaveCriticalSection( &addrinfo_cache_cs );
+    if (entry->event) SetEvent( entry->event );
+
+    *ret = entry;
+    return result;
+}
+
+#endif  /* HAVE_GETADDRINFO */
+
 /***********************************************************************
  *		getaddrinfo		(WS2_32.@)
  */
 int WINAPI WS_getaddrinfo(LPCSTR nodename, LPCSTR servname, const struct WS_addrinfo *hints, struct WS_addrinfo **res)
 {
 #ifdef HAVE_GETADDRINFO
+    struct addrinfo_cache_entry *cache_entry = NULL;
     struct addrinfo *unixaires = NULL;
     int   result;
     struct addrinfo unixhints, *punixhints = NULL;
@@ -6673,8 +6905,7 @@ int WINAPI WS_getaddrinfo(LPCSTR nodename, LPCSTR servname, const struct WS_addr
             punixhints->ai_protocol = 0;
     }
 
-    /* getaddrinfo(3) is thread safe, no need to wrap in CS */
-    result = getaddrinfo(node, servname, punixhints, &unixaires);
+    result = cached_getaddrinfo(node, servname, punixhints, &cache_entry);
 
     if (result && !strcmp(hostname, node))
     {
@@ -6682,8 +6913,11 @@ int WINAPI WS_getaddrinfo(LPCSTR nodename, LPCSTR servname, const struct WS_addr
         * by sending a NULL host and avoid sending a NULL servname too because that
         * is invalid */
         ERR_(winediag)("Failed to resolve your host name IP\n");
-        result = getaddrinfo(NULL, servname ? servname : "0", punixhints, &unixaires);
+        release_addrinfo_entry(cache_entry);
+        cache_entry = NULL;
+        result = cached_getaddrinfo(NULL, servname ? servname : "0", punixhints, &cache_entry);
     }
+    if (!result) unixaires = cache_entry->ai;
     TRACE("%s, %s %p -> %p %d\n", debugstr_a(nodename), debugstr_a(servname), hints, res, result);
     HeapFree(GetProcessHeap(), 0, hostname);
 
@@ -6737,7 +6971,7 @@ int WINAPI WS_getaddrinfo(LPCSTR nodename, LPCSTR servname, const struct WS_addr
             } while (1);
             xuai = xuai->ai_next;
         }
-        freeaddrinfo(unixaires);
+        release_addrinfo_entry(cache_entry);
 
         if (TRACE_ON(winsock))
         {
@@ -6751,14 +6985,17 @@ int WINAPI WS_getaddrinfo(LPCSTR nodename, LPCSTR servname, const struct WS_addr
             }
         }
     } else
+    {
+        release_addrinfo_entry(cache_entry);
         result = convert_eai_u2w(result);
+    }
 
     SetLastError(result);
     return result;
 
 outofmem:
     if (*res) WS_freeaddrinfo(*res);
-    if (unixaires) freeaddrinfo(unixaires);
+    release_addrinfo_entry(cache_entry);
     return WSA_NOT_ENOUGH_MEMORY;
 #else
     FIXME("getaddrinfo() failed, not found during buildtime.\n");
@@ -7801,7 +8038,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             {
                 int loc_errno = errno;
                 err = wsaErrno();
-                if (cvalue) WS_AddCompletion( s, cvalue, sock_get_ntstatus(loc_errno), 0 );
+                if (cvalue) WS_AddCompletion( s, cvalue, sock_get_ntstatus(loc_errno), 0, FALSE );
                 goto error;
             }
         }
@@ -7842,7 +8079,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             iosb->Information = n;
             if (!wsa->completion_func)
             {
-                if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+                if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n, FALSE );
                 if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
                 HeapFree( GetProcessHeap(), 0, wsa );
             }
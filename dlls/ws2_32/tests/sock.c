@@ -3521,6 +3521,30 @@ static DWORD WINAPI SelectCloseThread(void *param)
     return 0;
 }
 
+struct select_idle_params
+{
+    SOCKET s;
+    HANDLE stop;
+};
+
+static DWORD WINAPI SelectIdleThread(void *param)
+{
+    struct select_idle_params *par = param;
+    struct timeval select_timeout;
+    fd_set readfds;
+
+    FD_ZERO(&readfds);
+    FD_SET(par->s, &readfds);
+    select_timeout.tv_sec = 0;
+    select_timeout.tv_usec = 0;
+    select(0, &readfds, NULL, NULL, &select_timeout);
+
+    /* stay alive without polling again */
+    SetEvent(server_ready);
+    WaitForSingleObject(par->stop, INFINITE);
+    return 0;
+}
+
 static void test_errors(void)
 {
     SOCKET sock;
@@ -3657,6 +3681,7 @@ static void test_select(void)
     struct timeval select_timeout;
     struct sockaddr_in address;
     select_thread_params thread_params;
+    struct select_idle_params idle_params;
     HANDLE thread_handle;
     DWORD ticks, id;
 
@@ -4017,6 +4042,63 @@ todo_wine
     ok(ret == 1, "expected 1, got %d\n", ret);
     ok(FD_ISSET(fdWrite, &writefds), "fdWrite socket is not in the set\n");
     closesocket(fdWrite);
+
+    /* test sockets selected repeatedly, and new sockets reusing their handles */
+    ok(!tcp_socketpair(&fdRead, &fdWrite), "creating socket pair failed\n");
+    select_timeout.tv_usec = 0;
+    for (len = 0; len < 3; len++)
+    {
+        FD_ZERO_ALL();
+        FD_SET(fdRead, &readfds);
+        ret = select(0, &readfds, NULL, NULL, &select_timeout);
+        ok(ret == 0, "expected 0, got %d\n", ret);
+    }
+    ret = send(fdWrite, "x", 1, 0);
+    ok(ret == 1, "send failed: %d\n", WSAGetLastError());
+    select_timeout.tv_usec = 250000;
+    FD_ZERO_ALL();
+    FD_SET(fdRead, &readfds);
+    ret = select(0, &readfds, NULL, NULL, &select_timeout);
+    ok(ret == 1, "expected 1, got %d\n", ret);
+    ok(FD_ISSET(fdRead, &readfds), "fdRead socket is not in the set\n");
+    closesocket(fdRead);
+    closesocket(fdWrite);
+
+    ok(!tcp_socketpair(&fdRead, &fdWrite), "creating socket pair failed\n");
+    FD_ZERO_ALL();
+    FD_SET(fdRead, &readfds);
+    FD_SET(fdWrite, &readfds);
+    ret = select(0, &readfds, NULL, NULL, &select_timeout);
+    ok(ret == 0, "expected 0, got %d\n", ret);
+    closesocket(fdRead);
+    closesocket(fdWrite);
+
+    /* closing a socket that an idle thread selected before must close the connection */
+    ok(!tcp_socketpair(&fdRead, &fdWrite), "creating socket pair failed\n");
+    idle_params.s = fdRead;
+    idle_params.stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+    server_ready = CreateEventA(NULL, TRUE, FALSE, NULL);
+    thread_handle = CreateThread(NULL, 0, SelectIdleThread, &idle_params, 0, &id);
+    ok(thread_handle != NULL, "CreateThread failed unexpectedly: %d\n", GetLastError());
+    WaitForSingleObject(server_ready, INFINITE);
+
+    ret = closesocket(fdRead);
+    ok(!ret, "closesocket failed unexpectedly: %d\n", WSAGetLastError());
+    select_timeout.tv_sec = 1;
+    select_timeout.tv_usec = 0;
+    FD_ZERO_ALL();
+    FD_SET(fdWrite, &readfds);
+    ret = select(0, &readfds, NULL, NULL, &select_timeout);
+    ok(ret == 1, "expected 1, got %d\n", ret);
+    ret = recv(fdWrite, &buffer, 1, 0);
+    ok(!ret, "expected the connection to be closed, got %d\n", ret);
+
+    SetEvent(idle_params.stop);
+    WaitForSingleObject(thread_handle, 1000);
+    CloseHandle(thread_handle);
+    CloseHandle(idle_params.stop);
+    CloseHandle(server_ready);
+    closesocket(fdWrite);
 }
 #undef FD_SET_ALL
 #undef FD_ZERO_ALL
@@ -990,6 +990,8 @@
 
 #define STATUS_WOW_ASSERTION             ((NTSTATUS) 0xC0009898)
 
+#define STATUS_AUTH_TAG_MISMATCH         ((NTSTATUS) 0xC000A002)
+
 #define RPC_NT_INVALID_STRING_BINDING    ((NTSTATUS) 0xC0020001)
 #define RPC_NT_WRONG_KIND_OF_BINDING     ((NTSTATUS) 0xC0020002)
 #define RPC_NT_INVALID_BINDING           ((NTSTATUS) 0xC0020003)
@@ -2355,6 +2355,16 @@ extern struct _TEB * WINAPI NtCurrentTeb(void);
 #endif
 #define GetFiberData()     (*(void **)GetCurrentFiber())
 
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+#define YieldProcessor() __asm__ __volatile__("rep; nop" : : : "memory")
+#elif (defined(__i386__) || defined(__x86_64__)) && defined(_MSC_VER)
+#define YieldProcessor() _mm_pause()
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define YieldProcessor() __asm__ __volatile__("yield" : : : "memory")
+#else
+#define YieldProcessor() do { } while (0)
+#endif
+
 #define TLS_MINIMUM_AVAILABLE 64
 
 /*
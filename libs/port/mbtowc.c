@@ -23,6 +23,28 @@
 #include "wine/unicode.h"
 
 extern unsigned int wine_decompose( WCHAR ch, WCHAR *dst, unsigned int dstlen ) DECLSPEC_HIDDEN;
+extern unsigned int wine_ascii_mbstowcs( const unsigned char *src, unsigned int srclen, WCHAR *dst ) DECLSPEC_HIDDEN;
+
+/* check whether the table maps 7-bit ASCII to itself, in which case ASCII runs */
+/* can be converted in bulk; the answer is remembered for the last tables seen */
+static int is_ascii_table( const WCHAR *cp2uni, const unsigned char *leadbytes )
+{
+    static const WCHAR *ascii_table, *other_table;
+    unsigned int i;
+
+    if (cp2uni == ascii_table) return 1;
+    if (cp2uni == other_table) return 0;
+    for (i = 0; i < 0x80; i++)
+    {
+        if (cp2uni[i] != i || (leadbytes && leadbytes[i]))
+        {
+            other_table = cp2uni;
+            return 0;
+        }
+    }
+    ascii_table = cp2uni;
+    return 1;
+}
 
 /* check the code whether it is in Unicode Private Use Area (PUA). */
 /* MB_ERR_INVALID_CHARS raises an error converting from 1-byte character to PUA. */
@@ -65,6 +87,24 @@ static inline int mbstowcs_sbcs( const struct sbcs_table *table, int flags,
         ret = -1;
     }
 
+    if (srclen >= 16 && is_ascii_table( cp2uni, NULL ))
+    {
+        for (;;)
+        {
+            unsigned int count = wine_ascii_mbstowcs( src, srclen, dst );
+            src += count;
+            dst += count;
+            if (!(srclen -= count)) return ret;
+            /* go through the table until the next ASCII char */
+            do
+            {
+                *dst++ = cp2uni[*src++];
+                srclen--;
+            } while (srclen && *src >= 0x80);
+            if (!srclen) return ret;
+        }
+    }
+
     for (;;)
     {
         switch(srclen)
@@ -127,10 +167,19 @@ static inline int get_length_dbcs( const struct dbcs_table *table,
                                    const unsigned char *src, unsigned int srclen )
 {
     const unsigned char * const cp2uni_lb = table->cp2uni_leadbytes;
+    const int ascii = srclen >= 16 && is_ascii_table( table->cp2uni, cp2uni_lb );
     int len;
 
     for (len = 0; srclen; srclen--, src++, len++)
     {
+        if (ascii && *src < 0x80)
+        {
+            unsigned int count = wine_ascii_mbstowcs( src, srclen, NULL ) - 1;
+            src += count;
+            srclen -= count;
+            len += count;
+            continue;
+        }
         if (cp2uni_lb[*src] && srclen > 1 && src[1])
         {
             src++;
@@ -178,11 +227,23 @@ static inline int mbstowcs_dbcs( const struct dbcs_table *table,
     const unsigned char * const cp2uni_lb = table->cp2uni_leadbytes;
     unsigned int len;
 
+    int ascii;
+
     if (!dstlen) return get_length_dbcs( table, src, srclen );
 
+    ascii = srclen >= 16 && is_ascii_table( cp2uni, cp2uni_lb );
     for (len = dstlen; srclen && len; len--, srclen--, src++, dst++)
     {
         unsigned char off = cp2uni_lb[*src];
+        if (ascii && *src < 0x80)
+        {
+            unsigned int count = wine_ascii_mbstowcs( src, srclen < len ? srclen : len, dst ) - 1;
+            src += count;
+            srclen -= count;
+            dst += count;
+            len -= count;
+            continue;
+        }
         if (off && srclen > 1 && src[1])
         {
             src++;
@@ -22,8 +22,179 @@
 
 #include "wine/unicode.h"
 
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define USE_SIMD
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 extern WCHAR wine_compose( const WCHAR *str ) DECLSPEC_HIDDEN;
 
+/* ASCII runs are converted in bulk, these helpers return the length of the
+ * leading run of 7-bit characters in src, converting it if dst is given */
+extern unsigned int wine_ascii_mbstowcs( const unsigned char *src, unsigned int srclen, WCHAR *dst ) DECLSPEC_HIDDEN;
+extern unsigned int wine_ascii_wcstombs( const WCHAR *src, unsigned int srclen, char *dst ) DECLSPEC_HIDDEN;
+
+#ifdef USE_SIMD
+enum simd_level
+{
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+static enum simd_level get_simd_level(void)
+{
+    static int level = -1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (level == -1)
+    {
+        enum simd_level res = SIMD_NONE;
+
+        if (__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && (edx & bit_SSE2))
+        {
+            res = SIMD_SSE2;
+            /* AVX2 also needs the OS to preserve the ymm registers */
+            if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) && __get_cpuid_max( 0, NULL ) >= 7)
+            {
+                unsigned int xcr0;
+
+                __asm__ __volatile__( ".byte 0x0f,0x01,0xd0" /* xgetbv */
+                                      : "=a" (xcr0), "=d" (edx) : "c" (0) );
+                __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+                if ((ebx & bit_AVX2) && (xcr0 & 6) == 6) res = SIMD_AVX2;
+            }
+        }
+        level = res;
+    }
+    return level;
+}
+
+__attribute__((target("sse2")))
+static unsigned int ascii_mbstowcs_sse2( const unsigned char *src, unsigned int srclen, WCHAR *dst )
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int i;
+
+    for (i = 0; i + 16 <= srclen; i += 16)
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i *)(src + i) );
+        if (_mm_movemask_epi8( v )) break;
+        if (!dst) continue;
+        _mm_storeu_si128( (__m128i *)(dst + i), _mm_unpacklo_epi8( v, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + i + 8), _mm_unpackhi_epi8( v, zero ));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static unsigned int ascii_mbstowcs_avx2( const unsigned char *src, unsigned int srclen, WCHAR *dst )
+{
+    unsigned int i;
+
+    for (i = 0; i + 32 <= srclen; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256( (const __m256i *)(src + i) );
+        if (_mm256_movemask_epi8( v )) break;
+        if (!dst) continue;
+        _mm256_storeu_si256( (__m256i *)(dst + i), _mm256_cvtepu8_epi16( _mm256_castsi256_si128( v )));
+        _mm256_storeu_si256( (__m256i *)(dst + i + 16), _mm256_cvtepu8_epi16( _mm256_extracti128_si256( v, 1 )));
+    }
+    return i;
+}
+
+__attribute__((target("sse2")))
+static unsigned int ascii_wcstombs_sse2( const WCHAR *src, unsigned int srclen, char *dst )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff80 );
+    unsigned int i;
+
+    for (i = 0; i + 16 <= srclen; i += 16)
+    {
+        __m128i lo = _mm_loadu_si128( (const __m128i *)(src + i) );
+        __m128i hi = _mm_loadu_si128( (const __m128i *)(src + i + 8) );
+        __m128i bits = _mm_and_si128( _mm_or_si128( lo, hi ), mask );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( bits, _mm_setzero_si128() )) != 0xffff) break;
+        if (dst) _mm_storeu_si128( (__m128i *)(dst + i), _mm_packus_epi16( lo, hi ));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static unsigned int ascii_wcstombs_avx2( const WCHAR *src, unsigned int srclen, char *dst )
+{
+    const __m256i mask = _mm256_set1_epi16( 0xff80 );
+    unsigned int i;
+
+    for (i = 0; i + 32 <= srclen; i += 32)
+    {
+        __m256i lo = _mm256_loadu_si256( (const __m256i *)(src + i) );
+        __m256i hi = _mm256_loadu_si256( (const __m256i *)(src + i + 16) );
+        if (!_mm256_testz_si256( _mm256_or_si256( lo, hi ), mask )) break;
+        /* packus works within 128-bit lanes, put the quadwords back in order */
+        if (dst) _mm256_storeu_si256( (__m256i *)(dst + i),
+                                      _mm256_permute4x64_epi64( _mm256_packus_epi16( lo, hi ), 0xd8 ));
+    }
+    return i;
+}
+#endif
+
+unsigned int wine_ascii_mbstowcs( const unsigned char *src, unsigned int srclen, WCHAR *dst )
+{
+    unsigned int i = 0;
+
+#ifdef USE_SIMD
+    if (srclen >= 16)
+    {
+        switch (get_simd_level())
+        {
+        case SIMD_AVX2:
+            i = ascii_mbstowcs_avx2( src, srclen, dst );
+            /* fall through */
+        case SIMD_SSE2:
+            i += ascii_mbstowcs_sse2( src + i, srclen - i, dst ? dst + i : NULL );
+            break;
+        case SIMD_NONE:
+            break;
+        }
+    }
+#endif
+    if (dst)
+        for (; i < srclen && src[i] < 0x80; i++) dst[i] = src[i];
+    else
+        while (i < srclen && src[i] < 0x80) i++;
+    return i;
+}
+
+unsigned int wine_ascii_wcstombs( const WCHAR *src, unsigned int srclen, char *dst )
+{
+    unsigned int i = 0;
+
+#ifdef USE_SIMD
+    if (srclen >= 16)
+    {
+        switch (get_simd_level())
+        {
+        case SIMD_AVX2:
+            i = ascii_wcstombs_avx2( src, srclen, dst );
+            /* fall through */
+        case SIMD_SSE2:
+            i += ascii_wcstombs_sse2( src + i, srclen - i, dst ? dst + i : NULL );
+            break;
+        case SIMD_NONE:
+            break;
+        }
+    }
+#endif
+    if (dst)
+        for (; i < srclen && src[i] < 0x80; i++) dst[i] = src[i];
+    else
+        while (i < srclen && src[i] < 0x80) i++;
+    return i;
+}
+
 /* number of following bytes in sequence based on first byte value (for bytes above 0x7f) */
 static const char utf8_length[128] =
 {
@@ -68,7 +239,10 @@ static inline int get_length_wcs_utf8( int flags, const WCHAR *src, unsigned int
     {
         if (*src < 0x80)  /* 0x00-0x7f: 1 byte */
         {
-            len++;
+            unsigned int count = wine_ascii_wcstombs( src, srclen, NULL );
+            len += count;
+            src += count - 1;
+            srclen -= count - 1;
             continue;
         }
         if (*src < 0x800)  /* 0x80-0x7ff: 2 bytes */
@@ -108,8 +282,14 @@ int wine_utf8_wcstombs( int flags, const WCHAR *src, int srclen, char *dst, int
 
         if (ch < 0x80)  /* 0x00-0x7f: 1 byte */
         {
-            if (!len--) return -1;  /* overflow */
-            *dst++ = ch;
+            unsigned int count;
+
+            if (!len) return -1;  /* overflow */
+            count = wine_ascii_wcstombs( src, srclen < len ? srclen : len, dst );
+            len -= count;
+            dst += count;
+            src += count - 1;
+            srclen -= count - 1;
             continue;
         }
 
@@ -285,7 +465,10 @@ static inline int get_length_mbs_utf8( int flags, const char *src, int srclen )
         unsigned char ch = *src++;
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
-            ret++;
+            unsigned int count = wine_ascii_mbstowcs( (const unsigned char *)src - 1,
+                                                      srcend - src + 1, NULL );
+            ret += count;
+            src += count - 1;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0x10ffff)
@@ -316,7 +499,12 @@ int wine_utf8_mbstowcs( int flags, const char *src, int srclen, WCHAR *dst, int
         unsigned char ch = *src++;
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
-            *dst++ = ch;
+            unsigned int count = srcend - src + 1;
+
+            if (count > dstend - dst) count = dstend - dst;
+            count = wine_ascii_mbstowcs( (const unsigned char *)src - 1, count, dst );
+            dst += count;
+            src += count - 1;
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -23,6 +23,32 @@
 #include "wine/unicode.h"
 
 extern WCHAR wine_compose( const WCHAR *str ) DECLSPEC_HIDDEN;
+extern unsigned int wine_ascii_wcstombs( const WCHAR *src, unsigned int srclen, char *dst ) DECLSPEC_HIDDEN;
+
+/* check whether the table maps 7-bit ASCII to itself, in which case ASCII runs */
+/* can be converted in bulk; the answer is remembered for the last tables seen */
+static int is_ascii_table( const union cptable *table )
+{
+    static const union cptable *ascii_table, *other_table;
+    unsigned int i, ch;
+
+    if (table == ascii_table) return 1;
+    if (table == other_table) return 0;
+    for (i = 0; i < 0x80; i++)
+    {
+        if (table->info.char_size == 1)
+            ch = table->sbcs.uni2cp_low[table->sbcs.uni2cp_high[0] + i];
+        else
+            ch = table->dbcs.uni2cp_low[table->dbcs.uni2cp_high[0] + i];
+        if (ch != i)
+        {
+            other_table = table;
+            return 0;
+        }
+    }
+    ascii_table = table;
+    return 1;
+}
 
 /****************************************************************/
 /* sbcs support */
@@ -91,7 +117,7 @@ static int get_length_sbcs( const struct sbcs_table *table, int flags,
 /* wcstombs for single-byte code page */
 static inline int wcstombs_sbcs( const struct sbcs_table *table,
                                  const WCHAR *src, unsigned int srclen,
-                                 char *dst, unsigned int dstlen )
+                                 char *dst, unsigned int dstlen, int ascii )
 {
     const unsigned char  * const uni2cp_low = table->uni2cp_low;
     const unsigned short * const uni2cp_high = table->uni2cp_high;
@@ -104,6 +130,25 @@ static inline int wcstombs_sbcs( const struct sbcs_table *table,
         ret = -1;
     }
 
+    if (ascii)
+    {
+        for (;;)
+        {
+            unsigned int count = wine_ascii_wcstombs( src, srclen, dst );
+            src += count;
+            dst += count;
+            if (!(srclen -= count)) return ret;
+            /* go through the table until the next ASCII char */
+            do
+            {
+                *dst++ = uni2cp_low[uni2cp_high[*src >> 8] + (*src & 0xff)];
+                src++;
+                srclen--;
+            } while (srclen && *src >= 0x80);
+            if (!srclen) return ret;
+        }
+    }
+
     while (srclen >= 16)
     {
         dst[0]  = uni2cp_low[uni2cp_high[src[0]  >> 8] + (src[0]  & 0xff)];
@@ -248,7 +293,7 @@ static inline WCHAR get_defchar_dbcs( const struct dbcs_table *table, const char
 /* query necessary dst length for src string */
 static int get_length_dbcs( const struct dbcs_table *table, int flags,
                             const WCHAR *src, unsigned int srclen,
-                            const char *defchar, int *used )
+                            const char *defchar, int *used, int ascii )
 {
     const unsigned short * const uni2cp_low = table->uni2cp_low;
     const unsigned short * const uni2cp_high = table->uni2cp_high;
@@ -259,6 +304,14 @@ static int get_length_dbcs( const struct dbcs_table *table, int flags,
     {
         for (len = 0; srclen; srclen--, src++, len++)
         {
+            if (ascii && *src < 0x80)
+            {
+                unsigned int count = wine_ascii_wcstombs( src, srclen, NULL ) - 1;
+                src += count;
+                srclen -= count;
+                len += count;
+                continue;
+            }
             if (uni2cp_low[uni2cp_high[*src >> 8] + (*src & 0xff)] & 0xff00) len++;
         }
         return len;
@@ -316,7 +369,7 @@ static int get_length_dbcs( const struct dbcs_table *table, int flags,
 /* wcstombs for double-byte code page */
 static inline int wcstombs_dbcs( const struct dbcs_table *table,
                                  const WCHAR *src, unsigned int srclen,
-                                 char *dst, unsigned int dstlen )
+                                 char *dst, unsigned int dstlen, int ascii )
 {
     const unsigned short * const uni2cp_low = table->uni2cp_low;
     const unsigned short * const uni2cp_high = table->uni2cp_high;
@@ -324,7 +377,18 @@ static inline int wcstombs_dbcs( const struct dbcs_table *table,
 
     for (len = dstlen; srclen && len; len--, srclen--, src++)
     {
-        unsigned short res = uni2cp_low[uni2cp_high[*src >> 8] + (*src & 0xff)];
+        unsigned short res;
+
+        if (ascii && *src < 0x80)
+        {
+            unsigned int count = wine_ascii_wcstombs( src, srclen < len ? srclen : len, dst );
+            src += count - 1;
+            srclen -= count - 1;
+            dst += count;
+            len -= count - 1;
+            continue;
+        }
+        res = uni2cp_low[uni2cp_high[*src >> 8] + (*src & 0xff)];
         if (res & 0xff00)
         {
             if (len == 1) break;  /* do not output a partial char */
@@ -421,14 +485,17 @@ int wine_cp_wcstombs( const union cptable *table, int flags,
                                        dst, dstlen, defchar, used );
         }
         if (!dstlen) return srclen;
-        return wcstombs_sbcs( &table->sbcs, src, srclen, dst, dstlen );
+        return wcstombs_sbcs( &table->sbcs, src, srclen, dst, dstlen,
+                              srclen >= 16 && is_ascii_table( table ));
     }
     else /* mbcs */
     {
-        if (!dstlen) return get_length_dbcs( &table->dbcs, flags, src, srclen, defchar, used );
+        const int ascii = srclen >= 16 && is_ascii_table( table );
+
+        if (!dstlen) return get_length_dbcs( &table->dbcs, flags, src, srclen, defchar, used, ascii );
         if (flags || defchar || used)
             return wcstombs_dbcs_slow( &table->dbcs, flags, src, srclen,
                                        dst, dstlen, defchar, used );
-        return wcstombs_dbcs( &table->dbcs, src, srclen, dst, dstlen );
+        return wcstombs_dbcs( &table->dbcs, src, srclen, dst, dstlen, ascii );
     }
 }
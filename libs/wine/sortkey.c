@@ -19,9 +19,22 @@
  */
 #include "wine/unicode.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 extern unsigned int wine_decompose( WCHAR ch, WCHAR *dst, unsigned int dstlen );
 extern const unsigned int collation_table[];
 
+/* weights of the first 256 chars, those are stored contiguously in the table */
+#define latin1_weights (collation_table + collation_table[0])
+
+static inline unsigned int get_weight( WCHAR ch )
+{
+    if (ch < 0x100) return latin1_weights[ch];
+    return collation_table[collation_table[ch >> 8] + (ch & 0xff)];
+}
+
 /*
  * flags - normalization NORM_* flags
  *
@@ -56,7 +69,7 @@ int wine_get_sortkey(int flags, const WCHAR *src, int srclen, char *dst, int dst
 
                 if (flags & NORM_IGNORECASE) wch = tolowerW(wch);
 
-                ce = collation_table[collation_table[wch >> 8] + (wch & 0xff)];
+                ce = get_weight(wch);
                 if (ce != (unsigned int)-1)
                 {
                     if (ce >> 16) key_len[0] += 2;
@@ -113,7 +126,7 @@ int wine_get_sortkey(int flags, const WCHAR *src, int srclen, char *dst, int dst
 
                 if (flags & NORM_IGNORECASE) wch = tolowerW(wch);
 
-                ce = collation_table[collation_table[wch >> 8] + (wch & 0xff)];
+                ce = get_weight(wch);
                 if (ce != (unsigned int)-1)
                 {
                     WCHAR key;
@@ -206,8 +219,8 @@ static inline int compare_unicode_weights(int flags, const WCHAR *str1, int len1
             }
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
+        ce1 = get_weight(*str1);
+        ce2 = get_weight(*str2);
 
         if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
             ret = (ce1 >> 16) - (ce2 >> 16);
@@ -265,8 +278,8 @@ static inline int compare_diacritic_weights(int flags, const WCHAR *str1, int le
             if (skip) continue;
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
+        ce1 = get_weight(*str1);
+        ce2 = get_weight(*str2);
 
         if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
             ret = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
@@ -324,8 +337,8 @@ static inline int compare_case_weights(int flags, const WCHAR *str1, int len1,
             if (skip) continue;
         }
 
-        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
-        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
+        ce1 = get_weight(*str1);
+        ce2 = get_weight(*str2);
 
         if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
             ret = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
@@ -352,18 +365,84 @@ static inline int compare_case_weights(int flags, const WCHAR *str1, int len1,
     return len1 - len2;
 }
 
+/* length of the common prefix, identical chars compare equal in all the passes */
+static inline int get_common_prefix(const WCHAR *str1, const WCHAR *str2, int len)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    while (i + 8 <= len)
+    {
+        __m128i a, b;
+        unsigned int mask;
+
+        /* the strings may end at a page boundary right after the first difference */
+        if (((UINT_PTR)(str1 + i) & 0xfff) > 0xff0 || ((UINT_PTR)(str2 + i) & 0xfff) > 0xff0)
+        {
+            if (str1[i] != str2[i]) return i;
+            i++;
+            continue;
+        }
+        a = _mm_loadu_si128((const __m128i *)(str1 + i));
+        b = _mm_loadu_si128((const __m128i *)(str2 + i));
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi16(a, b));
+        if (mask != 0xffff) return i + __builtin_ctz(~mask) / 2;
+        i += 8;
+    }
+#endif
+    while (i < len && str1[i] == str2[i]) i++;
+    return i;
+}
+
 int wine_compare_string(int flags, const WCHAR *str1, int len1,
                         const WCHAR *str2, int len2)
 {
-    int ret;
+    int ret, prefix, diacritic = 0, case_diff = 0;
+
+    prefix = get_common_prefix(str1, str2, min(len1, len2));
+    str1 += prefix;
+    str2 += prefix;
+    len1 -= prefix;
+    len2 -= prefix;
+
+    /* As long as no char is skipped, all three passes look at the same chars,
+     * so they can be done at once. The hyphen and apostrophe handling can make
+     * the first pass diverge, in that case finish with the separate passes.
+     */
+    if (!(flags & NORM_IGNORESYMBOLS))
+    {
+        while (len1 > 0 && len2 > 0)
+        {
+            unsigned int ce1, ce2;
+
+            if (!(flags & SORT_STRINGSORT) &&
+                (*str1 == '-' || *str1 == '\'' || *str2 == '-' || *str2 == '\''))
+                break;
+
+            ce1 = get_weight(*str1);
+            ce2 = get_weight(*str2);
+            if (ce1 != (unsigned int)-1 && ce2 != (unsigned int)-1)
+            {
+                if ((ret = (ce1 >> 16) - (ce2 >> 16))) return ret;
+                if (!diacritic) diacritic = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
+                if (!case_diff) case_diff = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
+            }
+            else if ((ret = *str1 - *str2)) return ret;
+
+            str1++;
+            str2++;
+            len1--;
+            len2--;
+        }
+    }
 
     ret = compare_unicode_weights(flags, str1, len1, str2, len2);
     if (!ret)
     {
         if (!(flags & NORM_IGNORENONSPACE))
-            ret = compare_diacritic_weights(flags, str1, len1, str2, len2);
+            ret = diacritic ? diacritic : compare_diacritic_weights(flags, str1, len1, str2, len2);
         if (!ret && !(flags & NORM_IGNORECASE))
-            ret = compare_case_weights(flags, str1, len1, str2, len2);
+            ret = case_diff ? case_diff : compare_case_weights(flags, str1, len1, str2, len2);
     }
     return ret;
 }
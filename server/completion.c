@@ -31,6 +31,8 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -44,11 +46,16 @@
 #include "request.h"
 
 
+#define COMPLETION_QUEUE_MIN_SIZE  16
+#define COMPLETION_QUEUE_KEEP_SIZE  256  /* queues larger than this are freed once empty */
+
 struct completion
 {
-    struct object  obj;
-    struct list    queue;
-    unsigned int   depth;
+    struct object         obj;
+    struct io_completion *queue;  /* ring buffer of queued completions */
+    unsigned int          size;   /* allocated size of the ring buffer */
+    unsigned int          head;   /* index of the oldest queued completion */
+    unsigned int          depth;  /* number of queued completions */
 };
 
 static void completion_dump( struct object*, int );
@@ -79,24 +86,11 @@ static const struct object_ops completion_ops =
     completion_destroy         /* destroy */
 };
 
-struct comp_msg
-{
-    struct   list queue_entry;
-    apc_param_t   ckey;
-    apc_param_t   cvalue;
-    apc_param_t   information;
-    unsigned int  status;
-};
-
 static void completion_destroy( struct object *obj)
 {
     struct completion *completion = (struct completion *) obj;
-    struct comp_msg *tmp, *next;
 
-    LIST_FOR_EACH_ENTRY_SAFE( tmp, next, &completion->queue, struct comp_msg, queue_entry )
-    {
-        free( tmp );
-    }
+    free( completion->queue );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -118,7 +112,7 @@ static int completion_signaled( struct object *obj, struct wait_queue_entry *ent
 {
     struct completion *completion = (struct completion *)obj;
 
-    return !list_empty( &completion->queue );
+    return completion->depth != 0;
 }
 
 static unsigned int completion_map_access( struct object *obj, unsigned int access )
@@ -140,7 +134,9 @@ static struct completion *create_completion( struct object *root, const struct u
     {
         if (get_error() != STATUS_OBJECT_NAME_EXISTS)
         {
-            list_init( &completion->queue );
+            completion->queue = NULL;
+            completion->size  = 0;
+            completion->head  = 0;
             completion->depth = 0;
         }
     }
@@ -153,20 +149,70 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
     return (struct completion *) get_handle_obj( process, handle, access, &completion_ops );
 }
 
+/* double the size of the ring buffer, keeping the queued completions in order */
+static int grow_completion_queue( struct completion *completion )
+{
+    unsigned int new_size = max( completion->size * 2, COMPLETION_QUEUE_MIN_SIZE );
+    struct io_completion *new_queue;
+    unsigned int wrapped;
+
+    if (!(new_queue = realloc( completion->queue, new_size * sizeof(*new_queue) )))
+    {
+        set_error( STATUS_NO_MEMORY );
+        return 0;
+    }
+    /* move the entries that wrapped around to the start of the buffer after the old end */
+    if (completion->head + completion->depth > completion->size)
+    {
+        wrapped = completion->head + completion->depth - completion->size;
+        memcpy( new_queue + completion->size, new_queue, wrapped * sizeof(*new_queue) );
+    }
+    completion->queue = new_queue;
+    completion->size  = new_size;
+    return 1;
+}
+
+/* remove up to count completions from the head of the queue */
+static unsigned int get_completions( struct completion *completion, struct io_completion *comps,
+                                     unsigned int count )
+{
+    unsigned int i, n = min( count, completion->depth );
+
+    for (i = 0; i < n; i++)
+    {
+        comps[i] = completion->queue[completion->head];
+        if (++completion->head == completion->size) completion->head = 0;
+    }
+    completion->depth -= n;
+
+    if (!completion->depth)
+    {
+        completion->head = 0;
+        if (completion->size > COMPLETION_QUEUE_KEEP_SIZE)
+        {
+            free( completion->queue );
+            completion->queue = NULL;
+            completion->size  = 0;
+        }
+    }
+    return n;
+}
+
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct io_completion *comp;
 
-    if (!msg)
+    if (completion->depth == completion->size && !grow_completion_queue( completion ))
         return;
 
-    msg->ckey = ckey;
-    msg->cvalue = cvalue;
-    msg->status = status;
-    msg->information = information;
+    comp = &completion->queue[(completion->head + completion->depth) % completion->size];
+    comp->ckey        = ckey;
+    comp->cvalue      = cvalue;
+    comp->status      = status;
+    comp->information = information;
+    comp->__pad       = 0;
 
-    list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
     wake_up( &completion->obj, 1 );
 }
@@ -217,29 +263,41 @@ DECL_HANDLER(add_completion)
 DECL_HANDLER(remove_completion)
 {
     struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
-    struct list *entry;
-    struct comp_msg *msg;
+    struct io_completion comp;
 
     if (!completion) return;
 
-    entry = list_head( &completion->queue );
-    if (!entry)
+    if (!get_completions( completion, &comp, 1 ))
         set_error( STATUS_PENDING );
     else
     {
-        list_remove( entry );
-        completion->depth--;
-        msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
-        reply->ckey = msg->ckey;
-        reply->cvalue = msg->cvalue;
-        reply->status = msg->status;
-        reply->information = msg->information;
-        free( msg );
+        reply->ckey = comp.ckey;
+        reply->cvalue = comp.cvalue;
+        reply->status = comp.status;
+        reply->information = comp.information;
     }
 
     release_object( completion );
 }
 
+/* get multiple completions from completion port */
+DECL_HANDLER(remove_completions)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    struct io_completion *comps;
+    unsigned int count;
+
+    if (!completion) return;
+
+    count = min( get_reply_max_size() / sizeof(*comps), completion->depth );
+    if (!count)
+        set_error( completion->depth ? STATUS_BUFFER_TOO_SMALL : STATUS_PENDING );
+    else if ((comps = set_reply_data_size( count * sizeof(*comps) )))
+        get_completions( completion, comps, count );
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {